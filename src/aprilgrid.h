@@ -8,11 +8,20 @@ extern "C" {
 #include <assert.h>
 #include <inttypes.h>
 #include <math.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #if ENABLE_APRILGRID_DETECTOR == 1
+#include <dirent.h>
+#include <pthread.h>
+
 #include "apriltag/apriltag.h"
 #include "apriltag/common/image_u8.h"
 #include "apriltag/common/pjpeg.h"
@@ -87,6 +96,10 @@ typedef double real_t;
   } while (0)
 #endif
 
+#ifndef APRILGRID_TRACE_SCOPE
+#define APRILGRID_TRACE_SCOPE(NAME)
+#endif
+
 #ifndef APRILGRID_CHECK
 #define APRILGRID_CHECK(X)                                                     \
   if (!(X)) {                                                                  \
@@ -153,6 +166,93 @@ void aprilgrid_measurements(const aprilgrid_t *grid,
 int aprilgrid_save(const aprilgrid_t *grid, const char *save_path);
 aprilgrid_t *aprilgrid_load(const char *data_path);
 
+// APRILGRID ARCHIVE /////////////////////////////////////////////////////////
+
+/**
+ * AprilGrid archive: all detections of a dataset in one binary file.
+ *
+ * Layout (native byte order, all sections 8-byte aligned):
+ *
+ *   header    aprilgrid_archive_header_t
+ *   frames    [frame header | tag_ids | corner_indices | kps | pts] x N
+ *   index     aprilgrid_archive_entry_t x N, sorted by (timestamp, cam_idx)
+ *
+ * Keypoints and object points are always stored as doubles so that archives
+ * are independent of PRECISION.
+ */
+#define APRILGRID_ARCHIVE_MAGIC "APGRDARC"
+#define APRILGRID_ARCHIVE_VERSION 1
+#define APRILGRID_ARCHIVE_MAX_TAGS 4096
+
+typedef struct aprilgrid_archive_header_t {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_frames;
+  uint64_t index_offset;
+} aprilgrid_archive_header_t;
+
+typedef struct aprilgrid_archive_entry_t {
+  int64_t timestamp;
+  uint64_t offset;
+  int32_t cam_idx;
+  int32_t corners_detected;
+} aprilgrid_archive_entry_t;
+
+typedef struct aprilgrid_archive_frame_t {
+  int64_t timestamp;
+  int32_t cam_idx;
+  int32_t corners_detected;
+  int32_t num_rows;
+  int32_t num_cols;
+  double tag_size;
+  double tag_spacing;
+} aprilgrid_archive_frame_t;
+
+/** Zero-copy view of a single archived frame */
+typedef struct aprilgrid_view_t {
+  const aprilgrid_archive_frame_t *frame;
+  const int32_t *tag_ids;
+  const int32_t *corner_indices;
+  const double *keypoints;
+  const double *object_points;
+} aprilgrid_view_t;
+
+typedef struct aprilgrid_archive_writer_t {
+  FILE *fp;
+  uint64_t offset;
+  aprilgrid_archive_entry_t *index;
+  int num_frames;
+  int capacity;
+} aprilgrid_archive_writer_t;
+
+typedef struct aprilgrid_archive_t {
+  void *data;
+  size_t size;
+  int num_frames;
+  const aprilgrid_archive_entry_t *index;
+} aprilgrid_archive_t;
+
+aprilgrid_archive_writer_t *aprilgrid_archive_writer_malloc(const char *path);
+int aprilgrid_archive_writer_add(aprilgrid_archive_writer_t *writer,
+                                 const int cam_idx,
+                                 const aprilgrid_t *grid);
+int aprilgrid_archive_writer_close(aprilgrid_archive_writer_t *writer);
+int aprilgrid_archive_check(const char *path);
+aprilgrid_archive_t *aprilgrid_archive_load(const char *path);
+void aprilgrid_archive_free(aprilgrid_archive_t *archive);
+int aprilgrid_archive_find(const aprilgrid_archive_t *archive,
+                           const timestamp_t ts,
+                           const int cam_idx);
+aprilgrid_view_t aprilgrid_archive_view(const aprilgrid_archive_t *archive,
+                                        const int frame_idx);
+void aprilgrid_view_measurements(const aprilgrid_view_t *view,
+                                 int *tag_ids,
+                                 int *corner_idxs,
+                                 real_t *tag_kps,
+                                 real_t *obj_pts);
+aprilgrid_t *aprilgrid_archive_grid(const aprilgrid_archive_t *archive,
+                                    const int frame_idx);
+
 // #ifdef __cplusplus
 // #include <opencv2/highgui.hpp>
 // cv::Mat aprilgrid_draw(const aprilgrid_t *grid,
@@ -186,6 +286,90 @@ aprilgrid_t *aprilgrid_detector_detect(const aprilgrid_detector_t *det,
                                        const int32_t image_height,
                                        const int32_t image_stride,
                                        uint8_t *image_data);
+aprilgrid_t *aprilgrid_detector_detect_file(const aprilgrid_detector_t *det,
+                                            const timestamp_t ts,
+                                            const char *image_path);
+
+// APRILGRID BATCH DETECTOR //////////////////////////////////////////////////
+
+/**
+ * Batch detection callback, called in image order from the calling thread.
+ * `grid` is NULL if the image could not be loaded, otherwise the callback
+ * owns it.
+ */
+typedef void (*aprilgrid_batch_callback_t)(void *data,
+                                           const int index,
+                                           aprilgrid_t *grid);
+
+typedef struct aprilgrid_batch_detector_t {
+  int num_threads;
+  aprilgrid_detector_t **dets;
+} aprilgrid_batch_detector_t;
+
+aprilgrid_batch_detector_t *aprilgrid_batch_detector_malloc(int num_threads,
+                                                            int num_rows,
+                                                            int num_cols,
+                                                            real_t tag_size,
+                                                            real_t tag_spacing);
+void aprilgrid_batch_detector_free(aprilgrid_batch_detector_t *bd);
+int aprilgrid_batch_detector_run(aprilgrid_batch_detector_t *bd,
+                                 const int num_images,
+                                 const timestamp_t *timestamps,
+                                 char **image_paths,
+                                 aprilgrid_batch_callback_t callback,
+                                 void *data);
+aprilgrid_t **aprilgrid_batch_detector_detect(aprilgrid_batch_detector_t *bd,
+                                              const int num_images,
+                                              const timestamp_t *timestamps,
+                                              char **image_paths);
+char **aprilgrid_list_images(const char *image_dir,
+                             timestamp_t **timestamps,
+                             int *num_images);
+int aprilgrid_batch_detector_save(aprilgrid_batch_detector_t *bd,
+                                  const char *image_dir,
+                                  const char *save_dir);
+
+// APRILGRID TRACKER /////////////////////////////////////////////////////////
+
+/**
+ * AprilGrid tracker for image sequences. The grid region is predicted from
+ * the previous detection and only that region of interest is searched, a
+ * full-frame search is only done when the grid is lost.
+ */
+typedef struct aprilgrid_tracker_t {
+  aprilgrid_detector_t *det;
+
+  // Settings
+  real_t roi_margin;     // ROI padding relative to the grid bounding box
+  int roi_min_pad;       // Minimum ROI padding [px]
+  real_t roi_decimate;   // Quad decimation used for ROI searches
+  real_t full_decimate;  // Quad decimation used for full-frame searches
+  real_t min_tag_ratio;  // Min ratio of tags re-detected to stay in ROI mode
+
+  // State
+  int ok;
+  int num_tags;
+  real_t bbox[4]; // Predicted grid bounding box (x_min, y_min, x_max, y_max)
+  real_t vel[2];  // Grid center velocity [px / frame]
+  int roi[4];     // Last ROI searched (x, y, width, height)
+  int tracked;    // 1 if last frame was detected from the ROI only
+} aprilgrid_tracker_t;
+
+aprilgrid_tracker_t *aprilgrid_tracker_malloc(int num_rows,
+                                              int num_cols,
+                                              real_t tag_size,
+                                              real_t tag_spacing);
+void aprilgrid_tracker_free(aprilgrid_tracker_t *tracker);
+void aprilgrid_tracker_reset(aprilgrid_tracker_t *tracker);
+void aprilgrid_tracker_predict(aprilgrid_tracker_t *tracker,
+                               const real_t *kps,
+                               const int num_kps);
+aprilgrid_t *aprilgrid_tracker_detect(aprilgrid_tracker_t *tracker,
+                                      const timestamp_t ts,
+                                      const int32_t image_width,
+                                      const int32_t image_height,
+                                      const int32_t image_stride,
+                                      uint8_t *image_data);
 
 #endif // ENABLE_APRILGRID_DETECTOR
 
@@ -723,6 +907,412 @@ aprilgrid_t *aprilgrid_load(const char *data_path) {
   return grid;
 }
 
+// APRILGRID ARCHIVE /////////////////////////////////////////////////////////
+
+/**
+ * Size of an archived frame with `n` corners in bytes.
+ */
+static size_t aprilgrid_archive_frame_size(const int n) {
+  size_t size = sizeof(aprilgrid_archive_frame_t);
+  size += sizeof(int32_t) * n * 2;
+  size += sizeof(double) * n * 5;
+  return size;
+}
+
+/**
+ * Malloc AprilGrid archive writer. Frames are streamed to `path` as they are
+ * added, the index is written when the writer is closed.
+ */
+aprilgrid_archive_writer_t *aprilgrid_archive_writer_malloc(const char *path) {
+  assert(path != NULL);
+
+  FILE *fp = fopen(path, "wb");
+  if (fp == NULL) {
+    APRILGRID_LOG("Failed to open [%s] for saving!\n", path);
+    return NULL;
+  }
+
+  // Write placeholder header, an index offset of 0 marks it as incomplete
+  aprilgrid_archive_header_t header;
+  memset(&header, 0, sizeof(aprilgrid_archive_header_t));
+  memcpy(header.magic, APRILGRID_ARCHIVE_MAGIC, 8);
+  header.version = APRILGRID_ARCHIVE_VERSION;
+  if (fwrite(&header, sizeof(header), 1, fp) != 1) {
+    fclose(fp);
+    return NULL;
+  }
+
+  aprilgrid_archive_writer_t *writer = MALLOC(aprilgrid_archive_writer_t, 1);
+  writer->fp = fp;
+  writer->offset = sizeof(aprilgrid_archive_header_t);
+  writer->index = NULL;
+  writer->num_frames = 0;
+  writer->capacity = 0;
+
+  return writer;
+}
+
+/**
+ * Append AprilGrid detected by camera `cam_idx` to archive.
+ */
+int aprilgrid_archive_writer_add(aprilgrid_archive_writer_t *writer,
+                                 const int cam_idx,
+                                 const aprilgrid_t *grid) {
+  assert(writer != NULL);
+  assert(grid != NULL);
+
+  // Grow index
+  if (writer->num_frames == writer->capacity) {
+    const int capacity = (writer->capacity) ? writer->capacity * 2 : 64;
+    aprilgrid_archive_entry_t *index = NULL;
+    index = REALLOC(writer->index, aprilgrid_archive_entry_t, capacity);
+    if (index == NULL) {
+      return -1;
+    }
+    writer->index = index;
+    writer->capacity = capacity;
+  }
+
+  // Frame header
+  const int n = grid->corners_detected;
+  aprilgrid_archive_frame_t frame;
+  memset(&frame, 0, sizeof(aprilgrid_archive_frame_t));
+  frame.timestamp = grid->timestamp;
+  frame.cam_idx = cam_idx;
+  frame.corners_detected = n;
+  frame.num_rows = grid->num_rows;
+  frame.num_cols = grid->num_cols;
+  frame.tag_size = grid->tag_size;
+  frame.tag_spacing = grid->tag_spacing;
+
+  // Frame data, zeroed so no uninitialized bytes reach the file
+  const size_t data_size = aprilgrid_archive_frame_size(n) - sizeof(frame);
+  uint8_t *buf = CALLOC(uint8_t, data_size + 1);
+  int32_t *tag_ids = (int32_t *) buf;
+  int32_t *corner_indices = tag_ids + n;
+  double *kps = (double *) (corner_indices + n);
+  double *pts = kps + n * 2;
+
+  int meas_idx = 0;
+  for (long i = 0; i < (grid->num_rows * grid->num_cols * 4); i++) {
+    if (grid->data[i * 6 + 0] < 1.0 || meas_idx == n) {
+      continue;
+    }
+    tag_ids[meas_idx] = i / 4;
+    corner_indices[meas_idx] = i % 4;
+    kps[meas_idx * 2 + 0] = grid->data[i * 6 + 1];
+    kps[meas_idx * 2 + 1] = grid->data[i * 6 + 2];
+    pts[meas_idx * 3 + 0] = grid->data[i * 6 + 3];
+    pts[meas_idx * 3 + 1] = grid->data[i * 6 + 4];
+    pts[meas_idx * 3 + 2] = grid->data[i * 6 + 5];
+    meas_idx++;
+  }
+
+  int retval = 0;
+  if (fwrite(&frame, sizeof(frame), 1, writer->fp) != 1) {
+    retval = -1;
+  } else if (data_size && fwrite(buf, data_size, 1, writer->fp) != 1) {
+    retval = -1;
+  }
+  free(buf);
+  if (retval != 0) {
+    APRILGRID_LOG("Failed to write AprilGrid archive frame!\n");
+    return -1;
+  }
+
+  // Update index
+  aprilgrid_archive_entry_t *entry = &writer->index[writer->num_frames];
+  memset(entry, 0, sizeof(aprilgrid_archive_entry_t));
+  entry->timestamp = frame.timestamp;
+  entry->offset = writer->offset;
+  entry->cam_idx = cam_idx;
+  entry->corners_detected = n;
+  writer->offset += sizeof(frame) + data_size;
+  writer->num_frames++;
+
+  return 0;
+}
+
+static int aprilgrid_archive_entry_cmp(const void *a, const void *b) {
+  const aprilgrid_archive_entry_t *e0 = (const aprilgrid_archive_entry_t *) a;
+  const aprilgrid_archive_entry_t *e1 = (const aprilgrid_archive_entry_t *) b;
+  if (e0->timestamp != e1->timestamp) {
+    return (e0->timestamp < e1->timestamp) ? -1 : 1;
+  }
+  if (e0->cam_idx != e1->cam_idx) {
+    return (e0->cam_idx < e1->cam_idx) ? -1 : 1;
+  }
+  return 0;
+}
+
+/**
+ * Write archive index and header, close file and free writer.
+ */
+int aprilgrid_archive_writer_close(aprilgrid_archive_writer_t *writer) {
+  if (writer == NULL) {
+    return -1;
+  }
+
+  // Sort index by (timestamp, cam_idx) for binary search lookups
+  int retval = 0;
+  const int n = writer->num_frames;
+  if (n) {
+    qsort(writer->index,
+          n,
+          sizeof(aprilgrid_archive_entry_t),
+          aprilgrid_archive_entry_cmp);
+    if (fwrite(writer->index, sizeof(*writer->index), n, writer->fp) != n) {
+      retval = -1;
+    }
+  }
+
+  // Finalize header
+  aprilgrid_archive_header_t header;
+  memset(&header, 0, sizeof(aprilgrid_archive_header_t));
+  memcpy(header.magic, APRILGRID_ARCHIVE_MAGIC, 8);
+  header.version = APRILGRID_ARCHIVE_VERSION;
+  header.num_frames = n;
+  header.index_offset = writer->offset;
+  if (fseek(writer->fp, 0, SEEK_SET) != 0) {
+    retval = -1;
+  } else if (fwrite(&header, sizeof(header), 1, writer->fp) != 1) {
+    retval = -1;
+  }
+  if (fclose(writer->fp) != 0) {
+    retval = -1;
+  }
+
+  free(writer->index);
+  free(writer);
+
+  return retval;
+}
+
+/**
+ * Check if file at `path` is an AprilGrid archive.
+ */
+int aprilgrid_archive_check(const char *path) {
+  assert(path != NULL);
+
+  FILE *fp = fopen(path, "rb");
+  if (fp == NULL) {
+    return 0;
+  }
+
+  char magic[8] = {0};
+  const size_t retval = fread(magic, 1, 8, fp);
+  fclose(fp);
+
+  return retval == 8 && memcmp(magic, APRILGRID_ARCHIVE_MAGIC, 8) == 0;
+}
+
+/**
+ * Memory map AprilGrid archive at `path`.
+ */
+aprilgrid_archive_t *aprilgrid_archive_load(const char *path) {
+  assert(path != NULL);
+
+  // Map file
+  const int fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    APRILGRID_LOG("Failed to open [%s]!\n", path);
+    return NULL;
+  }
+  struct stat sb;
+  if (fstat(fd, &sb) == -1 ||
+      (size_t) sb.st_size < sizeof(aprilgrid_archive_header_t)) {
+    APRILGRID_LOG("Invalid AprilGrid archive [%s]!\n", path);
+    close(fd);
+    return NULL;
+  }
+  const size_t size = sb.st_size;
+  void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    APRILGRID_LOG("Failed to mmap [%s]!\n", path);
+    return NULL;
+  }
+
+  // Validate header and index
+  const aprilgrid_archive_header_t *header = data;
+  const uint64_t index_size =
+      (uint64_t) header->num_frames * sizeof(aprilgrid_archive_entry_t);
+  APRILGRID_CHECK(memcmp(header->magic, APRILGRID_ARCHIVE_MAGIC, 8) == 0);
+  APRILGRID_CHECK(header->version == APRILGRID_ARCHIVE_VERSION);
+  APRILGRID_CHECK(header->index_offset >= sizeof(aprilgrid_archive_header_t));
+  APRILGRID_CHECK((header->index_offset & 7) == 0);
+  APRILGRID_CHECK(header->index_offset <= size);
+  APRILGRID_CHECK(index_size <= size - header->index_offset);
+
+  // Validate frames, the frame header must agree with its index entry since
+  // readers take the corner count from either
+  const aprilgrid_archive_entry_t *index =
+      (const aprilgrid_archive_entry_t *) ((uint8_t *) data +
+                                           header->index_offset);
+  for (uint32_t i = 0; i < header->num_frames; i++) {
+    const aprilgrid_archive_entry_t *entry = &index[i];
+    APRILGRID_CHECK(entry->corners_detected >= 0);
+    APRILGRID_CHECK(entry->offset >= sizeof(aprilgrid_archive_header_t));
+    APRILGRID_CHECK((entry->offset & 7) == 0);
+    APRILGRID_CHECK(entry->offset <= header->index_offset);
+
+    const uint64_t frame_size =
+        aprilgrid_archive_frame_size(entry->corners_detected);
+    APRILGRID_CHECK(frame_size <= header->index_offset - entry->offset);
+
+    const aprilgrid_archive_frame_t *frame =
+        (const aprilgrid_archive_frame_t *) ((uint8_t *) data +
+                                             entry->offset);
+    APRILGRID_CHECK(frame->corners_detected == entry->corners_detected);
+
+    // Grid geometry sizes the grid aprilgrid_archive_grid() allocates
+    APRILGRID_CHECK(frame->num_rows > 0 && frame->num_cols > 0);
+    APRILGRID_CHECK(frame->num_rows <= APRILGRID_ARCHIVE_MAX_TAGS);
+    APRILGRID_CHECK(frame->num_cols <= APRILGRID_ARCHIVE_MAX_TAGS);
+    const int64_t num_tags = (int64_t) frame->num_rows * frame->num_cols;
+    APRILGRID_CHECK(num_tags <= APRILGRID_ARCHIVE_MAX_TAGS);
+    APRILGRID_CHECK(frame->corners_detected <= num_tags * 4);
+    APRILGRID_CHECK(isfinite(frame->tag_size) && frame->tag_size > 0);
+    APRILGRID_CHECK(isfinite(frame->tag_spacing) && frame->tag_spacing >= 0);
+  }
+
+  aprilgrid_archive_t *archive = MALLOC(aprilgrid_archive_t, 1);
+  archive->data = data;
+  archive->size = size;
+  archive->num_frames = header->num_frames;
+  archive->index = index;
+
+  return archive;
+error:
+  APRILGRID_LOG("Invalid AprilGrid archive [%s]!\n", path);
+  munmap(data, size);
+  return NULL;
+}
+
+/**
+ * Unmap and free AprilGrid archive.
+ */
+void aprilgrid_archive_free(aprilgrid_archive_t *archive) {
+  if (archive == NULL) {
+    return;
+  }
+  munmap(archive->data, archive->size);
+  free(archive);
+}
+
+/**
+ * Find frame index of camera `cam_idx` at timestamp `ts`, returns -1 if the
+ * archive does not contain it.
+ */
+int aprilgrid_archive_find(const aprilgrid_archive_t *archive,
+                           const timestamp_t ts,
+                           const int cam_idx) {
+  assert(archive != NULL);
+
+  aprilgrid_archive_entry_t key;
+  key.timestamp = ts;
+  key.cam_idx = cam_idx;
+
+  int lo = 0;
+  int hi = archive->num_frames;
+  while (lo < hi) {
+    const int mid = lo + (hi - lo) / 2;
+    if (aprilgrid_archive_entry_cmp(&archive->index[mid], &key) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo < archive->num_frames &&
+      aprilgrid_archive_entry_cmp(&archive->index[lo], &key) == 0) {
+    return lo;
+  }
+
+  return -1;
+}
+
+/**
+ * Return zero-copy view of archived frame `frame_idx`. The view is valid
+ * until the archive is freed.
+ */
+aprilgrid_view_t aprilgrid_archive_view(const aprilgrid_archive_t *archive,
+                                        const int frame_idx) {
+  assert(archive != NULL);
+  assert(frame_idx >= 0 && frame_idx < archive->num_frames);
+
+  const aprilgrid_archive_entry_t *entry = &archive->index[frame_idx];
+  const uint8_t *ptr = (const uint8_t *) archive->data + entry->offset;
+  const int n = entry->corners_detected;
+
+  aprilgrid_view_t view;
+  view.frame = (const aprilgrid_archive_frame_t *) ptr;
+  view.tag_ids = (const int32_t *) (view.frame + 1);
+  view.corner_indices = view.tag_ids + n;
+  view.keypoints = (const double *) (view.corner_indices + n);
+  view.object_points = view.keypoints + n * 2;
+
+  return view;
+}
+
+/**
+ * Copy archived frame measurements, same layout as `aprilgrid_measurements`.
+ */
+void aprilgrid_view_measurements(const aprilgrid_view_t *view,
+                                 int *tag_ids,
+                                 int *corner_idxs,
+                                 real_t *tag_kps,
+                                 real_t *obj_pts) {
+  assert(view != NULL);
+
+  const int n = view->frame->corners_detected;
+  for (int i = 0; i < n; i++) {
+    tag_ids[i] = view->tag_ids[i];
+    corner_idxs[i] = view->corner_indices[i];
+  }
+  for (int i = 0; i < n * 2; i++) {
+    tag_kps[i] = view->keypoints[i];
+  }
+  for (int i = 0; i < n * 3; i++) {
+    obj_pts[i] = view->object_points[i];
+  }
+}
+
+/**
+ * Load archived frame `frame_idx` as an AprilGrid.
+ */
+aprilgrid_t *aprilgrid_archive_grid(const aprilgrid_archive_t *archive,
+                                    const int frame_idx) {
+  assert(archive != NULL);
+
+  const aprilgrid_view_t view = aprilgrid_archive_view(archive, frame_idx);
+  const aprilgrid_archive_frame_t *frame = view.frame;
+  aprilgrid_t *grid = aprilgrid_malloc(frame->num_rows,
+                                       frame->num_cols,
+                                       frame->tag_size,
+                                       frame->tag_spacing);
+  grid->timestamp = frame->timestamp;
+
+  const int num_tags = frame->num_rows * frame->num_cols;
+  for (int i = 0; i < frame->corners_detected; i++) {
+    const int tag_id = view.tag_ids[i];
+    const int corner_idx = view.corner_indices[i];
+    if (tag_id < 0 || tag_id >= num_tags || corner_idx < 0 ||
+        corner_idx > 3) {
+      continue;
+    }
+    const int data_row = tag_id * 4 + corner_idx;
+    grid->corners_detected++;
+    grid->data[data_row * 6 + 0] = 1;
+    grid->data[data_row * 6 + 1] = view.keypoints[i * 2 + 0];
+    grid->data[data_row * 6 + 2] = view.keypoints[i * 2 + 1];
+    grid->data[data_row * 6 + 3] = view.object_points[i * 3 + 0];
+    grid->data[data_row * 6 + 4] = view.object_points[i * 3 + 1];
+    grid->data[data_row * 6 + 5] = view.object_points[i * 3 + 2];
+  }
+
+  return grid;
+}
+
 // APRILGRID DETECTOR ////////////////////////////////////////////////////////
 
 #if ENABLE_APRILGRID_DETECTOR == 1
@@ -754,6 +1344,53 @@ void aprilgrid_detector_free(aprilgrid_detector_t *det) {
   det = NULL;
 }
 
+/**
+ * Detect AprilTags in the `roi_width` x `roi_height` region at (`roi_x`,
+ * `roi_y`) and add them to `grid` in full image coordinates. The region is
+ * searched in place, no pixels are copied.
+ * @returns Number of tags detected
+ */
+static int aprilgrid_detector_detect_roi(const aprilgrid_detector_t *det,
+                                         aprilgrid_t *grid,
+                                         const int32_t roi_x,
+                                         const int32_t roi_y,
+                                         const int32_t roi_width,
+                                         const int32_t roi_height,
+                                         const int32_t image_stride,
+                                         uint8_t *image_data) {
+  // Form image_u8_t
+  image_u8_t im = {.width = roi_width,
+                   .height = roi_height,
+                   .stride = image_stride,
+                   .buf = image_data + roi_y * image_stride + roi_x};
+
+  // Detect AprilTags
+  const int num_tags = det->num_rows * det->num_cols;
+  zarray_t *dets = apriltag_detector_detect(det->td, &im);
+  int tags_detected = 0;
+  for (int i = 0; i < zarray_size(dets); i++) {
+    apriltag_detection_t *det;
+    zarray_get(dets, i, &det);
+    if (det->id < 0 || det->id >= num_tags) {
+      continue;
+    }
+
+    const real_t p0[2] = {det->p[0][0] + roi_x, det->p[0][1] + roi_y};
+    const real_t p1[2] = {det->p[1][0] + roi_x, det->p[1][1] + roi_y};
+    const real_t p2[2] = {det->p[2][0] + roi_x, det->p[2][1] + roi_y};
+    const real_t p3[2] = {det->p[3][0] + roi_x, det->p[3][1] + roi_y};
+
+    aprilgrid_add_corner(grid, det->id, 0, p0);
+    aprilgrid_add_corner(grid, det->id, 1, p1);
+    aprilgrid_add_corner(grid, det->id, 2, p2);
+    aprilgrid_add_corner(grid, det->id, 3, p3);
+    tags_detected++;
+  }
+  apriltag_detections_destroy(dets);
+
+  return tags_detected;
+}
+
 aprilgrid_t *aprilgrid_detector_detect(const aprilgrid_detector_t *det,
                                        const timestamp_t ts,
                                        const int32_t image_width,
@@ -765,12 +1402,7 @@ aprilgrid_t *aprilgrid_detector_detect(const aprilgrid_detector_t *det,
   assert(image_height > 0);
   assert(image_stride > 0);
   assert(image_data != NULL);
-
-  // Form image_u8_t
-  image_u8_t im = {.width = image_width,
-                   .height = image_height,
-                   .stride = image_stride,
-                   .buf = image_data};
+  APRILGRID_TRACE_SCOPE("aprilgrid_detector_detect");
 
   // Detect AprilTags
   aprilgrid_t *grid = aprilgrid_malloc(det->num_rows,
@@ -778,33 +1410,634 @@ aprilgrid_t *aprilgrid_detector_detect(const aprilgrid_detector_t *det,
                                        det->tag_size,
                                        det->tag_spacing);
   grid->timestamp = ts;
-  zarray_t *dets = apriltag_detector_detect(det->td, &im);
-  // int num_corners = 0;
-  for (int i = 0; i < zarray_size(dets); i++) {
-    apriltag_detection_t *det;
-    zarray_get(dets, i, &det);
+  aprilgrid_detector_detect_roi(det,
+                                grid,
+                                0,
+                                0,
+                                image_width,
+                                image_height,
+                                image_stride,
+                                image_data);
 
-    const real_t p0[2] = {det->p[0][0], det->p[0][1]};
-    const real_t p1[2] = {det->p[1][0], det->p[1][1]};
-    const real_t p2[2] = {det->p[2][0], det->p[2][1]};
-    const real_t p3[2] = {det->p[3][0], det->p[3][1]};
+  return grid;
+}
 
-    aprilgrid_add_corner(grid, det->id, 0, p0);
-    aprilgrid_add_corner(grid, det->id, 1, p1);
-    aprilgrid_add_corner(grid, det->id, 2, p2);
-    aprilgrid_add_corner(grid, det->id, 3, p3);
-    // num_corners += 4;
+/**
+ * Load image at `image_path` as a single channel 8-bit image. Uses
+ * stb_image if it was included before this header, otherwise JPEG and PNM
+ * files are supported through apriltag.
+ */
+static image_u8_t *aprilgrid_image_load(const char *image_path) {
+#ifdef STBI_INCLUDE_STB_IMAGE_H
+  int w = 0;
+  int h = 0;
+  int c = 0;
+  uint8_t *data = stbi_load(image_path, &w, &h, &c, 1);
+  if (data == NULL) {
+    return NULL;
   }
-  apriltag_detections_destroy(dets);
+  image_u8_t *im = image_u8_create(w, h);
+  for (int y = 0; y < h; y++) {
+    memcpy(&im->buf[y * im->stride], &data[y * w], w);
+  }
+  stbi_image_free(data);
+  return im;
+#else
+  const char *ext = strrchr(image_path, '.');
+  if (ext && (strcmp(ext, ".jpg") == 0 || strcmp(ext, ".jpeg") == 0)) {
+    int err = 0;
+    pjpeg_t *pjpeg = pjpeg_create_from_file(image_path, 0, &err);
+    if (pjpeg == NULL) {
+      return NULL;
+    }
+    image_u8_t *im = pjpeg_to_u8_baseline(pjpeg);
+    pjpeg_destroy(pjpeg);
+    return im;
+  }
+  return image_u8_create_from_pnm(image_path);
+#endif
+}
 
-  // // Return NULL if no apriltag detected
-  // if (num_corners == 0) {
-  //   aprilgrid_free(grid);
-  //   return NULL;
-  // }
+/**
+ * Detect AprilGrid in image file at `image_path`.
+ * @returns AprilGrid or NULL if the image failed to load
+ */
+aprilgrid_t *aprilgrid_detector_detect_file(const aprilgrid_detector_t *det,
+                                            const timestamp_t ts,
+                                            const char *image_path) {
+  assert(det != NULL);
+  assert(image_path != NULL);
+
+  image_u8_t *im = aprilgrid_image_load(image_path);
+  if (im == NULL) {
+    APRILGRID_LOG("Failed to load image [%s]!\n", image_path);
+    return NULL;
+  }
+
+  aprilgrid_t *grid = aprilgrid_detector_detect(det,
+                                                ts,
+                                                im->width,
+                                                im->height,
+                                                im->stride,
+                                                im->buf);
+  image_u8_destroy(im);
 
   return grid;
 }
+
+// APRILGRID BATCH DETECTOR //////////////////////////////////////////////////
+
+/**
+ * Malloc AprilGrid batch detector with a pool of `num_threads` detectors, one
+ * per worker thread. If `num_threads` <= 0 the number of online CPUs is used.
+ */
+aprilgrid_batch_detector_t *
+aprilgrid_batch_detector_malloc(int num_threads,
+                                int num_rows,
+                                int num_cols,
+                                real_t tag_size,
+                                real_t tag_spacing) {
+  if (num_threads <= 0) {
+    num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    num_threads = (num_threads > 0) ? num_threads : 1;
+  }
+
+  aprilgrid_batch_detector_t *bd = MALLOC(aprilgrid_batch_detector_t, 1);
+  bd->num_threads = num_threads;
+  bd->dets = MALLOC(aprilgrid_detector_t *, num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    bd->dets[i] =
+        aprilgrid_detector_malloc(num_rows, num_cols, tag_size, tag_spacing);
+    // Parallelism is across images, not within the detector
+    bd->dets[i]->td->nthreads = 1;
+  }
+
+  return bd;
+}
+
+/**
+ * Free AprilGrid batch detector.
+ */
+void aprilgrid_batch_detector_free(aprilgrid_batch_detector_t *bd) {
+  assert(bd != NULL);
+  for (int i = 0; i < bd->num_threads; i++) {
+    aprilgrid_detector_free(bd->dets[i]);
+  }
+  free(bd->dets);
+  free(bd);
+}
+
+typedef struct aprilgrid_batch_state_t {
+  aprilgrid_batch_detector_t *bd;
+  int num_images;
+  const timestamp_t *timestamps;
+  char **image_paths;
+
+  aprilgrid_t **grids;
+  int *done;
+  int next_job;
+  int next_deliver;
+  int window;
+
+  pthread_mutex_t mutex;
+  pthread_cond_t job_cond;
+  pthread_cond_t done_cond;
+} aprilgrid_batch_state_t;
+
+typedef struct aprilgrid_batch_worker_t {
+  aprilgrid_batch_state_t *state;
+  const aprilgrid_detector_t *det;
+} aprilgrid_batch_worker_t;
+
+static void *aprilgrid_batch_worker(void *arg) {
+  aprilgrid_batch_worker_t *worker = (aprilgrid_batch_worker_t *) arg;
+  aprilgrid_batch_state_t *state = worker->state;
+
+  while (1) {
+    // Claim next image, without running too far ahead of the consumer
+    pthread_mutex_lock(&state->mutex);
+    while (state->next_job < state->num_images &&
+           state->next_job >= state->next_deliver + state->window) {
+      pthread_cond_wait(&state->job_cond, &state->mutex);
+    }
+    if (state->next_job >= state->num_images) {
+      pthread_mutex_unlock(&state->mutex);
+      break;
+    }
+    const int idx = state->next_job++;
+    pthread_mutex_unlock(&state->mutex);
+
+    // Detect
+    const timestamp_t ts = state->timestamps[idx];
+    const char *path = state->image_paths[idx];
+    aprilgrid_t *grid = aprilgrid_detector_detect_file(worker->det, ts, path);
+
+    // Publish result
+    pthread_mutex_lock(&state->mutex);
+    state->grids[idx] = grid;
+    state->done[idx] = 1;
+    pthread_cond_broadcast(&state->done_cond);
+    pthread_mutex_unlock(&state->mutex);
+  }
+
+  return NULL;
+}
+
+/**
+ * Detect AprilGrids in `num_images` images in parallel. Results are passed
+ * to `callback` on the calling thread in the same order as `image_paths`,
+ * and at most a few images per thread are kept in flight.
+ * @returns 0 for success, -1 for failure
+ */
+int aprilgrid_batch_detector_run(aprilgrid_batch_detector_t *bd,
+                                 const int num_images,
+                                 const timestamp_t *timestamps,
+                                 char **image_paths,
+                                 aprilgrid_batch_callback_t callback,
+                                 void *data) {
+  assert(bd != NULL);
+  assert(timestamps != NULL || num_images == 0);
+  assert(image_paths != NULL || num_images == 0);
+  assert(callback != NULL);
+  if (num_images <= 0) {
+    return 0;
+  }
+
+  // Setup
+  aprilgrid_batch_state_t state;
+  state.bd = bd;
+  state.num_images = num_images;
+  state.timestamps = timestamps;
+  state.image_paths = image_paths;
+  state.grids = CALLOC(aprilgrid_t *, num_images);
+  state.done = CALLOC(int, num_images);
+  state.next_job = 0;
+  state.next_deliver = 0;
+  state.window = bd->num_threads * 4;
+  pthread_mutex_init(&state.mutex, NULL);
+  pthread_cond_init(&state.job_cond, NULL);
+  pthread_cond_init(&state.done_cond, NULL);
+
+  // Start workers
+  const int num_threads = bd->num_threads;
+  pthread_t *threads = MALLOC(pthread_t, num_threads);
+  aprilgrid_batch_worker_t *workers =
+      MALLOC(aprilgrid_batch_worker_t, num_threads);
+  int num_started = 0;
+  for (int i = 0; i < num_threads; i++) {
+    workers[i].state = &state;
+    workers[i].det = bd->dets[i];
+    void *arg = &workers[i];
+    if (pthread_create(&threads[i], NULL, aprilgrid_batch_worker, arg) != 0) {
+      APRILGRID_LOG("Failed to create detector thread!\n");
+      break;
+    }
+    num_started++;
+  }
+
+  // Deliver results in order
+  int retval = (num_started > 0) ? 0 : -1;
+  for (int i = 0; i < num_images && num_started > 0; i++) {
+    pthread_mutex_lock(&state.mutex);
+    while (state.done[i] == 0) {
+      pthread_cond_wait(&state.done_cond, &state.mutex);
+    }
+    aprilgrid_t *grid = state.grids[i];
+    state.next_deliver = i + 1;
+    pthread_cond_broadcast(&state.job_cond);
+    pthread_mutex_unlock(&state.mutex);
+
+    callback(data, i, grid);
+  }
+
+  // Clean up
+  for (int i = 0; i < num_started; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  pthread_mutex_destroy(&state.mutex);
+  pthread_cond_destroy(&state.job_cond);
+  pthread_cond_destroy(&state.done_cond);
+  free(threads);
+  free(workers);
+  free(state.grids);
+  free(state.done);
+
+  return retval;
+}
+
+static void aprilgrid_batch_collect(void *data,
+                                    const int index,
+                                    aprilgrid_t *grid) {
+  aprilgrid_t **grids = (aprilgrid_t **) data;
+  grids[index] = grid;
+}
+
+/**
+ * Detect AprilGrids in `num_images` images in parallel.
+ * @returns Array of `num_images` AprilGrids in input order, entries are NULL
+ * for images that failed to load
+ */
+aprilgrid_t **aprilgrid_batch_detector_detect(aprilgrid_batch_detector_t *bd,
+                                              const int num_images,
+                                              const timestamp_t *timestamps,
+                                              char **image_paths) {
+  aprilgrid_t **grids = CALLOC(aprilgrid_t *, num_images);
+  aprilgrid_batch_detector_run(bd,
+                               num_images,
+                               timestamps,
+                               image_paths,
+                               aprilgrid_batch_collect,
+                               grids);
+  return grids;
+}
+
+static int aprilgrid_image_filter(const struct dirent *entry) {
+  const char *ext = strrchr(entry->d_name, '.');
+  if (ext == NULL) {
+    return 0;
+  }
+  const char *exts[5] = {".png", ".jpg", ".jpeg", ".pgm", ".pnm"};
+  for (int i = 0; i < 5; i++) {
+    if (strcmp(ext, exts[i]) == 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * List images in `image_dir` sorted by name. The timestamp of each image is
+ * parsed from its file name, e.g. `1403715273262142976.png`.
+ * @returns Heap allocated image paths, free each path and the array
+ */
+char **aprilgrid_list_images(const char *image_dir,
+                             timestamp_t **timestamps,
+                             int *num_images) {
+  assert(image_dir != NULL);
+  assert(timestamps != NULL);
+  assert(num_images != NULL);
+
+  struct dirent **namelist = NULL;
+  const int n =
+      scandir(image_dir, &namelist, aprilgrid_image_filter, alphasort);
+  *num_images = 0;
+  *timestamps = NULL;
+  if (n <= 0) {
+    free(namelist);
+    return NULL;
+  }
+
+  char **paths = MALLOC(char *, n);
+  *timestamps = MALLOC(timestamp_t, n);
+  for (int i = 0; i < n; i++) {
+    const char *name = namelist[i]->d_name;
+    const size_t len = strlen(image_dir) + strlen(name) + 2;
+    paths[i] = MALLOC(char, len);
+    snprintf(paths[i], len, "%s/%s", image_dir, name);
+    (*timestamps)[i] = strtoll(name, NULL, 10);
+    free(namelist[i]);
+  }
+  free(namelist);
+  *num_images = n;
+
+  return paths;
+}
+
+typedef struct aprilgrid_batch_save_t {
+  const char *save_dir;
+  int retval;
+} aprilgrid_batch_save_t;
+
+static void aprilgrid_batch_save(void *data,
+                                 const int index,
+                                 aprilgrid_t *grid) {
+  APRILGRID_UNUSED(index);
+  if (grid == NULL) {
+    return;
+  }
+
+  aprilgrid_batch_save_t *save = (aprilgrid_batch_save_t *) data;
+  char save_path[1024] = {0};
+  snprintf(save_path,
+           sizeof(save_path),
+           "%s/%" PRId64 ".csv",
+           save->save_dir,
+           (int64_t) grid->timestamp);
+  if (aprilgrid_save(grid, save_path) != 0) {
+    save->retval = -1;
+  }
+  aprilgrid_free(grid);
+}
+
+/**
+ * Detect AprilGrids in every image of `image_dir` in parallel and save each
+ * detection to `save_dir/<timestamp>.csv` with `aprilgrid_save()`. Saving
+ * carries on past a failed save.
+ * @returns 0 for success, -1 if detection or any save failed
+ */
+int aprilgrid_batch_detector_save(aprilgrid_batch_detector_t *bd,
+                                  const char *image_dir,
+                                  const char *save_dir) {
+  assert(bd != NULL);
+  assert(image_dir != NULL);
+  assert(save_dir != NULL);
+
+  int num_images = 0;
+  timestamp_t *timestamps = NULL;
+  char **paths = aprilgrid_list_images(image_dir, &timestamps, &num_images);
+  if (num_images == 0) {
+    APRILGRID_LOG("No images found in [%s]!\n", image_dir);
+    return -1;
+  }
+
+  aprilgrid_batch_save_t save = {save_dir, 0};
+  int retval = aprilgrid_batch_detector_run(bd,
+                                            num_images,
+                                            timestamps,
+                                            paths,
+                                            aprilgrid_batch_save,
+                                            &save);
+  if (save.retval != 0) {
+    retval = -1;
+  }
+
+  for (int i = 0; i < num_images; i++) {
+    free(paths[i]);
+  }
+  free(paths);
+  free(timestamps);
+
+  return retval;
+}
+
+// APRILGRID TRACKER /////////////////////////////////////////////////////////
+
+/**
+ * Malloc AprilGrid tracker.
+ */
+aprilgrid_tracker_t *aprilgrid_tracker_malloc(int num_rows,
+                                              int num_cols,
+                                              real_t tag_size,
+                                              real_t tag_spacing) {
+  aprilgrid_tracker_t *tracker = MALLOC(aprilgrid_tracker_t, 1);
+  tracker->det =
+      aprilgrid_detector_malloc(num_rows, num_cols, tag_size, tag_spacing);
+
+  tracker->roi_margin = 0.25;
+  tracker->roi_min_pad = 32;
+  tracker->roi_decimate = tracker->det->td->quad_decimate;
+  tracker->full_decimate = tracker->det->td->quad_decimate;
+  tracker->min_tag_ratio = 0.5;
+  aprilgrid_tracker_reset(tracker);
+
+  return tracker;
+}
+
+/**
+ * Free AprilGrid tracker.
+ */
+void aprilgrid_tracker_free(aprilgrid_tracker_t *tracker) {
+  assert(tracker != NULL);
+  aprilgrid_detector_free(tracker->det);
+  free(tracker);
+}
+
+/**
+ * Reset AprilGrid tracker, the next frame will be searched in full.
+ */
+void aprilgrid_tracker_reset(aprilgrid_tracker_t *tracker) {
+  assert(tracker != NULL);
+  tracker->ok = 0;
+  tracker->num_tags = 0;
+  tracker->bbox[0] = 0;
+  tracker->bbox[1] = 0;
+  tracker->bbox[2] = 0;
+  tracker->bbox[3] = 0;
+  tracker->vel[0] = 0;
+  tracker->vel[1] = 0;
+  tracker->roi[0] = 0;
+  tracker->roi[1] = 0;
+  tracker->roi[2] = 0;
+  tracker->roi[3] = 0;
+  tracker->tracked = 0;
+}
+
+static void aprilgrid_kps_bbox(const real_t *kps,
+                               const int num_kps,
+                               real_t bbox[4]) {
+  bbox[0] = kps[0];
+  bbox[1] = kps[1];
+  bbox[2] = kps[0];
+  bbox[3] = kps[1];
+  for (int i = 1; i < num_kps; i++) {
+    const real_t x = kps[i * 2 + 0];
+    const real_t y = kps[i * 2 + 1];
+    bbox[0] = (x < bbox[0]) ? x : bbox[0];
+    bbox[1] = (y < bbox[1]) ? y : bbox[1];
+    bbox[2] = (x > bbox[2]) ? x : bbox[2];
+    bbox[3] = (y > bbox[3]) ? y : bbox[3];
+  }
+}
+
+/**
+ * Bounding box of the detected corners in `grid`. Returns 0 for success or -1
+ * if no corners were detected.
+ */
+static int aprilgrid_grid_bbox(const aprilgrid_t *grid, real_t bbox[4]) {
+  int num_corners = 0;
+  for (long i = 0; i < (grid->num_rows * grid->num_cols * 4); i++) {
+    if (grid->data[i * 6 + 0] < 1.0) {
+      continue;
+    }
+
+    const real_t x = grid->data[i * 6 + 1];
+    const real_t y = grid->data[i * 6 + 2];
+    if (num_corners++ == 0) {
+      bbox[0] = x;
+      bbox[1] = y;
+      bbox[2] = x;
+      bbox[3] = y;
+      continue;
+    }
+    bbox[0] = (x < bbox[0]) ? x : bbox[0];
+    bbox[1] = (y < bbox[1]) ? y : bbox[1];
+    bbox[2] = (x > bbox[2]) ? x : bbox[2];
+    bbox[3] = (y > bbox[3]) ? y : bbox[3];
+  }
+
+  return (num_corners > 0) ? 0 : -1;
+}
+
+/**
+ * Override the predicted grid region with keypoints `kps` (`num_kps` x 2),
+ * e.g. the grid's outer corners projected with the last camera pose from
+ * `solvepnp_camera()` and a motion model.
+ */
+void aprilgrid_tracker_predict(aprilgrid_tracker_t *tracker,
+                               const real_t *kps,
+                               const int num_kps) {
+  assert(tracker != NULL);
+  assert(kps != NULL);
+  if (num_kps <= 0 || tracker->ok == 0) {
+    return;
+  }
+
+  aprilgrid_kps_bbox(kps, num_kps, tracker->bbox);
+  tracker->vel[0] = 0;
+  tracker->vel[1] = 0;
+}
+
+/**
+ * Track AprilGrid. Only the region predicted from the previous detection is
+ * searched, the full image is searched if there is no previous detection or
+ * if fewer than `min_tag_ratio` of the previous tags are found in the ROI.
+ */
+aprilgrid_t *aprilgrid_tracker_detect(aprilgrid_tracker_t *tracker,
+                                      const timestamp_t ts,
+                                      const int32_t image_width,
+                                      const int32_t image_height,
+                                      const int32_t image_stride,
+                                      uint8_t *image_data) {
+  assert(tracker != NULL);
+  assert(image_width > 0);
+  assert(image_height > 0);
+  assert(image_stride > 0);
+  assert(image_data != NULL);
+
+  const aprilgrid_detector_t *det = tracker->det;
+  aprilgrid_t *grid = aprilgrid_malloc(det->num_rows,
+                                       det->num_cols,
+                                       det->tag_size,
+                                       det->tag_spacing);
+  grid->timestamp = ts;
+
+  // Search predicted region of interest
+  int num_tags = 0;
+  tracker->tracked = 0;
+  if (tracker->ok) {
+    // Predict ROI with a constant velocity model
+    const real_t bw = tracker->bbox[2] - tracker->bbox[0];
+    const real_t bh = tracker->bbox[3] - tracker->bbox[1];
+    const real_t pad_x = tracker->roi_margin * bw + tracker->roi_min_pad;
+    const real_t pad_y = tracker->roi_margin * bh + tracker->roi_min_pad;
+    int x0 = floor(tracker->bbox[0] + tracker->vel[0] - pad_x);
+    int y0 = floor(tracker->bbox[1] + tracker->vel[1] - pad_y);
+    int x1 = ceil(tracker->bbox[2] + tracker->vel[0] + pad_x);
+    int y1 = ceil(tracker->bbox[3] + tracker->vel[1] + pad_y);
+    x0 = (x0 < 0) ? 0 : x0;
+    y0 = (y0 < 0) ? 0 : y0;
+    x1 = (x1 > image_width) ? image_width : x1;
+    y1 = (y1 > image_height) ? image_height : y1;
+
+    if (x1 - x0 > 0 && y1 - y0 > 0) {
+      tracker->roi[0] = x0;
+      tracker->roi[1] = y0;
+      tracker->roi[2] = x1 - x0;
+      tracker->roi[3] = y1 - y0;
+      det->td->quad_decimate = tracker->roi_decimate;
+      num_tags = aprilgrid_detector_detect_roi(det,
+                                               grid,
+                                               x0,
+                                               y0,
+                                               x1 - x0,
+                                               y1 - y0,
+                                               image_stride,
+                                               image_data);
+    }
+
+    // Lost track, fall back to full-frame search
+    if (num_tags < tracker->min_tag_ratio * tracker->num_tags) {
+      aprilgrid_clear(grid);
+      num_tags = 0;
+      grid->timestamp = ts;
+    } else {
+      tracker->tracked = 1;
+    }
+  }
+
+  // Search full image
+  if (tracker->tracked == 0) {
+    tracker->roi[0] = 0;
+    tracker->roi[1] = 0;
+    tracker->roi[2] = image_width;
+    tracker->roi[3] = image_height;
+    det->td->quad_decimate = tracker->full_decimate;
+    num_tags = aprilgrid_detector_detect_roi(det,
+                                             grid,
+                                             0,
+                                             0,
+                                             image_width,
+                                             image_height,
+                                             image_stride,
+                                             image_data);
+  }
+
+  // Update track
+  real_t bbox[4] = {0};
+  if (num_tags == 0 || aprilgrid_grid_bbox(grid, bbox) != 0) {
+    aprilgrid_tracker_reset(tracker);
+    return grid;
+  }
+
+  if (tracker->ok && tracker->tracked) {
+    tracker->vel[0] = 0.5 * (bbox[0] + bbox[2] - tracker->bbox[0] -
+                             tracker->bbox[2]);
+    tracker->vel[1] = 0.5 * (bbox[1] + bbox[3] - tracker->bbox[1] -
+                             tracker->bbox[3]);
+  } else {
+    tracker->vel[0] = 0;
+    tracker->vel[1] = 0;
+  }
+  tracker->bbox[0] = bbox[0];
+  tracker->bbox[1] = bbox[1];
+  tracker->bbox[2] = bbox[2];
+  tracker->bbox[3] = bbox[3];
+  tracker->num_tags = num_tags;
+  tracker->ok = 1;
+
+  return grid;
+}
+
 #endif // ENABLE_APRILGRID_DETECTOR
 
 // #ifdef __cplusplus
@@ -1174,6 +2407,110 @@ int test_aprilgrid_save_and_load() {
   return 0;
 }
 
+int test_aprilgrid_archive() {
+  // Setup
+  const int num_rows = 6;
+  const int num_cols = 6;
+  const real_t tag_size = 0.088;
+  const real_t tag_spacing = 0.3;
+  const int num_frames = 10;
+  const int num_cams = 2;
+  const char *archive_path = "/tmp/test_aprilgrid_archive.bin";
+
+  // Write archive, frames are added out of order on purpose
+  aprilgrid_archive_writer_t *writer =
+      aprilgrid_archive_writer_malloc(archive_path);
+  TEST_ASSERT(writer != NULL);
+  for (int k = num_frames - 1; k >= 0; k--) {
+    for (int cam_idx = 0; cam_idx < num_cams; cam_idx++) {
+      aprilgrid_t *grid =
+          aprilgrid_malloc(num_rows, num_cols, tag_size, tag_spacing);
+      grid->timestamp = k * 100;
+      for (int tag_id = 0; tag_id < k; tag_id++) {
+        const real_t kps[4][2] = {{tag_id, k},
+                                  {tag_id + 1, k},
+                                  {tag_id + 1, k + cam_idx},
+                                  {tag_id, k + cam_idx}};
+        aprilgrid_add_tag(grid, tag_id, kps);
+      }
+      TEST_ASSERT(aprilgrid_archive_writer_add(writer, cam_idx, grid) == 0);
+      aprilgrid_free(grid);
+    }
+  }
+  TEST_ASSERT(aprilgrid_archive_writer_close(writer) == 0);
+  TEST_ASSERT(aprilgrid_archive_check(archive_path) == 1);
+  TEST_ASSERT(aprilgrid_archive_check("/tmp/test_aprilgrid.dat") == 0);
+
+  // Load archive
+  aprilgrid_archive_t *archive = aprilgrid_archive_load(archive_path);
+  TEST_ASSERT(archive != NULL);
+  TEST_ASSERT(archive->num_frames == num_frames * num_cams);
+  TEST_ASSERT(aprilgrid_archive_find(archive, 123, 0) == -1);
+  TEST_ASSERT(aprilgrid_archive_find(archive, 100, 2) == -1);
+
+  for (int k = 0; k < num_frames; k++) {
+    for (int cam_idx = 0; cam_idx < num_cams; cam_idx++) {
+      const int frame_idx = aprilgrid_archive_find(archive, k * 100, cam_idx);
+      TEST_ASSERT(frame_idx == k * num_cams + cam_idx);
+
+      // Zero-copy view
+      const aprilgrid_view_t view = aprilgrid_archive_view(archive, frame_idx);
+      TEST_ASSERT(view.frame->timestamp == k * 100);
+      TEST_ASSERT(view.frame->cam_idx == cam_idx);
+      TEST_ASSERT(view.frame->corners_detected == k * 4);
+
+      // Compare against original AprilGrid
+      aprilgrid_t *expected =
+          aprilgrid_malloc(num_rows, num_cols, tag_size, tag_spacing);
+      expected->timestamp = k * 100;
+      for (int tag_id = 0; tag_id < k; tag_id++) {
+        const real_t kps[4][2] = {{tag_id, k},
+                                  {tag_id + 1, k},
+                                  {tag_id + 1, k + cam_idx},
+                                  {tag_id, k + cam_idx}};
+        aprilgrid_add_tag(expected, tag_id, kps);
+      }
+      aprilgrid_t *grid = aprilgrid_archive_grid(archive, frame_idx);
+      TEST_ASSERT(grid->timestamp == expected->timestamp);
+      TEST_ASSERT(aprilgrid_equals(grid, expected));
+      aprilgrid_free(grid);
+      aprilgrid_free(expected);
+    }
+  }
+
+  // Corrupt frame header fields one at a time, a corner count that no longer
+  // matches the index and grid sizes out of range must all be rejected
+  const uint64_t offset = archive->index[num_cams].offset;
+  aprilgrid_archive_free(archive);
+  const size_t fields[3] = {offsetof(aprilgrid_archive_frame_t,
+                                     corners_detected),
+                            offsetof(aprilgrid_archive_frame_t, num_rows),
+                            offsetof(aprilgrid_archive_frame_t, num_cols)};
+  const int32_t values[3] = {1000, INT32_MAX, -1};
+  for (int i = 0; i < 3; i++) {
+    FILE *fp = fopen(archive_path, "r+b");
+    TEST_ASSERT(fp != NULL);
+    int32_t value = 0;
+    TEST_ASSERT(fseek(fp, offset + fields[i], SEEK_SET) == 0);
+    TEST_ASSERT(fread(&value, sizeof(int32_t), 1, fp) == 1);
+    TEST_ASSERT(fseek(fp, offset + fields[i], SEEK_SET) == 0);
+    TEST_ASSERT(fwrite(&values[i], sizeof(int32_t), 1, fp) == 1);
+    fclose(fp);
+    TEST_ASSERT(aprilgrid_archive_load(archive_path) == NULL);
+
+    fp = fopen(archive_path, "r+b");
+    TEST_ASSERT(fp != NULL);
+    TEST_ASSERT(fseek(fp, offset + fields[i], SEEK_SET) == 0);
+    TEST_ASSERT(fwrite(&value, sizeof(int32_t), 1, fp) == 1);
+    fclose(fp);
+    aprilgrid_archive_t *restored = aprilgrid_archive_load(archive_path);
+    TEST_ASSERT(restored != NULL);
+    aprilgrid_archive_free(restored);
+  }
+
+  return 0;
+}
+
 #if ENABLE_APRILGRID_DETECTOR == 1
 
 int test_aprilgrid_detector_detect() {
@@ -1220,6 +2557,117 @@ int test_aprilgrid_detector_detect() {
   return 0;
 }
 
+int test_aprilgrid_batch_detector_detect() {
+  // Same test image repeated, each with its own timestamp
+  const int num_images = 8;
+  timestamp_t timestamps[8] = {0};
+  char *image_paths[8] = {0};
+  for (int i = 0; i < num_images; i++) {
+    timestamps[i] = i;
+    image_paths[i] = (char *) "./test_data/images/aprilgrid_tag36h11.jpg";
+  }
+
+  // Detect
+  const int num_threads = 3;
+  const int num_rows = 10;
+  const int num_cols = 10;
+  const real_t tag_size = 1.0;
+  const real_t tag_spacing = 0.0;
+  aprilgrid_batch_detector_t *bd = aprilgrid_batch_detector_malloc(num_threads,
+                                                                   num_rows,
+                                                                   num_cols,
+                                                                   tag_size,
+                                                                   tag_spacing);
+  aprilgrid_t **grids = aprilgrid_batch_detector_detect(bd,
+                                                        num_images,
+                                                        timestamps,
+                                                        image_paths);
+
+  // Output order must match input order
+  for (int i = 0; i < num_images; i++) {
+    TEST_ASSERT(grids[i] != NULL);
+    TEST_ASSERT(grids[i]->timestamp == i);
+    TEST_ASSERT(grids[i]->corners_detected == 400);
+    aprilgrid_free(grids[i]);
+  }
+
+  // Saving into a missing directory fails
+  const char *image_dir = "./test_data/images";
+  const char *save_dir = "/tmp/aprilgrid_batch_missing/dir";
+  TEST_ASSERT(aprilgrid_batch_detector_save(bd, image_dir, save_dir) == -1);
+
+  // Clean up
+  free(grids);
+  aprilgrid_batch_detector_free(bd);
+
+  return 0;
+}
+
+int test_aprilgrid_tracker_detect() {
+  // Load test image
+  const char *test_image = "./test_data/images/aprilgrid_tag36h11.jpg";
+  int err = 0;
+  pjpeg_t *pjpeg = pjpeg_create_from_file(test_image, 0, &err);
+  if (pjpeg == NULL) {
+    printf("Failed to load [%s]\n", test_image);
+    return -1;
+  }
+  image_u8_t *im = pjpeg_to_u8_baseline(pjpeg);
+
+  // Image sequence: the test image pasted onto a larger white canvas with a
+  // small offset between frames, the grid disappears at frame 3
+  const int w = im->width + 100;
+  const int h = im->height + 100;
+  const int offsets[5][2] = {{20, 20}, {26, 23}, {32, 26}, {-1, -1}, {80, 80}};
+  const int tracked[5] = {0, 1, 1, 0, 0};
+  uint8_t *canvas = MALLOC(uint8_t, w * h);
+
+  const int num_rows = 10;
+  const int num_cols = 10;
+  const real_t tag_size = 1.0;
+  const real_t tag_spacing = 0.0;
+  aprilgrid_tracker_t *tracker =
+      aprilgrid_tracker_malloc(num_rows, num_cols, tag_size, tag_spacing);
+  aprilgrid_detector_t *det =
+      aprilgrid_detector_malloc(num_rows, num_cols, tag_size, tag_spacing);
+
+  for (int k = 0; k < 5; k++) {
+    memset(canvas, 255, w * h);
+    const int dx = offsets[k][0];
+    const int dy = offsets[k][1];
+    if (dx >= 0) {
+      for (int y = 0; y < im->height; y++) {
+        memcpy(canvas + (y + dy) * w + dx, im->buf + y * im->stride, im->width);
+      }
+    }
+
+    // Track and compare against full-frame detection
+    aprilgrid_t *grid = aprilgrid_tracker_detect(tracker, k, w, h, w, canvas);
+    aprilgrid_t *expected = aprilgrid_detector_detect(det, k, w, h, w, canvas);
+    TEST_ASSERT(tracker->tracked == tracked[k]);
+    TEST_ASSERT(grid->timestamp == k);
+    TEST_ASSERT(grid->corners_detected == expected->corners_detected);
+    TEST_ASSERT(grid->corners_detected == ((dx >= 0) ? 400 : 0));
+    for (int i = 0; i < num_rows * num_cols * 4 * 6; i++) {
+      TEST_ASSERT(fabs(grid->data[i] - expected->data[i]) < 0.5);
+    }
+    if (tracked[k]) {
+      TEST_ASSERT(tracker->roi[2] < w || tracker->roi[3] < h);
+    }
+    aprilgrid_free(grid);
+    aprilgrid_free(expected);
+  }
+
+  // Clean up
+  free(canvas);
+  pjpeg_destroy(pjpeg);
+  image_u8_destroy(im);
+  aprilgrid_tracker_free(tracker);
+  aprilgrid_detector_free(det);
+
+  return 0;
+}
+
 #endif // ENABLE_APRILGRID_DETECTOR
 
 int main(int argc, char *argv[]) {
@@ -1230,8 +2678,11 @@ int main(int argc, char *argv[]) {
   TEST(test_aprilgrid_add_and_remove_corner);
   TEST(test_aprilgrid_add_and_remove_tag);
   TEST(test_aprilgrid_save_and_load);
+  TEST(test_aprilgrid_archive);
 #if ENABLE_APRILGRID_DETECTOR == 1
   TEST(test_aprilgrid_detector_detect);
+  TEST(test_aprilgrid_batch_detector_detect);
+  TEST(test_aprilgrid_tracker_detect);
 #endif
 
   return (nb_failed) ? -1 : 0;
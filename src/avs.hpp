@@ -715,6 +715,8 @@ struct GridDetector {
       std::vector<cv::KeyPoint> &kps_new,
       const std::vector<cv::KeyPoint> &kps_prev = std::vector<cv::KeyPoint>(),
       bool debug = false) const {
+    TRACE_SCOPE("GridDetector::detect");
+
     // Asserts
     assert(image.channels() == 1);
 
@@ -1119,8 +1121,7 @@ struct VisionFactor : ceres::CostFunction {
     // Project to image plane
     bool valid = true;
     real_t z_hat[2] = {0};
-    const project_func_t proj_func = pinhole_radtan4_project;
-    proj_func(cam, p_Ci, z_hat);
+    pinhole_radtan4_project_inline(cam, p_Ci, z_hat);
 
     bool x_ok = z_hat[0] > 0 && z_hat[0] < 752;
     bool y_ok = z_hat[1] > 0 && z_hat[1] < 480;
@@ -1794,6 +1795,8 @@ struct TSF {
   void detect(const timestamp_t ts,
               const cv::Mat &frame0,
               const cv::Mat &frame1) {
+    TRACE_SCOPE("TSF::detect");
+
     // Get previous keypoints from cam0
     std::vector<size_t> feature_ids;
     std::vector<cv::KeyPoint> kps0;
@@ -1847,6 +1850,8 @@ struct TSF {
   bool track(const timestamp_t ts,
              const cv::Mat &frame0,
              const cv::Mat &frame1) {
+    TRACE_SCOPE("TSF::track");
+
     // Pre-check
     if (prev_frame0.empty() || prev_frame1.empty()) {
       return false;
@@ -1944,6 +1949,8 @@ struct TSF {
   void update(const timestamp_t ts,
               const cv::Mat &frame0,
               const cv::Mat &frame1) {
+    TRACE_SCOPE("TSF::update");
+
     // Apply CLAHE
     if (enable_clahe) {
       clahe->apply(frame0, frame0);
@@ -0,0 +1,663 @@
+/**
+ * Replay benchmark for the UBX and SBGC serial drivers.
+ *
+ * A pseudo-terminal stands in for the serial port. The driver opens the PTY
+ * slave through its usual connect function, while a player thread on the PTY
+ * master streams a recorded byte log at the original link rate times a
+ * speedup. The UBX log is streamed into `ublox_run()`. The SBGC log is a
+ * sequence of realtime data replies, one for each request `sbgc_update()`
+ * sends. Without a log, a synthetic one is generated.
+ *
+ * Usage:
+ *
+ *   bench_io <ubx|sbgc> [--log PATH] [--speedup X] [--baud N]
+ *
+ * A speedup of 0 (default) streams as fast as the driver consumes.
+ */
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <math.h>
+#include <time.h>
+
+#define UBX_IMPLEMENTATION
+#include "ubx.h"
+#include "sbgc.h"
+
+#define BENCH_IO_IDLE_MS 100
+#define BENCH_IO_CHUNK 4096
+
+typedef struct bench_io_t {
+  // Recorded byte log and the frames it contains
+  uint8_t *log;
+  size_t log_size;
+  size_t *frame_offsets;
+  size_t *frame_lengths;
+  size_t nb_frames;
+
+  // Player
+  int master;
+  double speedup;
+  double rate; // Link rate [bytes/s]
+  int64_t *ts_sent;
+  size_t nb_sent;
+  int64_t ts_start;
+  int done;
+
+  // Receiver
+  int64_t *latencies;
+  size_t nb_received;
+  size_t nb_dropped;
+  size_t nb_unexpected;
+  size_t cursor;
+  int64_t ts_last;
+} bench_io_t;
+
+/** Monotonic time in nano-seconds **/
+static int64_t bench_io_now() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+/** Sleep until monotonic time `ts` in nano-seconds **/
+static void bench_io_sleep_until(const int64_t ts) {
+  struct timespec t;
+  t.tv_sec = ts / 1000000000LL;
+  t.tv_nsec = ts % 1000000000LL;
+  clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL);
+}
+
+/**
+ * Open a raw pseudo-terminal pair. Returns the master file descriptor and
+ * writes the slave device path to `slave`, or returns -1 on failure.
+ */
+static int bench_io_pty_open(char *slave, const size_t slave_size) {
+  const int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master == -1) {
+    return -1;
+  }
+  if (grantpt(master) != 0 || unlockpt(master) != 0 ||
+      ptsname_r(master, slave, slave_size) != 0) {
+    close(master);
+    return -1;
+  }
+
+  // No echo or line processing until the driver configures the port
+  struct termios tty;
+  if (tcgetattr(master, &tty) == 0) {
+    cfmakeraw(&tty);
+    tcsetattr(master, TCSANOW, &tty);
+  }
+
+  return master;
+}
+
+/** Load byte log at `path`, returns NULL on failure **/
+static uint8_t *bench_io_log_load(const char *path, size_t *size) {
+  FILE *fp = fopen(path, "rb");
+  if (fp == NULL) {
+    return NULL;
+  }
+
+  fseek(fp, 0, SEEK_END);
+  const long n = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  uint8_t *log = malloc((n > 0) ? n : 1);
+  *size = fread(log, 1, (n > 0) ? n : 0, fp);
+  fclose(fp);
+
+  return log;
+}
+
+/** Append frame spanning `[offset, offset + length)` to the frame index **/
+static void bench_io_add_frame(bench_io_t *bench,
+                               const size_t offset,
+                               const size_t length) {
+  const size_t k = bench->nb_frames++;
+  const size_t size = sizeof(size_t) * (k + 1);
+  bench->frame_offsets = realloc(bench->frame_offsets, size);
+  bench->frame_lengths = realloc(bench->frame_lengths, size);
+  bench->frame_offsets[k] = offset;
+  bench->frame_lengths[k] = length;
+}
+
+/** Allocate per-frame timestamps once the frame index is complete **/
+static void bench_io_setup(bench_io_t *bench) {
+  bench->ts_sent = calloc(bench->nb_frames + 1, sizeof(int64_t));
+  bench->latencies = calloc(bench->nb_frames + 1, sizeof(int64_t));
+}
+
+/** Free benchmark **/
+static void bench_io_free(bench_io_t *bench) {
+  free(bench->log);
+  free(bench->frame_offsets);
+  free(bench->frame_lengths);
+  free(bench->ts_sent);
+  free(bench->latencies);
+  close(bench->master);
+}
+
+static int bench_io_cmp(const void *a, const void *b) {
+  const int64_t x = *(const int64_t *) a;
+  const int64_t y = *(const int64_t *) b;
+  return (x > y) - (x < y);
+}
+
+/** Print benchmark results **/
+static void bench_io_report(bench_io_t *bench, const char *driver) {
+  const size_t n = bench->nb_received;
+  const double elapsed = (bench->ts_last - bench->ts_start) * 1e-9;
+  qsort(bench->latencies, n, sizeof(int64_t), bench_io_cmp);
+  double mean = 0.0;
+  for (size_t i = 0; i < n; i++) {
+    mean += bench->latencies[i] * 1e-3 / n;
+  }
+  const double p50 = (n) ? bench->latencies[n / 2] * 1e-3 : 0.0;
+  const double p99 = (n) ? bench->latencies[(n * 99) / 100] * 1e-3 : 0.0;
+  const double max = (n) ? bench->latencies[n - 1] * 1e-3 : 0.0;
+
+  printf("driver: %s\n", driver);
+  printf("speedup: %.2f\n", bench->speedup);
+  printf("log_bytes: %zu\n", bench->log_size);
+  printf("frames_sent: %zu\n", bench->nb_sent);
+  printf("frames_received: %zu\n", bench->nb_received);
+  printf("frames_dropped: %zu\n", bench->nb_dropped);
+  printf("frames_unexpected: %zu\n", bench->nb_unexpected);
+  printf("elapsed_s: %.3f\n", elapsed);
+  printf("msgs_per_s: %.1f\n", (elapsed > 0) ? n / elapsed : 0.0);
+  printf("latency_mean_us: %.1f\n", mean);
+  printf("latency_p50_us: %.1f\n", p50);
+  printf("latency_p99_us: %.1f\n", p99);
+  printf("latency_max_us: %.1f\n", max);
+}
+
+/*****************************************************************************
+ * UBX
+ ****************************************************************************/
+
+static bench_io_t *bench_io_ubx = NULL;
+
+/** Append serialized UBX message to log **/
+static void bench_io_ubx_append(bench_io_t *bench,
+                                const uint8_t msg_class,
+                                const uint8_t msg_id,
+                                const uint16_t length,
+                                const uint8_t *payload) {
+  ubx_msg_t msg;
+  ubx_msg_build(&msg, msg_class, msg_id, length, payload);
+  size_t frame_size = 0;
+  ubx_msg_serialize(&msg, bench->log + bench->log_size, &frame_size);
+  bench->log_size += frame_size;
+}
+
+/** Append RTCM3 frame with `length` payload bytes to log **/
+static void bench_io_rtcm3_append(bench_io_t *bench,
+                                  const uint16_t msg_type,
+                                  const uint16_t length) {
+  uint8_t *frame = bench->log + bench->log_size;
+  frame[0] = 0xD3;
+  frame[1] = (length >> 8) & 0x03;
+  frame[2] = length & 0xFF;
+  frame[3] = msg_type >> 4;
+  frame[4] = (msg_type & 0x0F) << 4;
+  for (uint16_t i = 2; i < length; i++) {
+    frame[3 + i] = (uint8_t) (rand() & 0xFF);
+  }
+  const uint32_t crc = rtcm3_crc24q(frame, 3 + length);
+  frame[3 + length + 0] = (crc >> 16) & 0xFF;
+  frame[3 + length + 1] = (crc >> 8) & 0xFF;
+  frame[3 + length + 2] = crc & 0xFF;
+  bench->log_size += 3 + length + 3;
+}
+
+/** Synthesize a 10Hz rover log of NAV messages and RTCM3 corrections **/
+static void bench_io_ubx_synthesize(bench_io_t *bench, const int nb_epochs) {
+  const size_t epoch_size = (8 + 92) + (8 + 18) + (8 + 36) + 2 * (6 + 1023);
+  bench->log = malloc(epoch_size * nb_epochs);
+  bench->log_size = 0;
+
+  srand(0);
+  uint8_t payload[1024] = {0};
+  for (int k = 0; k < nb_epochs; k++) {
+    const uint32_t itow = k * 100;
+    memcpy(payload, &itow, sizeof(uint32_t));
+    bench_io_ubx_append(bench, UBX_NAV, UBX_NAV_PVT, 92, payload);
+    bench_io_ubx_append(bench, UBX_NAV, UBX_NAV_DOP, 18, payload);
+    bench_io_ubx_append(bench, UBX_NAV, UBX_NAV_HPPOSLLH, 36, payload);
+    bench_io_rtcm3_append(bench, 1077, 100 + rand() % 900);
+    bench_io_rtcm3_append(bench, 1087, 100 + rand() % 900);
+  }
+}
+
+static void bench_io_ubx_index_cb(void *arg, const ubx_frame_t *frame) {
+  bench_io_t *bench = (bench_io_t *) arg;
+  bench_io_add_frame(bench, frame->data - bench->log, frame->length);
+}
+
+/** Index the frames in the UBX log with the same parser the driver uses **/
+static void bench_io_ubx_index(bench_io_t *bench) {
+  ubx_stream_t stream;
+  ubx_stream_init(&stream);
+  ubx_frames_scan(&stream,
+                  bench->log,
+                  bench->log_size,
+                  bench_io_ubx_index_cb,
+                  bench);
+}
+
+/**
+ * Match the frame the driver just parsed against the frame index. Frames
+ * arrive in order, so index frames skipped over were dropped.
+ */
+static void bench_io_ubx_received(ublox_t *ublox) {
+  const int64_t now = bench_io_now();
+  bench_io_t *bench = bench_io_ubx;
+  const ubx_frame_t *frame = ublox->frame;
+  if (frame == NULL) {
+    return;
+  }
+
+  const size_t window = 64;
+  for (size_t k = bench->cursor;
+       k < bench->nb_frames && k < bench->cursor + window;
+       k++) {
+    const uint8_t *expected = bench->log + bench->frame_offsets[k];
+    if (bench->frame_lengths[k] != frame->length ||
+        memcmp(expected, frame->data, frame->length) != 0) {
+      continue;
+    }
+
+    const int64_t ts = __atomic_load_n(&bench->ts_sent[k], __ATOMIC_ACQUIRE);
+    bench->latencies[bench->nb_received++] = now - ts;
+    bench->nb_dropped += k - bench->cursor;
+    bench->ts_last = now;
+    __atomic_store_n(&bench->cursor, k + 1, __ATOMIC_RELEASE);
+    return;
+  }
+  bench->nb_unexpected++;
+}
+
+/** Acknowledge configuration requests until the driver goes quiet **/
+static void bench_io_ubx_ack(bench_io_t *bench) {
+  ubx_parser_t parser;
+  ubx_parser_init(&parser);
+
+  struct pollfd fds[1];
+  fds[0].fd = bench->master;
+  fds[0].events = POLLIN;
+  int nb_acks = 0;
+  while (1) {
+    const int ready = poll(fds, 1, BENCH_IO_IDLE_MS);
+    if (ready < 0 || (ready == 0 && nb_acks > 0)) {
+      break;
+    } else if (ready == 0) {
+      continue;
+    }
+
+    uint8_t buf[1024];
+    const ssize_t n = read(bench->master, buf, sizeof(buf));
+    for (ssize_t i = 0; i < n; i++) {
+      if (ubx_parser_update(&parser, buf[i]) != 1) {
+        continue;
+      }
+      if (parser.msg.msg_class != UBX_CFG) {
+        continue;
+      }
+
+      uint8_t payload[2] = {parser.msg.msg_class, parser.msg.msg_id};
+      ubx_msg_t ack;
+      ubx_msg_build(&ack, UBX_ACK, UBX_ACK_ACK, 2, payload);
+      uint8_t frame[10];
+      size_t frame_size = 0;
+      ubx_msg_serialize(&ack, frame, &frame_size);
+      if (write(bench->master, frame, frame_size) == (ssize_t) frame_size) {
+        nb_acks++;
+      }
+    }
+  }
+}
+
+/**
+ * Stream the log into the PTY master. Each frame is stamped with the time
+ * the write containing its last byte was issued.
+ */
+static void bench_io_stream(bench_io_t *bench) {
+  const int64_t t0 = bench_io_now();
+  bench->ts_start = t0;
+  size_t offset = 0;
+  size_t k = 0;
+  while (offset < bench->log_size) {
+    // Bytes due by now at the paced link rate
+    size_t end = offset + BENCH_IO_CHUNK;
+    if (bench->speedup > 0) {
+      const double dt = (bench_io_now() - t0) * 1e-9;
+      const size_t due = dt * bench->rate * bench->speedup;
+      if (due <= offset) {
+        bench_io_sleep_until(bench_io_now() + 1000000);
+        continue;
+      }
+      end = (due < end) ? due : end;
+    }
+    end = (end < bench->log_size) ? end : bench->log_size;
+
+    // Stamp frames completed by this write
+    const int64_t ts = bench_io_now();
+    size_t k_end = k;
+    while (k_end < bench->nb_frames &&
+           bench->frame_offsets[k_end] + bench->frame_lengths[k_end] <= end) {
+      __atomic_store_n(&bench->ts_sent[k_end], ts, __ATOMIC_RELEASE);
+      k_end++;
+    }
+
+    const ssize_t n = write(bench->master, bench->log + offset, end - offset);
+    if (n < 0) {
+      break;
+    }
+    offset += n;
+
+    // A short write completes fewer frames, re-stamp them on the next write
+    while (k < k_end &&
+           bench->frame_offsets[k] + bench->frame_lengths[k] <= offset) {
+      k++;
+    }
+    __atomic_store_n(&bench->nb_sent, k, __ATOMIC_RELEASE);
+  }
+  __atomic_store_n(&bench->done, 1, __ATOMIC_RELEASE);
+}
+
+static void *bench_io_ubx_player(void *arg) {
+  bench_io_t *bench = (bench_io_t *) arg;
+  bench_io_ubx_ack(bench);
+  bench_io_stream(bench);
+  return NULL;
+}
+
+typedef struct bench_io_ublox_t {
+  ublox_t *ublox;
+  int loop;
+} bench_io_ublox_t;
+
+static void *bench_io_ubx_driver(void *arg) {
+  bench_io_ublox_t *driver = (bench_io_ublox_t *) arg;
+  ublox_run(driver->ublox, &driver->loop);
+  return NULL;
+}
+
+/** Replay UBX log through `ublox_run()` **/
+static int bench_io_ubx_run(bench_io_t *bench) {
+  // Connect to PTY slave as if it were the receiver's serial port
+  char slave[100] = {0};
+  bench->master = bench_io_pty_open(slave, sizeof(slave));
+  if (bench->master == -1) {
+    UBX_ERROR("Failed to open pseudo-terminal!");
+    return -1;
+  }
+  ubx_uart_t uart;
+  uart.speed = B115200;
+  uart.parity = 0;
+  if (ubx_uart_connect(&uart, slave) != 0) {
+    UBX_ERROR("Failed to connect to [%s]!", slave);
+    return -1;
+  }
+  ublox_t ublox;
+  ublox_init(&ublox, &uart);
+  ublox.ubx_cb = bench_io_ubx_received;
+  ublox.rtcm3_cb = bench_io_ubx_received;
+  bench_io_ubx = bench;
+
+  // Replay
+  pthread_t player;
+  pthread_t driver;
+  bench_io_ublox_t args = {.ublox = &ublox, .loop = 1};
+  pthread_create(&player, NULL, bench_io_ubx_player, bench);
+  pthread_create(&driver, NULL, bench_io_ubx_driver, &args);
+  pthread_join(player, NULL);
+
+  // Wait for the driver to drain the PTY
+  int64_t t_last = bench_io_now();
+  size_t nb_seen = 0;
+  while (bench_io_now() - t_last < BENCH_IO_IDLE_MS * 1000000LL) {
+    const size_t n = __atomic_load_n(&bench->cursor, __ATOMIC_ACQUIRE);
+    if (n == bench->nb_frames) {
+      break;
+    } else if (n != nb_seen) {
+      nb_seen = n;
+      t_last = bench_io_now();
+    }
+    usleep(1000);
+  }
+  __atomic_store_n(&args.loop, 0, __ATOMIC_RELEASE);
+  pthread_join(driver, NULL);
+  bench->nb_dropped += bench->nb_sent - bench->cursor;
+
+  ublox_disconnect(&ublox);
+  return 0;
+}
+
+/*****************************************************************************
+ * SBGC
+ ****************************************************************************/
+
+/** Realtime data reply size for the fields `sbgc_update()` requests **/
+#define BENCH_IO_SBGC_PAYLOAD (2 + 6 + 6 + 9)
+
+/** Synthesize realtime data replies of a slowly sweeping gimbal **/
+static void bench_io_sbgc_synthesize(bench_io_t *bench, const int nb_frames) {
+  bench->log = malloc((6 + BENCH_IO_SBGC_PAYLOAD) * nb_frames);
+  bench->log_size = 0;
+
+  for (int k = 0; k < nb_frames; k++) {
+    uint8_t payload[BENCH_IO_SBGC_PAYLOAD] = {0};
+    payload[0] = k & 0xFF;
+    payload[1] = (k >> 8) & 0xFF;
+    for (int i = 0; i < 6; i++) {
+      const int16_t angle = 100.0 * sin(0.01 * k + i) / SBGC_DEG_PER_BIT;
+      payload[2 + 2 * i + 0] = angle & 0xFF;
+      payload[2 + 2 * i + 1] = (angle >> 8) & 0xFF;
+    }
+    for (int i = 0; i < 3; i++) {
+      const int32_t encoder = (1 << 23) + 1000 * k * (i + 1);
+      payload[14 + 3 * i + 0] = encoder & 0xFF;
+      payload[14 + 3 * i + 1] = (encoder >> 8) & 0xFF;
+      payload[14 + 3 * i + 2] = (encoder >> 16) & 0xFF;
+    }
+
+    sbgc_frame_t frame;
+    sbgc_frame_setup(&frame,
+                     SBGC_CMD_REALTIME_DATA_CUSTOM,
+                     payload,
+                     BENCH_IO_SBGC_PAYLOAD);
+    uint8_t *data = bench->log + bench->log_size;
+    data[0] = '$';
+    data[1] = frame.cmd_id;
+    data[2] = frame.payload_size;
+    data[3] = frame.header_checksum;
+    memcpy(data + 4, frame.payload, frame.payload_size);
+    data[4 + frame.payload_size + 0] = frame.crc16[0];
+    data[4 + frame.payload_size + 1] = frame.crc16[1];
+    bench->log_size += 6 + frame.payload_size;
+  }
+}
+
+/** Index the valid SBGC frames in the log **/
+static void bench_io_sbgc_index(bench_io_t *bench) {
+  size_t offset = 0;
+  while (offset + 6 <= bench->log_size) {
+    uint8_t *data = bench->log + offset;
+    const size_t length = 6 + data[2];
+    sbgc_frame_t frame;
+    if (offset + length <= bench->log_size &&
+        sbgc_frame_parse_frame(&frame, data) == 0) {
+      bench_io_add_frame(bench, offset, length);
+      offset += length;
+    } else {
+      offset++;
+    }
+  }
+}
+
+/** Reply to each realtime data request with the next frame in the log **/
+static void *bench_io_sbgc_player(void *arg) {
+  bench_io_t *bench = (bench_io_t *) arg;
+
+  struct pollfd fds[1];
+  fds[0].fd = bench->master;
+  fds[0].events = POLLIN;
+  uint8_t buf[1024];
+  size_t size = 0;
+  int64_t t0 = 0;
+  size_t k = 0;
+  while (k < bench->nb_frames && poll(fds, 1, 1000) > 0) {
+    const ssize_t n = read(bench->master, buf + size, sizeof(buf) - size);
+    if (n <= 0) {
+      break;
+    }
+    size += n;
+
+    // Complete requests
+    size_t offset = 0;
+    while (offset < size) {
+      if (buf[offset] != '$') {
+        offset++;
+        continue;
+      }
+      if (offset + 4 > size || offset + 6 + buf[offset + 2] > size) {
+        break;
+      }
+      const uint8_t cmd_id = buf[offset + 1];
+      offset += 6 + buf[offset + 2];
+      if (cmd_id != SBGC_CMD_REALTIME_DATA_CUSTOM || k == bench->nb_frames) {
+        continue;
+      }
+
+      // Pace replies at the recorded link rate
+      if (bench->speedup > 0) {
+        t0 = (k == 0) ? bench_io_now() : t0;
+        const double dt = bench->frame_offsets[k] / bench->rate;
+        bench_io_sleep_until(t0 + dt / bench->speedup * 1e9);
+      }
+
+      const uint8_t *frame = bench->log + bench->frame_offsets[k];
+      const size_t length = bench->frame_lengths[k];
+      __atomic_store_n(&bench->ts_sent[k], bench_io_now(), __ATOMIC_RELEASE);
+      if (write(bench->master, frame, length) != (ssize_t) length) {
+        break;
+      }
+      __atomic_store_n(&bench->nb_sent, ++k, __ATOMIC_RELEASE);
+    }
+    memmove(buf, buf + offset, size - offset);
+    size -= offset;
+  }
+  __atomic_store_n(&bench->done, 1, __ATOMIC_RELEASE);
+
+  return NULL;
+}
+
+/** Replay SBGC log through `sbgc_update()` **/
+static int bench_io_sbgc_run(bench_io_t *bench) {
+  // Connect to PTY slave as if it were the controller's serial port
+  char slave[100] = {0};
+  bench->master = bench_io_pty_open(slave, sizeof(slave));
+  if (bench->master == -1) {
+    SBGC_ERROR("Failed to open pseudo-terminal!");
+    return -1;
+  }
+  sbgc_t sbgc;
+  if (sbgc_connect(&sbgc, slave) != 0) {
+    SBGC_ERROR("Failed to connect to [%s]!", slave);
+    return -1;
+  }
+
+  // Replay, every request is answered with exactly one frame
+  pthread_t player;
+  pthread_create(&player, NULL, bench_io_sbgc_player, bench);
+  bench->ts_start = bench_io_now();
+  while (__atomic_load_n(&bench->done, __ATOMIC_ACQUIRE) == 0) {
+    const int retval = sbgc_update(&sbgc);
+    const int64_t now = bench_io_now();
+    const size_t k = __atomic_load_n(&bench->nb_sent, __ATOMIC_ACQUIRE);
+    if (retval == 0 && k > 0) {
+      const int64_t ts = __atomic_load_n(&bench->ts_sent[k - 1],
+                                         __ATOMIC_ACQUIRE);
+      bench->latencies[bench->nb_received++] = now - ts;
+      bench->ts_last = now;
+    }
+  }
+  pthread_join(player, NULL);
+  bench->nb_dropped = bench->nb_sent - bench->nb_received;
+
+  sbgc_disconnect(&sbgc);
+  return 0;
+}
+
+/*****************************************************************************
+ * MAIN
+ ****************************************************************************/
+
+static void bench_io_usage(const char *prog) {
+  printf("Usage: %s <ubx|sbgc> [--log PATH] [--speedup X] [--baud N]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+  // Parse arguments
+  if (argc < 2) {
+    bench_io_usage(argv[0]);
+    return -1;
+  }
+  const char *driver = argv[1];
+  const char *log_path = NULL;
+  double speedup = 0.0;
+  double baud = 115200.0;
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
+      log_path = argv[++i];
+    } else if (strcmp(argv[i], "--speedup") == 0 && i + 1 < argc) {
+      speedup = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--baud") == 0 && i + 1 < argc) {
+      baud = atof(argv[++i]);
+    } else {
+      bench_io_usage(argv[0]);
+      return -1;
+    }
+  }
+
+  // Setup
+  bench_io_t bench;
+  memset(&bench, 0, sizeof(bench_io_t));
+  bench.master = -1;
+  bench.speedup = speedup;
+  bench.rate = baud / 10.0; // 8N1 framing
+  const int is_ubx = (strcmp(driver, "ubx") == 0);
+  const int is_sbgc = (strcmp(driver, "sbgc") == 0);
+  if (is_ubx == 0 && is_sbgc == 0) {
+    bench_io_usage(argv[0]);
+    return -1;
+  }
+  if (log_path) {
+    bench.log = bench_io_log_load(log_path, &bench.log_size);
+    if (bench.log == NULL) {
+      printf("Failed to load log [%s]!\n", log_path);
+      return -1;
+    }
+  } else if (is_ubx) {
+    bench_io_ubx_synthesize(&bench, 20000);
+  } else {
+    bench_io_sbgc_synthesize(&bench, 500);
+  }
+  if (is_ubx) {
+    bench_io_ubx_index(&bench);
+  } else {
+    bench_io_sbgc_index(&bench);
+  }
+  bench_io_setup(&bench);
+
+  // Replay
+  const int retval = is_ubx ? bench_io_ubx_run(&bench)
+                            : bench_io_sbgc_run(&bench);
+  if (retval == 0) {
+    bench_io_report(&bench, driver);
+  }
+  bench_io_free(&bench);
+
+  return retval;
+}
@@ -0,0 +1,488 @@
+/**
+ * End-to-end solver benchmarks on simulated calibration and odometry
+ * problems of increasing size.
+ *
+ * Every problem is built from a fixed random seed and solved in a forked
+ * child process, so the reported peak resident set size belongs to that
+ * problem alone. Results are printed to stdout as CSV:
+ *
+ *   problem,size,sv_size,r_size,iters,solve_ms,iter_ms,linearize_ms,
+ *   linsolve_ms,peak_rss_kb,cost_init,cost_final
+ *
+ * `size` is the number of views for the calibration problems and the number
+ * of IMU factors for inertial odometry. `iters` counts solver steps and
+ * `iter_ms` is the mean wall time per step. `linearize_ms` and `linsolve_ms`
+ * are the total time spent linearizing and solving the normal equations,
+ * taken from the solver trace points. Costs are `0.5 * ||r||^2`.
+ *
+ * Usage:
+ *
+ *   bench_solver [--filter NAME] [--max-size N]
+ *
+ * Requires USE_TRACE. Build with `make benchmarks BUILD_TYPE=release
+ * ADDRESS_SANITIZER=0` to measure optimized code.
+ */
+#include <limits.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "xyz.h"
+
+typedef struct bench_solver_result_t {
+  int sv_size;
+  int r_size;
+  int iters;
+  double solve_ms;
+  double linearize_ms;
+  double linsolve_ms;
+  real_t cost_init;
+  real_t cost_final;
+} bench_solver_result_t;
+
+typedef param_order_t *(*bench_solver_order_func_t)(const void *data,
+                                                    int *sv_size,
+                                                    int *r_size);
+typedef void (*bench_solver_cost_func_t)(const void *data, real_t *r);
+
+/** Monotonic time in nano-seconds **/
+static int64_t bench_solver_now() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+/** Evaluate cost `0.5 * ||r||^2` and problem size **/
+static real_t bench_solver_cost(bench_solver_order_func_t order_func,
+                                bench_solver_cost_func_t cost_func,
+                                const void *data,
+                                int *sv_size,
+                                int *r_size) {
+  param_order_t *hash = order_func(data, sv_size, r_size);
+  real_t *r = CALLOC(real_t, *r_size);
+  cost_func(data, r);
+
+  real_t r_sq = 0.0;
+  dot(r, 1, *r_size, r, *r_size, 1, &r_sq);
+  param_order_free(hash);
+  free(r);
+
+  return 0.5 * r_sq;
+}
+
+/** Start timing a solve **/
+static int64_t bench_solver_start() {
+  trace_clear();
+  trace_start();
+  return bench_solver_now();
+}
+
+/** Stop timing a solve and collect the solver trace points **/
+static void bench_solver_stop(const int64_t start,
+                              const char *linearize,
+                              bench_solver_result_t *res) {
+  const int64_t elapsed = bench_solver_now() - start;
+  trace_stop();
+
+  uint64_t linearize_ns = 0;
+  uint64_t linsolve_ns = 0;
+  uint64_t step_ns = 0;
+  trace_total(linearize, &linearize_ns);
+  trace_total("solver_linsolve", &linsolve_ns);
+  res->iters = trace_total("solver_step", &step_ns);
+  res->solve_ms = elapsed * 1e-6;
+  res->linearize_ms = linearize_ns * 1e-6;
+  res->linsolve_ms = linsolve_ns * 1e-6;
+  trace_clear();
+}
+
+/** Point the simulated gimbal somewhere new, keeping the grid in view **/
+static void bench_solver_gimbal_joints(sim_gimbal_t *sim, real_t *joints) {
+  for (int i = 0; i < sim->num_joints; i++) {
+    sim_gimbal_set_joint(sim, i, randf(-0.2, 0.2));
+  }
+  sim_gimbal_get_joints(sim, sim->num_joints, joints);
+}
+
+/**
+ * Camera calibration with `num_views` views of `num_cams` cameras, simulated
+ * on the gimbal rig. Intrinsics start a few pixels off.
+ */
+static void bench_calib_camera(const int num_views,
+                               const int num_cams,
+                               bench_solver_result_t *res) {
+  sim_gimbal_t *sim = sim_gimbal_malloc();
+  calib_camera_t *calib = calib_camera_malloc();
+  calib->verbose = 0;
+
+  // Cameras, extrinsics are relative to cam0
+  POSE2TF(sim->cam_exts[0].data, T_MC0);
+  TF_INV(T_MC0, T_C0M);
+  for (int cam_idx = 0; cam_idx < num_cams; cam_idx++) {
+    const camera_params_t *cam = &sim->cam_params[cam_idx];
+    POSE2TF(sim->cam_exts[cam_idx].data, T_MCi);
+    TF_CHAIN(T_C0Ci, 2, T_C0M, T_MCi);
+    TF_VECTOR(T_C0Ci, cam_ext);
+
+    real_t cam_params[8] = {0};
+    vec_copy(cam->data, 8, cam_params);
+    for (int i = 0; i < 4; i++) {
+      cam_params[i] += randf(-5.0, 5.0);
+    }
+    calib_camera_add_camera(calib,
+                            cam_idx,
+                            cam->resolution,
+                            cam->proj_model,
+                            cam->dist_model,
+                            cam_params,
+                            cam_ext);
+  }
+
+  // Views
+  for (int view_idx = 0; view_idx < num_views; view_idx++) {
+    real_t joints[3] = {0};
+    bench_solver_gimbal_joints(sim, joints);
+    for (int cam_idx = 0; cam_idx < num_cams; cam_idx++) {
+      const timestamp_t ts = view_idx;
+      const real_t *body_pose = sim->gimbal_pose.data;
+      sim_gimbal_view_t *view =
+          sim_gimbal_view(sim, ts, view_idx, cam_idx, body_pose);
+      calib_camera_add_view(calib,
+                            ts,
+                            view_idx,
+                            cam_idx,
+                            view->num_measurements,
+                            view->tag_ids,
+                            view->corner_indices,
+                            view->object_points,
+                            view->keypoints);
+      sim_gimbal_view_free(view);
+    }
+  }
+
+  // Solve
+  res->cost_init = bench_solver_cost(&calib_camera_param_order,
+                                     &calib_camera_cost,
+                                     calib,
+                                     &res->sv_size,
+                                     &res->r_size);
+  const int64_t start = bench_solver_start();
+  calib_camera_solve(calib);
+  bench_solver_stop(start, "calib_camera_linearize_compact", res);
+  res->cost_final = bench_solver_cost(&calib_camera_param_order,
+                                      &calib_camera_cost,
+                                      calib,
+                                      &res->sv_size,
+                                      &res->r_size);
+
+  // Clean up
+  calib_camera_free(calib);
+  sim_gimbal_free(sim);
+}
+
+/** Stereo camera calibration **/
+static void bench_calib_camera2(const int num_views,
+                                bench_solver_result_t *res) {
+  bench_calib_camera(num_views, 2, res);
+}
+
+/** Monocular camera calibration **/
+static void bench_calib_camera1(const int num_views,
+                                bench_solver_result_t *res) {
+  bench_calib_camera(num_views, 1, res);
+}
+
+/**
+ * Gimbal calibration with `num_views` stereo views. The gimbal links and
+ * fiducial start a few centimeters off.
+ */
+static void bench_calib_gimbal(const int num_views,
+                               bench_solver_result_t *res) {
+  sim_gimbal_t *sim = sim_gimbal_malloc();
+  calib_gimbal_t *calib = calib_gimbal_malloc();
+
+  // Perturbed initial estimates
+  real_t fiducial[7] = {0};
+  real_t links[2][7] = {0};
+  vec_copy(sim->fiducial_ext.data, 7, fiducial);
+  for (int i = 0; i < 3; i++) {
+    fiducial[i] += randf(-0.02, 0.02);
+  }
+  for (int k = 0; k < 2; k++) {
+    vec_copy(sim->gimbal_links[k].data, 7, links[k]);
+    for (int i = 0; i < 3; i++) {
+      links[k][i] += randf(-0.02, 0.02);
+    }
+  }
+
+  // Setup gimbal calibrator
+  const int pose_idx = 0;
+  calib_gimbal_add_fiducial(calib, fiducial);
+  calib_gimbal_add_pose(calib, 0, sim->gimbal_pose.data);
+  calib_gimbal_add_gimbal_extrinsic(calib, sim->gimbal_ext.data);
+  calib_gimbal_add_gimbal_link(calib, 0, links[0]);
+  calib_gimbal_add_gimbal_link(calib, 1, links[1]);
+  for (int cam_idx = 0; cam_idx < sim->num_cams; cam_idx++) {
+    calib_gimbal_add_camera(calib,
+                            cam_idx,
+                            sim->cam_params[cam_idx].resolution,
+                            sim->cam_params[cam_idx].proj_model,
+                            sim->cam_params[cam_idx].dist_model,
+                            sim->cam_params[cam_idx].data,
+                            sim->cam_exts[cam_idx].data);
+  }
+
+  // Views
+  for (int view_idx = 0; view_idx < num_views; view_idx++) {
+    real_t joints[3] = {0};
+    bench_solver_gimbal_joints(sim, joints);
+    for (int cam_idx = 0; cam_idx < sim->num_cams; cam_idx++) {
+      const timestamp_t ts = view_idx;
+      const real_t *body_pose = sim->gimbal_pose.data;
+      sim_gimbal_view_t *view =
+          sim_gimbal_view(sim, ts, view_idx, cam_idx, body_pose);
+      calib_gimbal_add_view(calib,
+                            pose_idx,
+                            view_idx,
+                            ts,
+                            cam_idx,
+                            view->num_measurements,
+                            view->tag_ids,
+                            view->corner_indices,
+                            view->object_points,
+                            view->keypoints,
+                            joints,
+                            sim->num_joints);
+      sim_gimbal_view_free(view);
+    }
+  }
+
+  // Solve
+  solver_t solver;
+  solver_setup(&solver);
+  solver.max_iter = 20;
+  solver.param_order_func = &calib_gimbal_param_order;
+  solver.cost_func = &calib_gimbal_cost;
+  solver.linearize_func = &calib_gimbal_linearize_compact;
+
+  res->cost_init = bench_solver_cost(solver.param_order_func,
+                                     solver.cost_func,
+                                     calib,
+                                     &res->sv_size,
+                                     &res->r_size);
+  const int64_t start = bench_solver_start();
+  solver_solve(&solver, calib);
+  bench_solver_stop(start, "calib_gimbal_linearize_compact", res);
+  res->cost_final = bench_solver_cost(solver.param_order_func,
+                                      solver.cost_func,
+                                      calib,
+                                      &res->sv_size,
+                                      &res->r_size);
+
+  // Clean up
+  calib_gimbal_free(calib);
+  sim_gimbal_free(sim);
+}
+
+/**
+ * Batch inertial odometry over a window of `num_factors` IMU factors on a
+ * simulated circle trajectory. Poses and velocities start perturbed.
+ */
+static void bench_inertial_odometry(const int num_factors,
+                                    bench_solver_result_t *res) {
+  // Simulate IMU, 50 measurements per factor
+  const int N = 50;
+  sim_circle_t conf;
+  sim_circle_defaults(&conf);
+  conf.imu_rate = 1000.0;
+  sim_imu_data_t *imu_data = sim_imu_circle_trajectory(&conf);
+  assert((size_t) (num_factors * N) < imu_data->num_measurements);
+
+  // Inertial odometry
+  inertial_odometry_t *odom = MALLOC(inertial_odometry_t, 1);
+  odom->imu_params.imu_idx = 0;
+  odom->imu_params.rate = conf.imu_rate;
+  odom->imu_params.sigma_a = 0.08;
+  odom->imu_params.sigma_g = 0.004;
+  odom->imu_params.sigma_aw = 0.00004;
+  odom->imu_params.sigma_gw = 2.0e-6;
+  odom->imu_params.g = 9.81;
+  odom->num_factors = 0;
+  odom->factors = MALLOC(imu_factor_t, num_factors);
+  odom->marg = NULL;
+  odom->poses = MALLOC(pose_t, num_factors + 1);
+  odom->vels = MALLOC(velocity_t, num_factors + 1);
+  odom->biases = MALLOC(imu_biases_t, num_factors + 1);
+
+  const real_t ba[3] = {0, 0, 0};
+  const real_t bg[3] = {0, 0, 0};
+  for (int i = 0; i <= num_factors; i++) {
+    const int k = i * N;
+    const timestamp_t ts = imu_data->timestamps[k];
+    pose_setup(&odom->poses[i], ts, imu_data->poses + k * 7);
+    velocity_setup(&odom->vels[i], ts, imu_data->velocities + k * 3);
+    imu_biases_setup(&odom->biases[i], ts, ba, bg);
+    if (i == 0) {
+      continue;
+    }
+
+    imu_buffer_t imu_buf;
+    imu_buffer_setup(&imu_buf);
+    for (int j = k - N; j <= k; j++) {
+      imu_buffer_add(&imu_buf,
+                     imu_data->timestamps[j],
+                     imu_data->imu_acc + j * 3,
+                     imu_data->imu_gyr + j * 3);
+    }
+    imu_factor_setup(&odom->factors[i - 1],
+                     &odom->imu_params,
+                     &imu_buf,
+                     &odom->poses[i - 1],
+                     &odom->vels[i - 1],
+                     &odom->biases[i - 1],
+                     &odom->poses[i],
+                     &odom->vels[i],
+                     &odom->biases[i]);
+    odom->num_factors++;
+  }
+
+  // Perturb poses and velocities
+  for (int i = 0; i <= num_factors; i++) {
+    for (int j = 0; j < 3; j++) {
+      odom->poses[i].data[j] += randf(-0.1, 0.1);
+      quat_perturb(odom->poses[i].data + 3, j, randf(-1e-2, 1e-2));
+      odom->vels[i].data[j] += randf(-0.1, 0.1);
+    }
+  }
+
+  // Solve
+  solver_t solver;
+  solver_setup(&solver);
+  solver.max_iter = 20;
+  solver.param_order_func = &inertial_odometry_param_order;
+  solver.cost_func = &inertial_odometry_cost;
+  solver.linearize_func = &inertial_odometry_linearize_compact;
+
+  res->cost_init = bench_solver_cost(solver.param_order_func,
+                                     solver.cost_func,
+                                     odom,
+                                     &res->sv_size,
+                                     &res->r_size);
+  const int64_t start = bench_solver_start();
+  solver_solve(&solver, odom);
+  bench_solver_stop(start, "inertial_odometry_linearize_compact", res);
+  res->cost_final = bench_solver_cost(solver.param_order_func,
+                                      solver.cost_func,
+                                      odom,
+                                      &res->sv_size,
+                                      &res->r_size);
+
+  // Clean up
+  inertial_odometry_free(odom);
+  sim_imu_data_free(imu_data);
+}
+
+typedef void (*bench_solver_func_t)(const int size, bench_solver_result_t *res);
+
+/**
+ * Build and solve a problem in a child process and print its CSV row.
+ * Returns 0 or -1 if the child failed.
+ */
+static int bench_solver_run(const char *problem,
+                            bench_solver_func_t func,
+                            const int size) {
+  fflush(stdout);
+  const pid_t pid = fork();
+  if (pid < 0) {
+    LOG_ERROR("Failed to fork!\n");
+    return -1;
+  }
+
+  // Child: solve, measure and report
+  if (pid == 0) {
+    srand(42);
+    bench_solver_result_t res = {0};
+    func(size, &res);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("%s,%d,", problem, size);
+    printf("%d,%d,%d,", res.sv_size, res.r_size, res.iters);
+    printf("%.3f,%.3f,", res.solve_ms, res.solve_ms / MAX(res.iters, 1));
+    printf("%.3f,%.3f,", res.linearize_ms, res.linsolve_ms);
+    printf("%ld,%.6e,%.6e\n", usage.ru_maxrss, res.cost_init, res.cost_final);
+    fflush(stdout);
+    _exit(0);
+  }
+
+  // Parent: wait for child
+  int status = 0;
+  waitpid(pid, &status, 0);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    LOG_ERROR("Benchmark [%s] size [%d] failed!\n", problem, size);
+    return -1;
+  }
+
+  return 0;
+}
+
+static void bench_solver_usage(const char *prog) {
+  printf("Usage: %s [--filter NAME] [--max-size N]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+#ifndef USE_TRACE
+  printf("bench_solver requires USE_TRACE to be defined in xyz.h!\n");
+  return -1;
+#endif
+
+  // Parse arguments
+  const char *filter = NULL;
+  int max_size = INT_MAX;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (strcmp(argv[i], "--max-size") == 0 && i + 1 < argc) {
+      max_size = atoi(argv[++i]);
+    } else {
+      bench_solver_usage(argv[0]);
+      return -1;
+    }
+  }
+
+  // Problems and the sizes they are solved at
+  const struct {
+    const char *problem;
+    bench_solver_func_t func;
+    int sizes[5];
+  } problems[] = {
+      {"calib_camera_mono", bench_calib_camera1, {10, 20, 40, 80, 160}},
+      {"calib_camera_stereo", bench_calib_camera2, {10, 20, 40, 80, 160}},
+      {"calib_gimbal", bench_calib_gimbal, {5, 10, 20, 40, 80}},
+      {"inertial_odometry", bench_inertial_odometry, {10, 20, 40, 80, 120}},
+  };
+  const int num_problems = sizeof(problems) / sizeof(problems[0]);
+  const int num_sizes = sizeof(problems[0].sizes) / sizeof(int);
+
+  // Run
+  int retval = 0;
+  printf("problem,size,sv_size,r_size,iters,solve_ms,iter_ms,");
+  printf("linearize_ms,linsolve_ms,peak_rss_kb,cost_init,cost_final\n");
+  for (int k = 0; k < num_problems; k++) {
+    const char *problem = problems[k].problem;
+    if (filter && strstr(problem, filter) == NULL) {
+      continue;
+    }
+
+    for (int i = 0; i < num_sizes; i++) {
+      const int size = problems[k].sizes[i];
+      if (size > max_size) {
+        break;
+      }
+      if (bench_solver_run(problem, problems[k].func, size) != 0) {
+        retval = -1;
+      }
+    }
+  }
+
+  return retval;
+}
@@ -0,0 +1,384 @@
+/**
+ * Microbenchmarks for the xyz linear algebra, geometry and camera kernels.
+ *
+ * Each kernel is run repeatedly until at least `--min-time` seconds have
+ * elapsed, and the results are printed to stdout as CSV:
+ *
+ *   kernel,size,iters,ns_per_op,gflops
+ *
+ * `size` is the matrix dimension for the linear algebra kernels, the number
+ * of points for the batched projection kernels and 1 otherwise. `gflops` is
+ * left empty for kernels without a fixed floating point operation count.
+ *
+ * Usage:
+ *
+ *   bench_xyz [--filter NAME] [--min-time SECONDS]
+ *
+ * Build with `make benchmarks BUILD_TYPE=release ADDRESS_SANITIZER=0` to
+ * measure optimized code.
+ */
+#include "xyz.h"
+
+#define BENCH_XYZ_MAX_SIZE 384
+#define BENCH_XYZ_MAX_POINTS 4096
+
+typedef struct bench_xyz_t {
+  int n;
+
+  // Matrices
+  real_t *A;
+  real_t *B;
+  real_t *C;
+  real_t *D;
+  real_t *S; // Symmetric positive definite
+  real_t *U;
+  real_t *V;
+  real_t *b;
+  real_t *x;
+  cholmod_common common;
+
+  // Geometry
+  real_t phi[3];
+  real_t C_rot[3 * 3];
+  real_t q0[4];
+  real_t q1[4];
+  real_t T[4 * 4];
+
+  // Camera
+  camera_params_t camera;
+  real_t *points;
+  real_t *keypoints;
+} bench_xyz_t;
+
+typedef void (*bench_xyz_func_t)(bench_xyz_t *bench);
+
+/** Sink for results so the compiler keeps every kernel call **/
+static volatile real_t bench_xyz_sink = 0.0;
+
+/** Monotonic time in nano-seconds **/
+static int64_t bench_xyz_now() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+static void bench_xyz_setup(bench_xyz_t *bench) {
+  const int N = BENCH_XYZ_MAX_SIZE;
+  bench->n = 0;
+  bench->A = MALLOC(real_t, N * N);
+  bench->B = MALLOC(real_t, N * N);
+  bench->C = MALLOC(real_t, N * N);
+  bench->D = MALLOC(real_t, N * N);
+  bench->S = MALLOC(real_t, N * N);
+  bench->U = MALLOC(real_t, N * N);
+  bench->V = MALLOC(real_t, N * N);
+  bench->b = MALLOC(real_t, N);
+  bench->x = MALLOC(real_t, N);
+  randvec(-1.0, 1.0, N * N, bench->A);
+  randvec(-1.0, 1.0, N * N, bench->B);
+  randvec(-1.0, 1.0, N * N, bench->C);
+  randvec(-1.0, 1.0, N, bench->b);
+  cholmod_start(&bench->common);
+
+  // Geometry
+  const real_t phi[3] = {0.1, -0.2, 0.3};
+  const real_t q0[4] = {0.9, 0.1, 0.2, 0.3};
+  const real_t q1[4] = {0.8, -0.3, 0.1, 0.2};
+  const real_t pose[7] = {1.0, 2.0, 3.0, 0.9, 0.1, 0.2, 0.3};
+  vec_copy(phi, 3, bench->phi);
+  vec_copy(q0, 4, bench->q0);
+  vec_copy(q1, 4, bench->q1);
+  quat_normalize(bench->q0);
+  quat_normalize(bench->q1);
+  lie_Exp(phi, bench->C_rot);
+  tf(pose, bench->T);
+
+  // Camera and points in front of it
+  const int cam_res[2] = {640, 480};
+  const real_t cam_data[8] = {320, 320, 320, 240, 0.01, 0.001, 0.001, 0.001};
+  camera_params_setup(&bench->camera,
+                      0,
+                      cam_res,
+                      "pinhole",
+                      "radtan4",
+                      cam_data);
+  bench->points = MALLOC(real_t, BENCH_XYZ_MAX_POINTS * 3);
+  bench->keypoints = MALLOC(real_t, BENCH_XYZ_MAX_POINTS * 2);
+  for (int i = 0; i < BENCH_XYZ_MAX_POINTS; i++) {
+    bench->points[i * 3 + 0] = randf(-1.0, 1.0);
+    bench->points[i * 3 + 1] = randf(-1.0, 1.0);
+    bench->points[i * 3 + 2] = randf(2.0, 10.0);
+  }
+}
+
+static void bench_xyz_free(bench_xyz_t *bench) {
+  free(bench->A);
+  free(bench->B);
+  free(bench->C);
+  free(bench->D);
+  free(bench->S);
+  free(bench->U);
+  free(bench->V);
+  free(bench->b);
+  free(bench->x);
+  free(bench->points);
+  free(bench->keypoints);
+  cholmod_finish(&bench->common);
+}
+
+/**
+ * Prepare inputs of size `n`: S = A' * A + n * I is symmetric positive
+ * definite.
+ */
+static void bench_xyz_resize(bench_xyz_t *bench, const int n) {
+  bench->n = n;
+  mat_transpose(bench->A, n, n, bench->U);
+  dot(bench->U, n, n, bench->A, n, n, bench->S);
+  for (int i = 0; i < n; i++) {
+    bench->S[i * n + i] += n;
+  }
+}
+
+// KERNELS ///////////////////////////////////////////////////////////////////
+
+static void bench_dot(bench_xyz_t *bench) {
+  const int n = bench->n;
+  dot(bench->A, n, n, bench->B, n, n, bench->D);
+  bench_xyz_sink = bench->D[0];
+}
+
+static void bench_dot3(bench_xyz_t *bench) {
+  const int n = bench->n;
+  dot3(bench->A, n, n, bench->B, n, n, bench->C, n, n, bench->D);
+  bench_xyz_sink = bench->D[0];
+}
+
+static void bench_dot_XtAX(bench_xyz_t *bench) {
+  const int n = bench->n;
+  dot_XtAX(bench->A, n, n, bench->B, n, n, bench->D);
+  bench_xyz_sink = bench->D[0];
+}
+
+static void bench_chol_solve(bench_xyz_t *bench) {
+  chol_solve(bench->S, bench->b, bench->x, bench->n);
+  bench_xyz_sink = bench->x[0];
+}
+
+static void bench_suitesparse_chol_solve(bench_xyz_t *bench) {
+  const int n = bench->n;
+  suitesparse_chol_solve(&bench->common, bench->S, n, n, bench->b, n, bench->x);
+  bench_xyz_sink = bench->x[0];
+}
+
+static void bench_svd(bench_xyz_t *bench) {
+  const int n = bench->n;
+  svd(bench->A, n, n, bench->U, bench->x, bench->V);
+  bench_xyz_sink = bench->x[0];
+}
+
+static void bench_eig_sym(bench_xyz_t *bench) {
+  const int n = bench->n;
+  eig_sym(bench->S, n, n, bench->V, bench->x);
+  bench_xyz_sink = bench->x[0];
+}
+
+static void bench_lie_Exp(bench_xyz_t *bench) {
+  real_t C[3 * 3] = {0};
+  lie_Exp(bench->phi, C);
+  bench_xyz_sink = C[0];
+}
+
+static void bench_lie_Log(bench_xyz_t *bench) {
+  real_t rvec[3] = {0};
+  lie_Log(bench->C_rot, rvec);
+  bench_xyz_sink = rvec[0];
+}
+
+static void bench_quat_mul(bench_xyz_t *bench) {
+  real_t r[4] = {0};
+  quat_mul(bench->q0, bench->q1, r);
+  bench_xyz_sink = r[0];
+}
+
+static void bench_tf_point(bench_xyz_t *bench) {
+  real_t p[3] = {0};
+  tf_point(bench->T, bench->points, p);
+  bench_xyz_sink = p[0];
+}
+
+static void bench_pinhole_project(bench_xyz_t *bench) {
+  real_t z[2] = {0};
+  pinhole_project(bench->camera.data, bench->points, z);
+  bench_xyz_sink = z[0];
+}
+
+static void bench_pinhole_radtan4_project(bench_xyz_t *bench) {
+  real_t z[2] = {0};
+  pinhole_radtan4_project(bench->camera.data, bench->points, z);
+  bench_xyz_sink = z[0];
+}
+
+static void bench_pinhole_equi4_project(bench_xyz_t *bench) {
+  real_t z[2] = {0};
+  pinhole_equi4_project(bench->camera.data, bench->points, z);
+  bench_xyz_sink = z[0];
+}
+
+static void bench_camera_project(bench_xyz_t *bench) {
+  real_t z[2] = {0};
+  camera_project(&bench->camera, bench->points, z);
+  bench_xyz_sink = z[0];
+}
+
+static void bench_camera_project_points(bench_xyz_t *bench) {
+  camera_project_points(&bench->camera,
+                        bench->points,
+                        bench->n,
+                        bench->keypoints);
+  bench_xyz_sink = bench->keypoints[0];
+}
+
+// FLOP COUNTS ///////////////////////////////////////////////////////////////
+
+/** Standard dense operation counts for size `n`, 0 if not fixed **/
+static double bench_xyz_flops(const char *kernel, const int n) {
+  const double n3 = (double) n * n * n;
+  const double n2 = (double) n * n;
+  if (strcmp(kernel, "dot") == 0) {
+    return 2.0 * n3;
+  } else if (strcmp(kernel, "dot3") == 0 || strcmp(kernel, "dot_XtAX") == 0) {
+    return 4.0 * n3;
+  } else if (strcmp(kernel, "chol_solve") == 0 ||
+             strcmp(kernel, "suitesparse_chol_solve") == 0) {
+    return n3 / 3.0 + 4.0 * n2;
+  } else if (strcmp(kernel, "svd") == 0) {
+    return 22.0 * n3;
+  } else if (strcmp(kernel, "eig_sym") == 0) {
+    return 9.0 * n3;
+  } else if (strcmp(kernel, "quat_mul") == 0) {
+    return 28.0;
+  } else if (strcmp(kernel, "tf_point") == 0) {
+    return 18.0;
+  }
+  return 0.0;
+}
+
+// RUNNER ////////////////////////////////////////////////////////////////////
+
+/**
+ * Time `func` at size `n`, doubling the iterations until `min_time` seconds
+ * have elapsed, and print a CSV row.
+ */
+static void bench_xyz_run(bench_xyz_t *bench,
+                          const char *kernel,
+                          bench_xyz_func_t func,
+                          const int n,
+                          const double min_time) {
+  bench->n = n;
+  func(bench); // Warm up
+
+  int64_t iters = 1;
+  int64_t elapsed = 0;
+  while (1) {
+    const int64_t start = bench_xyz_now();
+    for (int64_t i = 0; i < iters; i++) {
+      func(bench);
+    }
+    elapsed = bench_xyz_now() - start;
+    if (elapsed >= min_time * 1e9) {
+      break;
+    }
+    iters *= 2;
+  }
+
+  const double ns_per_op = (double) elapsed / iters;
+  const double flops = bench_xyz_flops(kernel, n);
+  printf("%s,%d,%ld,%.2f,", kernel, n, iters, ns_per_op);
+  if (flops > 0.0) {
+    printf("%.4f", flops / ns_per_op);
+  }
+  printf("\n");
+  fflush(stdout);
+}
+
+static void bench_xyz_usage(const char *prog) {
+  printf("Usage: %s [--filter NAME] [--min-time SECONDS]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+  // Parse arguments
+  const char *filter = NULL;
+  double min_time = 0.1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+      min_time = atof(argv[++i]);
+    } else {
+      bench_xyz_usage(argv[0]);
+      return -1;
+    }
+  }
+
+  // Setup
+  srand(42);
+  bench_xyz_t bench;
+  bench_xyz_setup(&bench);
+
+  // Kernels and the sizes they are timed at
+  const int mat_sizes[] = {3, 6, 12, 24, 48, 96, 192, 384};
+  const int num_mat_sizes = sizeof(mat_sizes) / sizeof(int);
+  const int point_sizes[] = {1, 16, 256, 4096};
+  const int num_point_sizes = sizeof(point_sizes) / sizeof(int);
+  const struct {
+    const char *kernel;
+    bench_xyz_func_t func;
+    int sized;
+  } kernels[] = {
+      {"dot", bench_dot, 1},
+      {"dot3", bench_dot3, 1},
+      {"dot_XtAX", bench_dot_XtAX, 1},
+      {"chol_solve", bench_chol_solve, 1},
+      {"suitesparse_chol_solve", bench_suitesparse_chol_solve, 1},
+      {"svd", bench_svd, 1},
+      {"eig_sym", bench_eig_sym, 1},
+      {"lie_Exp", bench_lie_Exp, 0},
+      {"lie_Log", bench_lie_Log, 0},
+      {"quat_mul", bench_quat_mul, 0},
+      {"tf_point", bench_tf_point, 0},
+      {"pinhole_project", bench_pinhole_project, 0},
+      {"pinhole_radtan4_project", bench_pinhole_radtan4_project, 0},
+      {"pinhole_equi4_project", bench_pinhole_equi4_project, 0},
+      {"camera_project", bench_camera_project, 0},
+      {"camera_project_points", bench_camera_project_points, 2},
+  };
+  const int num_kernels = sizeof(kernels) / sizeof(kernels[0]);
+
+  // Run
+  printf("kernel,size,iters,ns_per_op,gflops\n");
+  for (int k = 0; k < num_kernels; k++) {
+    const char *kernel = kernels[k].kernel;
+    if (filter && strstr(kernel, filter) == NULL) {
+      continue;
+    }
+
+    if (kernels[k].sized == 1) {
+      for (int i = 0; i < num_mat_sizes; i++) {
+        bench_xyz_resize(&bench, mat_sizes[i]);
+        bench_xyz_run(&bench, kernel, kernels[k].func, mat_sizes[i], min_time);
+      }
+    } else if (kernels[k].sized == 2) {
+      for (int i = 0; i < num_point_sizes; i++) {
+        const int n = point_sizes[i];
+        bench_xyz_run(&bench, kernel, kernels[k].func, n, min_time);
+      }
+    } else {
+      bench_xyz_run(&bench, kernel, kernels[k].func, 1, min_time);
+    }
+  }
+
+  // Clean up
+  bench_xyz_free(&bench);
+
+  return 0;
+}
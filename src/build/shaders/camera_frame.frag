@@ -0,0 +1,7 @@
+#version 150 core
+
+out vec4 FragColor;
+
+void main() {
+  FragColor = vec4(1.0f, 1.0f, 1.0f, 1.0f);
+}
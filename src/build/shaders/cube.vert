@@ -0,0 +1,13 @@
+#version 330 core
+layout (location = 0) in vec3 in_pos;
+layout (location = 1) in vec3 in_color;
+out vec3 color;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+void main() {
+  gl_Position = projection * view * model * vec4(in_pos, 1.0);
+  color = in_color;
+}
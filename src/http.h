@@ -5,6 +5,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include <netdb.h>
 #include <netinet/in.h>
@@ -12,9 +16,14 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/poll.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 #include <openssl/sha.h>
 
+#include "xyz.h"
+
 /** Macro that adds the ability to switch between C / C++ style mallocs */
 #ifdef __cplusplus
 
@@ -178,6 +187,8 @@
 #define WS_PONG 0xA
 #define WS_MASK_ON 0x80
 #define WS_MASK_OFF 0x00
+#define WS_HEADER_MAX_SIZE 14 // 2 + 8 byte extended length + 4 byte mask
+#define WS_IOV_MAX 16
 
 #define WEBSOCKET_HANDSHAKE_RESPONSE                                           \
   "HTTP/1.1 101 Switching Protocols\r\n"                                       \
@@ -214,6 +225,57 @@ typedef struct ws_frame_t {
   uint8_t *payload_data;
 } ws_frame_t;
 
+#define WS_SERVER_MAX_EVENTS 64
+#define WS_SERVER_MAX_TOPICS 64
+#define WS_SERVER_TOPIC_SIZE 32
+#define WS_CLIENT_BUF_SIZE 8192
+#define WS_CLIENT_SUB_SIZE 1024
+#ifndef WS_CLIENT_QUEUE_SIZE
+#define WS_CLIENT_QUEUE_SIZE 64
+#endif
+
+// Serialized websocket frame shared by the clients it is queued to
+typedef struct ws_msg_t {
+  size_t refs;
+  size_t size;
+  uint8_t *data;
+} ws_msg_t;
+
+// Websocket server client
+typedef struct ws_client_t {
+  int fd;
+  int open;
+  int want_write;
+  uint64_t topics;
+  char subscription[WS_CLIENT_SUB_SIZE];
+
+  // Bounded send queue, the oldest message is dropped when full
+  ws_msg_t *queue[WS_CLIENT_QUEUE_SIZE];
+  size_t head;
+  size_t count;
+  size_t offset;
+  size_t nb_dropped;
+
+  // Receive buffer
+  uint8_t buf[WS_CLIENT_BUF_SIZE];
+  size_t size;
+} ws_client_t;
+
+// Websocket publish / subscribe server
+typedef struct ws_server_t {
+  int sockfd;
+  int epfd;
+  int evfd;
+  int loop;
+
+  pthread_mutex_t mutex;
+  char topics[WS_SERVER_MAX_TOPICS][WS_SERVER_TOPIC_SIZE];
+  int nb_topics;
+  ws_client_t **clients;
+  size_t nb_clients;
+  size_t max_clients;
+} ws_server_t;
+
 char *base64_encode(const uint8_t *data, size_t in_len, size_t *out_len);
 uint8_t *base64_decode(const char *data, size_t in_len, size_t *out_len);
 
@@ -231,12 +293,38 @@ int ws_frame_rsv_bit(uint8_t *data_frame);
 int ws_frame_op_code(uint8_t *data_frame);
 int ws_frame_mask_enabled(uint8_t *data_frame);
 ws_frame_t *ws_frame_parse(int connfd);
+size_t ws_frame_header(uint8_t header[WS_HEADER_MAX_SIZE],
+                       const uint8_t flags_opcode,
+                       const size_t payload_size,
+                       const uint8_t *mask);
+ssize_t ws_frame_decode(uint8_t *data, const size_t length, ws_frame_t *frame);
+int ws_writev(const int connfd, struct iovec *iov, int iovcnt);
+int ws_sendv(const int connfd,
+             const uint8_t flags_opcode,
+             const struct iovec *payload,
+             const int iovcnt);
+int ws_send_frame(const int connfd,
+                  const uint8_t flags_opcode,
+                  const uint8_t *payload,
+                  const size_t payload_size);
+int ws_send_binary(const int connfd, const void *data, const size_t size);
 
 char *ws_recv(int connfd);
 void ws_send(int connfd, const uint8_t *msg);
 char *ws_read(ws_frame_t *ws_frame);
 char *ws_hash(const char *ws_key);
+int ws_handshake_respond(const int connfd, const char *ws_key);
 int ws_handshake(const int connfd);
+
+int ws_server_setup(ws_server_t *server, const int port);
+void ws_server_free(ws_server_t *server);
+int ws_server_loop(ws_server_t *server);
+void ws_server_stop(ws_server_t *server);
+int ws_server_publish(ws_server_t *server,
+                      const char *topic,
+                      const uint8_t opcode,
+                      const void *data,
+                      const size_t size);
 int ws_server();
 
 #endif // HTTP_H
@@ -527,7 +615,7 @@ uint8_t *ws_frame_serialize(ws_frame_t *frame) {
   size_t header_size = 0;
   size_t payload_size = frame->payload_size;
 
-  if (payload_size <= 126) {
+  if (payload_size < 126) {
     header[1] = (uint8_t)(payload_size & 0x00000000000000FFU);
     header_size = 2;
 
@@ -577,8 +665,8 @@ int ws_frame_mask_enabled(uint8_t *data_frame) {
 ws_frame_t *ws_frame_parse(int connfd) {
   // Parse header
   uint8_t header[2] = {0};
-  int retval = (int) recv(connfd, header, 2, 0);
-  if (retval != 0) {
+  ssize_t retval = recv(connfd, header, 2, MSG_WAITALL);
+  if (retval != 2) {
     return NULL;
   }
   ws_frame_t *ws_frame = ws_frame_malloc();
@@ -589,8 +677,9 @@ ws_frame_t *ws_frame_parse(int connfd) {
   if (ws_frame->payload_size == 126) {
     // Obtain extended data size - 2 bytes
     uint8_t buf_2bytes[2] = {0};
-    retval = (int) recv(connfd, buf_2bytes, 2, 0);
-    if (retval != 0) {
+    retval = recv(connfd, buf_2bytes, 2, MSG_WAITALL);
+    if (retval != 2) {
+      ws_frame_free(ws_frame);
       return NULL;
     }
 
@@ -601,8 +690,9 @@ ws_frame_t *ws_frame_parse(int connfd) {
   } else if (ws_frame->payload_size == 127) {
     // Obtain extended data size - 8 bytes
     uint8_t buf_8bytes[8] = {0};
-    retval = (int) recv(connfd, buf_8bytes, 8, 0);
-    if (retval != 0) {
+    retval = recv(connfd, buf_8bytes, 8, MSG_WAITALL);
+    if (retval != 8) {
+      ws_frame_free(ws_frame);
       return NULL;
     }
 
@@ -621,8 +711,9 @@ ws_frame_t *ws_frame_parse(int connfd) {
   // Recv mask
   uint8_t mask[4] = {0};
   if (ws_frame_mask_enabled(header)) {
-    retval = (int) recv(connfd, mask, 4, 0);
-    if (retval != 0) {
+    retval = recv(connfd, mask, 4, MSG_WAITALL);
+    if (retval != 4) {
+      ws_frame_free(ws_frame);
       return NULL;
     }
   }
@@ -630,8 +721,10 @@ ws_frame_t *ws_frame_parse(int connfd) {
   // Recv payload
   if (ws_frame->payload_size) {
     uint8_t *payload_data = CALLOC(uint8_t, ws_frame->payload_size);
-    retval = (int) recv(connfd, payload_data, ws_frame->payload_size, 0);
-    if (retval != 0) {
+    retval = recv(connfd, payload_data, ws_frame->payload_size, MSG_WAITALL);
+    if (retval != (ssize_t) ws_frame->payload_size) {
+      free(payload_data);
+      ws_frame_free(ws_frame);
       return NULL;
     }
 
@@ -647,6 +740,188 @@ ws_frame_t *ws_frame_parse(int connfd) {
   return ws_frame;
 }
 
+/**
+ * Build a websocket frame header for a `payload_size` bytes payload in
+ * `header`, picking the 7-bit, 16-bit or 64-bit length encoding. A non-NULL
+ * 4 byte `mask` sets the mask bit and appends the masking key. Returns the
+ * header size.
+ */
+size_t ws_frame_header(uint8_t header[WS_HEADER_MAX_SIZE],
+                       const uint8_t flags_opcode,
+                       const size_t payload_size,
+                       const uint8_t *mask) {
+  const uint8_t mask_bit = (mask) ? WS_MASK_ON : WS_MASK_OFF;
+  size_t header_size = 0;
+  header[0] = flags_opcode;
+
+  if (payload_size < 126) {
+    header[1] = mask_bit | (uint8_t) payload_size;
+    header_size = 2;
+
+  } else if (payload_size <= 65535) {
+    header[1] = mask_bit | 0x7E;
+    header[2] = (payload_size >> 8) & 0xFF;
+    header[3] = payload_size & 0xFF;
+    header_size = 4;
+
+  } else {
+    const uint64_t size = payload_size;
+    header[1] = mask_bit | 0x7F;
+    for (int i = 0; i < 8; i++) {
+      header[2 + i] = (size >> (56 - 8 * i)) & 0xFF;
+    }
+    header_size = 10;
+  }
+
+  if (mask) {
+    memcpy(header + header_size, mask, 4);
+    header_size += 4;
+  }
+
+  return header_size;
+}
+
+/**
+ * Decode the websocket frame at the start of `data` in place. On success
+ * `frame->payload_data` points into `data` and a masked payload is unmasked
+ * in place. Returns the frame size, 0 if `length` does not hold a complete
+ * frame yet, or -1 if the frame is invalid.
+ */
+ssize_t ws_frame_decode(uint8_t *data, const size_t length, ws_frame_t *frame) {
+  // Header
+  if (length < 2) {
+    return 0;
+  }
+  size_t header_size = 2;
+  uint64_t payload_size = data[1] & 0x7F;
+  if (payload_size == 126) {
+    header_size += 2;
+    if (length < header_size) {
+      return 0;
+    }
+    payload_size = ((uint64_t) data[2] << 8) | data[3];
+
+  } else if (payload_size == 127) {
+    header_size += 8;
+    if (length < header_size) {
+      return 0;
+    }
+    payload_size = 0;
+    for (int i = 0; i < 8; i++) {
+      payload_size = (payload_size << 8) | data[2 + i];
+    }
+    if (payload_size >> 63) {
+      return -1;
+    }
+  }
+
+  // Mask
+  const int masked = ws_frame_mask_enabled(data);
+  if (masked) {
+    if (length < header_size + 4) {
+      return 0;
+    }
+    memcpy(frame->mask, data + header_size, 4);
+    header_size += 4;
+  } else {
+    memset(frame->mask, 0, 4);
+  }
+
+  // Payload
+  if (payload_size > length - header_size) {
+    return 0;
+  }
+  frame->header = data[0];
+  frame->payload_size = payload_size;
+  frame->payload_data = data + header_size;
+  if (masked) {
+    uint8_t *payload = frame->payload_data;
+    for (size_t i = 0; i < payload_size; i++) {
+      payload[i] ^= frame->mask[i & 3];
+    }
+  }
+
+  return header_size + payload_size;
+}
+
+/**
+ * Write all of `iov` to `connfd`, resuming after partial writes. `iov` is
+ * modified. Returns 0 on success or -1 on failure.
+ */
+int ws_writev(const int connfd, struct iovec *iov, int iovcnt) {
+  while (iovcnt > 0) {
+    const ssize_t wrote = writev(connfd, iov, iovcnt);
+    if (wrote < 0 && errno == EINTR) {
+      continue;
+    } else if (wrote < 0) {
+      return -1;
+    }
+
+    // Skip the buffers written
+    size_t n = wrote;
+    while (iovcnt > 0 && n >= iov->iov_len) {
+      n -= iov->iov_len;
+      iov++;
+      iovcnt--;
+    }
+    if (iovcnt > 0) {
+      iov->iov_base = (uint8_t *) iov->iov_base + n;
+      iov->iov_len -= n;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * Send one unmasked websocket frame whose payload is gathered from the
+ * `iovcnt` buffers in `payload`, without copying them. At most
+ * `WS_IOV_MAX - 1` buffers are supported. Returns 0 or -1 on failure.
+ */
+int ws_sendv(const int connfd,
+             const uint8_t flags_opcode,
+             const struct iovec *payload,
+             const int iovcnt) {
+  if (iovcnt < 0 || iovcnt >= WS_IOV_MAX) {
+    return -1;
+  }
+
+  size_t payload_size = 0;
+  for (int i = 0; i < iovcnt; i++) {
+    payload_size += payload[i].iov_len;
+  }
+
+  uint8_t header[WS_HEADER_MAX_SIZE];
+  struct iovec iov[WS_IOV_MAX];
+  iov[0].iov_base = header;
+  iov[0].iov_len = ws_frame_header(header, flags_opcode, payload_size, NULL);
+  memcpy(iov + 1, payload, sizeof(struct iovec) * iovcnt);
+
+  return ws_writev(connfd, iov, iovcnt + 1);
+}
+
+/**
+ * Send one unmasked websocket frame with `payload`, returns 0 or -1 on
+ * failure.
+ */
+int ws_send_frame(const int connfd,
+                  const uint8_t flags_opcode,
+                  const uint8_t *payload,
+                  const size_t payload_size) {
+  struct iovec iov;
+  iov.iov_base = (void *) payload;
+  iov.iov_len = payload_size;
+  return ws_sendv(connfd, flags_opcode, &iov, 1);
+}
+
+/**
+ * Send `data` as a single binary websocket message, returns 0 or -1 on
+ * failure.
+ */
+int ws_send_binary(const int connfd, const void *data, const size_t size) {
+  return ws_send_frame(connfd, WS_FIN | WS_BIN, data, size);
+}
+
 char *ws_recv(int connfd) {
   ws_frame_t *frame = ws_frame_parse(connfd);
   if (frame->header != WS_TEXT || frame->header != (WS_FIN | WS_TEXT)) {
@@ -658,22 +933,9 @@ char *ws_recv(int connfd) {
 }
 
 void ws_send(int connfd, const uint8_t *msg) {
-  // Setup
-  ws_frame_t *frame = ws_frame_malloc();
-  frame->header = WS_FIN | WS_TEXT;
-  frame->payload_size = strlen((char *) msg);
-  frame->payload_data = MALLOC(uint8_t, strlen((const char *) msg));
-  memcpy(frame->payload_data, (const char *) msg, strlen((const char *) msg));
-
-  // Write
-  uint8_t *frame_bytes = ws_frame_serialize(frame);
-  const size_t wrote = write(connfd, frame_bytes, frame->payload_size + 2);
-  UNUSED(wrote);
-
-  // Clean up
-  free(frame_bytes);
-  free(frame->payload_data);
-  ws_frame_free(frame);
+  const size_t length = strlen((const char *) msg);
+  const int retval = ws_send_frame(connfd, WS_FIN | WS_TEXT, msg, length);
+  UNUSED(retval);
 }
 
 char *ws_read(ws_frame_t *ws_frame) {
@@ -705,6 +967,19 @@ char *ws_hash(const char *ws_key) {
   return base64_encode(hash, SHA_DIGEST_LENGTH, &length);
 }
 
+/**
+ * Accept websocket handshake with key `ws_key`, returns 0 or -1 on failure.
+ */
+int ws_handshake_respond(const int connfd, const char *ws_key) {
+  char *hash = ws_hash(ws_key);
+  char resp[1024] = {0};
+  snprintf(resp, sizeof(resp), WEBSOCKET_HANDSHAKE_RESPONSE, hash);
+  free(hash);
+
+  const ssize_t length = strlen(resp);
+  return (send(connfd, resp, length, MSG_NOSIGNAL) == length) ? 0 : -1;
+}
+
 int ws_handshake(const int connfd) {
   // Get incoming websocket handshake request
   char buf[9046] = {0};
@@ -725,45 +1000,549 @@ int ws_handshake(const int connfd) {
   http_msg_free(&req);
 
   // Respond websocket handshake and establish connection
-  char *hash = ws_hash(ws_key);
-  char resp[1024] = {0};
-  snprintf(resp, sizeof(resp), WEBSOCKET_HANDSHAKE_RESPONSE, hash);
-  const size_t wrote = write(connfd, resp, strlen(resp));
-  UNUSED(wrote);
-  free(hash);
+  return ws_handshake_respond(connfd, ws_key);
+}
+
+/**
+ * Release a reference to `msg`, freeing it with the last reference.
+ */
+static void ws_msg_release(ws_msg_t *msg) {
+  if (--msg->refs == 0) {
+    free(msg);
+  }
+}
+
+/**
+ * Queue `msg` on `client`. When the queue is full the oldest message that
+ * has not started sending is dropped.
+ */
+static void ws_client_push(ws_client_t *client, ws_msg_t *msg) {
+  if (client->count == WS_CLIENT_QUEUE_SIZE) {
+    const size_t head = client->head;
+    const size_t next = (head + 1) % WS_CLIENT_QUEUE_SIZE;
+    if (client->offset > 0) {
+      // Keep the partially sent message at the head
+      ws_msg_release(client->queue[next]);
+      client->queue[next] = client->queue[head];
+    } else {
+      ws_msg_release(client->queue[head]);
+    }
+    client->head = next;
+    client->count--;
+    client->nb_dropped++;
+  }
+
+  const size_t tail = (client->head + client->count) % WS_CLIENT_QUEUE_SIZE;
+  client->queue[tail] = msg;
+  client->count++;
+  msg->refs++;
+}
+
+/**
+ * Close `client` and release its queue, the client is freed by the event
+ * loop. Called with the server mutex held.
+ */
+static void ws_client_close(ws_server_t *server, ws_client_t *client) {
+  if (client->fd == -1) {
+    return;
+  }
+
+  epoll_ctl(server->epfd, EPOLL_CTL_DEL, client->fd, NULL);
+  close(client->fd);
+  client->fd = -1;
+  client->open = 0;
+  for (size_t i = 0; i < client->count; i++) {
+    ws_msg_release(client->queue[(client->head + i) % WS_CLIENT_QUEUE_SIZE]);
+  }
+  client->count = 0;
+}
+
+/**
+ * Write as much of the client's queue as the socket accepts, and only poll
+ * for writability while a backlog remains. Called with the server mutex
+ * held.
+ */
+static void ws_client_flush(ws_server_t *server, ws_client_t *client) {
+  while (client->fd != -1 && client->count > 0) {
+    // Gather queued messages
+    struct iovec iov[WS_IOV_MAX];
+    int iovcnt = 0;
+    for (size_t i = 0; i < client->count && iovcnt < WS_IOV_MAX; i++) {
+      const size_t idx = (client->head + i) % WS_CLIENT_QUEUE_SIZE;
+      const size_t offset = (i == 0) ? client->offset : 0;
+      iov[iovcnt].iov_base = client->queue[idx]->data + offset;
+      iov[iovcnt].iov_len = client->queue[idx]->size - offset;
+      iovcnt++;
+    }
+
+    // A viewer that went away fails with EPIPE / ECONNRESET, not SIGPIPE
+    struct msghdr hdr = {0};
+    hdr.msg_iov = iov;
+    hdr.msg_iovlen = iovcnt;
+    const ssize_t wrote =
+        sendmsg(client->fd, &hdr, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (wrote < 0 && errno == EINTR) {
+      continue;
+    } else if (wrote < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    } else if (wrote < 0) {
+      ws_client_close(server, client);
+      return;
+    }
+
+    // Release the messages sent
+    size_t n = wrote;
+    while (client->count > 0) {
+      ws_msg_t *msg = client->queue[client->head];
+      const size_t remaining = msg->size - client->offset;
+      if (n < remaining) {
+        client->offset += n;
+        break;
+      }
+      n -= remaining;
+      ws_msg_release(msg);
+      client->head = (client->head + 1) % WS_CLIENT_QUEUE_SIZE;
+      client->count--;
+      client->offset = 0;
+    }
+  }
+
+  // Poll for writability only while there is a backlog
+  const int want_write = (client->fd != -1 && client->count > 0);
+  if (client->fd != -1 && want_write != client->want_write) {
+    struct epoll_event event;
+    event.events = EPOLLIN | (want_write ? EPOLLOUT : 0);
+    event.data.ptr = client;
+    epoll_ctl(server->epfd, EPOLL_CTL_MOD, client->fd, &event);
+    client->want_write = want_write;
+  }
+}
+
+/**
+ * Check if `client` subscribed to `topic`. The subscription is the request
+ * path's comma separated topic list, e.g. "pose,imu".
+ */
+static int ws_client_subscribed(const ws_client_t *client, const char *topic) {
+  const size_t len = strnlen(topic, WS_SERVER_TOPIC_SIZE - 1);
+  const char *tok = client->subscription;
+  while (*tok != '\0') {
+    const char *tok_end = strchr(tok, ',');
+    const size_t tok_len = (tok_end) ? (size_t) (tok_end - tok) : strlen(tok);
+    if (tok_len == len && strncmp(tok, topic, len) == 0) {
+      return 1;
+    }
+    tok += tok_len + (tok_end != NULL);
+  }
 
   return 0;
 }
 
-int ws_server() {
-  // Setup server
-  tcp_server_t server;
-  const int port = 5000;
-  if (tcp_server_setup(&server, port) != 0) {
+/**
+ * Topic index of `topic`, adding it if it does not exist yet. Topics are only
+ * added by the server when publishing, clients that already subscribed to a
+ * new topic are added to it. Returns -1 if the topic table is full. Called
+ * with the server mutex held.
+ */
+static int ws_server_topic(ws_server_t *server, const char *topic) {
+  for (int i = 0; i < server->nb_topics; i++) {
+    if (strncmp(server->topics[i], topic, WS_SERVER_TOPIC_SIZE - 1) == 0) {
+      return i;
+    }
+  }
+  if (server->nb_topics == WS_SERVER_MAX_TOPICS) {
     return -1;
   }
 
-  // Server is ready to listen
-  if ((listen(server.sockfd, 5)) != 0) {
+  const int idx = server->nb_topics++;
+  strncpy(server->topics[idx], topic, WS_SERVER_TOPIC_SIZE - 1);
+  server->topics[idx][WS_SERVER_TOPIC_SIZE - 1] = '\0';
+  for (size_t i = 0; i < server->nb_clients; i++) {
+    ws_client_t *client = server->clients[i];
+    if (ws_client_subscribed(client, server->topics[idx])) {
+      client->topics |= (uint64_t) 1 << idx;
+    }
+  }
+
+  return idx;
+}
+
+/**
+ * Complete the client's websocket handshake once the HTTP request has been
+ * received. The request path selects the topics, e.g. "/pose,imu", while an
+ * empty path or "*" subscribes to all topics. Called with the server mutex
+ * held.
+ */
+static void ws_client_handshake(ws_server_t *server, ws_client_t *client) {
+  // Wait for the complete request
+  client->buf[client->size] = '\0';
+  char *end = strstr((char *) client->buf, "\r\n\r\n");
+  if (end == NULL) {
+    if (client->size == WS_CLIENT_BUF_SIZE - 1) {
+      ws_client_close(server, client);
+    }
+    return;
+  }
+  const size_t request_size = (end + 4) - (char *) client->buf;
+  *end = '\0';
+
+  // Parse request
+  http_msg_t req;
+  http_msg_setup(&req);
+  http_parse_request((char *) client->buf, &req);
+  if (req.sec_websocket_key == NULL || req.path == NULL) {
+    http_msg_free(&req);
+    ws_client_close(server, client);
+    return;
+  }
+
+  // Subscribe to topics, topics the server has not published yet are
+  // resolved when they are first published
+  client->topics = 0;
+  client->subscription[0] = '\0';
+  const char *path = (req.path[0] == '/') ? req.path + 1 : req.path;
+  if (path[0] == '\0' || strcmp(path, "*") == 0) {
+    client->topics = ~(uint64_t) 0;
+  } else {
+    strncpy(client->subscription, path, WS_CLIENT_SUB_SIZE - 1);
+    client->subscription[WS_CLIENT_SUB_SIZE - 1] = '\0';
+    for (int i = 0; i < server->nb_topics; i++) {
+      if (ws_client_subscribed(client, server->topics[i])) {
+        client->topics |= (uint64_t) 1 << i;
+      }
+    }
+  }
+
+  // Respond
+  const int retval = ws_handshake_respond(client->fd, req.sec_websocket_key);
+  http_msg_free(&req);
+  if (retval != 0) {
+    ws_client_close(server, client);
+    return;
+  }
+  client->open = 1;
+
+  // Keep any frames that followed the request
+  client->size -= request_size;
+  memmove(client->buf, client->buf + request_size, client->size);
+}
+
+/**
+ * Read from client, completing the handshake or handling its frames. Called
+ * with the server mutex held.
+ */
+static void ws_client_recv(ws_server_t *server, ws_client_t *client) {
+  const size_t space = WS_CLIENT_BUF_SIZE - 1 - client->size;
+  const ssize_t n = recv(client->fd, client->buf + client->size, space, 0);
+  if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+    ws_client_close(server, client);
+    return;
+  } else if (n < 0) {
+    return;
+  }
+  client->size += n;
+
+  // Handshake
+  if (client->open == 0) {
+    ws_client_handshake(server, client);
+  }
+
+  // Frames
+  size_t offset = 0;
+  while (client->open && offset < client->size) {
+    ws_frame_t frame;
+    const ssize_t frame_size = ws_frame_decode(client->buf + offset,
+                                               client->size - offset,
+                                               &frame);
+    if (frame_size < 0 || (frame_size == 0 && offset == 0 &&
+                           client->size == WS_CLIENT_BUF_SIZE - 1)) {
+      ws_client_close(server, client);
+      return;
+    } else if (frame_size == 0) {
+      break;
+    }
+    offset += frame_size;
+
+    const int opcode = frame.header & 0x0F;
+    if (opcode == WS_CLOSE) {
+      ws_client_close(server, client);
+      return;
+    } else if (opcode == WS_PING && frame.payload_size <= 125) {
+      ws_msg_t *pong = malloc(sizeof(ws_msg_t) + 2 + frame.payload_size);
+      pong->refs = 0;
+      pong->data = (uint8_t *) (pong + 1);
+      pong->size = 2 + frame.payload_size;
+      ws_frame_header(pong->data, WS_FIN | WS_PONG, frame.payload_size, NULL);
+      memcpy(pong->data + 2, frame.payload_data, frame.payload_size);
+      ws_client_push(client, pong);
+      ws_client_flush(server, client);
+    }
+  }
+  if (client->fd != -1) {
+    client->size -= offset;
+    memmove(client->buf, client->buf + offset, client->size);
+  }
+}
+
+/**
+ * Accept pending connections. Called with the server mutex held.
+ */
+static void ws_server_accept(ws_server_t *server) {
+  while (1) {
+    const int fd = accept(server->sockfd, NULL, NULL);
+    if (fd < 0) {
+      return;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    // Grow clients
+    if (server->nb_clients == server->max_clients) {
+      const size_t max_clients =
+          (server->max_clients) ? server->max_clients * 2 : 16;
+      void *clients =
+          realloc(server->clients, sizeof(ws_client_t *) * max_clients);
+      if (clients == NULL) {
+        close(fd);
+        return;
+      }
+      server->clients = clients;
+      server->max_clients = max_clients;
+    }
+
+    // Add client
+    ws_client_t *client = CALLOC(ws_client_t, 1);
+    client->fd = fd;
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = client;
+    if (epoll_ctl(server->epfd, EPOLL_CTL_ADD, fd, &event) != 0) {
+      close(fd);
+      free(client);
+      continue;
+    }
+    server->clients[server->nb_clients++] = client;
+  }
+}
+
+/**
+ * Free closed clients. Called with the server mutex held.
+ */
+static void ws_server_reap(ws_server_t *server) {
+  size_t k = 0;
+  for (size_t i = 0; i < server->nb_clients; i++) {
+    if (server->clients[i]->fd == -1) {
+      free(server->clients[i]);
+    } else {
+      server->clients[k++] = server->clients[i];
+    }
+  }
+  server->nb_clients = k;
+}
+
+/**
+ * Setup a non-blocking websocket server listening on `port`, returns 0 or
+ * -1 on failure.
+ */
+int ws_server_setup(ws_server_t *server, const int port) {
+  server->sockfd = -1;
+  server->epfd = -1;
+  server->evfd = -1;
+  server->loop = 1;
+  pthread_mutex_init(&server->mutex, NULL);
+  server->nb_topics = 0;
+  server->clients = NULL;
+  server->nb_clients = 0;
+  server->max_clients = 0;
+
+  // Listen
+  tcp_server_t tcp;
+  if (tcp_server_setup(&tcp, port) != 0) {
+    ws_server_free(server);
+    return -1;
+  }
+  server->sockfd = tcp.sockfd;
+  if (listen(server->sockfd, 64) != 0) {
     HTTP_ERROR("Listen failed...");
+    ws_server_free(server);
     return -1;
   }
+  fcntl(server->sockfd, F_SETFL, fcntl(server->sockfd, F_GETFL) | O_NONBLOCK);
 
-  // Accept incomming connections
-  struct sockaddr_in sockaddr;
-  socklen_t len = sizeof(sockaddr);
-  int connfd = accept(server.sockfd, (struct sockaddr *) &sockaddr, &len);
-  if (connfd < 0) {
-    HTTP_ERROR("Server acccept failed!");
+  // Event loop, the eventfd wakes the loop on publish and stop
+  server->epfd = epoll_create1(0);
+  server->evfd = eventfd(0, EFD_NONBLOCK);
+  if (server->epfd == -1 || server->evfd == -1) {
+    ws_server_free(server);
     return -1;
   }
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.ptr = &server->sockfd;
+  epoll_ctl(server->epfd, EPOLL_CTL_ADD, server->sockfd, &event);
+  event.data.ptr = &server->evfd;
+  epoll_ctl(server->epfd, EPOLL_CTL_ADD, server->evfd, &event);
+
+  return 0;
+}
+
+/**
+ * Free websocket server, the event loop must have returned.
+ */
+void ws_server_free(ws_server_t *server) {
+  for (size_t i = 0; i < server->nb_clients; i++) {
+    ws_client_close(server, server->clients[i]);
+  }
+  ws_server_reap(server);
+  free(server->clients);
+  server->clients = NULL;
+
+  if (server->sockfd != -1) {
+    close(server->sockfd);
+  }
+  if (server->epfd != -1) {
+    close(server->epfd);
+  }
+  if (server->evfd != -1) {
+    close(server->evfd);
+  }
+  server->sockfd = -1;
+  server->epfd = -1;
+  server->evfd = -1;
+  pthread_mutex_destroy(&server->mutex);
+}
+
+/**
+ * Run the websocket server event loop until `ws_server_stop()` is called.
+ * Returns 0 or -1 on failure.
+ */
+int ws_server_loop(ws_server_t *server) {
+  struct epoll_event events[WS_SERVER_MAX_EVENTS];
+  while (__atomic_load_n(&server->loop, __ATOMIC_ACQUIRE)) {
+    const int n = epoll_wait(server->epfd, events, WS_SERVER_MAX_EVENTS, 100);
+    if (n < 0 && errno != EINTR) {
+      return -1;
+    }
+
+    pthread_mutex_lock(&server->mutex);
+    for (int i = 0; i < n; i++) {
+      void *ptr = events[i].data.ptr;
+      if (ptr == &server->sockfd) {
+        ws_server_accept(server);
+        continue;
+      }
+
+      if (ptr == &server->evfd) {
+        // Flush messages published since the last wake up
+        uint64_t count = 0;
+        UNUSED(read(server->evfd, &count, sizeof(count)));
+        for (size_t k = 0; k < server->nb_clients; k++) {
+          ws_client_t *client = server->clients[k];
+          if (client->count && client->want_write == 0) {
+            ws_client_flush(server, client);
+          }
+        }
+        continue;
+      }
+
+      ws_client_t *client = (ws_client_t *) ptr;
+      if (client->fd == -1) {
+        continue;
+      }
+      if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+        ws_client_close(server, client);
+        continue;
+      }
+      if (events[i].events & EPOLLIN) {
+        ws_client_recv(server, client);
+      }
+      if (client->fd != -1 && (events[i].events & EPOLLOUT)) {
+        ws_client_flush(server, client);
+      }
+    }
+    ws_server_reap(server);
+    pthread_mutex_unlock(&server->mutex);
+  }
+
+  return 0;
+}
+
+/**
+ * Stop the websocket server event loop, safe to call from any thread.
+ */
+void ws_server_stop(ws_server_t *server) {
+  __atomic_store_n(&server->loop, 0, __ATOMIC_RELEASE);
+  const uint64_t one = 1;
+  UNUSED(write(server->evfd, &one, sizeof(one)));
+}
+
+/**
+ * Publish `data` to the clients subscribed to `topic` as one websocket
+ * message with `opcode` WS_TEXT or WS_BIN. The message is serialized once
+ * and queued on every subscriber without blocking on their sockets, slow
+ * clients drop their oldest messages instead. Safe to call from any thread.
+ * Returns the number of clients the message was queued on, or -1 on
+ * failure.
+ */
+int ws_server_publish(ws_server_t *server,
+                      const char *topic,
+                      const uint8_t opcode,
+                      const void *data,
+                      const size_t size) {
+  // Serialize
+  ws_msg_t *msg = malloc(sizeof(ws_msg_t) + WS_HEADER_MAX_SIZE + size);
+  if (msg == NULL) {
+    return -1;
+  }
+  msg->refs = 0;
+  msg->data = (uint8_t *) (msg + 1);
+  msg->size = ws_frame_header(msg->data, WS_FIN | opcode, size, NULL);
+  memcpy(msg->data + msg->size, data, size);
+  msg->size += size;
+
+  // Queue on subscribers
+  int nb_queued = 0;
+  pthread_mutex_lock(&server->mutex);
+  const int idx = ws_server_topic(server, topic);
+  const uint64_t topic_bit = (idx >= 0) ? ((uint64_t) 1 << idx) : 0;
+  for (size_t i = 0; i < server->nb_clients; i++) {
+    ws_client_t *client = server->clients[i];
+    if (client->open && (client->topics & topic_bit)) {
+      ws_client_push(client, msg);
+      nb_queued++;
+    }
+  }
+  pthread_mutex_unlock(&server->mutex);
+
+  // Wake up event loop
+  if (nb_queued == 0) {
+    free(msg);
+    return (idx >= 0) ? 0 : -1;
+  }
+  const uint64_t one = 1;
+  UNUSED(write(server->evfd, &one, sizeof(one)));
+
+  return nb_queued;
+}
+
+static void *ws_server_thread(void *arg) {
+  ws_server_loop((ws_server_t *) arg);
+  return NULL;
+}
 
-  // Perform websocket handshake
-  ws_handshake(connfd);
+int ws_server() {
+  // Setup server
+  ws_server_t server;
+  const int port = 5000;
+  if (ws_server_setup(&server, port) != 0) {
+    return -1;
+  }
+  pthread_t thread;
+  pthread_create(&thread, NULL, ws_server_thread, &server);
 
+  // Publish to clients connected to ws://localhost:5000/hello
   while (1) {
     const char *msg = "Hello World!";
-    ws_send(connfd, (const uint8_t *) msg);
+    ws_server_publish(&server, "hello", WS_TEXT, msg, strlen(msg));
+    usleep(100 * 1000);
   }
 
   return 0;
@@ -888,6 +1667,368 @@ int test_ws_hash() {
   return 0;
 }
 
+int test_ws_frame_header() {
+  uint8_t header[WS_HEADER_MAX_SIZE] = {0};
+
+  // 7-bit length
+  TEST_ASSERT(ws_frame_header(header, WS_FIN | WS_BIN, 125, NULL) == 2);
+  TEST_ASSERT(header[0] == (WS_FIN | WS_BIN));
+  TEST_ASSERT(header[1] == 125);
+
+  // 16-bit length
+  TEST_ASSERT(ws_frame_header(header, WS_FIN | WS_BIN, 126, NULL) == 4);
+  TEST_ASSERT(header[1] == 126);
+  TEST_ASSERT(header[2] == 0x00 && header[3] == 0x7E);
+  TEST_ASSERT(ws_frame_header(header, WS_FIN | WS_BIN, 65535, NULL) == 4);
+  TEST_ASSERT(header[2] == 0xFF && header[3] == 0xFF);
+
+  // 64-bit length
+  TEST_ASSERT(ws_frame_header(header, WS_FIN | WS_BIN, 65536, NULL) == 10);
+  TEST_ASSERT(header[1] == 127);
+  TEST_ASSERT(header[7] == 0x01 && header[8] == 0x00 && header[9] == 0x00);
+
+  // Masked
+  const uint8_t mask[4] = {0x37, 0xfa, 0x21, 0x3d};
+  TEST_ASSERT(ws_frame_header(header, WS_FIN | WS_TEXT, 5, mask) == 6);
+  TEST_ASSERT(header[1] == (WS_MASK_ON | 5));
+  TEST_ASSERT(memcmp(header + 2, mask, 4) == 0);
+
+  return 0;
+}
+
+int test_ws_frame_decode() {
+  // Masked "Hello" frame from RFC 6455
+  uint8_t data[11] = {0x81, 0x85, 0x37, 0xfa, 0x21, 0x3d,
+                      0x7f, 0x9f, 0x4d, 0x51, 0x58};
+  ws_frame_t frame;
+  for (size_t n = 0; n < sizeof(data); n++) {
+    TEST_ASSERT(ws_frame_decode(data, n, &frame) == 0);
+  }
+  TEST_ASSERT(ws_frame_decode(data, sizeof(data), &frame) == 11);
+  TEST_ASSERT(frame.header == (WS_FIN | WS_TEXT));
+  TEST_ASSERT(frame.payload_size == 5);
+  TEST_ASSERT(memcmp(frame.payload_data, "Hello", 5) == 0);
+
+  return 0;
+}
+
+int test_ws_send_binary() {
+  int fds[2] = {0};
+  TEST_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+  // Send frames with every length encoding
+  const size_t sizes[5] = {0, 125, 126, 65535, 70000};
+  uint8_t *payload = MALLOC(uint8_t, 70000);
+  for (size_t i = 0; i < 70000; i++) {
+    payload[i] = (i * 31) & 0xFF;
+  }
+  for (int k = 0; k < 5; k++) {
+    TEST_ASSERT(ws_send_binary(fds[0], payload, sizes[k]) == 0);
+  }
+
+  // Gather a frame from several buffers
+  struct iovec iov[3];
+  iov[0].iov_base = payload;
+  iov[0].iov_len = 10;
+  iov[1].iov_base = payload + 10;
+  iov[1].iov_len = 200;
+  iov[2].iov_base = payload + 210;
+  iov[2].iov_len = 1000;
+  TEST_ASSERT(ws_sendv(fds[0], WS_FIN | WS_BIN, iov, 3) == 0);
+  shutdown(fds[0], SHUT_WR);
+
+  // Receive everything and decode the frames in place
+  size_t size = 0;
+  uint8_t *buf = MALLOC(uint8_t, 300000);
+  ssize_t n = 0;
+  while ((n = recv(fds[1], buf + size, 300000 - size, 0)) > 0) {
+    size += n;
+  }
+  const size_t expected[6] = {0, 125, 126, 65535, 70000, 1210};
+  size_t offset = 0;
+  for (int k = 0; k < 6; k++) {
+    ws_frame_t frame;
+    const ssize_t frame_size = ws_frame_decode(buf + offset,
+                                               size - offset,
+                                               &frame);
+    TEST_ASSERT(frame_size > 0);
+    TEST_ASSERT(frame.header == (WS_FIN | WS_BIN));
+    TEST_ASSERT(frame.payload_size == expected[k]);
+    TEST_ASSERT(memcmp(frame.payload_data, payload, expected[k]) == 0);
+    offset += frame_size;
+  }
+  TEST_ASSERT(offset == size);
+
+  // Clean up
+  free(payload);
+  free(buf);
+  close(fds[0]);
+  close(fds[1]);
+
+  return 0;
+}
+
+#define WS_TEST_PORT 18235
+#define WS_TEST_NB_MSGS 1000
+#define WS_TEST_POSE_SIZE 4096
+#define WS_TEST_BUF_SIZE 65536
+
+typedef struct ws_test_client_t {
+  int fd;
+  uint8_t buf[WS_TEST_BUF_SIZE];
+  size_t size;
+  int next_pose;
+  int next_imu;
+  int nb_recv;
+  int ok;
+} ws_test_client_t;
+
+static int ws_test_connect(ws_test_client_t *client,
+                           const char *path,
+                           const int rcvbuf) {
+  memset(client, 0, sizeof(ws_test_client_t));
+  client->ok = 1;
+
+  // Connect
+  client->fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (rcvbuf > 0) {
+    setsockopt(client->fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(int));
+  }
+  struct sockaddr_in addr = {0};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+  addr.sin_port = htons(WS_TEST_PORT);
+  if (connect(client->fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+    return -1;
+  }
+
+  // Handshake
+  char req[1024] = {0};
+  snprintf(req,
+           sizeof(req),
+           "GET %s HTTP/1.1\r\n"
+           "Host: localhost\r\n"
+           "Upgrade: websocket\r\n"
+           "Connection: Upgrade\r\n"
+           "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+           "Sec-WebSocket-Version: 13\r\n\r\n",
+           path);
+  const ssize_t req_size = strlen(req);
+  if (write(client->fd, req, req_size) != req_size) {
+    return -1;
+  }
+
+  // Read the response byte by byte so no frame is consumed
+  char resp[1024] = {0};
+  size_t resp_size = 0;
+  while (resp_size < sizeof(resp) - 1 && strstr(resp, "\r\n\r\n") == NULL) {
+    if (read(client->fd, resp + resp_size, 1) != 1) {
+      return -1;
+    }
+    resp_size++;
+  }
+  if (strstr(resp, "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") == NULL) {
+    return -1;
+  }
+  fcntl(client->fd, F_SETFL, fcntl(client->fd, F_GETFL) | O_NONBLOCK);
+
+  return 0;
+}
+
+static void ws_test_recv(ws_test_client_t *client) {
+  while (1) {
+    const size_t space = WS_TEST_BUF_SIZE - client->size;
+    const ssize_t n = recv(client->fd, client->buf + client->size, space, 0);
+    if (n <= 0) {
+      return;
+    }
+    client->size += n;
+
+    // Check frames are complete and in order
+    size_t offset = 0;
+    ws_frame_t frame;
+    ssize_t frame_size = 0;
+    while ((frame_size = ws_frame_decode(client->buf + offset,
+                                         client->size - offset,
+                                         &frame)) > 0) {
+      offset += frame_size;
+      client->nb_recv++;
+
+      const int opcode = frame.header & 0x0F;
+      if (opcode == WS_BIN) {
+        uint32_t seq = 0;
+        memcpy(&seq, frame.payload_data, sizeof(uint32_t));
+        client->ok &= (frame.payload_size == WS_TEST_POSE_SIZE);
+        client->ok &= ((int) seq >= client->next_pose);
+        client->ok &= (frame.payload_data[WS_TEST_POSE_SIZE - 1] ==
+                       (uint8_t) seq);
+        client->next_pose = seq + 1;
+      } else if (opcode == WS_TEXT) {
+        int seq = -1;
+        char text[32] = {0};
+        memcpy(text, frame.payload_data, MIN(frame.payload_size, 31));
+        client->ok &= (sscanf(text, "imu %d", &seq) == 1);
+        client->ok &= (seq == client->next_imu);
+        client->next_imu = seq + 1;
+      } else {
+        client->ok = 0;
+      }
+    }
+    client->ok &= (frame_size == 0);
+    client->size -= offset;
+    memmove(client->buf, client->buf + offset, client->size);
+  }
+}
+
+static void *ws_test_server_thread(void *arg) {
+  ws_server_loop((ws_server_t *) arg);
+  return NULL;
+}
+
+int test_ws_server_pubsub() {
+  // Setup server
+  ws_server_t server;
+  TEST_ASSERT(ws_server_setup(&server, WS_TEST_PORT) == 0);
+  pthread_t thread;
+  TEST_ASSERT(pthread_create(&thread, NULL, ws_test_server_thread, &server) ==
+              0);
+
+  // Connect clients, the last one is slow with a small receive buffer
+  ws_test_client_t *clients = MALLOC(ws_test_client_t, 4);
+  TEST_ASSERT(ws_test_connect(&clients[0], "/pose", 0) == 0);
+  TEST_ASSERT(ws_test_connect(&clients[1], "/imu", 0) == 0);
+  TEST_ASSERT(ws_test_connect(&clients[2], "/pose,imu", 0) == 0);
+  TEST_ASSERT(ws_test_connect(&clients[3], "/pose", 4096) == 0);
+  ws_test_client_t *pose = &clients[0];
+  ws_test_client_t *imu = &clients[1];
+  ws_test_client_t *both = &clients[2];
+  ws_test_client_t *slow = &clients[3];
+
+  // Publish, keeping the fast clients within a few messages
+  uint8_t payload[WS_TEST_POSE_SIZE] = {0};
+  for (int seq = 0; seq < WS_TEST_NB_MSGS; seq++) {
+    const uint32_t pose_seq = seq;
+    memcpy(payload, &pose_seq, sizeof(uint32_t));
+    payload[WS_TEST_POSE_SIZE - 1] = (uint8_t) seq;
+    TEST_ASSERT(ws_server_publish(&server,
+                                  "pose",
+                                  WS_BIN,
+                                  payload,
+                                  WS_TEST_POSE_SIZE) == 3);
+
+    char text[32] = {0};
+    snprintf(text, sizeof(text), "imu %d", seq);
+    TEST_ASSERT(ws_server_publish(&server,
+                                  "imu",
+                                  WS_TEXT,
+                                  text,
+                                  strlen(text)) == 2);
+
+    const timestamp_t deadline = time_now() + sec2ts(10.0);
+    while (pose->nb_recv < seq - 8 || imu->nb_recv < seq - 8 ||
+           both->nb_recv < 2 * seq - 8) {
+      TEST_ASSERT(time_now() < deadline);
+      ws_test_recv(pose);
+      ws_test_recv(imu);
+      ws_test_recv(both);
+      usleep(10);
+    }
+  }
+
+  // Receive the remaining messages
+  for (int k = 0; k < 5000; k++) {
+    ws_test_recv(pose);
+    ws_test_recv(imu);
+    ws_test_recv(both);
+    ws_test_recv(slow);
+    if (pose->nb_recv == WS_TEST_NB_MSGS &&
+        imu->nb_recv == WS_TEST_NB_MSGS &&
+        both->nb_recv == 2 * WS_TEST_NB_MSGS &&
+        slow->next_pose == WS_TEST_NB_MSGS) {
+      break;
+    }
+    usleep(1000);
+  }
+
+  // Fast clients receive everything in order
+  TEST_ASSERT(pose->ok && pose->nb_recv == WS_TEST_NB_MSGS);
+  TEST_ASSERT(imu->ok && imu->nb_recv == WS_TEST_NB_MSGS);
+  TEST_ASSERT(both->ok && both->nb_recv == 2 * WS_TEST_NB_MSGS);
+  TEST_ASSERT(both->next_pose == WS_TEST_NB_MSGS);
+
+  // Slow client drops old messages but still receives the latest
+  size_t nb_dropped = 0;
+  pthread_mutex_lock(&server.mutex);
+  for (size_t i = 0; i < server.nb_clients; i++) {
+    nb_dropped += server.clients[i]->nb_dropped;
+  }
+  pthread_mutex_unlock(&server.mutex);
+  TEST_ASSERT(slow->ok);
+  TEST_ASSERT(slow->next_pose == WS_TEST_NB_MSGS);
+  TEST_ASSERT(slow->nb_recv < WS_TEST_NB_MSGS);
+  TEST_ASSERT(nb_dropped == (size_t) (WS_TEST_NB_MSGS - slow->nb_recv));
+
+  // Clean up
+  ws_server_stop(&server);
+  pthread_join(thread, NULL);
+  for (int i = 0; i < 4; i++) {
+    close(clients[i].fd);
+  }
+  free(clients);
+  ws_server_free(&server);
+
+  return 0;
+}
+
+int test_ws_server_disconnect() {
+  // Setup server
+  ws_server_t server;
+  TEST_ASSERT(ws_server_setup(&server, WS_TEST_PORT) == 0);
+  pthread_t thread;
+  TEST_ASSERT(pthread_create(&thread, NULL, ws_test_server_thread, &server) ==
+              0);
+
+  // Subscribing to unpublished topics does not fill the topic table
+  char path[1024] = "/";
+  for (int i = 0; i < 2 * WS_SERVER_MAX_TOPICS; i++) {
+    char topic[16] = {0};
+    snprintf(topic, sizeof(topic), "%st%d", (i) ? "," : "", i);
+    strcat(path, topic);
+  }
+  ws_test_client_t *clients = MALLOC(ws_test_client_t, 2);
+  TEST_ASSERT(ws_test_connect(&clients[0], path, 0) == 0);
+  TEST_ASSERT(ws_test_connect(&clients[1], "/pose", 4096) == 0);
+  pthread_mutex_lock(&server.mutex);
+  TEST_ASSERT(server.nb_topics == 0);
+  pthread_mutex_unlock(&server.mutex);
+
+  // Viewer closes with frames still queued, the server must not get SIGPIPE
+  uint8_t payload[WS_TEST_POSE_SIZE] = {0};
+  for (int k = 0; k < 200; k++) {
+    const int retval = ws_server_publish(&server,
+                                         "pose",
+                                         WS_BIN,
+                                         payload,
+                                         WS_TEST_POSE_SIZE);
+    TEST_ASSERT(retval >= 0);
+    if (k == 20) {
+      shutdown(clients[1].fd, SHUT_RDWR);
+      close(clients[1].fd);
+    }
+    usleep(1000);
+  }
+  TEST_ASSERT(ws_server_publish(&server, "imu", WS_TEXT, "imu", 3) == 0);
+
+  // Clean up
+  ws_server_stop(&server);
+  pthread_join(thread, NULL);
+  close(clients[0].fd);
+  free(clients);
+  ws_server_free(&server);
+
+  return 0;
+}
+
 int test_ws_server() {
   ws_server();
   return 0;
@@ -896,6 +2037,11 @@ int test_ws_server() {
 int main(int argc, char *argv[]) {
   TEST(test_http_parse_request);
   TEST(test_ws_hash);
+  TEST(test_ws_frame_header);
+  TEST(test_ws_frame_decode);
+  TEST(test_ws_send_binary);
+  TEST(test_ws_server_pubsub);
+  TEST(test_ws_server_disconnect);
   // TEST(test_ws_server);
 
   return (nb_failed) ? -1 : 0;
@@ -9,8 +9,11 @@
 #include <fcntl.h>
 #include <string.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <termios.h>
 #include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
 #include <sys/ioctl.h>
 
 #define SBGC_INVERT_YAW 1
@@ -122,11 +125,28 @@
 #define SBGC_CMD_EEPROM_READ 48
 #define SBGC_CMD_CALIB_INFO 49
 #define SBGC_CMD_BOOT_MODE_3 51
+#define SBGC_CMD_DATA_STREAM_INTERVAL 85
 
 // CMD FRAME SIZE
 #define SBGC_CMD_BOARD_INFO_FRAME_SIZE 6 + 18
 #define SBGC_CMD_REALTIME_DATA_3_FRAME_SIZE 6 + 63
 #define SBGC_CMD_REALTIME_DATA_4_FRAME_SIZE 6 + 63 + 61
+#define SBGC_CMD_REALTIME_DATA_CUSTOM_FRAME_SIZE 6 + 2 + 6 + 6 + 9
+
+// SBGC_CMD_REALTIME_DATA_CUSTOM fields requested by `sbgc_update()` and the
+// realtime data stream: IMU_ANGLES, TARGET_ANGLES and ENCODER_RAW24.
+// Offset       Field              Field size
+// [0]          TIMESTAMP_MS       2u
+// [2]          IMU_ANGLES         2s * 3
+// [8]          TARGET_ANGLES      2s * 3
+// [14]         ENCODER_RAW24      3s * 3
+// Total Payload Size: 23 Bytes
+#define SBGC_REALTIME_DATA_CUSTOM_FLAGS ((1 << 0) | (1 << 1) | (1 << 11))
+
+// Realtime data stream ring buffer size, must be a power of 2
+#ifndef SBGC_STREAM_RING_SIZE
+  #define SBGC_STREAM_RING_SIZE 1024
+#endif
 
 // SBGC_CMD_REALTIME_DATA_3 Frame contents:
 // Offset       Field              Field size
@@ -215,6 +235,11 @@ typedef struct sbgc_frame_t {
 } sbgc_frame_t;
 
 typedef struct sbgc_status_t {
+  int64_t timestamp;
+  float camera_angles[3];
+  float target_angles[3];
+  float encoder_angles[3];
+
   uint16_t serial_error_count;
   uint16_t system_error;
   uint16_t cycle_time;
@@ -228,6 +253,11 @@ typedef struct sbgc_status_t {
   int current;
 } sbgc_status_t;
 
+typedef struct sbgc_stream_slot_t {
+  uint64_t seq;
+  sbgc_status_t status;
+} sbgc_stream_slot_t;
+
 typedef struct sbgc_t {
   int connected;
   const char *port;
@@ -244,6 +274,13 @@ typedef struct sbgc_t {
   uint8_t state_flags;
   uint16_t board_features;
   uint8_t connection_flags;
+
+  // Realtime data stream
+  int streaming;
+  pthread_t stream_thread;
+  sbgc_stream_slot_t *stream_ring;
+  uint64_t stream_head;
+  uint64_t stream_nb_bad_frames;
 } sbgc_t;
 
 void sbgc_frame_print(const sbgc_frame_t *frame);
@@ -272,6 +309,14 @@ int sbgc_set_angle(sbgc_t *sbgc,
                    const float roll,
                    const float pitch,
                    const float yaw);
+
+int sbgc_stream_start(sbgc_t *sbgc, const uint16_t interval_ms);
+int sbgc_stream_stop(sbgc_t *sbgc);
+size_t sbgc_stream_read(const sbgc_t *sbgc,
+                        uint64_t *cursor,
+                        sbgc_status_t *samples,
+                        const size_t max_samples);
+int sbgc_stream_latest(const sbgc_t *sbgc, sbgc_status_t *status);
 #endif // SBGC_H
 
 //////////////////////////////////////////////////////////////////////////////
@@ -555,6 +600,11 @@ int sbgc_frame_parse_frame(sbgc_frame_t *frame, uint8_t *data) {
  * Setup SBGC data
  */
 void sbgc_status_setup(sbgc_status_t *data) {
+  data->timestamp = 0;
+  memset(data->camera_angles, 0, sizeof(float) * 3);
+  memset(data->target_angles, 0, sizeof(float) * 3);
+  memset(data->encoder_angles, 0, sizeof(float) * 3);
+
   data->serial_error_count = 0;
   data->system_error = 0;
   data->cycle_time = 0;
@@ -573,6 +623,19 @@ void sbgc_status_setup(sbgc_status_t *data) {
  * Print SBGC data
  */
 void sbgc_status_print(sbgc_status_t *data) {
+  printf("timestamp: %" PRId64 "\n", data->timestamp);
+  printf("camera_angles: [%f, %f, %f]\n",
+         data->camera_angles[0],
+         data->camera_angles[1],
+         data->camera_angles[2]);
+  printf("target_angles: [%f, %f, %f]\n",
+         data->target_angles[0],
+         data->target_angles[1],
+         data->target_angles[2]);
+  printf("encoder_angles: [%f, %f, %f]\n\n",
+         data->encoder_angles[0],
+         data->encoder_angles[1],
+         data->encoder_angles[2]);
   printf("serial_error_count: %d\n", data->serial_error_count);
   printf("system_error: %d\n", data->system_error);
   printf("cycle_time: %d\n", data->cycle_time);
@@ -626,6 +689,11 @@ int sbgc_connect(sbgc_t *sbgc, const char *port) {
   sbgc->board_features = 0;
   sbgc->connection_flags = 0;
 
+  sbgc->streaming = 0;
+  sbgc->stream_ring = NULL;
+  sbgc->stream_head = 0;
+  sbgc->stream_nb_bad_frames = 0;
+
   // Open serial port
   sbgc->serial = open(sbgc->port, O_RDWR | O_NOCTTY | O_NDELAY);
   if (sbgc->serial == -1) {
@@ -645,6 +713,7 @@ int sbgc_connect(sbgc_t *sbgc, const char *port) {
  * Disconnect SBGC
  */
 int sbgc_disconnect(sbgc_t *sbgc) {
+  sbgc_stream_stop(sbgc);
   if (close(sbgc->serial) != 0) {
     return SBGC_DISCONNECT_FAILED;
   }
@@ -654,9 +723,11 @@ int sbgc_disconnect(sbgc_t *sbgc) {
 }
 
 /**
- * Reset SBGC
+ * Reset SBGC. A running stream is stopped first, so the stream thread is no
+ * longer writing the ring when it is released.
  */
 void sbgc_reset(sbgc_t *sbgc) {
+  sbgc_stream_stop(sbgc);
   sbgc->connected = 0;
 
   sbgc->port = NULL;
@@ -667,6 +738,11 @@ void sbgc_reset(sbgc_t *sbgc) {
   sbgc->state_flags = 0;
   sbgc->board_features = 0;
   sbgc->connection_flags = 0;
+
+  sbgc->streaming = 0;
+  sbgc->stream_ring = NULL;
+  sbgc->stream_head = 0;
+  sbgc->stream_nb_bad_frames = 0;
 }
 
 /**
@@ -697,8 +773,12 @@ int sbgc_send(const sbgc_t *sbgc, const sbgc_frame_t *frame) {
   retval += write(sbgc->serial, frame->payload, frame->payload_size);
   retval += write(sbgc->serial, frame->crc16, 2);
 
-  // Flush
-  tcflush(sbgc->serial, TCIOFLUSH); // VERY CRITICAL
+  // Flush, a realtime data stream's input is kept and the frame is drained
+  if (__atomic_load_n(&sbgc->streaming, __ATOMIC_ACQUIRE)) {
+    tcdrain(sbgc->serial);
+  } else {
+    tcflush(sbgc->serial, TCIOFLUSH); // VERY CRITICAL
+  }
   usleep(10 * 1000);
   if (retval != (6 + frame->payload_size)) {
     return SBGC_SEND_FAILED;
@@ -783,9 +863,14 @@ int sbgc_off(const sbgc_t *sbgc) {
 }
 
 /**
- * Obtain SBGC board information
+ * Obtain SBGC board information. Fails while streaming, since the stream
+ * thread owns the serial port.
  */
 int sbgc_info(sbgc_t *sbgc) {
+  if (__atomic_load_n(&sbgc->streaming, __ATOMIC_ACQUIRE)) {
+    return -1;
+  }
+
   // Request board info
   sbgc_frame_t frame;
   sbgc_frame_setup(&frame, SBGC_CMD_BOARD_INFO, NULL, 0);
@@ -805,7 +890,14 @@ int sbgc_info(sbgc_t *sbgc) {
   return 0;
 }
 
+/**
+ * Calibrate SBGC encoders. Fails while streaming.
+ */
 int sbgc_calib(sbgc_t *sbgc) {
+  if (__atomic_load_n(&sbgc->streaming, __ATOMIC_ACQUIRE)) {
+    return -1;
+  }
+
   // Swtich on gimbal
   SBGC_EXEC(sbgc_on(sbgc));
   sleep(3);
@@ -845,9 +937,63 @@ int sbgc_calib(sbgc_t *sbgc) {
 }
 
 /**
- * Calibrate SBGC
+ * Parse SBGC_CMD_REALTIME_DATA_CUSTOM payload with the fields
+ * SBGC_REALTIME_DATA_CUSTOM_FLAGS into `status` angles.
+ */
+void sbgc_parse_realtime_data(const sbgc_t *sbgc,
+                              const uint8_t *payload,
+                              sbgc_status_t *status) {
+  // clang-format off
+  float imu_roll = sbgc_parse_angle(payload, 2);
+  float imu_pitch = sbgc_parse_angle(payload, 4);
+  float imu_yaw = sbgc_parse_angle(payload, 6);
+  float target_roll = sbgc_parse_angle(payload, 8);
+  float target_pitch = sbgc_parse_angle(payload, 10);
+  float target_yaw = sbgc_parse_angle(payload, 12);
+  float encoder_roll = sbgc_parse_encoder(payload, 14, sbgc->encoder_offsets[0]);
+  float encoder_pitch = sbgc_parse_encoder(payload, 17, sbgc->encoder_offsets[1]);
+  float encoder_yaw = sbgc_parse_encoder(payload, 20, sbgc->encoder_offsets[2]);
+  // clang-format on
+
+  // Invert Yaw?
+  imu_yaw = SBGC_INVERT_YAW ? -1 * imu_yaw : imu_yaw;
+  target_yaw = SBGC_INVERT_YAW ? -1 * target_yaw : target_yaw;
+
+  status->camera_angles[0] = imu_roll;
+  status->camera_angles[1] = imu_pitch;
+  status->camera_angles[2] = imu_yaw;
+  status->target_angles[0] = target_roll;
+  status->target_angles[1] = target_pitch;
+  status->target_angles[2] = target_yaw;
+  status->encoder_angles[0] = encoder_roll;
+  status->encoder_angles[1] = encoder_pitch;
+  status->encoder_angles[2] = encoder_yaw;
+}
+
+/**
+ * Update SBGC angles from `status`
+ */
+static void sbgc_set_status(sbgc_t *sbgc, const sbgc_status_t *status) {
+  sbgc->timestamp = status->timestamp;
+  for (int i = 0; i < 3; i++) {
+    sbgc->camera_angles[i] = status->camera_angles[i];
+    sbgc->target_angles[i] = status->target_angles[i];
+    sbgc->encoder_angles[i] = status->encoder_angles[i];
+  }
+}
+
+/**
+ * Update SBGC angles. While streaming the latest streamed realtime data is
+ * used instead of a request and reply.
  */
 int sbgc_update(sbgc_t *sbgc) {
+  if (__atomic_load_n(&sbgc->streaming, __ATOMIC_ACQUIRE)) {
+    sbgc_status_t status;
+    SBGC_EXEC(sbgc_stream_latest(sbgc, &status));
+    sbgc_set_status(sbgc, &status);
+    return 0;
+  }
+
   // Whick data to return
   const uint8_t enable_imu_angles = 1;
   const uint8_t enable_target_angles = 1;
@@ -933,50 +1079,24 @@ int sbgc_update(sbgc_t *sbgc) {
   SBGC_EXEC(sbgc_read(sbgc, resp_size, &resp));
 
   // -- Parse real time data
-  // clang-format off
-  const uint8_t *payload = resp.payload;
-  float imu_roll = sbgc_parse_angle(payload, 2);
-  float imu_pitch = sbgc_parse_angle(payload, 4);
-  float imu_yaw = sbgc_parse_angle(payload, 6);
-  float target_roll = sbgc_parse_angle(payload, 8);
-  float target_pitch = sbgc_parse_angle(payload, 10);
-  float target_yaw = sbgc_parse_angle(payload, 12);
-  float encoder_roll = sbgc_parse_encoder(payload, 14, sbgc->encoder_offsets[0]);
-  float encoder_pitch = sbgc_parse_encoder(payload, 17, sbgc->encoder_offsets[1]);
-  float encoder_yaw = sbgc_parse_encoder(payload, 20, sbgc->encoder_offsets[2]);
-  // clang-format on
-
-  // Invert Yaw?
-  imu_yaw = SBGC_INVERT_YAW ? -1 * imu_yaw : imu_yaw;
-  target_yaw = SBGC_INVERT_YAW ? -1 * target_yaw : target_yaw;
-
-  // -- Get timestamp
-  const int64_t timestamp = timestamp_now();
-
-  sbgc->timestamp = timestamp;
-  sbgc->camera_angles[0] = imu_roll;
-  sbgc->camera_angles[1] = imu_pitch;
-  sbgc->camera_angles[2] = imu_yaw;
-  sbgc->target_angles[0] = target_roll;
-  sbgc->target_angles[1] = target_pitch;
-  sbgc->target_angles[2] = target_yaw;
-  sbgc->encoder_angles[0] = encoder_roll;
-  sbgc->encoder_angles[1] = encoder_pitch;
-  sbgc->encoder_angles[2] = encoder_yaw;
-
-  // printf("\n");
-  // printf("timestamp: %ld\n", timestamp);
-  // printf("imu:     %f, %f, %f\n", imu_roll, imu_pitch, imu_yaw);
-  // printf("target:  %f, %f, %f\n", target_roll, target_pitch, target_yaw);
-  // printf("encoder: %f, %f, %f\n", encoder_roll, encoder_pitch, encoder_yaw);
+  sbgc_status_t status;
+  sbgc_status_setup(&status);
+  sbgc_parse_realtime_data(sbgc, resp.payload, &status);
+  status.timestamp = timestamp_now();
+  sbgc_set_status(sbgc, &status);
 
   return 0;
 }
 
 /**
- * SBGC status
+ * SBGC status. Fails while streaming, the realtime data requested here is
+ * not part of the stream and the stream thread owns the serial port.
  */
 int sbgc_get_status(const sbgc_t *sbgc, sbgc_status_t *status) {
+  if (__atomic_load_n(&sbgc->streaming, __ATOMIC_ACQUIRE)) {
+    return -1;
+  }
+
   // Request real time data
   sbgc_frame_t frame;
   sbgc_frame_setup(&frame, SBGC_CMD_REALTIME_DATA_4, NULL, 0);
@@ -1101,6 +1221,226 @@ int sbgc_set_angle(sbgc_t *sbgc,
   return 0;
 }
 
+// SBGC STREAM //////////////////////////////////////////////////////////////
+
+/**
+ * Publish `status` to the realtime data stream ring. Only the stream thread
+ * writes, each slot is guarded by a sequence number so readers can detect
+ * a slot being overwritten while they copy it.
+ */
+static void sbgc_stream_push(sbgc_t *sbgc, const sbgc_status_t *status) {
+  const uint64_t idx = sbgc->stream_head;
+  sbgc_stream_slot_t *slot =
+      &sbgc->stream_ring[idx & (SBGC_STREAM_RING_SIZE - 1)];
+  __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  slot->status = *status;
+  __atomic_store_n(&slot->seq, idx + 1, __ATOMIC_RELEASE);
+  __atomic_store_n(&sbgc->stream_head, idx + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Copy stream sample `idx`, returns -1 if it has been overwritten.
+ */
+static int sbgc_stream_get(const sbgc_t *sbgc,
+                           const uint64_t idx,
+                           sbgc_status_t *status) {
+  const sbgc_stream_slot_t *slot =
+      &sbgc->stream_ring[idx & (SBGC_STREAM_RING_SIZE - 1)];
+  if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != idx + 1) {
+    return -1;
+  }
+  *status = slot->status;
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != idx + 1) {
+    return -1;
+  }
+
+  return 0;
+}
+
+/**
+ * Stream thread. Parses the realtime data frames pushed by the controller
+ * and timestamps them with the host time they were read.
+ */
+static void *sbgc_stream_worker(void *arg) {
+  sbgc_t *sbgc = (sbgc_t *) arg;
+
+  struct pollfd fds[1];
+  fds[0].fd = sbgc->serial;
+  fds[0].events = POLLIN;
+  uint8_t buf[1024];
+  size_t size = 0;
+  while (__atomic_load_n(&sbgc->streaming, __ATOMIC_ACQUIRE)) {
+    if (poll(fds, 1, 100) <= 0) {
+      continue;
+    }
+    const ssize_t n = read(sbgc->serial, buf + size, sizeof(buf) - size);
+    const int64_t timestamp = timestamp_now();
+    if (n <= 0) {
+      continue;
+    }
+    size += n;
+
+    // Parse complete frames
+    size_t offset = 0;
+    while (offset + 4 <= size) {
+      uint8_t *data = buf + offset;
+      const uint8_t header_checksum = (data[1] + data[2]) % 256;
+      if (data[0] != '$' || data[3] != header_checksum) {
+        offset++;
+        continue;
+      }
+      const size_t frame_size = 6 + data[2];
+      if (offset + frame_size > size) {
+        break;
+      }
+
+      sbgc_frame_t frame;
+      if (sbgc_frame_parse_frame(&frame, data) != 0) {
+        __atomic_fetch_add(&sbgc->stream_nb_bad_frames, 1, __ATOMIC_RELAXED);
+        offset++;
+        continue;
+      }
+      offset += frame_size;
+
+      const uint8_t payload_size = SBGC_CMD_REALTIME_DATA_CUSTOM_FRAME_SIZE - 6;
+      if (frame.cmd_id == SBGC_CMD_REALTIME_DATA_CUSTOM &&
+          frame.payload_size == payload_size) {
+        sbgc_status_t status;
+        sbgc_status_setup(&status);
+        sbgc_parse_realtime_data(sbgc, frame.payload, &status);
+        status.timestamp = timestamp;
+        sbgc_stream_push(sbgc, &status);
+      }
+    }
+    memmove(buf, buf + offset, size - offset);
+    size -= offset;
+  }
+
+  return NULL;
+}
+
+/**
+ * Request SBGC_CMD_REALTIME_DATA_CUSTOM every `interval_ms` from the
+ * controller, and start a thread that parses the stream into a ring of
+ * SBGC_STREAM_RING_SIZE timestamped `sbgc_status_t`. Only the angles of the
+ * streamed samples are set.
+ */
+int sbgc_stream_start(sbgc_t *sbgc, const uint16_t interval_ms) {
+  // Check connection
+  if (sbgc->connected == 0) {
+    return SBGC_NOT_CONNECTED;
+  }
+  if (sbgc->streaming) {
+    return 0;
+  }
+
+  // Start stream thread
+  sbgc->stream_ring =
+      calloc(SBGC_STREAM_RING_SIZE, sizeof(sbgc_stream_slot_t));
+  sbgc->stream_head = 0;
+  sbgc->stream_nb_bad_frames = 0;
+  __atomic_store_n(&sbgc->streaming, 1, __ATOMIC_RELEASE);
+  if (pthread_create(&sbgc->stream_thread, NULL, sbgc_stream_worker, sbgc)) {
+    __atomic_store_n(&sbgc->streaming, 0, __ATOMIC_RELEASE);
+    free(sbgc->stream_ring);
+    sbgc->stream_ring = NULL;
+    return -1;
+  }
+
+  // Request stream
+  const uint32_t flags = SBGC_REALTIME_DATA_CUSTOM_FLAGS;
+  uint8_t payload[21] = {0};
+  payload[0] = SBGC_CMD_REALTIME_DATA_CUSTOM;
+  payload[1] = (interval_ms >> 0) & 0xFF;
+  payload[2] = (interval_ms >> 8) & 0xFF;
+  payload[3] = (flags >> 0) & 0xFF;
+  payload[4] = (flags >> 8) & 0xFF;
+  payload[5] = (flags >> 16) & 0xFF;
+  payload[6] = (flags >> 24) & 0xFF;
+  sbgc_frame_t frame;
+  sbgc_frame_setup(&frame, SBGC_CMD_DATA_STREAM_INTERVAL, payload, 21);
+  const int retval = sbgc_send(sbgc, &frame);
+  if (retval != 0) {
+    sbgc_stream_stop(sbgc);
+    return retval;
+  }
+
+  return 0;
+}
+
+/**
+ * Stop realtime data stream
+ */
+int sbgc_stream_stop(sbgc_t *sbgc) {
+  if (sbgc->streaming == 0) {
+    return 0;
+  }
+
+  // Request stream to stop, a zero interval disables it
+  uint8_t payload[21] = {0};
+  payload[0] = SBGC_CMD_REALTIME_DATA_CUSTOM;
+  sbgc_frame_t frame;
+  sbgc_frame_setup(&frame, SBGC_CMD_DATA_STREAM_INTERVAL, payload, 21);
+  const int retval = sbgc_send(sbgc, &frame);
+
+  // Stop stream thread
+  __atomic_store_n(&sbgc->streaming, 0, __ATOMIC_RELEASE);
+  pthread_join(sbgc->stream_thread, NULL);
+  free(sbgc->stream_ring);
+  sbgc->stream_ring = NULL;
+
+  return retval;
+}
+
+/**
+ * Read up to `max_samples` stream samples after `cursor`, and advance
+ * `cursor`. Samples overwritten before they were read are skipped. Returns
+ * number of samples read.
+ */
+size_t sbgc_stream_read(const sbgc_t *sbgc,
+                        uint64_t *cursor,
+                        sbgc_status_t *samples,
+                        const size_t max_samples) {
+  const uint64_t head = __atomic_load_n(&sbgc->stream_head, __ATOMIC_ACQUIRE);
+  if (head - *cursor > SBGC_STREAM_RING_SIZE) {
+    *cursor = head - SBGC_STREAM_RING_SIZE;
+  }
+
+  size_t nb_samples = 0;
+  while (*cursor < head && nb_samples < max_samples) {
+    if (sbgc_stream_get(sbgc, *cursor, &samples[nb_samples]) == 0) {
+      nb_samples++;
+    }
+    (*cursor)++;
+  }
+
+  return nb_samples;
+}
+
+/**
+ * Get latest stream sample, returns -1 if there is none.
+ */
+int sbgc_stream_latest(const sbgc_t *sbgc, sbgc_status_t *status) {
+  if (sbgc->stream_ring == NULL) {
+    return -1;
+  }
+
+  for (int attempt = 0; attempt < 10; attempt++) {
+    const uint64_t head =
+        __atomic_load_n(&sbgc->stream_head, __ATOMIC_ACQUIRE);
+    if (head == 0) {
+      return -1;
+    }
+    if (sbgc_stream_get(sbgc, head - 1, status) == 0) {
+      return 0;
+    }
+  }
+
+  return -1;
+}
+
 #endif // SBGC_IMPLEMENTATION
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1358,6 +1698,151 @@ int test_sbgc_set_angle() {
   return 0;
 }
 
+/**
+ * Write SBGC_CMD_REALTIME_DATA_CUSTOM frame with IMU roll angle `k` to `fd`
+ */
+static int test_sbgc_stream_write(const int fd, const int16_t k) {
+  uint8_t payload[SBGC_CMD_REALTIME_DATA_CUSTOM_FRAME_SIZE - 6] = {0};
+  payload[2] = k & 0xFF;
+  payload[3] = (k >> 8) & 0xFF;
+  sbgc_frame_t frame;
+  sbgc_frame_setup(&frame,
+                   SBGC_CMD_REALTIME_DATA_CUSTOM,
+                   payload,
+                   sizeof(payload));
+
+  uint8_t data[SBGC_CMD_REALTIME_DATA_CUSTOM_FRAME_SIZE] = {0};
+  data[0] = '$';
+  data[1] = frame.cmd_id;
+  data[2] = frame.payload_size;
+  data[3] = frame.header_checksum;
+  memcpy(data + 4, frame.payload, frame.payload_size);
+  data[4 + frame.payload_size + 0] = frame.crc16[0];
+  data[4 + frame.payload_size + 1] = frame.crc16[1];
+  if (write(fd, data, sizeof(data)) != sizeof(data)) {
+    return -1;
+  }
+
+  return 0;
+}
+
+/**
+ * Read stream samples until `nb_samples` have been read or it times out
+ */
+static size_t test_sbgc_stream_read(const sbgc_t *sbgc,
+                                    uint64_t *cursor,
+                                    sbgc_status_t *samples,
+                                    const size_t nb_samples) {
+  size_t nb_read = 0;
+  for (int i = 0; i < 1000 && nb_read < nb_samples; i++) {
+    nb_read += sbgc_stream_read(sbgc,
+                                cursor,
+                                samples + nb_read,
+                                nb_samples - nb_read);
+    usleep(1000);
+  }
+  return nb_read;
+}
+
+int test_sbgc_stream() {
+  // Stand in for the controller's serial port with a pseudo-terminal
+  const int master = open("/dev/ptmx", O_RDWR | O_NOCTTY);
+  TEST_ASSERT(master != -1);
+  int unlock = 0;
+  int pty = 0;
+  TEST_ASSERT(ioctl(master, TIOCSPTLCK, &unlock) == 0);
+  TEST_ASSERT(ioctl(master, TIOCGPTN, &pty) == 0);
+  struct termios tty;
+  tcgetattr(master, &tty);
+  cfmakeraw(&tty);
+  tcsetattr(master, TCSANOW, &tty);
+  char slave[64] = {0};
+  snprintf(slave, sizeof(slave), "/dev/pts/%d", pty);
+
+  // Start stream
+  sbgc_t sbgc;
+  TEST_ASSERT(sbgc_connect(&sbgc, slave) == 0);
+  TEST_ASSERT(sbgc_stream_start(&sbgc, 1) == 0);
+
+  // Check stream request
+  uint8_t req[6 + 21] = {0};
+  TEST_ASSERT(read(master, req, sizeof(req)) == sizeof(req));
+  sbgc_frame_t frame;
+  TEST_ASSERT(sbgc_frame_parse_frame(&frame, req) == 0);
+  TEST_ASSERT(frame.cmd_id == SBGC_CMD_DATA_STREAM_INTERVAL);
+  TEST_ASSERT(frame.payload[0] == SBGC_CMD_REALTIME_DATA_CUSTOM);
+  TEST_ASSERT(frame.payload[1] == 1);
+
+  // Stream frames with a corrupted frame every 10 frames
+  const int nb_frames = 500;
+  for (int k = 0; k < nb_frames; k++) {
+    TEST_ASSERT(test_sbgc_stream_write(master, k) == 0);
+    if (k % 10 == 0) {
+      const uint8_t bad[8] = {'$', SBGC_CMD_REALTIME_DATA_CUSTOM, 2, 90};
+      TEST_ASSERT(write(master, bad, sizeof(bad)) == sizeof(bad));
+    }
+  }
+
+  // Samples arrive in order with monotonic host timestamps
+  uint64_t cursor = 0;
+  sbgc_status_t samples[500];
+  TEST_ASSERT(test_sbgc_stream_read(&sbgc, &cursor, samples, 500) == 500);
+  for (int k = 0; k < nb_frames; k++) {
+    TEST_ASSERT(fabs(samples[k].camera_angles[0] - k * SBGC_DEG_PER_BIT) <
+                1e-4);
+    TEST_ASSERT(k == 0 || samples[k].timestamp >= samples[k - 1].timestamp);
+  }
+  TEST_ASSERT(sbgc.stream_nb_bad_frames == (uint64_t) nb_frames / 10);
+
+  // Overrun the ring, the reader skips to the oldest retained sample
+  const int nb_overrun = 3 * SBGC_STREAM_RING_SIZE;
+  for (int k = 0; k < nb_overrun; k++) {
+    TEST_ASSERT(test_sbgc_stream_write(master, k) == 0);
+  }
+  const uint64_t nb_total = nb_frames + nb_overrun;
+  while (__atomic_load_n(&sbgc.stream_head, __ATOMIC_ACQUIRE) < nb_total) {
+    usleep(1000);
+  }
+  sbgc_status_t latest;
+  TEST_ASSERT(sbgc_stream_latest(&sbgc, &latest) == 0);
+  const float angle = (nb_overrun - 1) * SBGC_DEG_PER_BIT;
+  TEST_ASSERT(fabs(latest.camera_angles[0] - angle) < 1e-4);
+  sbgc_status_t retained[SBGC_STREAM_RING_SIZE];
+  const size_t nb_retained =
+      sbgc_stream_read(&sbgc, &cursor, retained, SBGC_STREAM_RING_SIZE);
+  TEST_ASSERT(nb_retained == SBGC_STREAM_RING_SIZE);
+  TEST_ASSERT(fabs(retained[nb_retained - 1].camera_angles[0] - angle) < 1e-4);
+
+  // sbgc_update() uses the stream while streaming
+  TEST_ASSERT(sbgc_update(&sbgc) == 0);
+  TEST_ASSERT(fabs(sbgc.camera_angles[0] - angle) < 1e-4);
+
+  // Commands that read the serial port are refused while streaming
+  sbgc_status_t status;
+  TEST_ASSERT(sbgc_get_status(&sbgc, &status) == -1);
+  TEST_ASSERT(sbgc_info(&sbgc) == -1);
+  TEST_ASSERT(sbgc_calib(&sbgc) == -1);
+
+  // Stop stream
+  TEST_ASSERT(sbgc_stream_stop(&sbgc) == 0);
+  TEST_ASSERT(sbgc.streaming == 0);
+
+  // Reset stops a running stream before clearing it
+  TEST_ASSERT(sbgc_stream_start(&sbgc, 1) == 0);
+  for (int k = 0; k < 10; k++) {
+    TEST_ASSERT(test_sbgc_stream_write(master, k) == 0);
+  }
+  const int serial = sbgc.serial;
+  sbgc_reset(&sbgc);
+  TEST_ASSERT(sbgc.streaming == 0);
+  TEST_ASSERT(sbgc.stream_ring == NULL);
+  TEST_ASSERT(sbgc.connected == 0);
+  close(serial);
+  close(master);
+
+  return 0;
+}
+
 int main(int argc, char *argv[]) {
   // TEST(test_sbgc_connect_disconnect);
   // TEST(test_sbgc_on_off);
@@ -1367,6 +1852,7 @@ int main(int argc, char *argv[]) {
   // TEST(test_sbgc_calib);
   // TEST(test_sbgc_update);
   // TEST(test_sbgc_get_status);
+  TEST(test_sbgc_stream);
   TEST(test_sbgc_set_angle);
 
   return (nb_failed) ? -1 : 0;
@@ -1,3 +1,6 @@
+#include <pthread.h>
+#include <sched.h>
+
 #include "xyz.h"
 #include "munit.h"
 #include "stb_ds.h"
@@ -729,6 +732,105 @@ int test_queue_enqueue_dequeue(void) {
   return 0;
 }
 
+// SPSC QUEUE ////////////////////////////////////////////////////////////////
+
+int test_spsc_queue_malloc_and_free(void) {
+  spsc_queue_t *q = spsc_queue_malloc(sizeof(int), 10);
+  MU_ASSERT(q != NULL);
+  MU_ASSERT(q->capacity == 16);
+  MU_ASSERT(q->mask == 15);
+  MU_ASSERT(q->element_size == sizeof(int));
+  MU_ASSERT(spsc_queue_empty(q) == 1);
+  MU_ASSERT(((uintptr_t) &q->tail - (uintptr_t) &q->head) >= CACHE_LINE_SIZE);
+  spsc_queue_free(q);
+
+  return 0;
+}
+
+int test_spsc_queue_push_pop(void) {
+  spsc_queue_t *q = spsc_queue_malloc(sizeof(int), 4);
+
+  // Pop from empty queue
+  int val = 0;
+  MU_ASSERT(spsc_queue_pop(q, &val) == -1);
+
+  // Fill queue
+  for (int i = 0; i < 4; i++) {
+    MU_ASSERT(spsc_queue_push(q, &i) == 0);
+  }
+  MU_ASSERT(spsc_queue_full(q) == 1);
+  MU_ASSERT(spsc_queue_size(q) == 4);
+
+  int extra = 4;
+  MU_ASSERT(spsc_queue_push(q, &extra) == -1);
+
+  // Peek and drain queue
+  MU_ASSERT(spsc_queue_peek(q, &val) == 0);
+  MU_ASSERT(val == 0);
+  for (int i = 0; i < 4; i++) {
+    MU_ASSERT(spsc_queue_pop(q, &val) == 0);
+    MU_ASSERT(val == i);
+  }
+  MU_ASSERT(spsc_queue_empty(q) == 1);
+
+  // Wrap around
+  for (int i = 0; i < 10; i++) {
+    MU_ASSERT(spsc_queue_push(q, &i) == 0);
+    MU_ASSERT(spsc_queue_pop(q, &val) == 0);
+    MU_ASSERT(val == i);
+  }
+
+  // Clean up
+  spsc_queue_free(q);
+
+  return 0;
+}
+
+#define TEST_SPSC_NUM_EVENTS 100000
+
+static void *test_spsc_queue_producer(void *arg) {
+  spsc_queue_t *q = (spsc_queue_t *) arg;
+  for (int i = 0; i < TEST_SPSC_NUM_EVENTS; i++) {
+    imu_event_t event = {0};
+    event.ts = i;
+    event.acc[0] = i;
+    event.gyr[2] = -i;
+    while (imu_event_queue_push(q, &event) != 0) {
+      sched_yield();
+    }
+  }
+  return NULL;
+}
+
+int test_spsc_queue_threaded(void) {
+  spsc_queue_t *q = imu_event_queue_malloc(64);
+
+  pthread_t producer;
+  pthread_create(&producer, NULL, test_spsc_queue_producer, q);
+
+  int num_popped = 0;
+  int in_order = 1;
+  while (num_popped < TEST_SPSC_NUM_EVENTS) {
+    imu_event_t event;
+    if (imu_event_queue_pop(q, &event) != 0) {
+      sched_yield();
+      continue;
+    }
+    if (event.ts != num_popped || event.acc[0] != num_popped ||
+        event.gyr[2] != -num_popped) {
+      in_order = 0;
+    }
+    num_popped++;
+  }
+  pthread_join(producer, NULL);
+
+  MU_ASSERT(in_order == 1);
+  MU_ASSERT(spsc_queue_empty(q) == 1);
+  spsc_queue_free(q);
+
+  return 0;
+}
+
 // HASHMAP ///////////////////////////////////////////////////////////////////
 
 static int traverse_called;
@@ -934,6 +1036,221 @@ int test_time_now() {
   return 0;
 }
 
+/******************************************************************************
+ * TEST TELEMETRY LOG
+ ******************************************************************************/
+
+int test_tlog() {
+  const char *log_path = "/tmp/test_tlog.tlog";
+
+  // Write channels at different rates, with several chunks per channel
+  tlog_writer_t *writer = tlog_writer_malloc(log_path);
+  MU_ASSERT(writer != NULL);
+  const int imu = tlog_writer_channel(writer, "imu", TLOG_F64, 6);
+  const int pose = tlog_writer_channel(writer, "pose", TLOG_F32, 7);
+  const int flag = tlog_writer_channel(writer, "flag", TLOG_U8, 1);
+  MU_ASSERT(imu == 0 && pose == 1 && flag == 2);
+  MU_ASSERT(tlog_writer_channel(writer, "imu", TLOG_F64, 6) == -1);
+  MU_ASSERT(tlog_writer_channel(writer, "bad", 100, 1) == -1);
+
+  const int num_samples = 5 * TLOG_CHUNK_SAMPLES + 7;
+  for (int k = 0; k < num_samples; k++) {
+    const timestamp_t ts = k * 1000;
+    const double imu_k[6] = {k, k + 1, k + 2, k + 3, k + 4, k + 5};
+    MU_ASSERT(tlog_write(writer, imu, ts, imu_k) == 0);
+    if (k % 10 == 0) {
+      const float pose_k[7] = {k, 0, 0, 1, 0, 0, 0};
+      MU_ASSERT(tlog_write(writer, pose, ts, pose_k) == 0);
+    }
+    if (k % 3 == 0) {
+      const uint8_t flag_k = k & 0xFF;
+      MU_ASSERT(tlog_write(writer, flag, ts, &flag_k) == 0);
+    }
+  }
+  MU_ASSERT(tlog_writer_close(writer) == 0);
+
+  // Load
+  MU_ASSERT(tlog_check(log_path));
+  tlog_t *log = tlog_load(log_path);
+  MU_ASSERT(log != NULL);
+  MU_ASSERT(log->num_channels == 3);
+  MU_ASSERT(tlog_find(log, "imu") == imu);
+  MU_ASSERT(tlog_find(log, "pose") == pose);
+  MU_ASSERT(tlog_find(log, "flag") == flag);
+  MU_ASSERT(tlog_find(log, "gps") == -1);
+  MU_ASSERT(log->channels[imu].num_samples == (uint64_t) num_samples);
+
+  // Slice time range spanning several chunks
+  const int k_start = TLOG_CHUNK_SAMPLES / 2;
+  const int k_end = 3 * TLOG_CHUNK_SAMPLES + 11;
+  size_t cursor = 0;
+  tlog_slice_t slice;
+  int k = k_start;
+  int num_slices = 0;
+  while (tlog_slice(log, imu, k_start * 1000, k_end * 1000, &cursor, &slice)) {
+    const double *values = slice.data;
+    for (int i = 0; i < slice.num_samples; i++, k++) {
+      MU_ASSERT(slice.ts[i] == k * 1000);
+      MU_ASSERT(fltcmp(values[i * 6 + 0], k) == 0);
+      MU_ASSERT(fltcmp(values[i * 6 + 5], k + 5) == 0);
+    }
+    num_slices++;
+  }
+  MU_ASSERT(k == k_end + 1);
+  MU_ASSERT(num_slices == 4);
+
+  // Slice timestamps between samples and full range
+  cursor = 0;
+  MU_ASSERT(tlog_slice(log, pose, 11000, 19000, &cursor, &slice) == 0);
+  cursor = 0;
+  int num_flags = 0;
+  while (tlog_slice(log, flag, INT64_MIN, INT64_MAX, &cursor, &slice)) {
+    const uint8_t *values = slice.data;
+    for (int i = 0; i < slice.num_samples; i++) {
+      MU_ASSERT(values[i] == ((num_flags * 3) & 0xFF));
+      num_flags++;
+    }
+  }
+  MU_ASSERT(num_flags == (num_samples + 2) / 3);
+
+  // Corrupt counts and chunk offsets, the log must be rejected
+  const char *bad_path = "/tmp/test_tlog_bad.tlog";
+  uint8_t *buf = MALLOC(uint8_t, log->size);
+  const tlog_header_t *header = (const tlog_header_t *) log->data;
+  const size_t chunks_offset =
+      header->index_offset + log->num_channels * sizeof(tlog_channel_t);
+  for (int i = 0; i < 4; i++) {
+    memcpy(buf, log->data, log->size);
+    tlog_header_t *bad_header = (tlog_header_t *) buf;
+    tlog_chunk_t *bad_chunks = (tlog_chunk_t *) (buf + chunks_offset);
+    switch (i) {
+      case 0:
+        bad_header->num_chunks = UINT64_MAX / sizeof(tlog_chunk_t) + 2;
+        break;
+      case 1:
+        bad_header->num_channels = UINT32_MAX;
+        break;
+      case 2:
+        bad_chunks[1].offset += 4;
+        break;
+      case 3:
+        bad_chunks[1].offset = 0;
+        break;
+    }
+    FILE *fp = fopen(bad_path, "wb");
+    MU_ASSERT(fp != NULL);
+    MU_ASSERT(fwrite(buf, 1, log->size, fp) == log->size);
+    fclose(fp);
+    MU_ASSERT(tlog_load(bad_path) == NULL);
+  }
+  free(buf);
+
+  // Clean up
+  tlog_free(log);
+
+  return 0;
+}
+
+/******************************************************************************
+ * TEST TRACE
+ ******************************************************************************/
+
+#ifdef USE_TRACE
+
+static void *test_trace_worker(void *arg) {
+  const int n = *(int *) arg;
+  for (int i = 0; i < n; i++) {
+    TRACE_SCOPE("test_trace_worker");
+  }
+  return NULL;
+}
+
+int test_trace() {
+  // Record scopes from two threads, scopes outside start / stop are ignored
+  const int n = TRACE_BLOCK_SIZE + 10;
+  {
+    TRACE_SCOPE("test_trace_ignored");
+  }
+  trace_start();
+  pthread_t threads[2];
+  for (int i = 0; i < 2; i++) {
+    pthread_create(&threads[i], NULL, test_trace_worker, (void *) &n);
+  }
+  {
+    TRACE_FUNC();
+  }
+  for (int i = 0; i < 2; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  trace_stop();
+  {
+    TRACE_SCOPE("test_trace_ignored");
+  }
+
+  // Sum event durations
+  uint64_t dur = 0;
+  MU_ASSERT(trace_total("test_trace_worker", &dur) == 2 * n);
+  MU_ASSERT(trace_total("test_trace_ignored", &dur) == 0);
+  MU_ASSERT(dur == 0);
+
+  // Save and count events
+  const char *json_path = "/tmp/test_trace.json";
+  MU_ASSERT(trace_save(json_path) == 0);
+  trace_clear();
+
+  char *json = file_read(json_path);
+  MU_ASSERT(json != NULL);
+  MU_ASSERT(strncmp(json, "{\"displayTimeUnit\"", 18) == 0);
+  int num_workers = 0;
+  int num_funcs = 0;
+  for (char *p = json; (p = strstr(p, "\"name\":\"")); p++) {
+    num_workers += strncmp(p + 8, "test_trace_worker\"", 18) == 0;
+    num_funcs += strncmp(p + 8, "test_trace\"", 11) == 0;
+    MU_ASSERT(strncmp(p + 8, "test_trace_ignored", 18) != 0);
+  }
+  MU_ASSERT(num_workers == 2 * n);
+  MU_ASSERT(num_funcs == 1);
+  free(json);
+
+  return 0;
+}
+
+#endif // USE_TRACE
+
+/******************************************************************************
+ * TEST PARALLEL
+ ******************************************************************************/
+
+static void test_parallel_for_task(void *data,
+                                   const int task,
+                                   const int thread) {
+  int *counts = (int *) data;
+  __atomic_fetch_add(&counts[task], 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&counts[1000 + thread], 1, __ATOMIC_RELAXED);
+}
+
+int test_parallel_for() {
+  MU_ASSERT(parallel_threads(4, 1000) == 4);
+  MU_ASSERT(parallel_threads(4, 2) == 2);
+  MU_ASSERT(parallel_threads(0, 1) == 1);
+  MU_ASSERT(parallel_threads(-1, 1000) >= 1);
+
+  // Every task runs exactly once, on a thread index in range
+  const int num_threads = 4;
+  int counts[1000 + 4] = {0};
+  parallel_for(1000, num_threads, test_parallel_for_task, counts);
+  int num_runs = 0;
+  for (int i = 0; i < 1000; i++) {
+    MU_ASSERT(counts[i] == 1);
+  }
+  for (int i = 0; i < num_threads; i++) {
+    num_runs += counts[1000 + i];
+  }
+  MU_ASSERT(num_runs == 1000);
+
+  return 0;
+}
+
 /******************************************************************************
  * TEST NETWORK
  ******************************************************************************/
@@ -2964,6 +3281,144 @@ int test_linear_triangulation() {
   return 0;
 }
 
+int test_linear_triangulation_batch() {
+  // Setup stereo projection matrices
+  const real_t proj_params[4] = {400.0, 400.0, 320.0, 240.0};
+  const real_t ypr_C0C1[3] = {0.01, 0.02, 0.0};
+  const real_t r_C0C1[3] = {0.1, 0.0, 0.0};
+  TF_IDENTITY(T_C0C0);
+  TF_ER(ypr_C0C1, r_C0C1, T_C0C1);
+  TF_INV(T_C0C1, T_C1C0);
+  real_t P0[3 * 4] = {0};
+  real_t P1[3 * 4] = {0};
+  pinhole_projection_matrix(proj_params, T_C0C0, P0);
+  pinhole_projection_matrix(proj_params, T_C0C1, P1);
+
+  // Setup correspondances
+  const int N = 3000;
+  real_t *points_gnd = MALLOC(real_t, N * 3);
+  real_t *z0 = MALLOC(real_t, N * 2);
+  real_t *z1 = MALLOC(real_t, N * 2);
+  for (int i = 0; i < N; i++) {
+    real_t *p_C0 = points_gnd + i * 3;
+    p_C0[0] = randf(-2.0, 2.0);
+    p_C0[1] = randf(-2.0, 2.0);
+    p_C0[2] = randf(1.0, 10.0);
+    real_t p_C1[3] = {0};
+    tf_point(T_C1C0, p_C0, p_C1);
+    pinhole_project(proj_params, p_C0, z0 + i * 2);
+    pinhole_project(proj_params, p_C1, z1 + i * 2);
+  }
+
+  // Triangulate serially and in parallel
+  real_t *points[2] = {0};
+  int *status[2] = {0};
+  for (int k = 0; k < 2; k++) {
+    points[k] = MALLOC(real_t, N * 3);
+    status[k] = MALLOC(int, N);
+  }
+  linear_triangulation_batch(P0, P1, z0, z1, N, 1, points[0], status[0]);
+  linear_triangulation_batch(P0, P1, z0, z1, N, 4, points[1], status[1]);
+  for (int i = 0; i < N; i++) {
+    real_t p[3] = {0};
+    linear_triangulation(P0, P1, z0 + i * 2, z1 + i * 2, p);
+
+    real_t diff[3] = {0};
+    vec_sub(points_gnd + i * 3, points[0] + i * 3, diff, 3);
+    MU_ASSERT(vec_norm(diff, 3) < 1e-4);
+    MU_ASSERT(vec_equals(points[0] + i * 3, p, 3));
+    MU_ASSERT(vec_equals(points[0] + i * 3, points[1] + i * 3, 3));
+    MU_ASSERT(status[0][i] == 0 && status[1][i] == 0);
+  }
+
+  // Degenerate, both rays are the same
+  real_t p[3] = {0};
+  int status_degenerate = 0;
+  linear_triangulation_batch(P0, P0, z0, z0, 1, 1, p, &status_degenerate);
+  MU_ASSERT(status_degenerate == -1);
+
+  // Clean up
+  free(points_gnd);
+  free(z0);
+  free(z1);
+  free(points[0]);
+  free(points[1]);
+  free(status[0]);
+  free(status[1]);
+
+  return 0;
+}
+
+int test_linear_triangulation_batch_noisy() {
+  // Short baseline stereo pair, far points are poorly conditioned
+  const real_t proj_params[4] = {400.0, 400.0, 320.0, 240.0};
+  const real_t ypr_C0C1[3] = {0.0, 0.0, 0.0};
+  const real_t r_C0C1[3] = {0.01, 0.0, 0.0};
+  TF_IDENTITY(T_C0C0);
+  TF_ER(ypr_C0C1, r_C0C1, T_C0C1);
+  TF_INV(T_C0C1, T_C1C0);
+  real_t P0[3 * 4] = {0};
+  real_t P1[3 * 4] = {0};
+  pinhole_projection_matrix(proj_params, T_C0C0, P0);
+  pinhole_projection_matrix(proj_params, T_C0C1, P1);
+
+  // Setup correspondances with pixel noise
+  const int N = 1000;
+  real_t *z0 = MALLOC(real_t, N * 2);
+  real_t *z1 = MALLOC(real_t, N * 2);
+  for (int i = 0; i < N; i++) {
+    const real_t p_C0[3] = {randf(-2.0, 2.0),
+                            randf(-2.0, 2.0),
+                            randf(1.0, 20.0)};
+    real_t p_C1[3] = {0};
+    tf_point(T_C1C0, p_C0, p_C1);
+    pinhole_project(proj_params, p_C0, z0 + i * 2);
+    pinhole_project(proj_params, p_C1, z1 + i * 2);
+    for (int k = 0; k < 2; k++) {
+      z0[i * 2 + k] += randf(-0.5, 0.5);
+      z1[i * 2 + k] += randf(-0.5, 0.5);
+    }
+  }
+
+  // Compare against the null vector of AᵀA from eig_sym
+  real_t *points = MALLOC(real_t, N * 3);
+  int *status = MALLOC(int, N);
+  linear_triangulation_batch(P0, P1, z0, z1, N, 1, points, status);
+  for (int i = 0; i < N; i++) {
+    const real_t *zi = z0 + i * 2;
+    const real_t *zj = z1 + i * 2;
+    real_t A[4 * 4] = {0};
+    for (int c = 0; c < 4; c++) {
+      A[0 * 4 + c] = zi[1] * P0[8 + c] - P0[4 + c];
+      A[1 * 4 + c] = zi[0] * P0[8 + c] - P0[0 + c];
+      A[2 * 4 + c] = zj[1] * P1[8 + c] - P1[4 + c];
+      A[3 * 4 + c] = zj[0] * P1[8 + c] - P1[0 + c];
+    }
+    real_t At[4 * 4] = {0};
+    real_t AtA[4 * 4] = {0};
+    mat_transpose(A, 4, 4, At);
+    dot(At, 4, 4, A, 4, 4, AtA);
+
+    real_t V[4 * 4] = {0};
+    real_t w[4] = {0};
+    MU_ASSERT(eig_sym(AtA, 4, 4, V, w) == 0);
+    const real_t p_ref[3] = {V[0] / V[12], V[4] / V[12], V[8] / V[12]};
+
+    real_t diff[3] = {0};
+    vec_sub(p_ref, points + i * 3, diff, 3);
+    MU_ASSERT(status[i] == 0);
+    MU_ASSERT(vec_norm(diff, 3) / vec_norm(p_ref, 3) < 1e-6);
+  }
+
+  // Clean up
+  free(z0);
+  free(z1);
+  free(points);
+  free(status);
+
+  return 0;
+}
+
 int test_homography_find() {
   // Setup camera
   const int image_width = 640;
@@ -3406,6 +3861,16 @@ int test_mav_att_ctrl() {
     idx += 1;
   }
 
+  // Save telemetry log
+  const char *log_path = "/tmp/test_mav_att_ctrl.tlog";
+  MU_ASSERT(mav_model_telem_save(telem, log_path) == 0);
+  tlog_t *log = tlog_load(log_path);
+  MU_ASSERT(log != NULL);
+  const int att = tlog_find(log, "attitude");
+  MU_ASSERT(att != -1);
+  MU_ASSERT(log->channels[att].num_samples == (uint64_t) N);
+  tlog_free(log);
+
   int debug = 0;
   if (debug) {
     mav_model_telem_plot(telem);
@@ -3583,6 +4048,126 @@ int test_mav_waypoints() {
   return 0;
 }
 
+int test_mav_batch() {
+  // Setup two identical batches, odd MAVs are disturbed
+  const int num_mavs = 130;
+  const int num_steps = 1000;
+  const real_t dt = 0.001;
+  const real_t sp[4] = {1.0, -1.0, 2.0, 0.5};
+  mav_batch_t *batch = mav_batch_malloc(num_mavs, 10, 50);
+  mav_batch_t *lockstep = mav_batch_malloc(num_mavs, 10, 50);
+  batch->num_threads = 4;
+  lockstep->num_threads = 1;
+
+  mav_model_t *mavs = MALLOC(mav_model_t, num_mavs);
+  mav_att_ctrl_t *att_ctrls = MALLOC(mav_att_ctrl_t, num_mavs);
+  mav_vel_ctrl_t *vel_ctrls = MALLOC(mav_vel_ctrl_t, num_mavs);
+  mav_pos_ctrl_t *pos_ctrls = MALLOC(mav_pos_ctrl_t, num_mavs);
+  for (int i = 0; i < num_mavs; i++) {
+    test_setup_mav(&mavs[i]);
+    mav_att_ctrl_setup(&att_ctrls[i]);
+    mav_vel_ctrl_setup(&vel_ctrls[i]);
+    mav_pos_ctrl_setup(&pos_ctrls[i]);
+    pos_ctrls[i].x.k_p = 0.5 + 0.01 * (i / 2);
+    pos_ctrls[i].y.k_p = 0.5 + 0.01 * (i / 2);
+
+    const real_t force[3] = {0.5, 0.0, 0.0};
+    const real_t torque[3] = {0.0, 0.0, 0.1};
+    mav_batch_t *batches[2] = {batch, lockstep};
+    for (int k = 0; k < 2; k++) {
+      mav_batch_set_model(batches[k], i, &mavs[i]);
+      mav_batch_set_ctrl(batches[k],
+                         i,
+                         &att_ctrls[i],
+                         &vel_ctrls[i],
+                         &pos_ctrls[i]);
+      mav_batch_set_setpoint(batches[k], i, sp);
+      if (i % 2) {
+        mav_batch_set_disturbance(batches[k], i, force, torque);
+      }
+    }
+  }
+
+  // Simulate in two runs, sample s holds the state after step 10 * s
+  mav_batch_run(batch, num_steps / 2, dt);
+  mav_batch_run(batch, num_steps / 2, dt);
+  MU_ASSERT(batch->num_steps == num_steps);
+  MU_ASSERT(fabs(batch->time - num_steps * dt) < 1e-9);
+  MU_ASSERT(batch->num_telem == 50);
+  MU_ASSERT(fabs(batch->telem_time[0] - 1 * dt) < 1e-9);
+  MU_ASSERT(fabs(batch->telem_time[49] - 491 * dt) < 1e-9);
+
+  // Step the second batch one step at a time against the scalar model and
+  // controllers. The closed loop amplifies rounding differences (vectorized
+  // sin / cos, BLAS rotations) so each scalar model is re-synced to its batch
+  // twin after every step, and all 12 states are compared per step.
+  for (int step = 0; step < num_steps; step++) {
+    mav_batch_run(lockstep, 1, dt);
+
+    for (int i = 0; i < num_mavs; i += 2) {
+      mav_model_t *mav = &mavs[i];
+      const real_t pos_pv[4] = {mav->x[6], mav->x[7], mav->x[8], mav->x[2]};
+      const real_t vel_pv[4] = {mav->x[9], mav->x[10], mav->x[11], mav->x[2]};
+      const real_t att_pv[3] = {mav->x[0], mav->x[1], mav->x[2]};
+
+      real_t vel_sp[4] = {0};
+      real_t att_sp[4] = {0};
+      real_t u[4] = {0};
+      mav_pos_ctrl_update(&pos_ctrls[i], sp, pos_pv, dt, vel_sp);
+      mav_vel_ctrl_update(&vel_ctrls[i], vel_sp, vel_pv, dt, att_sp);
+      mav_att_ctrl_update(&att_ctrls[i], att_sp, att_pv, dt, u);
+      mav_model_update(mav, u, dt);
+
+      mav_model_t mav_batch;
+      mav_batch_get_model(lockstep, i, &mav_batch);
+      for (int k = 0; k < 12; k++) {
+        MU_ASSERT(fabs(mav_batch.x[k] - mav->x[k]) < 1e-9);
+        mav->x[k] = mav_batch.x[k];
+      }
+    }
+  }
+
+  // Single steps and multi-step runs give the same states and telemetry
+  MU_ASSERT(lockstep->num_telem == batch->num_telem);
+  for (int s = 0; s < batch->num_telem; s++) {
+    MU_ASSERT(fabs(lockstep->telem_time[s] - batch->telem_time[s]) < 1e-9);
+    for (int k = 0; k < 12; k++) {
+      const real_t *telem0 = mav_batch_telem(batch, s, k);
+      const real_t *telem1 = mav_batch_telem(lockstep, s, k);
+      for (int i = 0; i < num_mavs; i++) {
+        MU_ASSERT(fabs(telem0[i] - telem1[i]) < 1e-12);
+      }
+    }
+  }
+  for (int i = 0; i < num_mavs; i++) {
+    mav_model_t mav0;
+    mav_model_t mav1;
+    mav_batch_get_model(batch, i, &mav0);
+    mav_batch_get_model(lockstep, i, &mav1);
+    for (int k = 0; k < 12; k++) {
+      MU_ASSERT(fabs(mav0.x[k] - mav1.x[k]) < 1e-12);
+    }
+  }
+
+  // Disturbed MAVs drift away from their undisturbed twin
+  mav_model_t mav0;
+  mav_model_t mav1;
+  mav_batch_get_model(batch, 0, &mav0);
+  mav_batch_get_model(batch, 1, &mav1);
+  MU_ASSERT(fabs(mav0.x[2] - mav1.x[2]) > 1e-3);
+  MU_ASSERT(fabs(mav0.x[6] - mav1.x[6]) > 1e-3);
+
+  // Clean up
+  mav_batch_free(batch);
+  mav_batch_free(lockstep);
+  free(mavs);
+  free(att_ctrls);
+  free(vel_ctrls);
+  free(pos_ctrls);
+
+  return 0;
+}
+
 /******************************************************************************
  * TEST SENSOR FUSION
  ******************************************************************************/
@@ -4016,6 +4601,94 @@ int test_camera_params() {
   return 0;
 }
 
+int test_camera_model_project() {
+  const int cam_res[2] = {752, 480};
+  const real_t data[8] = {640, 480, 320, 240, 0.01, 0.001, 0.001, 0.001};
+  const real_t p_C[3] = {0.1, -0.2, 2.0};
+
+  // Pinhole-Radtan4
+  camera_params_t radtan;
+  camera_params_setup(&radtan, 0, cam_res, "pinhole", "radtan4", data);
+  MU_ASSERT(radtan.model == CAMERA_PINHOLE_RADTAN4);
+
+  real_t z[2] = {0};
+  real_t z_gnd[2] = {0};
+  camera_project(&radtan, p_C, z);
+  pinhole_radtan4_project(data, p_C, z_gnd);
+  MU_ASSERT(fltcmp(z[0], z_gnd[0]) == 0);
+  MU_ASSERT(fltcmp(z[1], z_gnd[1]) == 0);
+
+  // Pinhole-Equi4
+  camera_params_t equi;
+  camera_params_setup(&equi, 0, cam_res, "pinhole", "equi4", data);
+  MU_ASSERT(equi.model == CAMERA_PINHOLE_EQUI4);
+
+  camera_project(&equi, p_C, z);
+  pinhole_equi4_project(data, p_C, z_gnd);
+  MU_ASSERT(fltcmp(z[0], z_gnd[0]) == 0);
+  MU_ASSERT(fltcmp(z[1], z_gnd[1]) == 0);
+
+  // Copy preserves model
+  camera_params_t copy;
+  camera_params_copy(&equi, &copy);
+  MU_ASSERT(copy.model == CAMERA_PINHOLE_EQUI4);
+  MU_ASSERT(camera_model_id("pinhole", "fov") == -1);
+
+  return 0;
+}
+
+int test_camera_project_points() {
+  const int cam_res[2] = {752, 480};
+  const real_t data[8] = {640, 480, 320, 240, 0.01, 0.001, 0.001, 0.001};
+  const char *dist_models[2] = {"radtan4", "equi4"};
+
+  // Points in front of the camera
+  const int n = 100;
+  real_t p_C[100 * 3] = {0};
+  for (int i = 0; i < n; i++) {
+    p_C[i * 3 + 0] = -0.45 + (i % 10) * 0.1;
+    p_C[i * 3 + 1] = -0.5 + (i / 10) * 0.1;
+    p_C[i * 3 + 2] = 1.0 + (i % 7) * 0.1;
+  }
+
+  for (int m = 0; m < 2; m++) {
+    camera_params_t cam;
+    camera_params_setup(&cam, 0, cam_res, "pinhole", dist_models[m], data);
+
+    // Bulk projection matches the single point path
+    real_t z[100 * 2] = {0};
+    camera_project_points(&cam, p_C, n, z);
+    for (int i = 0; i < n; i++) {
+      real_t z_gnd[2] = {0};
+      cam.proj_func(cam.data, &p_C[i * 3], z_gnd);
+      MU_ASSERT(fltcmp(z[i * 2 + 0], z_gnd[0]) == 0);
+      MU_ASSERT(fltcmp(z[i * 2 + 1], z_gnd[1]) == 0);
+    }
+
+    // Bulk back-projection recovers the bearing of each point
+    real_t bearings[100 * 3] = {0};
+    camera_back_project_points(&cam, z, n, bearings);
+    for (int i = 0; i < n; i++) {
+      const real_t *p = &p_C[i * 3];
+      MU_ASSERT(fabs(bearings[i * 3 + 0] - p[0] / p[2]) < 1e-8);
+      MU_ASSERT(fabs(bearings[i * 3 + 1] - p[1] / p[2]) < 1e-8);
+      MU_ASSERT(fltcmp(bearings[i * 3 + 2], 1.0) == 0);
+    }
+
+    // Bulk undistortion matches the pinhole projection without distortion
+    real_t z_und[100 * 2] = {0};
+    camera_undistort_points(&cam, z, n, z_und);
+    for (int i = 0; i < n; i++) {
+      real_t z_gnd[2] = {0};
+      pinhole_project(data, &p_C[i * 3], z_gnd);
+      MU_ASSERT(fabs(z_und[i * 2 + 0] - z_gnd[0]) < 1e-6);
+      MU_ASSERT(fabs(z_und[i * 2 + 1] - z_gnd[1]) < 1e-6);
+    }
+  }
+
+  return 0;
+}
+
 int test_triangulation_batch() {
   // Setup camera
   const int image_width = 640;
@@ -4123,6 +4796,124 @@ int test_triangulation_batch() {
   return 0;
 }
 
+int test_remap_table_undistort() {
+  // Setup image
+  const int w = 64;
+  const int h = 48;
+  uint8_t *src_data = MALLOC(uint8_t, w * h);
+  uint8_t *dst_data = MALLOC(uint8_t, w * h);
+  for (int i = 0; i < w * h; i++) {
+    src_data[i] = (i * 7) % 251;
+  }
+  image_t src;
+  image_t dst;
+  image_setup(&src, w, h, src_data);
+  image_setup(&dst, w, h, dst_data);
+
+  // Without distortion the table is the identity map
+  const int cam_res[2] = {w, h};
+  real_t data[8] = {50.0, 50.0, w / 2.0, h / 2.0, 0.0, 0.0, 0.0, 0.0};
+  camera_params_t cam;
+  camera_params_setup(&cam, 0, cam_res, "pinhole", "radtan4", data);
+  remap_table_t *table = remap_table_undistort(&cam);
+  remap_image(table, &src, &dst);
+  for (int i = 0; i < w * h; i++) {
+    MU_ASSERT(dst_data[i] == src_data[i]);
+  }
+  remap_table_free(table);
+
+  // With distortion every pixel samples the distorted projection of its ray
+  data[4] = -0.1;
+  data[5] = 0.01;
+  camera_params_setup(&cam, 0, cam_res, "pinhole", "radtan4", data);
+  table = remap_table_undistort(&cam);
+  for (int v = 0; v < h; v++) {
+    for (int u = 0; u < w; u++) {
+      const real_t p_C[3] = {(u - data[2]) / data[0],
+                             (v - data[3]) / data[1],
+                             1.0};
+      real_t z[2] = {0};
+      camera_project(&cam, p_C, z);
+
+      const int idx = v * w + u;
+      const uint16_t *wt = &table->weights[idx * 4];
+      const int sum = wt[0] + wt[1] + wt[2] + wt[3];
+      if (z[0] < 0 || z[1] < 0 || z[0] > w - 1 || z[1] > h - 1) {
+        MU_ASSERT(sum == 0);
+        continue;
+      }
+      MU_ASSERT(sum == REMAP_FRAC_SIZE * REMAP_FRAC_SIZE);
+
+      const real_t x0 = table->offsets[idx] % w;
+      const real_t y0 = table->offsets[idx] / w;
+      const real_t wx = (wt[1] + wt[3]) / (real_t) sum;
+      const real_t wy = (wt[2] + wt[3]) / (real_t) sum;
+      MU_ASSERT(fabs(x0 + wx - z[0]) < 1.0 / REMAP_FRAC_SIZE);
+      MU_ASSERT(fabs(y0 + wy - z[1]) < 1.0 / REMAP_FRAC_SIZE);
+    }
+  }
+  remap_image(table, &src, &dst);
+
+  // Clean up
+  remap_table_free(table);
+  free(src_data);
+  free(dst_data);
+
+  return 0;
+}
+
+int test_stereo_rectify() {
+  // Setup cameras
+  const int cam_res[2] = {640, 480};
+  const real_t data0[8] = {458.0, 457.0, 367.0, 248.0, 0.0, 0.0, 0.0, 0.0};
+  const real_t data1[8] = {457.0, 456.0, 379.0, 255.0, 0.0, 0.0, 0.0, 0.0};
+  camera_params_t cam0;
+  camera_params_t cam1;
+  camera_params_setup(&cam0, 0, cam_res, "pinhole", "radtan4", data0);
+  camera_params_setup(&cam1, 1, cam_res, "pinhole", "radtan4", data1);
+
+  // Stereo extrinsics
+  const real_t ypr_C0C1[3] = {0.01, -0.02, 0.005};
+  const real_t r_C0C1[3] = {0.11, 0.002, -0.001};
+  real_t T_C0C1[4 * 4] = {0};
+  tf_er(ypr_C0C1, r_C0C1, T_C0C1);
+  TF_INV(T_C0C1, T_C1C0);
+
+  // Rectify
+  real_t K_rect[4] = {0};
+  real_t R0[3 * 3] = {0};
+  real_t R1[3 * 3] = {0};
+  stereo_rectify(&cam0, &cam1, T_C0C1, K_rect, R0, R1);
+
+  // Corresponding points lie on the same rectified row
+  for (int i = 0; i < 10; i++) {
+    const real_t p_C0[3] = {-0.5 + 0.1 * i, 0.3 - 0.05 * i, 2.0 + 0.2 * i};
+    TF_POINT(T_C1C0, p_C0, p_C1);
+
+    real_t p0[3] = {0};
+    real_t p1[3] = {0};
+    real_t z0[2] = {0};
+    real_t z1[2] = {0};
+    dot(R0, 3, 3, p_C0, 3, 1, p0);
+    dot(R1, 3, 3, p_C1, 3, 1, p1);
+    pinhole_project(K_rect, p0, z0);
+    pinhole_project(K_rect, p1, z1);
+    MU_ASSERT(fabs(z0[1] - z1[1]) < 1e-8);
+    MU_ASSERT(z0[0] > z1[0]);
+  }
+
+  // Remap tables
+  remap_table_t *table0 = NULL;
+  remap_table_t *table1 = NULL;
+  remap_table_stereo_rectify(&cam0, &cam1, T_C0C1, K_rect, &table0, &table1);
+  MU_ASSERT(table0->width == cam_res[0]);
+  MU_ASSERT(table1->height == cam_res[1]);
+  remap_table_free(table0);
+  remap_table_free(table1);
+
+  return 0;
+}
+
 int test_pose_factor() {
   /* Pose */
   timestamp_t ts = 1;
@@ -4994,6 +5785,111 @@ int test_calib_camera_factor() {
   return 0;
 }
 
+int test_calib_camera_view_linearize() {
+  // Setup
+  test_calib_camera_data_t calib_data;
+  test_calib_camera_data_setup(&calib_data);
+  calib_data.cam_params.data[4] = 0.01;
+  calib_data.cam_params.data[5] = 0.001;
+  calib_data.cam_params.data[6] = 0.001;
+  calib_data.cam_params.data[7] = 0.001;
+
+  // Form view with more corners than CALIB_CAMERA_BATCH_SIZE
+  aprilgrid_t *grid = aprilgrid_malloc(6, 6, 0.088, 0.3);
+  const int num_corners = grid->num_rows * grid->num_cols * 4;
+  int *tag_ids = MALLOC(int, num_corners);
+  int *corner_indices = MALLOC(int, num_corners);
+  real_t *object_points = MALLOC(real_t, num_corners * 3);
+  real_t *keypoints = MALLOC(real_t, num_corners * 2);
+
+  TF_INV(calib_data.T_BCi, T_CiB);
+  TF_CHAIN(T_CiF, 2, T_CiB, calib_data.T_BF);
+  for (int i = 0; i < num_corners; i++) {
+    tag_ids[i] = i / 4;
+    corner_indices[i] = i % 4;
+    real_t *p_FFi = &object_points[i * 3];
+    aprilgrid_object_point(grid, tag_ids[i], corner_indices[i], p_FFi);
+    TF_POINT(T_CiF, p_FFi, p_CiFi);
+    camera_project(&calib_data.cam_params, p_CiFi, &keypoints[i * 2]);
+    keypoints[i * 2 + 0] += 0.5 * ((i % 3) - 1);
+    keypoints[i * 2 + 1] -= 0.5 * ((i % 5) - 2);
+  }
+
+  calib_camera_view_t *view = calib_camera_view_malloc(0,
+                                                       0,
+                                                       0,
+                                                       num_corners,
+                                                       tag_ids,
+                                                       corner_indices,
+                                                       object_points,
+                                                       keypoints,
+                                                       &calib_data.rel_pose,
+                                                       &calib_data.cam_ext,
+                                                       &calib_data.cam_params);
+
+  // Parameter order
+  int sv_size = 0;
+  param_order_t *hash = NULL;
+  param_order_add_pose(&hash, &calib_data.rel_pose, &sv_size);
+  param_order_add_extrinsic(&hash, &calib_data.cam_ext, &sv_size);
+  param_order_add_camera(&hash, &calib_data.cam_params, &sv_size);
+  MU_ASSERT(sv_size == 20);
+
+  // Evaluate per factor
+  const int r_size = num_corners * 2;
+  real_t *H_fwd = CALLOC(real_t, sv_size * sv_size);
+  real_t *g_fwd = CALLOC(real_t, sv_size);
+  real_t *r_fwd = CALLOC(real_t, r_size);
+  for (int i = 0; i < num_corners; i++) {
+    calib_camera_factor_t *factor = &view->factors[i];
+    calib_camera_factor_eval(factor);
+    vec_copy(factor->r, factor->r_size, &r_fwd[i * 2]);
+    solver_fill_hessian(hash,
+                        factor->num_params,
+                        factor->params,
+                        factor->jacs,
+                        factor->r,
+                        factor->r_size,
+                        sv_size,
+                        H_fwd,
+                        g_fwd);
+  }
+  real_t J_cam_params[2 * 8] = {0};
+  mat_copy(view->factors[0].J_cam_params, 2, 8, J_cam_params);
+
+  // Evaluate batched
+  real_t *H = CALLOC(real_t, sv_size * sv_size);
+  real_t *g = CALLOC(real_t, sv_size);
+  real_t *r = CALLOC(real_t, r_size);
+  calib_camera_view_linearize(view, sv_size, hash, H, g, r);
+
+  MU_ASSERT(mat_equals(r, r_fwd, r_size, 1, 1e-8));
+  MU_ASSERT(mat_equals(H, H_fwd, sv_size, sv_size, 1e-6));
+  MU_ASSERT(mat_equals(g, g_fwd, sv_size, 1, 1e-6));
+  MU_ASSERT(mat_equals(view->factors[0].J_cam_params,
+                       J_cam_params,
+                       2,
+                       8,
+                       1e-8));
+
+  // Clean up
+  free(H_fwd);
+  free(g_fwd);
+  free(r_fwd);
+  free(H);
+  free(g);
+  free(r);
+  free(tag_ids);
+  free(corner_indices);
+  free(object_points);
+  free(keypoints);
+  param_order_free(hash);
+  calib_camera_view_free(view);
+  aprilgrid_free(grid);
+
+  return 0;
+}
+
 typedef struct test_calib_imucam_data_t {
   real_t T_WF[4 * 4];
   real_t T_WS[4 * 4];
@@ -5302,6 +6198,110 @@ int test_calib_gimbal_factor() {
   return 0;
 }
 
+int test_info_gain() {
+  // Parameters: two positions (scored) and two joints
+  real_t p0[3] = {0};
+  real_t p1[3] = {0};
+  real_t j0[1] = {0};
+  real_t j1[1] = {0};
+  param_order_t *hash = NULL;
+  int col_idx = 0;
+  param_order_add(&hash, POSITION_PARAM, 0, p0, &col_idx);
+  param_order_add(&hash, POSITION_PARAM, 0, p1, &col_idx);
+  param_order_add(&hash, JOINT_PARAM, 0, j0, &col_idx);
+  param_order_add(&hash, JOINT_PARAM, 0, j1, &col_idx);
+  const int sv_size = 8;
+  const int n = 6;
+  MU_ASSERT(col_idx == sv_size);
+
+  // Information matrix H = A' * A + I
+  real_t A[10 * 8] = {0};
+  real_t At[8 * 10] = {0};
+  real_t H[8 * 8] = {0};
+  for (int i = 0; i < 10 * sv_size; i++) {
+    A[i] = randf(-1.0, 1.0);
+  }
+  mat_transpose(A, 10, sv_size, At);
+  dot(At, sv_size, 10, A, 10, sv_size, H);
+  for (int i = 0; i < sv_size; i++) {
+    H[i * sv_size + i] += 1.0;
+  }
+
+  // Candidate measurements with two new nuisance parameters
+  const int m = 4;
+  const int p = 2;
+  real_t J[4 * 6] = {0};
+  real_t J_nuis[4 * 2] = {0};
+  real_t info_nuis[2] = {2.0, 3.0};
+  for (int i = 0; i < m * n; i++) {
+    J[i] = randf(-1.0, 1.0);
+  }
+  for (int i = 0; i < m * p; i++) {
+    J_nuis[i] = randf(-1.0, 1.0);
+  }
+
+  // Information gain
+  info_gain_t *ig = info_gain_malloc(hash, H, sv_size, 0, n - 1);
+  MU_ASSERT(ig != NULL);
+  MU_ASSERT(ig->size == n);
+  MU_ASSERT(ig->rank == n);
+  MU_ASSERT(info_gain_col(ig, p0) == 0);
+  MU_ASSERT(info_gain_col(ig, p1) == 3);
+  MU_ASSERT(info_gain_col(ig, j0) == -1);
+  real_t entropy = 0.0;
+  MU_ASSERT(info_gain_eval(ig, J, J_nuis, info_nuis, m, p, &entropy) == 0);
+
+  // Brute force: augment H with the measurements and nuisance parameters
+  const int N = sv_size + p;
+  real_t H_aug[10 * 10] = {0};
+  real_t H_aug_inv[10 * 10] = {0};
+  real_t J_aug[4 * 10] = {0};
+  real_t J_aug_t[10 * 4] = {0};
+  for (int i = 0; i < m; i++) {
+    for (int j = 0; j < n; j++) {
+      J_aug[i * N + j] = J[i * n + j];
+    }
+    for (int j = 0; j < p; j++) {
+      J_aug[i * N + sv_size + j] = J_nuis[i * p + j];
+    }
+  }
+  mat_transpose(J_aug, m, N, J_aug_t);
+  dot(J_aug_t, N, m, J_aug, m, N, H_aug);
+  for (int i = 0; i < sv_size; i++) {
+    for (int j = 0; j < sv_size; j++) {
+      H_aug[i * N + j] += H[i * sv_size + j];
+    }
+  }
+  for (int i = 0; i < p; i++) {
+    H_aug[(sv_size + i) * N + (sv_size + i)] += info_nuis[i];
+  }
+  pinv(H_aug, N, N, H_aug_inv);
+
+  real_t covar0[6 * 6] = {0};
+  real_t covar1[6 * 6] = {0};
+  real_t H_inv[8 * 8] = {0};
+  pinv(H, sv_size, sv_size, H_inv);
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      covar0[i * n + j] = H_inv[i * sv_size + j];
+      covar1[i * n + j] = H_aug_inv[i * N + j];
+    }
+  }
+  real_t entropy0 = 0.0;
+  real_t entropy1 = 0.0;
+  shannon_entropy(covar0, n, &entropy0);
+  shannon_entropy(covar1, n, &entropy1);
+  MU_ASSERT(fabs(ig->entropy - entropy0) < 1e-8);
+  MU_ASSERT(fabs(entropy - entropy1) < 1e-8);
+  MU_ASSERT(entropy < ig->entropy);
+
+  // Clean up
+  info_gain_free(ig);
+  param_order_free(hash);
+
+  return 0;
+}
+
 int test_marg() {
   // Timestamp
   timestamp_t ts = 0;
@@ -6209,6 +7209,71 @@ int test_calib_camera_mono_batch() {
   return 0;
 }
 
+int test_calib_camera_add_archive() {
+  const char *data_path = TEST_CAM_APRIL "/cam0";
+  const char *archive_path = "/tmp/test_calib_camera_archive.bin";
+
+  // Pack AprilGrid csv files into archive
+  int num_files = 0;
+  char **files = list_files(data_path, &num_files);
+  aprilgrid_archive_writer_t *writer =
+      aprilgrid_archive_writer_malloc(archive_path);
+  MU_ASSERT(writer != NULL);
+  for (int i = 0; i < num_files; i++) {
+    aprilgrid_t *grid = aprilgrid_load(files[i]);
+    MU_ASSERT(aprilgrid_archive_writer_add(writer, 0, grid) == 0);
+    aprilgrid_free(grid);
+  }
+  MU_ASSERT(aprilgrid_archive_writer_close(writer) == 0);
+  list_files_free(files, num_files);
+
+  // Load csv files and archive
+  const int cam_res[2] = {752, 480};
+  const real_t cam_ext[7] = {0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0};
+  const real_t cam_params[8] =
+      {495.864541, 495.864541, 375.500000, 239.500000, 0, 0, 0, 0};
+  calib_camera_t *calib_csv = calib_camera_malloc();
+  calib_camera_t *calib_bin = calib_camera_malloc();
+  calib_camera_add_camera(calib_csv,
+                          0,
+                          cam_res,
+                          "pinhole",
+                          "radtan4",
+                          cam_params,
+                          cam_ext);
+  calib_camera_add_camera(calib_bin,
+                          0,
+                          cam_res,
+                          "pinhole",
+                          "radtan4",
+                          cam_params,
+                          cam_ext);
+  MU_ASSERT(calib_camera_add_data(calib_csv, 0, data_path) == 0);
+  MU_ASSERT(calib_camera_add_data(calib_bin, 0, archive_path) == 0);
+
+  // Asserts
+  MU_ASSERT(calib_bin->num_views == calib_csv->num_views);
+  MU_ASSERT(calib_bin->num_factors == calib_csv->num_factors);
+  for (int view_idx = 0; view_idx < calib_csv->num_views; view_idx++) {
+    const timestamp_t ts = calib_csv->timestamps[view_idx];
+    calib_camera_view_t *v0 = hmgets(calib_csv->view_sets, ts).value[0];
+    calib_camera_view_t *v1 = hmgets(calib_bin->view_sets, ts).value[0];
+    MU_ASSERT(v1 != NULL);
+    MU_ASSERT(v0->num_corners == v1->num_corners);
+    for (int i = 0; i < v0->num_corners; i++) {
+      MU_ASSERT(v0->tag_ids[i] == v1->tag_ids[i]);
+      MU_ASSERT(v0->corner_indices[i] == v1->corner_indices[i]);
+      MU_ASSERT(fltcmp(v0->keypoints[i * 2], v1->keypoints[i * 2]) == 0);
+    }
+  }
+
+  // Clean up
+  calib_camera_free(calib_csv);
+  calib_camera_free(calib_bin);
+
+  return 0;
+}
+
 int test_calib_camera_mono_ceres() {
   const char *data_path = TEST_CAM_APRIL "/cam0";
 
@@ -8070,6 +9135,258 @@ int test_sim_camera_circle_trajectory() {
   return 0;
 }
 
+int test_sim_features_grid() {
+  // Landmarks
+  const real_t origin[3] = {0.0, 0.0, 0.0};
+  const real_t dim[3] = {5.0, 5.0, 5.0};
+  const int num_features = 5000;
+  real_t *features = MALLOC(real_t, num_features * 3);
+  sim_create_features(origin, dim, num_features, features);
+
+  // Distorted camera, the frustum has to contain every projectable point
+  const int cam_res[2] = {640, 480};
+  const real_t fx = pinhole_focal(cam_res[0], 90.0);
+  const real_t cam_vec[8] = {fx, fx, 320.0, 240.0, -0.2, 0.05, 1e-3, -1e-3};
+  camera_params_t cam;
+  camera_params_setup(&cam, 0, cam_res, "pinhole", "radtan4", cam_vec);
+  sim_frustum_t frustum;
+  sim_frustum_setup(&frustum, &cam, 1e-3, 0.0);
+
+  // Grid query must be a sorted superset of the brute-force visible set
+  sim_features_grid_t *grid = sim_features_grid_malloc(features,
+                                                       num_features,
+                                                       0.0);
+  int *ids = MALLOC(int, num_features);
+  int *mask = CALLOC(int, num_features);
+  for (int k = 0; k < 36; k++) {
+    const real_t yaw = 2.0 * M_PI * k / 36.0;
+    const real_t r_WB[3] = {2.0 * cos(yaw), 2.0 * sin(yaw), 0.1 * k - 1.8};
+    const real_t ypr_WC[3] = {yaw, 0.0, -M_PI / 2.0};
+    TF_ER(ypr_WC, r_WB, T_WC);
+    TF_INV(T_WC, T_CW);
+
+    const int n = sim_features_grid_query(grid, &frustum, T_CW, ids);
+    MU_ASSERT(n < num_features);
+    for (int i = 0; i < n; i++) {
+      MU_ASSERT(i == 0 || ids[i - 1] < ids[i]);
+      mask[ids[i]] = 1;
+    }
+
+    for (int i = 0; i < num_features; i++) {
+      TF_POINT(T_CW, features + i * 3, p_C);
+      real_t z[2] = {0};
+      if (p_C[2] > 1e-3) {
+        camera_project(&cam, p_C, z);
+        const int x_ok = (z[0] > 0 && z[0] < cam_res[0]);
+        const int y_ok = (z[1] > 0 && z[1] < cam_res[1]);
+        MU_ASSERT(!(x_ok && y_ok) || mask[i]);
+      }
+      mask[i] = 0;
+    }
+  }
+
+  // Clean up
+  sim_features_grid_free(grid);
+  free(features);
+  free(ids);
+  free(mask);
+
+  return 0;
+}
+
+static sim_spline_t *setup_sim_spline() {
+  // Wobbly loop around the origin
+  const int num_points = 24;
+  const real_t dt = 0.5;
+  real_t points[24 * 6] = {0};
+  for (int i = 0; i < num_points; i++) {
+    const real_t theta = 2.0 * M_PI * i / (num_points - 3);
+    points[i * 6 + 0] = 2.0 * cos(theta);
+    points[i * 6 + 1] = 1.5 * sin(theta);
+    points[i * 6 + 2] = 0.3 * sin(2.0 * theta);
+    points[i * 6 + 3] = theta + M_PI / 2.0;
+    points[i * 6 + 4] = 0.1 * sin(3.0 * theta);
+    points[i * 6 + 5] = 0.1 * cos(2.0 * theta);
+  }
+  return sim_spline_malloc(0, dt, points, num_points);
+}
+
+int test_sim_spline() {
+  sim_spline_t *spline = setup_sim_spline();
+  MU_ASSERT(sim_spline_end(spline) == sec2ts(21 * 0.5));
+
+  // Check derivatives against finite differences
+  const timestamp_t h = sec2ts(1e-4);
+  for (real_t t = 0.1; t < 10.4; t += 0.37) {
+    const timestamp_t ts = sec2ts(t);
+    real_t pose[7] = {0};
+    real_t v[3] = {0};
+    real_t a[3] = {0};
+    real_t w[3] = {0};
+    real_t pose_m[7] = {0};
+    real_t pose_p[7] = {0};
+    real_t v_m[3] = {0};
+    real_t v_p[3] = {0};
+    sim_spline_eval(spline, ts, pose, v, a, w);
+    sim_spline_eval(spline, ts - h, pose_m, v_m, NULL, NULL);
+    sim_spline_eval(spline, ts + h, pose_p, v_p, NULL, NULL);
+
+    // -- Velocity and acceleration
+    for (int k = 0; k < 3; k++) {
+      const real_t v_fd = (pose_p[k] - pose_m[k]) / (2.0 * ts2sec(h));
+      const real_t a_fd = (v_p[k] - v_m[k]) / (2.0 * ts2sec(h));
+      MU_ASSERT(fabs(v_fd - v[k]) < 1e-4);
+      MU_ASSERT(fabs(a_fd - a[k]) < 1e-4);
+    }
+
+    // -- Angular velocity
+    real_t C_m[3 * 3] = {0};
+    real_t C_p[3 * 3] = {0};
+    real_t C_mt[3 * 3] = {0};
+    real_t dC[3 * 3] = {0};
+    real_t rvec[3] = {0};
+    quat2rot(pose_m + 3, C_m);
+    quat2rot(pose_p + 3, C_p);
+    mat_transpose(C_m, 3, 3, C_mt);
+    dot(C_mt, 3, 3, C_p, 3, 3, dC);
+    lie_Log(dC, rvec);
+    for (int k = 0; k < 3; k++) {
+      MU_ASSERT(fabs(rvec[k] / (2.0 * ts2sec(h)) - w[k]) < 1e-4);
+    }
+
+    // -- Accelerometer measures specific force in the body frame
+    real_t acc[3] = {0};
+    real_t gyr[3] = {0};
+    real_t C_WB[3 * 3] = {0};
+    real_t f_W[3] = {0};
+    sim_spline_imu(spline, ts, acc, gyr);
+    quat2rot(pose + 3, C_WB);
+    dot(C_WB, 3, 3, acc, 3, 1, f_W);
+    MU_ASSERT(fabs(f_W[0] - a[0]) < 1e-8);
+    MU_ASSERT(fabs(f_W[1] - a[1]) < 1e-8);
+    MU_ASSERT(fabs(f_W[2] - 9.81 - a[2]) < 1e-8);
+    MU_ASSERT(vec_equals(gyr, w, 3));
+  }
+
+  sim_spline_free(spline);
+
+  return 0;
+}
+
+typedef struct test_sim_vi_data_t {
+  const sim_vi_t *sim;
+  timestamp_t ts_prev;
+  int type_prev;
+  int cam_idx_prev;
+  int num_imu;
+  int num_cam;
+  int num_keypoints;
+  real_t checksum;
+  int ok;
+} test_sim_vi_data_t;
+
+static int test_sim_vi_cb(void *arg, const timeline_event_t *event) {
+  test_sim_vi_data_t *data = (test_sim_vi_data_t *) arg;
+
+  // Check order: by timestamp, IMU first, then cameras by index
+  const int cam_idx = (event->type == CAMERA_EVENT) ? event->data.camera.cam_idx
+                                                    : -1;
+  if (event->ts < data->ts_prev) {
+    data->ok = 0;
+  } else if (event->ts == data->ts_prev && cam_idx <= data->cam_idx_prev) {
+    data->ok = 0;
+  }
+  data->ts_prev = event->ts;
+  data->cam_idx_prev = cam_idx;
+
+  if (event->type == IMU_EVENT) {
+    data->num_imu++;
+    data->checksum += event->data.imu.acc[0] + event->data.imu.gyr[2];
+    return 0;
+  }
+
+  // Check keypoints against the trajectory
+  const camera_event_t *cam_event = &event->data.camera;
+  const camera_params_t *cam = &data->sim->cam_params[cam_idx];
+  real_t pose[7] = {0};
+  sim_spline_eval(data->sim->spline, event->ts, pose, NULL, NULL, NULL);
+  TF(pose, T_WB);
+  TF(data->sim->cam_exts + cam_idx * 7, T_BC);
+  TF_CHAIN(T_WC, 2, T_WB, T_BC);
+  TF_INV(T_WC, T_CW);
+  for (int i = 0; i < cam_event->num_features; i++) {
+    const real_t *p_W = data->sim->features + cam_event->feature_ids[i] * 3;
+    const real_t *z = cam_event->keypoints + i * 2;
+    TF_POINT(T_CW, p_W, p_C);
+    real_t z_est[2] = {0};
+    camera_project(cam, p_C, z_est);
+    if (fabs(z[0] - z_est[0]) > 1e-9 || fabs(z[1] - z_est[1]) > 1e-9) {
+      data->ok = 0;
+    }
+    data->checksum += z[0] + z[1];
+  }
+  data->num_cam++;
+  data->num_keypoints += cam_event->num_features;
+
+  return 0;
+}
+
+int test_sim_vi() {
+  // Trajectory and landmarks
+  sim_spline_t *spline = setup_sim_spline();
+  const real_t origin[3] = {0.0, 0.0, 0.0};
+  const real_t dim[3] = {5.0, 5.0, 5.0};
+  const int num_features = 2000;
+  real_t *features = MALLOC(real_t, num_features * 3);
+  sim_create_features(origin, dim, num_features, features);
+
+  // Cameras
+  const int cam_res[2] = {640, 480};
+  const real_t fx = pinhole_focal(cam_res[0], 90.0);
+  const real_t cam_vec[8] = {fx, fx, 320.0, 240.0, 0.0, 0.0, 0.0, 0.0};
+  camera_params_t cam_params[2];
+  const char *pmodel = "pinhole";
+  const char *dmodel = "radtan4";
+  camera_params_setup(&cam_params[0], 0, cam_res, pmodel, dmodel, cam_vec);
+  camera_params_setup(&cam_params[1], 1, cam_res, pmodel, dmodel, cam_vec);
+  const real_t cam0_ypr[3] = {-M_PI / 2.0, 0.0, -M_PI / 2.0};
+  const real_t cam1_ypr[3] = {M_PI / 2.0, 0.0, -M_PI / 2.0};
+  const real_t cam0_r[3] = {0.05, 0.0, 0.0};
+  const real_t cam1_r[3] = {-0.05, 0.0, 0.0};
+  TF_ER(cam0_ypr, cam0_r, T_BC0);
+  TF_ER(cam1_ypr, cam1_r, T_BC1);
+  real_t cam_exts[2 * 7] = {0};
+  tf_vector(T_BC0, cam_exts + 0);
+  tf_vector(T_BC1, cam_exts + 7);
+
+  // Simulate serially and in parallel
+  sim_vi_t sim;
+  sim_vi_setup(&sim, spline, cam_params, cam_exts, 2, features, num_features);
+  sim.window_size = 7;
+
+  test_sim_vi_data_t data[2];
+  for (int run = 0; run < 2; run++) {
+    sim.num_threads = (run == 0) ? 1 : 4;
+    data[run] = (test_sim_vi_data_t){.sim = &sim,
+                                     .ts_prev = -1,
+                                     .cam_idx_prev = -1,
+                                     .ok = 1};
+    MU_ASSERT(sim_vi_run(&sim, test_sim_vi_cb, &data[run]) == 0);
+    MU_ASSERT(data[run].ok);
+    MU_ASSERT(data[run].num_imu == 21 * 0.5 * 200 + 1);
+    MU_ASSERT(data[run].num_cam == 2 * (21 * 0.5 * 20 + 1));
+    MU_ASSERT(data[run].num_keypoints > 0);
+  }
+  MU_ASSERT(data[0].num_keypoints == data[1].num_keypoints);
+  MU_ASSERT(fltcmp(data[0].checksum, data[1].checksum) == 0);
+
+  // Clean up
+  sim_spline_free(spline);
+  free(features);
+
+  return 0;
+}
+
 int test_sim_gimbal_malloc_free() {
   sim_gimbal_t *sim = sim_gimbal_malloc();
   sim_gimbal_free(sim);
@@ -8091,6 +9408,91 @@ int test_sim_gimbal_view() {
   return 0;
 }
 
+int test_calib_gimbal_nbv() {
+  // Setup gimbal simulator and calibrator
+  sim_gimbal_t *sim = sim_gimbal_malloc();
+  calib_gimbal_t *calib = calib_gimbal_malloc();
+  const timestamp_t ts = 0;
+  calib_gimbal_add_fiducial(calib, sim->fiducial_ext.data);
+  calib_gimbal_add_pose(calib, ts, sim->gimbal_pose.data);
+  calib_gimbal_add_gimbal_extrinsic(calib, sim->gimbal_ext.data);
+  calib_gimbal_add_gimbal_link(calib, 0, sim->gimbal_links[0].data);
+  calib_gimbal_add_gimbal_link(calib, 1, sim->gimbal_links[1].data);
+  for (int cam_idx = 0; cam_idx < sim->num_cams; cam_idx++) {
+    calib_gimbal_add_camera(calib,
+                            cam_idx,
+                            sim->cam_params[cam_idx].resolution,
+                            sim->cam_params[cam_idx].proj_model,
+                            sim->cam_params[cam_idx].dist_model,
+                            sim->cam_params[cam_idx].data,
+                            sim->cam_exts[cam_idx].data);
+  }
+
+  // Add a few views
+  const int pose_idx = 0;
+  for (int view_idx = 0; view_idx < 3; view_idx++) {
+    sim_gimbal_set_joint(sim, 0, deg2rad(-10.0 + 10.0 * view_idx));
+    sim_gimbal_set_joint(sim, 1, deg2rad(5.0 * view_idx));
+    sim_gimbal_set_joint(sim, 2, deg2rad(-5.0 * view_idx));
+    real_t joints[3] = {0};
+    sim_gimbal_get_joints(sim, 3, joints);
+
+    for (int cam_idx = 0; cam_idx < sim->num_cams; cam_idx++) {
+      const real_t *pose = sim->gimbal_pose.data;
+      sim_gimbal_view_t *view =
+          sim_gimbal_view(sim, view_idx, view_idx, cam_idx, pose);
+      calib_gimbal_add_view(calib,
+                            pose_idx,
+                            view_idx,
+                            view_idx,
+                            cam_idx,
+                            view->num_measurements,
+                            view->tag_ids,
+                            view->corner_indices,
+                            view->object_points,
+                            view->keypoints,
+                            joints,
+                            sim->num_joints);
+      sim_gimbal_view_free(view);
+    }
+  }
+
+  // Candidate grid
+  calib->nbv_parts[0] = 3;
+  calib->nbv_parts[1] = 2;
+  calib->nbv_parts[2] = 2;
+  real_t *joints = NULL;
+  const int num_candidates = calib_gimbal_nbv_candidates(calib, &joints);
+  MU_ASSERT(num_candidates == 12);
+  MU_ASSERT(fltcmp(joints[0], calib->nbv_range[0][0]) == 0);
+  MU_ASSERT(fltcmp(joints[11 * 3 + 0], calib->nbv_range[0][1]) == 0);
+  MU_ASSERT(fltcmp(joints[11 * 3 + 2], calib->nbv_range[2][1]) == 0);
+
+  // Serial and parallel scores must agree
+  real_t *entropies_serial = MALLOC(real_t, num_candidates);
+  real_t *entropies_parallel = MALLOC(real_t, num_candidates);
+  calib->nbv_threads = 1;
+  calib_gimbal_nbv_eval(calib, joints, num_candidates, entropies_serial);
+  calib->nbv_threads = 4;
+  calib_gimbal_nbv_eval(calib, joints, num_candidates, entropies_parallel);
+  for (int i = 0; i < num_candidates; i++) {
+    MU_ASSERT(isfinite(entropies_serial[i]));
+    MU_ASSERT(fltcmp(entropies_serial[i], entropies_parallel[i]) == 0);
+  }
+
+  // Problem must be unchanged
+  MU_ASSERT(calib->num_views == 3);
+
+  // Clean up
+  free(joints);
+  free(entropies_serial);
+  free(entropies_parallel);
+  calib_gimbal_free(calib);
+  sim_gimbal_free(sim);
+
+  return 0;
+}
+
 int test_sim_gimbal_solve() {
   // Setup gimbal simulator
   sim_gimbal_t *sim = sim_gimbal_malloc();
@@ -8216,6 +9618,9 @@ void test_suite() {
   MU_ADD_TEST(test_mstack_pop);
   MU_ADD_TEST(test_queue_malloc_and_free);
   MU_ADD_TEST(test_queue_enqueue_dequeue);
+  MU_ADD_TEST(test_spsc_queue_malloc_and_free);
+  MU_ADD_TEST(test_spsc_queue_push_pop);
+  MU_ADD_TEST(test_spsc_queue_threaded);
   MU_ADD_TEST(test_hashmap_new_destroy);
   MU_ADD_TEST(test_hashmap_clear_destroy);
   MU_ADD_TEST(test_hashmap_get_set);
@@ -8227,6 +9632,17 @@ void test_suite() {
   MU_ADD_TEST(test_mtoc);
   MU_ADD_TEST(test_time_now);
 
+  // TELEMETRY LOG
+  MU_ADD_TEST(test_tlog);
+
+  // TRACE
+#ifdef USE_TRACE
+  MU_ADD_TEST(test_trace);
+#endif // USE_TRACE
+
+  // PARALLEL
+  MU_ADD_TEST(test_parallel_for);
+
   // NETWORK
   MU_ADD_TEST(test_tcp_server_setup);
 
@@ -8337,6 +9753,8 @@ void test_suite() {
   MU_ADD_TEST(test_pinhole_equi4_project_jacobian);
   MU_ADD_TEST(test_pinhole_equi4_params_jacobian);
   MU_ADD_TEST(test_linear_triangulation);
+  MU_ADD_TEST(test_linear_triangulation_batch);
+  MU_ADD_TEST(test_linear_triangulation_batch_noisy);
   MU_ADD_TEST(test_homography_find);
   MU_ADD_TEST(test_homography_pose);
   // MU_ADD_TEST(test_p3p_kneip);
@@ -8353,6 +9771,7 @@ void test_suite() {
   MU_ADD_TEST(test_mav_vel_ctrl);
   MU_ADD_TEST(test_mav_pos_ctrl);
   MU_ADD_TEST(test_mav_waypoints);
+  MU_ADD_TEST(test_mav_batch);
 
   // SENSOR FUSION
   MU_ADD_TEST(test_schur_complement);
@@ -8369,7 +9788,11 @@ void test_suite() {
   MU_ADD_TEST(test_time_delay);
   MU_ADD_TEST(test_joint);
   MU_ADD_TEST(test_camera_params);
+  MU_ADD_TEST(test_camera_model_project);
+  MU_ADD_TEST(test_camera_project_points);
   MU_ADD_TEST(test_triangulation_batch);
+  MU_ADD_TEST(test_remap_table_undistort);
+  MU_ADD_TEST(test_stereo_rectify);
   MU_ADD_TEST(test_pose_factor);
   MU_ADD_TEST(test_ba_factor);
   MU_ADD_TEST(test_camera_factor);
@@ -8384,8 +9807,10 @@ void test_suite() {
   MU_ADD_TEST(test_imu_factor);
   MU_ADD_TEST(test_joint_factor);
   MU_ADD_TEST(test_calib_camera_factor);
+  MU_ADD_TEST(test_calib_camera_view_linearize);
   MU_ADD_TEST(test_calib_imucam_factor);
   MU_ADD_TEST(test_calib_gimbal_factor);
+  MU_ADD_TEST(test_info_gain);
   MU_ADD_TEST(test_marg);
   // MU_ADD_TEST(test_visual_odometry_batch);
   MU_ADD_TEST(test_inertial_odometry_batch);
@@ -8398,6 +9823,7 @@ void test_suite() {
   // MU_ADD_TEST(test_solver_eval);
   MU_ADD_TEST(test_camchain);
   MU_ADD_TEST(test_calib_camera_mono_batch);
+  MU_ADD_TEST(test_calib_camera_add_archive);
   MU_ADD_TEST(test_calib_camera_mono_ceres);
   MU_ADD_TEST(test_calib_camera_mono_incremental);
   MU_ADD_TEST(test_calib_camera_stereo_batch);
@@ -8437,8 +9863,12 @@ void test_suite() {
   MU_ADD_TEST(test_sim_camera_frame_load);
   MU_ADD_TEST(test_sim_camera_data_load);
   MU_ADD_TEST(test_sim_camera_circle_trajectory);
+  MU_ADD_TEST(test_sim_features_grid);
+  MU_ADD_TEST(test_sim_spline);
+  MU_ADD_TEST(test_sim_vi);
   MU_ADD_TEST(test_sim_gimbal_malloc_free);
   MU_ADD_TEST(test_sim_gimbal_view);
+  MU_ADD_TEST(test_calib_gimbal_nbv);
   // MU_ADD_TEST(test_sim_gimbal_solve);
 }
 
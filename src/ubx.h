@@ -14,6 +14,8 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/poll.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
 
 // UBX Class IDs
 #define UBX_NAV 0x01
@@ -416,19 +418,89 @@ void rtcm3_parser_init(rtcm3_parser_t *parser);
 void rtcm3_parser_reset(rtcm3_parser_t *parser);
 int rtcm3_parser_update(rtcm3_parser_t *parser, uint8_t data);
 
+/*****************************************************************************
+ * UBX / RTCM3 Block Parser
+ ****************************************************************************/
+
+#define UBX_FRAME_UBX 1
+#define UBX_FRAME_RTCM3 2
+
+// Largest frame the block parser reassembles across reads, must hold the
+// largest UBX-RXM-RAWX (8 + 16 + 32 * 255 bytes)
+#define UBX_STREAM_BUF_SIZE 16384
+
+// Zero-copy view of a validated UBX or RTCM3 frame
+typedef struct ubx_frame_t {
+  int type;
+  const uint8_t *data;
+  size_t length;
+
+  // UBX
+  uint8_t msg_class;
+  uint8_t msg_id;
+  uint16_t payload_length;
+  const uint8_t *payload;
+
+  // RTCM3
+  uint16_t msg_type;
+} ubx_frame_t;
+
+typedef void (*ubx_frame_callback)(void *arg, const ubx_frame_t *frame);
+
+// Block parser state, holds the tail of a frame split across reads
+typedef struct ubx_stream_t {
+  uint8_t buf[UBX_STREAM_BUF_SIZE];
+  size_t size;
+
+  size_t nb_frames;
+  size_t nb_bad_frames;
+  size_t nb_skipped_bytes;
+} ubx_stream_t;
+
+void ubx_fletcher8(const uint8_t *data,
+                   const size_t length,
+                   uint8_t *ck_a,
+                   uint8_t *ck_b);
+uint32_t rtcm3_crc24q(const uint8_t *data, const size_t length);
+size_t ubx_frames_scan(ubx_stream_t *stream,
+                       const uint8_t *data,
+                       const size_t length,
+                       ubx_frame_callback cb,
+                       void *arg);
+void ubx_stream_init(ubx_stream_t *stream);
+size_t ubx_stream_update(ubx_stream_t *stream,
+                         const uint8_t *data,
+                         const size_t length,
+                         ubx_frame_callback cb,
+                         void *arg);
+
 /*****************************************************************************
  * UBlox
  ****************************************************************************/
 
-#define UBLOX_MAX_CONNS 10
 #define UBLOX_READY 0
 #define UBLOX_PARSING_UBX 1
 #define UBLOX_PARSING_RTCM3 2
 
+// Per-client outbound ring buffer size, must be a power of two. A client that
+// falls this far behind is evicted.
+#define UBLOX_CLIENT_BUF_SIZE 65536
+#define UBLOX_MAX_EVENTS 64
+
 typedef struct ublox_t ublox_t;
 typedef void (*ubx_msg_callback)(ublox_t *ublox);
 typedef void (*rtcm3_msg_callback)(ublox_t *ublox);
 
+// UBlox base station client
+typedef struct ublox_client_t {
+  int fd;
+  int want_write;
+  int eof; // Rover half-closed its write side, stop polling for reads
+  uint8_t *buf;
+  size_t head;
+  size_t size;
+} ublox_client_t;
+
 // UBlox
 typedef struct ublox_t {
   int state;
@@ -436,11 +508,14 @@ typedef struct ublox_t {
   ubx_uart_t *uart;
 
   int sockfd;
-  int conns[UBLOX_MAX_CONNS];
+  int epfd;
+  ublox_client_t **conns;
   size_t nb_conns;
+  size_t max_conns;
 
   ubx_parser_t ubx_parser;
   rtcm3_parser_t rtcm3_parser;
+  const ubx_frame_t *frame;
 
   ubx_msg_callback ubx_cb;
   rtcm3_msg_callback rtcm3_cb;
@@ -478,15 +553,21 @@ int ubx_set(const ublox_t *ublox,
 //***************************** Ublox GPS Mode *****************************
 
 void ublox_version(const ublox_t *ublox);
+void ublox_parse_frame(void *arg, const ubx_frame_t *frame);
 int ublox_parse_ubx(ublox_t *ublox, uint8_t data);
 int ublox_gps_config(ublox_t *ublox);
 int ublox_run(ublox_t *ublox, int *loop);
 
 //*************************** Ublox Base Station ***************************
 
+int ublox_client_add(ublox_t *base, const int fd);
+int ublox_client_flush(ublox_t *base, ublox_client_t *client);
+void ublox_client_evict(ublox_t *base, ublox_client_t *client);
+void ublox_broadcast(ublox_t *base, const uint8_t *data, const size_t len);
 void ublox_broadcast_rtcm3(ublox_t *ublox);
 int ublox_parse_rtcm3(ublox_t *ublox, uint8_t data);
 int ublox_base_station_config(ublox_t *base);
+int ublox_base_serve(ublox_t *base, const int port, int *loop);
 int ublox_base_run(ublox_t *base, const int port, int *loop);
 
 //****************************** Ublox Rover *******************************
@@ -1253,6 +1334,253 @@ int rtcm3_parser_update(rtcm3_parser_t *parser, uint8_t data) {
   return 0;
 }
 
+/*****************************************************************************
+ * UBX / RTCM3 Block Parser
+ ****************************************************************************/
+
+// CRC-24Q lookup table, polynomial 0x1864CFB
+static const uint32_t rtcm3_crc24q_table[256] = {
+    0x000000, 0x864CFB, 0x8AD50D, 0x0C99F6, 0x93E6E1, 0x15AA1A,
+    0x1933EC, 0x9F7F17, 0xA18139, 0x27CDC2, 0x2B5434, 0xAD18CF,
+    0x3267D8, 0xB42B23, 0xB8B2D5, 0x3EFE2E, 0xC54E89, 0x430272,
+    0x4F9B84, 0xC9D77F, 0x56A868, 0xD0E493, 0xDC7D65, 0x5A319E,
+    0x64CFB0, 0xE2834B, 0xEE1ABD, 0x685646, 0xF72951, 0x7165AA,
+    0x7DFC5C, 0xFBB0A7, 0x0CD1E9, 0x8A9D12, 0x8604E4, 0x00481F,
+    0x9F3708, 0x197BF3, 0x15E205, 0x93AEFE, 0xAD50D0, 0x2B1C2B,
+    0x2785DD, 0xA1C926, 0x3EB631, 0xB8FACA, 0xB4633C, 0x322FC7,
+    0xC99F60, 0x4FD39B, 0x434A6D, 0xC50696, 0x5A7981, 0xDC357A,
+    0xD0AC8C, 0x56E077, 0x681E59, 0xEE52A2, 0xE2CB54, 0x6487AF,
+    0xFBF8B8, 0x7DB443, 0x712DB5, 0xF7614E, 0x19A3D2, 0x9FEF29,
+    0x9376DF, 0x153A24, 0x8A4533, 0x0C09C8, 0x00903E, 0x86DCC5,
+    0xB822EB, 0x3E6E10, 0x32F7E6, 0xB4BB1D, 0x2BC40A, 0xAD88F1,
+    0xA11107, 0x275DFC, 0xDCED5B, 0x5AA1A0, 0x563856, 0xD074AD,
+    0x4F0BBA, 0xC94741, 0xC5DEB7, 0x43924C, 0x7D6C62, 0xFB2099,
+    0xF7B96F, 0x71F594, 0xEE8A83, 0x68C678, 0x645F8E, 0xE21375,
+    0x15723B, 0x933EC0, 0x9FA736, 0x19EBCD, 0x8694DA, 0x00D821,
+    0x0C41D7, 0x8A0D2C, 0xB4F302, 0x32BFF9, 0x3E260F, 0xB86AF4,
+    0x2715E3, 0xA15918, 0xADC0EE, 0x2B8C15, 0xD03CB2, 0x567049,
+    0x5AE9BF, 0xDCA544, 0x43DA53, 0xC596A8, 0xC90F5E, 0x4F43A5,
+    0x71BD8B, 0xF7F170, 0xFB6886, 0x7D247D, 0xE25B6A, 0x641791,
+    0x688E67, 0xEEC29C, 0x3347A4, 0xB50B5F, 0xB992A9, 0x3FDE52,
+    0xA0A145, 0x26EDBE, 0x2A7448, 0xAC38B3, 0x92C69D, 0x148A66,
+    0x181390, 0x9E5F6B, 0x01207C, 0x876C87, 0x8BF571, 0x0DB98A,
+    0xF6092D, 0x7045D6, 0x7CDC20, 0xFA90DB, 0x65EFCC, 0xE3A337,
+    0xEF3AC1, 0x69763A, 0x578814, 0xD1C4EF, 0xDD5D19, 0x5B11E2,
+    0xC46EF5, 0x42220E, 0x4EBBF8, 0xC8F703, 0x3F964D, 0xB9DAB6,
+    0xB54340, 0x330FBB, 0xAC70AC, 0x2A3C57, 0x26A5A1, 0xA0E95A,
+    0x9E1774, 0x185B8F, 0x14C279, 0x928E82, 0x0DF195, 0x8BBD6E,
+    0x872498, 0x016863, 0xFAD8C4, 0x7C943F, 0x700DC9, 0xF64132,
+    0x693E25, 0xEF72DE, 0xE3EB28, 0x65A7D3, 0x5B59FD, 0xDD1506,
+    0xD18CF0, 0x57C00B, 0xC8BF1C, 0x4EF3E7, 0x426A11, 0xC426EA,
+    0x2AE476, 0xACA88D, 0xA0317B, 0x267D80, 0xB90297, 0x3F4E6C,
+    0x33D79A, 0xB59B61, 0x8B654F, 0x0D29B4, 0x01B042, 0x87FCB9,
+    0x1883AE, 0x9ECF55, 0x9256A3, 0x141A58, 0xEFAAFF, 0x69E604,
+    0x657FF2, 0xE33309, 0x7C4C1E, 0xFA00E5, 0xF69913, 0x70D5E8,
+    0x4E2BC6, 0xC8673D, 0xC4FECB, 0x42B230, 0xDDCD27, 0x5B81DC,
+    0x57182A, 0xD154D1, 0x26359F, 0xA07964, 0xACE092, 0x2AAC69,
+    0xB5D37E, 0x339F85, 0x3F0673, 0xB94A88, 0x87B4A6, 0x01F85D,
+    0x0D61AB, 0x8B2D50, 0x145247, 0x921EBC, 0x9E874A, 0x18CBB1,
+    0xE37B16, 0x6537ED, 0x69AE1B, 0xEFE2E0, 0x709DF7, 0xF6D10C,
+    0xFA48FA, 0x7C0401, 0x42FA2F, 0xC4B6D4, 0xC82F22, 0x4E63D9,
+    0xD11CCE, 0x575035, 0x5BC9C3, 0xDD8538,
+};
+
+/**
+ * UBX 8-bit Fletcher checksum of `data`. The running sums are expanded into
+ * A = sum(x_k) and B = sum((n - k) x_k), which vectorize, and wrapping 32-bit
+ * arithmetic is exact modulo 256.
+ */
+void ubx_fletcher8(const uint8_t *data,
+                   const size_t length,
+                   uint8_t *ck_a,
+                   uint8_t *ck_b) {
+  uint32_t a = 0;
+  uint32_t w = 0;
+#pragma omp simd reduction(+ : a, w)
+  for (size_t k = 0; k < length; k++) {
+    a += data[k];
+    w += (uint32_t) k * data[k];
+  }
+  *ck_a = a & 0xFF;
+  *ck_b = ((uint32_t) length * a - w) & 0xFF;
+}
+
+/**
+ * RTCM3 CRC-24Q of `data`.
+ */
+uint32_t rtcm3_crc24q(const uint8_t *data, const size_t length) {
+  uint32_t crc = 0;
+  for (size_t i = 0; i < length; i++) {
+    crc = ((crc << 8) & 0xFFFFFF) ^ rtcm3_crc24q_table[(crc >> 16) ^ data[i]];
+  }
+  return crc;
+}
+
+/**
+ * Scan `data` for UBX and RTCM3 frames. Sync bytes are located with memchr,
+ * candidate frames are checksummed in one pass and valid frames are passed to
+ * `cb` as views into `data`. Scanning stops at the first incomplete frame.
+ * @returns Number of bytes consumed, the rest is the start of a frame
+ */
+size_t ubx_frames_scan(ubx_stream_t *stream,
+                       const uint8_t *data,
+                       const size_t length,
+                       ubx_frame_callback cb,
+                       void *arg) {
+  const uint8_t *p = data;
+  const uint8_t *end = data + length;
+  const uint8_t *next_ubx = data;
+  const uint8_t *next_rtcm3 = data;
+
+  while (p < end) {
+    // Find the next sync byte, memchr results are reused until passed
+    if (next_ubx < p || (next_ubx == p && *p != 0xB5)) {
+      next_ubx = memchr(p, 0xB5, end - p);
+      next_ubx = (next_ubx) ? next_ubx : end;
+    }
+    if (next_rtcm3 < p || (next_rtcm3 == p && *p != 0xD3)) {
+      next_rtcm3 = memchr(p, 0xD3, end - p);
+      next_rtcm3 = (next_rtcm3) ? next_rtcm3 : end;
+    }
+    const uint8_t *sync = (next_ubx < next_rtcm3) ? next_ubx : next_rtcm3;
+    stream->nb_skipped_bytes += sync - p;
+    p = sync;
+    if (p == end) {
+      break;
+    }
+
+    // Frame candidate
+    const size_t avail = end - p;
+    ubx_frame_t frame = {0};
+    frame.data = p;
+    if (*p == 0xB5) {
+      // UBX: SYNC_1 SYNC_2 CLASS ID LENGTH[2] PAYLOAD CK_A CK_B
+      if (avail >= 2 && p[1] != 0x62) {
+        stream->nb_skipped_bytes++;
+        p++;
+        continue;
+      } else if (avail < 6) {
+        break;
+      }
+      const size_t payload_length = p[4] | (p[5] << 8);
+      frame.length = payload_length + 8;
+      if (frame.length > UBX_STREAM_BUF_SIZE) {
+        stream->nb_skipped_bytes++;
+        p++;
+        continue;
+      } else if (avail < frame.length) {
+        break;
+      }
+
+      uint8_t ck_a = 0;
+      uint8_t ck_b = 0;
+      ubx_fletcher8(p + 2, payload_length + 4, &ck_a, &ck_b);
+      if (ck_a != p[frame.length - 2] || ck_b != p[frame.length - 1]) {
+        stream->nb_bad_frames++;
+        p++;
+        continue;
+      }
+      frame.type = UBX_FRAME_UBX;
+      frame.msg_class = p[2];
+      frame.msg_id = p[3];
+      frame.payload_length = payload_length;
+      frame.payload = p + 6;
+
+    } else {
+      // RTCM3: 0xD3 RESERVED(6 bits) LENGTH(10 bits) MESSAGE CRC24Q[3]
+      if (avail < 3) {
+        break;
+      }
+      const size_t msg_len = ((p[1] & 0x03) << 8) | p[2];
+      frame.length = msg_len + 6;
+      if (p[1] & 0xFC) {
+        stream->nb_skipped_bytes++;
+        p++;
+        continue;
+      } else if (avail < frame.length) {
+        break;
+      }
+
+      const uint8_t *crc = p + 3 + msg_len;
+      const uint32_t expected = (crc[0] << 16) | (crc[1] << 8) | crc[2];
+      if (rtcm3_crc24q(p, 3 + msg_len) != expected) {
+        stream->nb_bad_frames++;
+        p++;
+        continue;
+      }
+      frame.type = UBX_FRAME_RTCM3;
+      frame.msg_type = (msg_len >= 2) ? (p[3] << 4) | (p[4] >> 4) : 0;
+    }
+
+    // Valid frame
+    stream->nb_frames++;
+    if (cb) {
+      cb(arg, &frame);
+    }
+    p += frame.length;
+  }
+
+  return p - data;
+}
+
+void ubx_stream_init(ubx_stream_t *stream) {
+  stream->size = 0;
+  stream->nb_frames = 0;
+  stream->nb_bad_frames = 0;
+  stream->nb_skipped_bytes = 0;
+}
+
+/**
+ * Bytes needed before the frame at the start of `buf` can be validated.
+ */
+static size_t ubx_stream_need(const uint8_t *buf, const size_t size) {
+  if (buf[0] == 0xB5) {
+    return (size < 6) ? 6 : (size_t) (buf[4] | (buf[5] << 8)) + 8;
+  }
+  return (size < 3) ? 3 : (size_t) (((buf[1] & 0x03) << 8) | buf[2]) + 6;
+}
+
+/**
+ * Parse a span of bytes read from a receiver. Frames fully contained in
+ * `data` are passed to `cb` without copying. Only a frame split across calls
+ * is reassembled in the stream buffer, which is topped up with just the bytes
+ * needed to complete it.
+ * @returns Number of valid frames
+ */
+size_t ubx_stream_update(ubx_stream_t *stream,
+                         const uint8_t *data,
+                         const size_t length,
+                         ubx_frame_callback cb,
+                         void *arg) {
+  const size_t nb_frames = stream->nb_frames;
+  const uint8_t *p = data;
+  size_t n = length;
+
+  // Complete the frame carried over from the last call
+  while (stream->size > 0 && n > 0) {
+    const size_t need = ubx_stream_need(stream->buf, stream->size);
+    const size_t k = (need - stream->size < n) ? need - stream->size : n;
+    memcpy(stream->buf + stream->size, p, k);
+    stream->size += k;
+    p += k;
+    n -= k;
+
+    const uint8_t *buf = stream->buf;
+    const size_t used = ubx_frames_scan(stream, buf, stream->size, cb, arg);
+    memmove(stream->buf, stream->buf + used, stream->size - used);
+    stream->size -= used;
+  }
+
+  // Parse in place and keep the incomplete tail
+  if (stream->size == 0) {
+    const size_t used = ubx_frames_scan(stream, p, n, cb, arg);
+    memcpy(stream->buf, p + used, n - used);
+    stream->size = n - used;
+  }
+
+  return stream->nb_frames - nb_frames;
+}
+
 /*****************************************************************************
  * UBlox
  ****************************************************************************/
@@ -1272,16 +1600,17 @@ int ublox_init(ublox_t *ublox, ubx_uart_t *uart) {
 
   // Socket
   ublox->sockfd = -1;
+  ublox->epfd = -1;
 
   // Connections
-  for (size_t i = 0; i < UBLOX_MAX_CONNS; i++) {
-    ublox->conns[i] = -1;
-  }
+  ublox->conns = NULL;
   ublox->nb_conns = 0;
+  ublox->max_conns = 0;
 
   // Parsers
   ubx_parser_init(&ublox->ubx_parser);
   rtcm3_parser_init(&ublox->rtcm3_parser);
+  ublox->frame = NULL;
 
   // Callbacks
   ublox->ubx_cb = NULL;
@@ -1299,16 +1628,28 @@ void ublox_disconnect(ublox_t *ublox) {
 
   // Connections
   for (size_t i = 0; i < ublox->nb_conns; i++) {
-    close(ublox->conns[i]);
-    ublox->conns[i] = -1;
+    if (ublox->conns[i]->fd != -1) {
+      close(ublox->conns[i]->fd);
+    }
+    free(ublox->conns[i]->buf);
+    free(ublox->conns[i]);
   }
+  free(ublox->conns);
+  ublox->conns = NULL;
   ublox->nb_conns = 0;
+  ublox->max_conns = 0;
 
   // Socket
   if (ublox->sockfd != -1) {
     close(ublox->sockfd);
   }
   ublox->sockfd = -1;
+
+  // Event loop
+  if (ublox->epfd != -1) {
+    close(ublox->epfd);
+  }
+  ublox->epfd = -1;
 }
 
 int ublox_reset(ublox_t *ublox) {
@@ -1544,6 +1885,39 @@ void ublox_version(const ublox_t *ublox) {
   }
 }
 
+/**
+ * Block parser callback, `arg` is the `ublox_t`. UBX frames are decoded into
+ * the UBX parser's message and RTCM3 frames are exposed through
+ * `ublox->frame` for the duration of the callbacks.
+ */
+void ublox_parse_frame(void *arg, const ubx_frame_t *frame) {
+  ublox_t *ublox = (ublox_t *) arg;
+  ublox->frame = frame;
+
+  if (frame->type == UBX_FRAME_UBX) {
+    UBX_DEBUG("[UBX]\tmsg_class: %d\tmsg_id: %d",
+              frame->msg_class,
+              frame->msg_id);
+    const size_t max_length = sizeof(ublox->ubx_parser.msg.payload);
+    if (frame->payload_length <= max_length) {
+      ubx_msg_parse(&ublox->ubx_parser.msg, frame->data);
+      if (ublox->ubx_cb) {
+        ublox->ubx_cb(ublox);
+      }
+    }
+
+  } else if (frame->type == UBX_FRAME_RTCM3) {
+    UBX_DEBUG("[RTCM3]\tmsg type: %d\tmsg length: %zu",
+              frame->msg_type,
+              frame->length);
+    if (ublox->rtcm3_cb) {
+      ublox->rtcm3_cb(ublox);
+    }
+  }
+
+  ublox->frame = NULL;
+}
+
 int ublox_parse_ubx(ublox_t *ublox, uint8_t data) {
   if (ubx_parser_update(&ublox->ubx_parser, data) == 1) {
     UBX_DEBUG("[UBX]\tmsg_class: %d\tmsg_id: %d",
@@ -1601,14 +1975,17 @@ int ublox_run(ublox_t *ublox, int *loop) {
   fds[0].events = POLLIN;
 
   // Poll
+  ubx_stream_t stream;
+  ubx_stream_init(&stream);
+  uint8_t buf[4096];
   while (poll(fds, 1, timeout) >= 0 && *loop == 1) {
-    // Read byte from UART and parse
+    // Read all available bytes from UART and parse
     if (fds[0].revents & POLLIN) {
-      uint8_t data = 0;
-      if (ubx_uart_read(ublox->uart, &data, 1) != 0) {
+      const ssize_t n = read(ublox->uart->connfd, buf, sizeof(buf));
+      if (n <= 0) {
         continue;
       }
-      ublox_parse_ubx(ublox, data);
+      ubx_stream_update(&stream, buf, n, ublox_parse_frame, ublox);
     }
   }
 
@@ -1617,36 +1994,191 @@ int ublox_run(ublox_t *ublox, int *loop) {
 
 //*************************** Ublox Base Station ***************************
 
-void ublox_broadcast_rtcm3(ublox_t *ublox) {
-  const uint8_t *msg_data = ublox->rtcm3_parser.buf_data;
-  const size_t msg_len = ublox->rtcm3_parser.msg_len;
-  const int msg_flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+/**
+ * Add client socket `fd` to the base station. The socket is made non-blocking
+ * and registered with the base station's event loop.
+ */
+int ublox_client_add(ublox_t *base, const int fd) {
+  // Grow connections
+  if (base->nb_conns == base->max_conns) {
+    const size_t max_conns = (base->max_conns) ? base->max_conns * 2 : 16;
+    void *conns = realloc(base->conns, sizeof(ublox_client_t *) * max_conns);
+    if (conns == NULL) {
+      return -1;
+    }
+    base->conns = conns;
+    base->max_conns = max_conns;
+  }
+
+  // Setup client
+  ublox_client_t *client = malloc(sizeof(ublox_client_t));
+  if (client == NULL) {
+    return -1;
+  }
+  client->fd = fd;
+  client->want_write = 0;
+  client->eof = 0;
+  client->buf = malloc(sizeof(uint8_t) * UBLOX_CLIENT_BUF_SIZE);
+  client->head = 0;
+  client->size = 0;
+  if (client->buf == NULL) {
+    free(client);
+    return -1;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+  // Register with event loop, EPOLLHUP and EPOLLERR are always reported
+  if (base->epfd != -1) {
+    struct epoll_event ev = {0};
+    ev.events = EPOLLIN;
+    ev.data.ptr = client;
+    if (epoll_ctl(base->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+      free(client->buf);
+      free(client);
+      return -1;
+    }
+  }
+  base->conns[base->nb_conns++] = client;
+
+  return 0;
+}
+
+/**
+ * Update the client's event loop interest, reads until the rover half-closes
+ * and writes while data is pending.
+ */
+static void ublox_client_poll(ublox_t *base, ublox_client_t *client) {
+  if (base->epfd == -1) {
+    return;
+  }
+  struct epoll_event ev = {0};
+  ev.events = (client->eof ? 0 : EPOLLIN);
+  ev.events |= (client->want_write ? EPOLLOUT : 0);
+  ev.data.ptr = client;
+  epoll_ctl(base->epfd, EPOLL_CTL_MOD, client->fd, &ev);
+}
 
-  // Broad cast RTCM3 to clients and check client connection
-  int good_conns[UBLOX_MAX_CONNS] = {0};
+/**
+ * Write out as much of the client's outbound ring buffer as the socket accepts
+ * without blocking. Interest in EPOLLOUT is only kept while data is pending.
+ * @returns 0 for success, -1 if the client disconnected
+ */
+int ublox_client_flush(ublox_t *base, ublox_client_t *client) {
+  const size_t mask = UBLOX_CLIENT_BUF_SIZE - 1;
+  while (client->size) {
+    // The pending data wraps around the end of the ring at most once
+    const size_t n_end = UBLOX_CLIENT_BUF_SIZE - client->head;
+    const size_t n0 = (client->size < n_end) ? client->size : n_end;
+    struct iovec iov[2];
+    iov[0].iov_base = client->buf + client->head;
+    iov[0].iov_len = n0;
+    iov[1].iov_base = client->buf;
+    iov[1].iov_len = client->size - n0;
+    struct msghdr msg = {0};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = (iov[1].iov_len) ? 2 : 1;
+
+    const ssize_t n = sendmsg(client->fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    } else if (n <= 0) {
+      return -1;
+    }
+    client->head = (client->head + n) & mask;
+    client->size -= n;
+  }
+
+  // Only wake up for writability while there is a backlog
+  const int want_write = (client->size > 0);
+  if (want_write != client->want_write) {
+    client->want_write = want_write;
+    ublox_client_poll(base, client);
+  }
+
+  return 0;
+}
+
+/**
+ * Disconnect client. The client is only marked closed here and released by
+ * the event loop, since pending events may still refer to it.
+ */
+void ublox_client_evict(ublox_t *base, ublox_client_t *client) {
+  if (client->fd == -1) {
+    return;
+  }
+  if (base->epfd != -1) {
+    epoll_ctl(base->epfd, EPOLL_CTL_DEL, client->fd, NULL);
+  }
+  close(client->fd);
+  client->fd = -1;
+  client->size = 0;
+}
+
+/**
+ * Release evicted clients.
+ */
+static void ublox_clients_reap(ublox_t *base) {
   size_t nb_conns = 0;
+  for (size_t i = 0; i < base->nb_conns; i++) {
+    ublox_client_t *client = base->conns[i];
+    if (client->fd == -1) {
+      free(client->buf);
+      free(client);
+      continue;
+    }
+    base->conns[nb_conns++] = client;
+  }
+  base->nb_conns = nb_conns;
+}
 
-  for (size_t i = 0; i < ublox->nb_conns; i++) {
-    const int conn_fd = ublox->conns[i];
-    if (send(conn_fd, msg_data, msg_len, msg_flags) == -1) {
+/**
+ * Queue `data` to all connected clients and try to send it straight away.
+ * Clients whose outbound buffer cannot hold the data are too slow to keep up
+ * with the receiver and are evicted.
+ */
+void ublox_broadcast(ublox_t *base, const uint8_t *data, const size_t len) {
+  const size_t mask = UBLOX_CLIENT_BUF_SIZE - 1;
+
+  for (size_t i = 0; i < base->nb_conns; i++) {
+    ublox_client_t *client = base->conns[i];
+    if (client->fd == -1) {
+      continue;
+    }
+
+    // Backpressure
+    if (client->size + len > UBLOX_CLIENT_BUF_SIZE) {
+      UBX_WARN("Evicting slow rover [fd: %d]!", client->fd);
+      ublox_client_evict(base, client);
+      continue;
+    }
+
+    // Append to ring buffer
+    const size_t tail = (client->head + client->size) & mask;
+    const size_t n_end = UBLOX_CLIENT_BUF_SIZE - tail;
+    const size_t n0 = (len < n_end) ? len : n_end;
+    memcpy(client->buf + tail, data, n0);
+    memcpy(client->buf, data + n0, len - n0);
+    client->size += len;
+
+    // Send, clients with a backlog are flushed when writable
+    if (client->want_write == 0 && ublox_client_flush(base, client) != 0) {
       UBX_ERROR("Rover diconnected!");
-    } else {
-      good_conns[nb_conns] = conn_fd;
-      nb_conns++;
+      ublox_client_evict(base, client);
     }
   }
+}
 
-  // Clear connections
-  for (size_t i = 0; i < UBLOX_MAX_CONNS; i++) {
-    ublox->conns[i] = 0;
+void ublox_broadcast_rtcm3(ublox_t *ublox) {
+  if (ublox->frame) {
+    ublox_broadcast(ublox, ublox->frame->data, ublox->frame->length);
+    return;
   }
-  ublox->nb_conns = 0;
 
-  // Copy good connections back to ublox->conns
-  for (size_t i = 0; i < nb_conns; i++) {
-    ublox->conns[i] = good_conns[i];
-  }
-  ublox->nb_conns = nb_conns;
+  const uint8_t *msg_data = ublox->rtcm3_parser.buf_data;
+  const size_t msg_len = ublox->rtcm3_parser.msg_len;
+  ublox_broadcast(ublox, msg_data, msg_len);
 }
 
 int ublox_parse_rtcm3(ublox_t *ublox, uint8_t data) {
@@ -1707,13 +2239,12 @@ int ublox_base_station_config(ublox_t *base) {
   return 0;
 }
 
-int ublox_base_run(ublox_t *base, const int port, int *loop) {
-  // Configure base station
-  if (ublox_base_station_config(base) != 0) {
-    UBX_ERROR("Failed to configure Ublox into BASE_STATION mode!");
-    return -1;
-  }
-
+/**
+ * Serve RTCM3 messages from the receiver to rovers connecting on TCP `port`
+ * until `loop` is cleared. A single epoll event loop waits on the UART, the
+ * listening socket and all clients, so the thread sleeps while idle.
+ */
+int ublox_base_serve(ublox_t *base, const int port, int *loop) {
   // Socket create and verification
   base->sockfd = socket(AF_INET, SOCK_STREAM, 0);
   if (base->sockfd == -1) {
@@ -1755,51 +2286,113 @@ int ublox_base_run(ublox_t *base, const int port, int *loop) {
   }
 
   // Server is ready to listen
-  if ((listen(base->sockfd, 20)) != 0) {
+  if ((listen(base->sockfd, SOMAXCONN)) != 0) {
     UBX_ERROR("Listen failed...");
     return -1;
   } else {
     UBX_DEBUG("Server running");
   }
 
+  // Setup event loop, the UART and listening socket are identified by the
+  // addresses of their file descriptors
+  base->epfd = epoll_create1(0);
+  if (base->epfd == -1) {
+    UBX_ERROR("epoll_create1() failed: %s", strerror(errno));
+    return -1;
+  }
+  struct epoll_event ev = {0};
+  ev.events = EPOLLIN;
+  ev.data.ptr = &base->uart->connfd;
+  if (epoll_ctl(base->epfd, EPOLL_CTL_ADD, base->uart->connfd, &ev) != 0) {
+    UBX_ERROR("Failed to add UART to event loop: %s", strerror(errno));
+    return -1;
+  }
+  ev.data.ptr = &base->sockfd;
+  if (epoll_ctl(base->epfd, EPOLL_CTL_ADD, base->sockfd, &ev) != 0) {
+    UBX_ERROR("Failed to add socket to event loop: %s", strerror(errno));
+    return -1;
+  }
+
   // Obtain RTCM3 Messages from receiver and transmit them to rover
+  const int timeout = 100; // [ms] Bounds the latency of noticing `loop`
+  struct epoll_event events[UBLOX_MAX_EVENTS];
+  ubx_stream_t stream;
+  ubx_stream_init(&stream);
+  uint8_t buf[4096];
   while (*loop) {
-    // Accept the data packet from client and verification
-    struct sockaddr_in client;
-    socklen_t len = sizeof(client);
-    int connfd = accept(base->sockfd, (struct sockaddr *) &client, &len);
-    if (connfd >= 0) {
-      char ip[INET6_ADDRSTRLEN] = {0};
-      int port = 0;
-      ubx_ip_port_info(connfd, ip, &port);
-      UBX_INFO("Server connected with UBlox client [%s:%d]", ip, port);
-
-      base->conns[base->nb_conns] = connfd;
-      base->nb_conns++;
+    const int nb_events =
+        epoll_wait(base->epfd, events, UBLOX_MAX_EVENTS, timeout);
+    if (nb_events < 0 && errno != EINTR) {
+      UBX_ERROR("epoll_wait() failed: %s", strerror(errno));
+      break;
     }
 
-    // Read byte
-    uint8_t data = 0;
-    if (ubx_uart_read(base->uart, &data, 1) != 0) {
-      continue;
-    }
+    for (int i = 0; i < nb_events; i++) {
+      const uint32_t flags = events[i].events;
+      void *ptr = events[i].data.ptr;
+
+      if (ptr == &base->sockfd) {
+        // Accept all pending rovers
+        while (1) {
+          struct sockaddr_in client;
+          socklen_t len = sizeof(client);
+          struct sockaddr *addr = (struct sockaddr *) &client;
+          const int connfd = accept(base->sockfd, addr, &len);
+          if (connfd < 0) {
+            break;
+          }
+
+          char ip[INET6_ADDRSTRLEN] = {0};
+          int port = 0;
+          ubx_ip_port_info(connfd, ip, &port);
+          UBX_INFO("Server connected with UBlox client [%s:%d]", ip, port);
+          if (ublox_client_add(base, connfd) != 0) {
+            UBX_ERROR("Failed to add client [%s:%d]", ip, port);
+            close(connfd);
+          }
+        }
 
-    // Parse data
-    switch (base->state) {
-      case UBLOX_READY:
-        if (data == 0xB5) {
-          base->state = UBLOX_PARSING_UBX;
-        } else if (data == 0xD3) {
-          base->state = UBLOX_PARSING_RTCM3;
+      } else if (ptr == &base->uart->connfd) {
+        // Read everything available from the receiver and parse
+        const ssize_t n = read(base->uart->connfd, buf, sizeof(buf));
+        if (n > 0) {
+          ubx_stream_update(&stream, buf, n, ublox_parse_frame, base);
         }
-        break;
-      case UBLOX_PARSING_UBX:
-        ublox_parse_ubx(base, data);
-        break;
-      case UBLOX_PARSING_RTCM3:
-        ublox_parse_rtcm3(base, data);
-        break;
+
+      } else {
+        // Rover socket
+        ublox_client_t *client = ptr;
+        if (client->fd == -1) {
+          continue;
+        } else if (flags & (EPOLLERR | EPOLLHUP)) {
+          UBX_INFO("Rover disconnected [fd: %d]", client->fd);
+          ublox_client_evict(base, client);
+          continue;
+        }
+
+        // Rovers have nothing to say, drain and discard. A rover may
+        // half-close its write side and keep receiving, a rover that closed
+        // completely is evicted when a send fails.
+        if (flags & EPOLLIN) {
+          const ssize_t n = recv(client->fd, buf, sizeof(buf), MSG_DONTWAIT);
+          if (n == 0) {
+            client->eof = 1;
+            ublox_client_poll(base, client);
+          } else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            UBX_INFO("Rover disconnected [fd: %d]", client->fd);
+            ublox_client_evict(base, client);
+            continue;
+          }
+        }
+        if ((flags & EPOLLOUT) && ublox_client_flush(base, client) != 0) {
+          UBX_ERROR("Rover diconnected!");
+          ublox_client_evict(base, client);
+        }
+      }
     }
+
+    // Release evicted clients once no pending event refers to them
+    ublox_clients_reap(base);
   }
 
   // Clean up
@@ -1808,6 +2401,16 @@ int ublox_base_run(ublox_t *base, const int port, int *loop) {
   return 0;
 }
 
+int ublox_base_run(ublox_t *base, const int port, int *loop) {
+  // Configure base station
+  if (ublox_base_station_config(base) != 0) {
+    UBX_ERROR("Failed to configure Ublox into BASE_STATION mode!");
+    return -1;
+  }
+
+  return ublox_base_serve(base, port, loop);
+}
+
 //****************************** Ublox Rover *******************************
 
 int ublox_rover_config(ublox_t *rover) {
@@ -1836,6 +2439,16 @@ int ublox_rover_config(ublox_t *rover) {
   return 0;
 }
 
+/**
+ * Forward RTCM3 frames received from the base station to the receiver.
+ */
+static void ublox_rover_forward(void *arg, const ubx_frame_t *frame) {
+  ublox_t *rover = (ublox_t *) arg;
+  if (frame->type == UBX_FRAME_RTCM3) {
+    ubx_uart_write(rover->uart, frame->data, frame->length);
+  }
+}
+
 int ublox_rover_run(ublox_t *rover,
                     const char *base_ip,
                     const int base_port,
@@ -1884,33 +2497,30 @@ int ublox_rover_run(ublox_t *rover,
 
   // Poll
   const int timeout = 1; // 1ms
+  ubx_stream_t uart_stream;
+  ubx_stream_t rtcm3_stream;
+  ubx_stream_init(&uart_stream);
+  ubx_stream_init(&rtcm3_stream);
+  uint8_t buf[4096];
   while (poll(fds, 2, timeout) >= 0 && *loop == 1) {
-    // Read byte from UART and parse
+    // Read all available bytes from UART and parse
     if (fds[0].revents & POLLIN) {
-      uint8_t data = 0;
-      if (ubx_uart_read(rover->uart, &data, 1) != 0) {
-        continue;
+      const ssize_t n = read(rover->uart->connfd, buf, sizeof(buf));
+      if (n > 0) {
+        ubx_stream_update(&uart_stream, buf, n, ublox_parse_frame, rover);
       }
-      ublox_parse_ubx(rover, data);
     }
 
-    // Read byte from TCP socket (assuming its the RTCM3)
+    // Read RTCM3 from TCP socket and forward complete frames to the receiver
     if (fds[1].fd != -1 && (fds[1].revents & POLLIN)) {
-      // Read byte
-      uint8_t data = 0;
-      if (read(rover->sockfd, &data, 1) != 1) {
-        UBX_ERROR("Failed to read RTCM3 byte from server!");
+      const ssize_t n = read(rover->sockfd, buf, sizeof(buf));
+      if (n <= 0) {
+        UBX_ERROR("Failed to read RTCM3 from server!");
         UBX_ERROR("Ignoring server for now!");
         fds[1].fd = -1;
+        continue;
       }
-
-      // Transmit RTCM3 packet if its ready
-      if (rtcm3_parser_update(&rover->rtcm3_parser, data)) {
-        const uint8_t *msg_data = rover->rtcm3_parser.buf_data;
-        const size_t msg_len = rover->rtcm3_parser.msg_len;
-        ubx_uart_write(rover->uart, msg_data, msg_len);
-        rtcm3_parser_reset(&rover->rtcm3_parser);
-      }
+      ubx_stream_update(&rtcm3_stream, buf, n, ublox_rover_forward, rover);
     }
   }
 
@@ -1929,6 +2539,8 @@ int ublox_rover_run(ublox_t *rover,
 #ifdef UBX_UNITTEST
 
 #include <signal.h>
+#include <time.h>
+#include <pthread.h>
 
 // UNITESTS GLOBAL VARIABLES
 static int nb_tests = 0;
@@ -2141,6 +2753,114 @@ int test_ubx_parser_update() {
   return 0;
 }
 
+/*****************************************************************************
+ * UBX / RTCM3 Block Parser
+ ****************************************************************************/
+
+int test_ubx_fletcher8() {
+  uint8_t data[300] = {0};
+  for (size_t i = 0; i < 300; i++) {
+    data[i] = (i * 37 + 11) & 0xFF;
+  }
+
+  for (size_t n = 0; n < 300; n++) {
+    uint8_t ck_a = 0;
+    uint8_t ck_b = 0;
+    uint8_t ck_a_gnd = 0;
+    uint8_t ck_b_gnd = 0;
+    ubx_fletcher8(data, n, &ck_a, &ck_b);
+    for (size_t i = 0; i < n; i++) {
+      ck_a_gnd += data[i];
+      ck_b_gnd += ck_a_gnd;
+    }
+    TEST_ASSERT(ck_a == ck_a_gnd);
+    TEST_ASSERT(ck_b == ck_b_gnd);
+  }
+
+  return 0;
+}
+
+typedef struct test_ubx_stream_t {
+  const uint8_t *frames[200];
+  size_t lengths[200];
+  size_t nb_expected;
+  size_t nb_received;
+  int ok;
+} test_ubx_stream_t;
+
+static void test_ubx_stream_cb(void *arg, const ubx_frame_t *frame) {
+  test_ubx_stream_t *test = (test_ubx_stream_t *) arg;
+  const size_t k = test->nb_received++;
+  if (k >= test->nb_expected || frame->length != test->lengths[k]) {
+    test->ok = 0;
+    return;
+  }
+  test->ok &= (memcmp(frame->data, test->frames[k], frame->length) == 0);
+}
+
+int test_ubx_stream_update() {
+  // clang-format off
+  const uint8_t garbage[6] = {0x00, 0xB5, 0x00, 0xD3, 0xFF, 0x42};
+  const uint8_t rtcm3[14] = {0xD3, 0x00, 0x08, 0x4C, 0xE0, 0x00, 0x8A, 0x00,
+                             0x00, 0x00, 0x00, 0xA8, 0xF7, 0x2A};
+  // clang-format on
+  uint8_t rtcm3_bad[14] = {0};
+  memcpy(rtcm3_bad, rtcm3, 14);
+  rtcm3_bad[7] = 0x01;
+
+  // Build a byte log of garbage, UBX, RTCM3 and corrupted RTCM3 frames
+  const size_t nb_iters = 50;
+  uint8_t *log = malloc(nb_iters * (6 + 8 + 100 + 14 + 14));
+  size_t log_size = 0;
+  test_ubx_stream_t test = {0};
+  test.ok = 1;
+  for (size_t i = 0; i < nb_iters; i++) {
+    memcpy(log + log_size, garbage, 6);
+    log_size += 6;
+
+    uint8_t payload[100] = {0};
+    for (size_t k = 0; k < 2 * i; k++) {
+      payload[k] = (i * 7 + k) & 0xFF;
+    }
+    ubx_msg_t msg;
+    ubx_msg_build(&msg, UBX_NAV, UBX_NAV_PVT, 2 * i, payload);
+    size_t frame_size = 0;
+    ubx_msg_serialize(&msg, log + log_size, &frame_size);
+    test.frames[test.nb_expected] = log + log_size;
+    test.lengths[test.nb_expected++] = frame_size;
+    log_size += frame_size;
+
+    memcpy(log + log_size, rtcm3, 14);
+    test.frames[test.nb_expected] = log + log_size;
+    test.lengths[test.nb_expected++] = 14;
+    log_size += 14;
+
+    memcpy(log + log_size, rtcm3_bad, 14);
+    log_size += 14;
+  }
+
+  // Parse the log in chunks of varying size
+  ubx_stream_t stream;
+  ubx_stream_init(&stream);
+  size_t offset = 0;
+  for (size_t chunk = 1; offset < log_size; chunk = chunk % 37 + 1) {
+    const size_t n = (offset + chunk < log_size) ? chunk : log_size - offset;
+    ubx_stream_update(&stream, log + offset, n, test_ubx_stream_cb, &test);
+    offset += n;
+  }
+  TEST_ASSERT(test.ok);
+  TEST_ASSERT(test.nb_received == test.nb_expected);
+  TEST_ASSERT(stream.nb_frames == 2 * nb_iters);
+  TEST_ASSERT(stream.nb_bad_frames == nb_iters);
+  TEST_ASSERT(stream.nb_skipped_bytes == nb_iters * (6 + 13));
+  TEST_ASSERT(stream.size == 0);
+
+  // Clean up
+  free(log);
+
+  return 0;
+}
+
 /*****************************************************************************
  * UBLOX
  ****************************************************************************/
@@ -2312,6 +3032,125 @@ int test_ublox_parse_rtcm3() {
   return 0;
 }
 
+typedef struct test_ublox_base_t {
+  ublox_t *base;
+  int port;
+  int loop;
+} test_ublox_base_t;
+
+static void *test_ublox_base_server(void *arg) {
+  test_ublox_base_t *test = (test_ublox_base_t *) arg;
+  ublox_base_serve(test->base, test->port, &test->loop);
+  return NULL;
+}
+
+static int test_ublox_base_connect(const int port, const int rcvbuf) {
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (rcvbuf > 0) {
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(int));
+  }
+
+  struct sockaddr_in server = {0};
+  server.sin_family = AF_INET;
+  server.sin_addr.s_addr = inet_addr("127.0.0.1");
+  server.sin_port = htons(port);
+  for (int attempt = 0; attempt < 100; attempt++) {
+    if (connect(fd, (struct sockaddr *) &server, sizeof(server)) == 0) {
+      return fd;
+    }
+    usleep(10000);
+  }
+  close(fd);
+
+  return -1;
+}
+
+int test_ublox_base_serve() {
+  // Stand in for the receiver's UART with a pipe
+  int uart_fds[2] = {0};
+  TEST_ASSERT(pipe(uart_fds) == 0);
+  ubx_uart_t uart;
+  uart.connected = 1;
+  uart.connfd = uart_fds[0];
+  ublox_t base;
+  TEST_ASSERT(ublox_init(&base, &uart) == 0);
+  base.rtcm3_cb = ublox_broadcast_rtcm3;
+
+  // Serve
+  pthread_t server;
+  test_ublox_base_t test = {.base = &base, .port = 18234, .loop = 1};
+  TEST_ASSERT(pthread_create(&server, NULL, test_ublox_base_server, &test) ==
+              0);
+
+  // Connect fast rovers and a slow rover that never reads
+  const int nb_rovers = 8;
+  int rovers[8] = {0};
+  for (int i = 0; i < nb_rovers; i++) {
+    rovers[i] = test_ublox_base_connect(test.port, 0);
+    TEST_ASSERT(rovers[i] != -1);
+  }
+  const int slow = test_ublox_base_connect(test.port, 4096);
+  TEST_ASSERT(slow != -1);
+
+  // A rover that half-closes its write side still receives the stream
+  TEST_ASSERT(shutdown(rovers[0], SHUT_WR) == 0);
+  usleep(100000);
+
+  // Stream RTCM3 1230 frames, far more than the slow rover can buffer
+  // clang-format off
+  const uint8_t frame[14] = {0xD3, 0x00, 0x08, 0x4C, 0xE0, 0x00, 0x8A, 0x00,
+                             0x00, 0x00, 0x00, 0xA8, 0xF7, 0x2A};
+  // clang-format on
+  const size_t nb_frames = 100000;
+  const size_t total = nb_frames * sizeof(frame);
+  size_t received[8] = {0};
+  size_t nb_done = 0;
+  uint8_t buf[4096];
+  size_t frames_written = 0;
+  const time_t deadline = time(NULL) + 30;
+  while (nb_done < (size_t) nb_rovers) {
+    TEST_ASSERT(time(NULL) < deadline);
+
+    // Write frames
+    for (int k = 0; k < 64 && frames_written < nb_frames; k++) {
+      if (write(uart_fds[1], frame, sizeof(frame)) != sizeof(frame)) {
+        break;
+      }
+      frames_written++;
+    }
+
+    // Read at every fast rover
+    nb_done = 0;
+    for (int i = 0; i < nb_rovers; i++) {
+      const ssize_t n = recv(rovers[i], buf, sizeof(buf), MSG_DONTWAIT);
+      for (ssize_t k = 0; k < n; k++) {
+        TEST_ASSERT(buf[k] == frame[(received[i] + k) % sizeof(frame)]);
+      }
+      received[i] += (n > 0) ? n : 0;
+      nb_done += (received[i] == total);
+    }
+  }
+
+  // Slow rover was evicted, it reads up to an end of stream
+  size_t slow_received = 0;
+  ssize_t n = 0;
+  while ((n = recv(slow, buf, sizeof(buf), 0)) > 0) {
+    slow_received += n;
+  }
+  TEST_ASSERT(slow_received < total);
+
+  // Clean up
+  test.loop = 0;
+  pthread_join(server, NULL);
+  for (int i = 0; i < nb_rovers; i++) {
+    close(rovers[i]);
+  }
+  close(slow);
+  close(uart_fds[1]);
+
+  return 0;
+}
+
 int test_ublox_run() {
   // Setup UART connection to UBlox
   ubx_uart_t uart;
@@ -2394,10 +3233,14 @@ int main(int argc, char *argv[]) {
   TEST(test_ubx_parser_reset);
   TEST(test_ubx_parser_update);
 
+  TEST(test_ubx_fletcher8);
+  TEST(test_ubx_stream_update);
+
   TEST(test_ublox_init);
   TEST(test_ublox_version);
   TEST(test_ubx_set_and_get);
   TEST(test_ublox_parse_rtcm3);
+  TEST(test_ublox_base_serve);
   TEST(test_ublox_run);
   // TEST(test_ublox_base);
   // TEST(test_ublox_rover);
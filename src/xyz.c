@@ -1414,6 +1414,147 @@ void *queue_last(queue_t *q) {
   return NULL;
 }
 
+////////////////
+// SPSC QUEUE //
+////////////////
+
+/**
+ * Malloc SPSC queue. The capacity is rounded up to the next power of two so
+ * that ring indices can be wrapped with a mask.
+ */
+spsc_queue_t *spsc_queue_malloc(const size_t element_size,
+                                const size_t capacity) {
+  assert(element_size > 0);
+  assert(capacity > 0);
+
+  size_t cap = 1;
+  while (cap < capacity) {
+    cap <<= 1;
+  }
+
+  spsc_queue_t *q = NULL;
+  if (posix_memalign((void **) &q, CACHE_LINE_SIZE, sizeof(spsc_queue_t))) {
+    return NULL;
+  }
+  memset(q, 0, sizeof(spsc_queue_t));
+
+  q->capacity = cap;
+  q->mask = cap - 1;
+  q->element_size = element_size;
+  if (posix_memalign((void **) &q->data, CACHE_LINE_SIZE, element_size * cap)) {
+    free(q);
+    return NULL;
+  }
+
+  return q;
+}
+
+/**
+ * Free SPSC queue.
+ */
+void spsc_queue_free(spsc_queue_t *q) {
+  if (q == NULL) {
+    return;
+  }
+  free(q->data);
+  free(q);
+}
+
+/**
+ * Push element `el` onto the queue. Must only be called from the producer
+ * thread.
+ *
+ * @returns 0 for success, -1 if the queue is full
+ */
+int spsc_queue_push(spsc_queue_t *q, const void *el) {
+  assert(q != NULL);
+  assert(el != NULL);
+
+  const size_t tail = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+  if ((tail - q->head_cache) == q->capacity) {
+    q->head_cache = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+    if ((tail - q->head_cache) == q->capacity) {
+      return -1;
+    }
+  }
+
+  memcpy(q->data + (tail & q->mask) * q->element_size, el, q->element_size);
+  __atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+
+  return 0;
+}
+
+/**
+ * Pop element off the queue into `el`. Must only be called from the consumer
+ * thread.
+ *
+ * @returns 0 for success, -1 if the queue is empty
+ */
+int spsc_queue_pop(spsc_queue_t *q, void *el) {
+  assert(q != NULL);
+  assert(el != NULL);
+
+  const size_t head = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+  if (head == q->tail_cache) {
+    q->tail_cache = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+    if (head == q->tail_cache) {
+      return -1;
+    }
+  }
+
+  memcpy(el, q->data + (head & q->mask) * q->element_size, q->element_size);
+  __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+
+  return 0;
+}
+
+/**
+ * Copy the next element into `el` without removing it. Must only be called
+ * from the consumer thread.
+ *
+ * @returns 0 for success, -1 if the queue is empty
+ */
+int spsc_queue_peek(spsc_queue_t *q, void *el) {
+  assert(q != NULL);
+  assert(el != NULL);
+
+  const size_t head = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+  if (head == q->tail_cache) {
+    q->tail_cache = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+    if (head == q->tail_cache) {
+      return -1;
+    }
+  }
+  memcpy(el, q->data + (head & q->mask) * q->element_size, q->element_size);
+
+  return 0;
+}
+
+/**
+ * Number of elements in queue. Only exact when called from either the
+ * producer or consumer thread while the other is idle.
+ */
+size_t spsc_queue_size(spsc_queue_t *q) {
+  assert(q != NULL);
+  const size_t head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+  const size_t tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+  return tail - head;
+}
+
+/**
+ * Check if queue is empty.
+ */
+int spsc_queue_empty(spsc_queue_t *q) {
+  return (spsc_queue_size(q) == 0) ? 1 : 0;
+}
+
+/**
+ * Check if queue is full.
+ */
+int spsc_queue_full(spsc_queue_t *q) {
+  return (spsc_queue_size(q) == q->capacity) ? 1 : 0;
+}
+
 /////////////
 // HASHMAP //
 /////////////
@@ -1750,34 +1891,755 @@ float mtoc(struct timespec *tic) {
 }
 
 /**
- * Get time now since epoch.
- * @return Time now in nano-seconds since epoch
+ * Get time now since epoch.
+ * @return Time now in nano-seconds since epoch
+ */
+timestamp_t time_now() {
+  struct timespec spec;
+  clock_gettime(CLOCK_REALTIME, &spec);
+
+  const time_t sec = spec.tv_sec;
+  const long int ns = spec.tv_nsec;
+  const uint64_t BILLION = 1000000000L;
+
+  return (uint64_t) sec * BILLION + (uint64_t) ns;
+}
+
+/**
+ * Convert string to timestamp
+ */
+timestamp_t str2ts(const char *ts_str) { return strtoll(ts_str, NULL, 10); }
+
+/**
+ * Convert timestamp to seconds
+ */
+real_t ts2sec(const timestamp_t ts) { return ts * 1e-9; }
+
+/**
+ * Convert seconds to timestamp
+ */
+timestamp_t sec2ts(const real_t time_s) { return time_s * 1e9; }
+
+/******************************************************************************
+ * TELEMETRY LOG
+ ******************************************************************************/
+
+/**
+ * Size of telemetry log data `type` in bytes, 0 if invalid.
+ */
+size_t tlog_type_size(const int type) {
+  switch (type) {
+    case TLOG_U8:
+      return sizeof(uint8_t);
+    case TLOG_I32:
+      return sizeof(int32_t);
+    case TLOG_I64:
+      return sizeof(int64_t);
+    case TLOG_F32:
+      return sizeof(float);
+    case TLOG_F64:
+      return sizeof(double);
+    default:
+      return 0;
+  }
+}
+
+/**
+ * Size of a chunk of `n` samples with `stride` bytes per sample, padded to 8
+ * bytes.
+ */
+static size_t tlog_chunk_size(const size_t n, const size_t stride) {
+  const size_t size = sizeof(timestamp_t) * n + stride * n;
+  return (size + 7) & ~(size_t) 7;
+}
+
+/**
+ * Malloc telemetry log writer. Chunks are streamed to `path` as they fill
+ * up, the channels and index are written when the writer is closed.
+ */
+tlog_writer_t *tlog_writer_malloc(const char *path) {
+  assert(path != NULL);
+
+  FILE *fp = fopen(path, "wb");
+  if (fp == NULL) {
+    LOG_ERROR("Failed to open [%s] for saving!\n", path);
+    return NULL;
+  }
+
+  // Write placeholder header, an index offset of 0 marks it as incomplete
+  tlog_header_t header;
+  memset(&header, 0, sizeof(tlog_header_t));
+  memcpy(header.magic, TLOG_MAGIC, 8);
+  header.version = TLOG_VERSION;
+  if (fwrite(&header, sizeof(header), 1, fp) != 1) {
+    fclose(fp);
+    return NULL;
+  }
+
+  tlog_writer_t *writer = MALLOC(tlog_writer_t, 1);
+  writer->fp = fp;
+  writer->offset = sizeof(tlog_header_t);
+  writer->channels = NULL;
+  writer->bufs = NULL;
+  writer->num_channels = 0;
+  writer->chunks = NULL;
+  writer->num_chunks = 0;
+  writer->capacity = 0;
+
+  return writer;
+}
+
+/**
+ * Add channel `name` of `dim` values of `type` per sample. Returns the
+ * channel index or -1 on failure.
+ */
+int tlog_writer_channel(tlog_writer_t *writer,
+                        const char *name,
+                        const int type,
+                        const int dim) {
+  assert(writer != NULL);
+  assert(name != NULL);
+
+  const size_t type_size = tlog_type_size(type);
+  if (type_size == 0 || dim <= 0 || strlen(name) >= TLOG_NAME_SIZE) {
+    LOG_ERROR("Invalid telemetry log channel [%s]!\n", name);
+    return -1;
+  }
+  for (int i = 0; i < writer->num_channels; i++) {
+    if (strcmp(writer->channels[i].name, name) == 0) {
+      LOG_ERROR("Telemetry log channel [%s] already exists!\n", name);
+      return -1;
+    }
+  }
+
+  // Grow channels
+  const int idx = writer->num_channels;
+  const int n = idx + 1;
+  writer->channels = REALLOC(writer->channels, tlog_channel_t, n);
+  writer->bufs = REALLOC(writer->bufs, tlog_buf_t, n);
+  writer->num_channels = n;
+
+  // Channel
+  tlog_channel_t *channel = &writer->channels[idx];
+  memset(channel, 0, sizeof(tlog_channel_t));
+  strcpy(channel->name, name);
+  channel->type = type;
+  channel->dim = dim;
+  channel->num_samples = 0;
+
+  // Chunk buffer
+  tlog_buf_t *buf = &writer->bufs[idx];
+  buf->stride = type_size * dim;
+  buf->num_samples = 0;
+  buf->ts = MALLOC(timestamp_t, TLOG_CHUNK_SAMPLES);
+  buf->data = MALLOC(uint8_t, buf->stride * TLOG_CHUNK_SAMPLES);
+
+  return idx;
+}
+
+/**
+ * Write the samples buffered for `channel` as one chunk.
+ */
+int tlog_writer_flush(tlog_writer_t *writer, const int channel) {
+  assert(writer != NULL);
+  assert(channel >= 0 && channel < writer->num_channels);
+
+  tlog_buf_t *buf = &writer->bufs[channel];
+  const int n = buf->num_samples;
+  if (n == 0) {
+    return 0;
+  }
+
+  // Grow index
+  if (writer->num_chunks == writer->capacity) {
+    const size_t capacity = (writer->capacity) ? writer->capacity * 2 : 64;
+    tlog_chunk_t *chunks = REALLOC(writer->chunks, tlog_chunk_t, capacity);
+    if (chunks == NULL) {
+      return -1;
+    }
+    writer->chunks = chunks;
+    writer->capacity = capacity;
+  }
+
+  // Write timestamps, values and padding
+  const size_t chunk_size = tlog_chunk_size(n, buf->stride);
+  const size_t data_size = buf->stride * n;
+  const size_t pad_size = chunk_size - sizeof(timestamp_t) * n - data_size;
+  const uint8_t pad[8] = {0};
+  buf->num_samples = 0;
+  if (fwrite(buf->ts, sizeof(timestamp_t), n, writer->fp) != (size_t) n) {
+    LOG_ERROR("Failed to write telemetry log chunk!\n");
+    return -1;
+  } else if (fwrite(buf->data, 1, data_size, writer->fp) != data_size) {
+    LOG_ERROR("Failed to write telemetry log chunk!\n");
+    return -1;
+  } else if (fwrite(pad, 1, pad_size, writer->fp) != pad_size) {
+    LOG_ERROR("Failed to write telemetry log chunk!\n");
+    return -1;
+  }
+
+  // Update index
+  tlog_chunk_t *chunk = &writer->chunks[writer->num_chunks++];
+  chunk->ts_start = buf->ts[0];
+  chunk->ts_end = buf->ts[n - 1];
+  chunk->offset = writer->offset;
+  chunk->channel = channel;
+  chunk->num_samples = n;
+  writer->offset += chunk_size;
+  writer->channels[channel].num_samples += n;
+
+  return 0;
+}
+
+static int tlog_chunk_cmp(const void *a, const void *b) {
+  const tlog_chunk_t *c0 = (const tlog_chunk_t *) a;
+  const tlog_chunk_t *c1 = (const tlog_chunk_t *) b;
+  if (c0->channel != c1->channel) {
+    return (c0->channel < c1->channel) ? -1 : 1;
+  }
+  if (c0->ts_start != c1->ts_start) {
+    return (c0->ts_start < c1->ts_start) ? -1 : 1;
+  }
+  return 0;
+}
+
+/**
+ * Flush remaining samples, write channels, index and header, close file and
+ * free writer.
+ */
+int tlog_writer_close(tlog_writer_t *writer) {
+  if (writer == NULL) {
+    return -1;
+  }
+
+  // Flush partial chunks
+  int retval = 0;
+  for (int i = 0; i < writer->num_channels; i++) {
+    if (tlog_writer_flush(writer, i) != 0) {
+      retval = -1;
+    }
+  }
+
+  // Write channels and index sorted by (channel, ts_start). Chunks of a
+  // channel are flushed in time order so the sort is stable for them.
+  const size_t num_channels = writer->num_channels;
+  const size_t num_chunks = writer->num_chunks;
+  if (num_chunks) {
+    qsort(writer->chunks, num_chunks, sizeof(tlog_chunk_t), tlog_chunk_cmp);
+  }
+  if (num_channels &&
+      fwrite(writer->channels, sizeof(tlog_channel_t), num_channels,
+             writer->fp) != num_channels) {
+    retval = -1;
+  }
+  if (num_chunks &&
+      fwrite(writer->chunks, sizeof(tlog_chunk_t), num_chunks, writer->fp) !=
+          num_chunks) {
+    retval = -1;
+  }
+
+  // Finalize header
+  tlog_header_t header;
+  memset(&header, 0, sizeof(tlog_header_t));
+  memcpy(header.magic, TLOG_MAGIC, 8);
+  header.version = TLOG_VERSION;
+  header.num_channels = num_channels;
+  header.num_chunks = num_chunks;
+  header.index_offset = writer->offset;
+  if (fseek(writer->fp, 0, SEEK_SET) != 0) {
+    retval = -1;
+  } else if (fwrite(&header, sizeof(header), 1, writer->fp) != 1) {
+    retval = -1;
+  }
+  if (fclose(writer->fp) != 0) {
+    retval = -1;
+  }
+
+  // Clean up
+  for (int i = 0; i < writer->num_channels; i++) {
+    free(writer->bufs[i].ts);
+    free(writer->bufs[i].data);
+  }
+  free(writer->channels);
+  free(writer->bufs);
+  free(writer->chunks);
+  free(writer);
+
+  return retval;
+}
+
+/**
+ * Check if file at `path` is a telemetry log.
+ */
+int tlog_check(const char *path) {
+  assert(path != NULL);
+
+  FILE *fp = fopen(path, "rb");
+  if (fp == NULL) {
+    return 0;
+  }
+
+  char magic[8] = {0};
+  const size_t retval = fread(magic, 1, 8, fp);
+  fclose(fp);
+
+  return retval == 8 && memcmp(magic, TLOG_MAGIC, 8) == 0;
+}
+
+/**
+ * Memory map telemetry log at `path`.
+ */
+tlog_t *tlog_load(const char *path) {
+  assert(path != NULL);
+
+  // Map file
+  const int fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    LOG_ERROR("Failed to open [%s]!\n", path);
+    return NULL;
+  }
+  struct stat sb;
+  if (fstat(fd, &sb) == -1 || (size_t) sb.st_size < sizeof(tlog_header_t)) {
+    LOG_ERROR("Invalid telemetry log [%s]!\n", path);
+    close(fd);
+    return NULL;
+  }
+  const size_t size = sb.st_size;
+  void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    LOG_ERROR("Failed to mmap [%s]!\n", path);
+    return NULL;
+  }
+
+  // Validate header, channels and index, counts are bounded by the index
+  // size before they are multiplied into sizes
+  const tlog_header_t *header = data;
+  CHECK(memcmp(header->magic, TLOG_MAGIC, 8) == 0);
+  CHECK(header->version == TLOG_VERSION);
+  CHECK(header->index_offset >= sizeof(tlog_header_t));
+  CHECK((header->index_offset & 7) == 0);
+  CHECK(header->index_offset <= size);
+  const uint64_t index_size = size - header->index_offset;
+  CHECK(header->num_channels <= index_size / sizeof(tlog_channel_t));
+  const uint64_t channels_size =
+      (uint64_t) header->num_channels * sizeof(tlog_channel_t);
+  CHECK(header->num_chunks <=
+        (index_size - channels_size) / sizeof(tlog_chunk_t));
+
+  const uint8_t *index = (const uint8_t *) data + header->index_offset;
+  const tlog_channel_t *channels = (const tlog_channel_t *) index;
+  const tlog_chunk_t *chunks =
+      (const tlog_chunk_t *) (index + channels_size);
+  for (uint32_t i = 0; i < header->num_channels; i++) {
+    CHECK(tlog_type_size(channels[i].type) > 0);
+    CHECK(channels[i].dim > 0);
+    CHECK(memchr(channels[i].name, '\0', TLOG_NAME_SIZE) != NULL);
+  }
+  for (uint64_t i = 0; i < header->num_chunks; i++) {
+    const tlog_chunk_t *chunk = &chunks[i];
+    CHECK(chunk->channel >= 0);
+    CHECK((uint32_t) chunk->channel < header->num_channels);
+    CHECK(chunk->num_samples > 0);
+
+    CHECK(chunk->offset >= sizeof(tlog_header_t));
+    CHECK((chunk->offset & 7) == 0);
+    CHECK(chunk->offset <= header->index_offset);
+
+    const tlog_channel_t *channel = &channels[chunk->channel];
+    const size_t stride = tlog_type_size(channel->type) * channel->dim;
+    const uint64_t data_size = header->index_offset - chunk->offset;
+    CHECK((uint64_t) chunk->num_samples <=
+          data_size / (sizeof(timestamp_t) + stride));
+    CHECK(tlog_chunk_size(chunk->num_samples, stride) <= data_size);
+  }
+
+  tlog_t *log = MALLOC(tlog_t, 1);
+  log->data = data;
+  log->size = size;
+  log->num_channels = header->num_channels;
+  log->channels = channels;
+  log->num_chunks = header->num_chunks;
+  log->chunks = chunks;
+
+  return log;
+error:
+  LOG_ERROR("Invalid telemetry log [%s]!\n", path);
+  munmap(data, size);
+  return NULL;
+}
+
+/**
+ * Unmap and free telemetry log.
+ */
+void tlog_free(tlog_t *log) {
+  if (log == NULL) {
+    return;
+  }
+  munmap(log->data, log->size);
+  free(log);
+}
+
+/**
+ * Find channel `name` in telemetry log. Returns the channel index or -1 if
+ * not found.
+ */
+int tlog_find(const tlog_t *log, const char *name) {
+  assert(log != NULL);
+  assert(name != NULL);
+
+  for (int i = 0; i < log->num_channels; i++) {
+    if (strcmp(log->channels[i].name, name) == 0) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+/**
+ * Index of the first sample in `ts` of length `n` not less than `t`.
+ */
+static int tlog_lower_bound(const timestamp_t *ts,
+                            const int n,
+                            const timestamp_t t) {
+  int lo = 0;
+  int hi = n;
+  while (lo < hi) {
+    const int mid = lo + (hi - lo) / 2;
+    if (ts[mid] < t) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+/**
+ * Get the next slice of `channel` samples with timestamps in [`ts_start`,
+ * `ts_end`]. A range spanning several chunks is returned as one slice per
+ * chunk, `cursor` keeps track of the position and must be initialized to 0.
+ * Slices point into the mapped file. Returns 1 if a slice was returned, or 0
+ * when there are no more samples in range.
+ */
+int tlog_slice(const tlog_t *log,
+               const int channel,
+               const timestamp_t ts_start,
+               const timestamp_t ts_end,
+               size_t *cursor,
+               tlog_slice_t *slice) {
+  assert(log != NULL);
+  assert(cursor != NULL);
+  assert(slice != NULL);
+  if (channel < 0 || channel >= log->num_channels) {
+    return 0;
+  }
+
+  // Find the first chunk of the channel that ends at or after `ts_start`
+  size_t lo = *cursor;
+  size_t hi = log->num_chunks;
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+    const tlog_chunk_t *chunk = &log->chunks[mid];
+    if (chunk->channel < channel ||
+        (chunk->channel == channel && chunk->ts_end < ts_start)) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  // Slice chunk samples in range
+  const tlog_channel_t *info = &log->channels[channel];
+  const size_t stride = tlog_type_size(info->type) * info->dim;
+  for (size_t idx = lo; idx < log->num_chunks; idx++) {
+    const tlog_chunk_t *chunk = &log->chunks[idx];
+    if (chunk->channel != channel || chunk->ts_start > ts_end) {
+      break;
+    }
+
+    const uint8_t *base = (const uint8_t *) log->data + chunk->offset;
+    const timestamp_t *ts = (const timestamp_t *) base;
+    const uint8_t *values = base + sizeof(timestamp_t) * chunk->num_samples;
+    const int n = chunk->num_samples;
+    const int begin = tlog_lower_bound(ts, n, ts_start);
+    const int end = (ts_end == INT64_MAX) ? n
+                                          : tlog_lower_bound(ts, n, ts_end + 1);
+    *cursor = idx + 1;
+    if (begin < end) {
+      slice->ts = ts + begin;
+      slice->data = values + stride * begin;
+      slice->num_samples = end - begin;
+      return 1;
+    }
+  }
+
+  *cursor = log->num_chunks;
+  return 0;
+}
+
+/******************************************************************************
+ * TRACE
+ ******************************************************************************/
+
+static int trace_enabled = 0;
+static int trace_generation = 0;
+static int trace_num_threads = 0;
+static trace_buf_t *trace_bufs = NULL;
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static __thread trace_buf_t *trace_buf = NULL;
+static __thread int trace_buf_generation = -1;
+
+/**
+ * Monotonic time in nanoseconds.
+ */
+static uint64_t trace_now() {
+  struct timespec spec;
+  clock_gettime(CLOCK_MONOTONIC, &spec);
+  return (uint64_t) spec.tv_sec * 1000000000UL + (uint64_t) spec.tv_nsec;
+}
+
+/**
+ * Start recording trace events.
+ */
+void trace_start() { __atomic_store_n(&trace_enabled, 1, __ATOMIC_RELAXED); }
+
+/**
+ * Stop recording trace events. Scopes already open are still recorded.
+ */
+void trace_stop() { __atomic_store_n(&trace_enabled, 0, __ATOMIC_RELAXED); }
+
+/**
+ * Free recorded trace events. Must not be called while traced code is
+ * running.
+ */
+void trace_clear() {
+  pthread_mutex_lock(&trace_mutex);
+  trace_buf_t *buf = trace_bufs;
+  while (buf) {
+    trace_block_t *block = buf->head;
+    while (block) {
+      trace_block_t *next = block->next;
+      free(block);
+      block = next;
+    }
+    trace_buf_t *next = buf->next;
+    free(buf);
+    buf = next;
+  }
+  trace_bufs = NULL;
+  trace_num_threads = 0;
+  __atomic_add_fetch(&trace_generation, 1, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&trace_mutex);
+}
+
+/**
+ * Open trace scope `name`.
+ */
+trace_scope_t trace_begin(const char *name) {
+  trace_scope_t scope = {name, 0};
+  if (__atomic_load_n(&trace_enabled, __ATOMIC_RELAXED)) {
+    scope.ts = trace_now();
+  }
+  return scope;
+}
+
+/**
+ * Close trace scope and record it in the calling thread's buffer.
+ */
+void trace_end(trace_scope_t *scope) {
+  if (scope->ts == 0) {
+    return;
+  }
+  const uint64_t ts_end = trace_now();
+
+  // Register thread buffer on first use or after `trace_clear()`
+  trace_buf_t *buf = trace_buf;
+  const int generation = __atomic_load_n(&trace_generation, __ATOMIC_ACQUIRE);
+  if (buf == NULL || trace_buf_generation != generation) {
+    buf = CALLOC(trace_buf_t, 1);
+    buf->head = CALLOC(trace_block_t, 1);
+    buf->tail = buf->head;
+    pthread_mutex_lock(&trace_mutex);
+    buf->tid = ++trace_num_threads;
+    buf->next = trace_bufs;
+    trace_bufs = buf;
+    pthread_mutex_unlock(&trace_mutex);
+    trace_buf = buf;
+    trace_buf_generation = generation;
+  }
+
+  // Append event, publishing it to `trace_save()` with the count
+  trace_block_t *block = buf->tail;
+  if (block->num_events == TRACE_BLOCK_SIZE) {
+    trace_block_t *next = CALLOC(trace_block_t, 1);
+    __atomic_store_n(&block->next, next, __ATOMIC_RELEASE);
+    buf->tail = next;
+    block = next;
+  }
+  trace_event_t *event = &block->events[block->num_events];
+  event->name = scope->name;
+  event->ts = scope->ts;
+  event->dur = ts_end - scope->ts;
+  __atomic_store_n(&block->num_events, block->num_events + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Save recorded trace events to `json_path` in the Chrome trace event
+ * format, viewable in chrome://tracing or ui.perfetto.dev. Returns 0 or -1
+ * on failure.
+ */
+int trace_save(const char *json_path) {
+  assert(json_path != NULL);
+
+  FILE *fp = fopen(json_path, "w");
+  if (fp == NULL) {
+    LOG_ERROR("Failed to open [%s] for saving!\n", json_path);
+    return -1;
+  }
+
+  const int pid = getpid();
+  int num_events = 0;
+  fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+  pthread_mutex_lock(&trace_mutex);
+  for (trace_buf_t *buf = trace_bufs; buf; buf = buf->next) {
+    trace_block_t *block = buf->head;
+    while (block) {
+      const int n = __atomic_load_n(&block->num_events, __ATOMIC_ACQUIRE);
+      for (int i = 0; i < n; i++) {
+        const trace_event_t *event = &block->events[i];
+        fprintf(fp, "%s\n", (num_events++) ? "," : "");
+        fprintf(fp, "{\"name\":\"%s\",\"ph\":\"X\",", event->name);
+        fprintf(fp, "\"ts\":%.3f,", event->ts * 1e-3);
+        fprintf(fp, "\"dur\":%.3f,", event->dur * 1e-3);
+        fprintf(fp, "\"pid\":%d,\"tid\":%d}", pid, buf->tid);
+      }
+      block = __atomic_load_n(&block->next, __ATOMIC_ACQUIRE);
+    }
+  }
+  pthread_mutex_unlock(&trace_mutex);
+  fprintf(fp, "\n]}\n");
+
+  return (fclose(fp) == 0) ? 0 : -1;
+}
+
+/**
+ * Sum the durations of recorded events named `name` in nanoseconds to `dur`.
+ * Returns the number of matching events.
+ */
+int trace_total(const char *name, uint64_t *dur) {
+  assert(name != NULL);
+  assert(dur != NULL);
+
+  int num_events = 0;
+  *dur = 0;
+  pthread_mutex_lock(&trace_mutex);
+  for (trace_buf_t *buf = trace_bufs; buf; buf = buf->next) {
+    trace_block_t *block = buf->head;
+    while (block) {
+      const int n = __atomic_load_n(&block->num_events, __ATOMIC_ACQUIRE);
+      for (int i = 0; i < n; i++) {
+        const trace_event_t *event = &block->events[i];
+        if (strcmp(event->name, name) == 0) {
+          *dur += event->dur;
+          num_events++;
+        }
+      }
+      block = __atomic_load_n(&block->next, __ATOMIC_ACQUIRE);
+    }
+  }
+  pthread_mutex_unlock(&trace_mutex);
+
+  return num_events;
+}
+
+/******************************************************************************
+ * PARALLEL
+ ******************************************************************************/
+
+typedef struct parallel_worker_t {
+  parallel_task_t task_fn;
+  void *data;
+  int num_tasks;
+  int thread;
+  int *next;
+} parallel_worker_t;
+
+/**
+ * Parallel for worker thread, tasks are claimed one at a time from a shared
+ * counter.
  */
-timestamp_t time_now() {
-  struct timespec spec;
-  clock_gettime(CLOCK_REALTIME, &spec);
+static void *parallel_worker(void *arg) {
+  parallel_worker_t *worker = (parallel_worker_t *) arg;
 
-  const time_t sec = spec.tv_sec;
-  const long int ns = spec.tv_nsec;
-  const uint64_t BILLION = 1000000000L;
+  while (1) {
+    const int task = __atomic_fetch_add(worker->next, 1, __ATOMIC_RELAXED);
+    if (task >= worker->num_tasks) {
+      break;
+    }
+    worker->task_fn(worker->data, task, worker->thread);
+  }
 
-  return (uint64_t) sec * BILLION + (uint64_t) ns;
+  return NULL;
 }
 
 /**
- * Convert string to timestamp
+ * Number of threads `parallel_for()` uses for `num_tasks` tasks, all cores if
+ * `num_threads` <= 0 and never more threads than tasks.
  */
-timestamp_t str2ts(const char *ts_str) { return strtoll(ts_str, NULL, 10); }
+int parallel_threads(const int num_threads, const int num_tasks) {
+  int nt = num_threads;
+  if (nt <= 0) {
+    nt = sysconf(_SC_NPROCESSORS_ONLN);
+  }
+  return MAX(MIN(nt, num_tasks), 1);
+}
 
 /**
- * Convert timestamp to seconds
+ * Run `task_fn(data, task, thread)` for every task in [0, num_tasks) on up to
+ * `num_threads` threads, see `parallel_threads()`. The calling thread is one
+ * of the workers, and runs every task if no thread could be spawned.
  */
-real_t ts2sec(const timestamp_t ts) { return ts * 1e-9; }
+void parallel_for(const int num_tasks,
+                  const int num_threads,
+                  parallel_task_t task_fn,
+                  void *data) {
+  assert(task_fn != NULL);
+  if (num_tasks <= 0) {
+    return;
+  }
 
-/**
- * Convert seconds to timestamp
- */
-timestamp_t sec2ts(const real_t time_s) { return time_s * 1e9; }
+  // Setup
+  const int nt = parallel_threads(num_threads, num_tasks);
+  int next = 0;
+  parallel_worker_t *workers = MALLOC(parallel_worker_t, nt);
+  for (int i = 0; i < nt; i++) {
+    workers[i].task_fn = task_fn;
+    workers[i].data = data;
+    workers[i].num_tasks = num_tasks;
+    workers[i].thread = i;
+    workers[i].next = &next;
+  }
+
+  // Run
+  pthread_t *threads = MALLOC(pthread_t, nt);
+  int num_spawned = 0;
+  for (int i = 1; i < nt; i++) {
+    if (pthread_create(&threads[i], NULL, parallel_worker, &workers[i])) {
+      break;
+    }
+    num_spawned++;
+  }
+  parallel_worker(&workers[0]);
+  for (int i = 1; i <= num_spawned; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  // Clean up
+  free(threads);
+  free(workers);
+}
 
 /******************************************************************************
  * NETWORK
@@ -6162,6 +7024,7 @@ void image_setup(image_t *img,
   assert(img != NULL);
   img->width = width;
   img->height = height;
+  img->channels = 1;
   img->data = data;
 }
 
@@ -6263,46 +7126,10 @@ void radtan4_distort(const real_t params[4],
 void radtan4_undistort(const real_t params[4],
                        const real_t p_in[2],
                        real_t p_out[2]) {
-  const int max_iter = 5;
-  real_t p[2] = {p_in[0], p_in[1]};
-
-  for (int i = 0; i < max_iter; i++) {
-    // Error
-    real_t p_d[2] = {0};
-    radtan4_distort(params, p, p_d);
-    const real_t e[2] = {p_in[0] - p_d[0], p_in[1] - p_d[1]};
-
-    // Jacobian
-    real_t J[2 * 2] = {0};
-    radtan4_point_jacobian(params, p, J);
-
-    // Calculate update
-    // dp = inv(J' * J) * J' * e;
-    real_t Jt[2 * 2] = {0};
-    real_t JtJ[2 * 2] = {0};
-    real_t JtJ_inv[2 * 2] = {0};
-    real_t dp[2] = {0};
-
-    mat_transpose(J, 2, 2, Jt);
-    dot(Jt, 2, 2, J, 2, 2, JtJ);
-    pinv(JtJ, 2, 2, JtJ_inv);
-    dot3(JtJ_inv, 2, 2, Jt, 2, 2, e, 2, 1, dp);
-
-    // Update
-    p[0] += dp[0];
-    p[1] += dp[1];
-
-    // Calculate cost
-    // cost = e' * e
-    const real_t cost = e[0] * e[0] + e[1] * e[1];
-    if (cost < 1.0e-15) {
-      break;
-    }
-  }
-
-  // Return result
-  p_out[0] = p[0];
-  p_out[1] = p[1];
+  assert(params != NULL);
+  assert(p_in != NULL);
+  assert(p_out != NULL);
+  radtan4_undistort_inline(params, p_in[0], p_in[1], &p_out[0], &p_out[1]);
 }
 
 /**
@@ -6419,24 +7246,10 @@ void equi4_distort(const real_t params[4],
 void equi4_undistort(const real_t dist_params[4],
                      const real_t p_in[2],
                      real_t p_out[2]) {
-  const real_t k1 = dist_params[0];
-  const real_t k2 = dist_params[1];
-  const real_t k3 = dist_params[2];
-  const real_t k4 = dist_params[3];
-
-  const real_t thd = sqrt(p_in[0] * p_in[0] + p_in[1] * p_in[1]);
-  real_t th = thd; // Initial guess
-  for (int i = 20; i > 0; i--) {
-    const real_t th2 = th * th;
-    const real_t th4 = th2 * th2;
-    const real_t th6 = th4 * th2;
-    const real_t th8 = th4 * th4;
-    th = thd / (1 + k1 * th2 + k2 * th4 + k3 * th6 + k4 * th8);
-  }
-
-  const real_t scaling = tan(th) / thd;
-  p_out[0] = p_in[0] * scaling;
-  p_out[1] = p_in[1] * scaling;
+  assert(dist_params != NULL);
+  assert(p_in != NULL);
+  assert(p_out != NULL);
+  equi4_undistort_inline(dist_params, p_in[0], p_in[1], &p_out[0], &p_out[1]);
 }
 
 /**
@@ -6739,6 +7552,42 @@ void pinhole_radtan4_back_project(const real_t params[8],
   ray[2] = 1.0;
 }
 
+/**
+ * Project `n` 3D points `p_C` (n x 3) with Pinhole + Radial-Tangential, the
+ * image points are written to `z` (n x 2).
+ */
+void pinhole_radtan4_project_points(const real_t params[8],
+                                    const real_t *p_C,
+                                    const int n,
+                                    real_t *z) {
+  assert(params != NULL);
+  assert(p_C != NULL);
+  assert(z != NULL);
+
+#pragma omp simd
+  for (int i = 0; i < n; i++) {
+    pinhole_radtan4_project_inline(params, &p_C[i * 3], &z[i * 2]);
+  }
+}
+
+/**
+ * Undistort `n` image points `z_in` (n x 2) with Pinhole + Radial-Tangential,
+ * the undistorted image points are written to `z_out` (n x 2).
+ */
+void pinhole_radtan4_undistort_points(const real_t params[8],
+                                      const real_t *z_in,
+                                      const int n,
+                                      real_t *z_out) {
+  assert(params != NULL);
+  assert(z_in != NULL);
+  assert(z_out != NULL);
+
+#pragma omp simd
+  for (int i = 0; i < n; i++) {
+    pinhole_radtan4_undistort_inline(params, &z_in[i * 2], &z_out[i * 2]);
+  }
+}
+
 /**
  * Projection Jacobian of Pinhole + Radial-Tangential.
  */
@@ -6933,6 +7782,42 @@ void pinhole_equi4_back_project(const real_t params[8],
   ray[2] = 1.0;
 }
 
+/**
+ * Project `n` 3D points `p_C` (n x 3) with Pinhole + Equi-Distant, the image
+ * points are written to `z` (n x 2).
+ */
+void pinhole_equi4_project_points(const real_t params[8],
+                                  const real_t *p_C,
+                                  const int n,
+                                  real_t *z) {
+  assert(params != NULL);
+  assert(p_C != NULL);
+  assert(z != NULL);
+
+#pragma omp simd
+  for (int i = 0; i < n; i++) {
+    pinhole_equi4_project_inline(params, &p_C[i * 3], &z[i * 2]);
+  }
+}
+
+/**
+ * Undistort `n` image points `z_in` (n x 2) with Pinhole + Equi-Distant, the
+ * undistorted image points are written to `z_out` (n x 2).
+ */
+void pinhole_equi4_undistort_points(const real_t params[8],
+                                    const real_t *z_in,
+                                    const int n,
+                                    real_t *z_out) {
+  assert(params != NULL);
+  assert(z_in != NULL);
+  assert(z_out != NULL);
+
+#pragma omp simd
+  for (int i = 0; i < n; i++) {
+    pinhole_equi4_undistort_inline(params, &z_in[i * 2], &z_out[i * 2]);
+  }
+}
+
 /**
  * Projection Jacobian of Pinhole + Equi-Distant.
  */
@@ -7049,23 +7934,116 @@ void pinhole_equi4_params_jacobian(const real_t params[8],
 //////////////
 
 /**
- * Triangulate a single 3D point `p` observed by two different camera frames
- * represented by two 3x4 camera projection matrices `P_i` and `P_j`, and the
- * 2D image point correspondance `z_i` and `z_j`.
- */
-void linear_triangulation(const real_t P_i[3 * 4],
-                          const real_t P_j[3 * 4],
-                          const real_t z_i[2],
-                          const real_t z_j[2],
-                          real_t p[3]) {
-  assert(P_i != NULL);
-  assert(P_j != NULL);
-  assert(z_i != NULL);
-  assert(z_j != NULL);
-  assert(p != NULL);
-
+ * Square the symmetric 4x4 matrix with upper triangle `b` in place after
+ * normalizing it by its trace.
+ */
+static inline __attribute__((always_inline)) void sym4_square(real_t b[10]) {
+  const real_t t = b[0] + b[4] + b[7] + b[9];
+  const real_t k = (t > 0.0) ? 1.0 / t : 0.0;
+  const real_t b00 = b[0] * k, b01 = b[1] * k, b02 = b[2] * k;
+  const real_t b03 = b[3] * k, b11 = b[4] * k, b12 = b[5] * k;
+  const real_t b13 = b[6] * k, b22 = b[7] * k, b23 = b[8] * k;
+  const real_t b33 = b[9] * k;
+  b[0] = b00 * b00 + b01 * b01 + b02 * b02 + b03 * b03;
+  b[1] = b00 * b01 + b01 * b11 + b02 * b12 + b03 * b13;
+  b[2] = b00 * b02 + b01 * b12 + b02 * b22 + b03 * b23;
+  b[3] = b00 * b03 + b01 * b13 + b02 * b23 + b03 * b33;
+  b[4] = b01 * b01 + b11 * b11 + b12 * b12 + b13 * b13;
+  b[5] = b01 * b02 + b11 * b12 + b12 * b22 + b13 * b23;
+  b[6] = b01 * b03 + b11 * b13 + b12 * b23 + b13 * b33;
+  b[7] = b02 * b02 + b12 * b12 + b22 * b22 + b23 * b23;
+  b[8] = b02 * b03 + b12 * b13 + b22 * b23 + b23 * b33;
+  b[9] = b03 * b03 + b13 * b13 + b23 * b23 + b33 * b33;
+}
+
+/**
+ * Null vector `v` of the symmetric positive semi-definite 4x4 matrix with
+ * upper triangle `m` (row-major m00, m01, m02, m03, m11, m12, m13, m22, m23,
+ * m33). The adjugate of a rank-3 matrix is a scaled outer product of its null
+ * vector, so the dominant adjugate column is the answer. With noise the
+ * adjugate is raised to the 8th power by repeated squaring to converge to the
+ * smallest eigenvector. A matrix of rank 2 or lower returns a zero vector.
+ */
+static inline __attribute__((always_inline)) void
+sym4_null_vector(const real_t m[10], real_t v[4]) {
+  // Normalize by the trace to keep the cofactors in range
+  const real_t tr = m[0] + m[4] + m[7] + m[9];
+  const real_t k = (tr > 0.0) ? 1.0 / tr : 0.0;
+  const real_t a00 = m[0] * k, a01 = m[1] * k, a02 = m[2] * k;
+  const real_t a03 = m[3] * k, a11 = m[4] * k, a12 = m[5] * k;
+  const real_t a13 = m[6] * k, a22 = m[7] * k, a23 = m[8] * k;
+  const real_t a33 = m[9] * k;
+
+  // 2x2 sub-determinants of the top and bottom row pairs
+  const real_t s0 = a00 * a11 - a01 * a01;
+  const real_t s1 = a00 * a12 - a01 * a02;
+  const real_t s2 = a00 * a13 - a01 * a03;
+  const real_t s3 = a01 * a12 - a11 * a02;
+  const real_t s4 = a01 * a13 - a11 * a03;
+  const real_t s5 = a02 * a13 - a12 * a03;
+  const real_t c1 = a02 * a23 - a03 * a22;
+  const real_t c2 = a02 * a33 - a03 * a23;
+  const real_t c3 = a12 * a23 - a13 * a22;
+  const real_t c4 = a12 * a33 - a13 * a23;
+  const real_t c5 = a22 * a33 - a23 * a23;
+
+  // Adjugate (symmetric)
+  real_t b00 = a11 * c5 - a12 * c4 + a13 * c3;
+  real_t b01 = -a01 * c5 + a02 * c4 - a03 * c3;
+  real_t b02 = a13 * s5 - a23 * s4 + a33 * s3;
+  real_t b03 = -a12 * s5 + a22 * s4 - a23 * s3;
+  real_t b11 = a00 * c5 - a02 * c2 + a03 * c1;
+  real_t b12 = -a03 * s5 + a23 * s2 - a33 * s1;
+  real_t b13 = a02 * s5 - a22 * s2 + a23 * s1;
+  real_t b22 = a03 * s4 - a13 * s2 + a33 * s0;
+  real_t b23 = -a02 * s4 + a12 * s2 - a23 * s0;
+  real_t b33 = a02 * s3 - a12 * s1 + a22 * s0;
+
+  // Square the trace normalized adjugate twice, B^4 shrinks the other
+  // eigenvalues relative to the null vector's by (l_min / l_i)^4
+  real_t b[10] = {b00, b01, b02, b03, b11, b12, b13, b22, b23, b33};
+  sym4_square(b);
+  sym4_square(b);
+  b00 = b[0], b01 = b[1], b02 = b[2], b03 = b[3], b11 = b[4];
+  b12 = b[5], b13 = b[6], b22 = b[7], b23 = b[8], b33 = b[9];
+
+  // Start from the B^4 column with the largest diagonal
+  real_t x0 = b00, x1 = b01, x2 = b02, x3 = b03, d = b00;
+  x0 = (b11 > d) ? b01 : x0;
+  x1 = (b11 > d) ? b11 : x1;
+  x2 = (b11 > d) ? b12 : x2;
+  x3 = (b11 > d) ? b13 : x3;
+  d = (b11 > d) ? b11 : d;
+  x0 = (b22 > d) ? b02 : x0;
+  x1 = (b22 > d) ? b12 : x1;
+  x2 = (b22 > d) ? b22 : x2;
+  x3 = (b22 > d) ? b23 : x3;
+  d = (b22 > d) ? b22 : d;
+  x0 = (b33 > d) ? b03 : x0;
+  x1 = (b33 > d) ? b13 : x1;
+  x2 = (b33 > d) ? b23 : x2;
+  x3 = (b33 > d) ? b33 : x3;
+
+  // One more power iteration gives B^8
+  v[0] = b00 * x0 + b01 * x1 + b02 * x2 + b03 * x3;
+  v[1] = b01 * x0 + b11 * x1 + b12 * x2 + b13 * x3;
+  v[2] = b02 * x0 + b12 * x1 + b22 * x2 + b23 * x3;
+  v[3] = b03 * x0 + b13 * x1 + b23 * x2 + b33 * x3;
+}
+
+/**
+ * DLT triangulation kernel, forms the normal matrix AᵀA of the 4x4 DLT system
+ * and solves for its null vector without heap allocations.
+ * @returns 0 for success, -1 if the point is degenerate or at infinity
+ */
+static inline __attribute__((always_inline)) int
+linear_triangulation_kernel(const real_t P_i[3 * 4],
+                            const real_t P_j[3 * 4],
+                            const real_t z_i[2],
+                            const real_t z_j[2],
+                            real_t p[3]) {
   // Form A matrix
-  real_t A[4 * 4] = {0};
+  real_t A[4 * 4];
   // -- ROW 1
   A[0] = -P_i[4] + P_i[8] * z_i[1];
   A[1] = -P_i[5] + P_i[9] * z_i[1];
@@ -7087,38 +8065,123 @@ void linear_triangulation(const real_t P_i[3 * 4],
   A[14] = P_j[10] * z_j[0] - P_j[2];
   A[15] = P_j[11] * z_j[0] - P_j[3];
 
-  // Form A_t
-  real_t A_t[4 * 4] = {0};
-  mat_transpose(A, 4, 4, A_t);
-
-  // SVD
-  real_t A2[4 * 4] = {0};
-  real_t s[4] = {0};
-  real_t U[4 * 4] = {0};
-  real_t V[4 * 4] = {0};
-  dot(A_t, 4, 4, A, 4, 4, A2);
-  svd(A2, 4, 4, U, s, V);
-
-  // Get best row of V_t
-  real_t min_s = s[0];
-  real_t x = V[0];
-  real_t y = V[4];
-  real_t z = V[8];
-  real_t w = V[12];
-  for (int i = 1; i < 4; i++) {
-    if (s[i] < min_s) {
-      min_s = s[i];
-      x = V[i + 0];
-      y = V[i + 4];
-      z = V[i + 8];
-      w = V[i + 12];
-    }
-  }
+  // Form upper triangle of AᵀA
+#define ATA(R, C)                                                              \
+  (A[R] * A[C] + A[4 + R] * A[4 + C] + A[8 + R] * A[8 + C] +                   \
+   A[12 + R] * A[12 + C])
+  const real_t m[10] = {ATA(0, 0),
+                        ATA(0, 1),
+                        ATA(0, 2),
+                        ATA(0, 3),
+                        ATA(1, 1),
+                        ATA(1, 2),
+                        ATA(1, 3),
+                        ATA(2, 2),
+                        ATA(2, 3),
+                        ATA(3, 3)};
+#undef ATA
 
   // Normalize the scale to obtain the 3D point
-  p[0] = x / w;
-  p[1] = y / w;
-  p[2] = z / w;
+  real_t v[4];
+  sym4_null_vector(m, v);
+  const real_t w = (v[3] != 0.0) ? v[3] : 1.0;
+  p[0] = v[0] / w;
+  p[1] = v[1] / w;
+  p[2] = v[2] / w;
+
+  const int ok = (v[3] != 0.0) && isfinite(p[0]) && isfinite(p[1]) &&
+                 isfinite(p[2]);
+  return ok ? 0 : -1;
+}
+
+/**
+ * Triangulate a single 3D point `p` observed by two different camera frames
+ * represented by two 3x4 camera projection matrices `P_i` and `P_j`, and the
+ * 2D image point correspondance `z_i` and `z_j`.
+ */
+void linear_triangulation(const real_t P_i[3 * 4],
+                          const real_t P_j[3 * 4],
+                          const real_t z_i[2],
+                          const real_t z_j[2],
+                          real_t p[3]) {
+  assert(P_i != NULL);
+  assert(P_j != NULL);
+  assert(z_i != NULL);
+  assert(z_j != NULL);
+  assert(p != NULL);
+  linear_triangulation_kernel(P_i, P_j, z_i, z_j, p);
+}
+
+typedef struct triangulation_worker_t {
+  const real_t *P_i;
+  const real_t *P_j;
+  const real_t *z_i;
+  const real_t *z_j;
+  int n;
+  real_t *points;
+  int *status;
+} triangulation_worker_t;
+
+/**
+ * Triangulate block `block` of `TRIANGULATION_BLOCK` points.
+ */
+static void triangulation_block(void *data, const int block, const int thread) {
+  UNUSED(thread);
+  triangulation_worker_t *worker = (triangulation_worker_t *) data;
+  const real_t *P_i = worker->P_i;
+  const real_t *P_j = worker->P_j;
+  const real_t *z_i = worker->z_i;
+  const real_t *z_j = worker->z_j;
+  real_t *points = worker->points;
+  int *status = worker->status;
+  const int i_s = block * TRIANGULATION_BLOCK;
+  const int i_e = MIN(i_s + TRIANGULATION_BLOCK, worker->n);
+
+#pragma omp simd
+  for (int i = i_s; i < i_e; i++) {
+    status[i] = linear_triangulation_kernel(P_i,
+                                            P_j,
+                                            z_i + i * 2,
+                                            z_j + i * 2,
+                                            points + i * 3);
+  }
+}
+
+/**
+ * Triangulate `n` points `points` from undistorted image point correspondances
+ * `z_i` and `z_j` observed by projection matrices `P_i` and `P_j`. Points are
+ * processed in SIMD lanes and blocks of `TRIANGULATION_BLOCK` are split
+ * across `num_threads` threads (all cores if `num_threads` <= 0). `status[i]`
+ * is set to -1 for degenerate points.
+ */
+void linear_triangulation_batch(const real_t P_i[3 * 4],
+                                const real_t P_j[3 * 4],
+                                const real_t *z_i,
+                                const real_t *z_j,
+                                const int n,
+                                const int num_threads,
+                                real_t *points,
+                                int *status) {
+  assert(P_i != NULL);
+  assert(P_j != NULL);
+  assert(z_i != NULL);
+  assert(z_j != NULL);
+  assert(points != NULL);
+  assert(status != NULL);
+  if (n <= 0) {
+    return;
+  }
+
+  // Triangulate
+  const int num_blocks = (n + TRIANGULATION_BLOCK - 1) / TRIANGULATION_BLOCK;
+  triangulation_worker_t worker = {.P_i = P_i,
+                                   .P_j = P_j,
+                                   .z_i = z_i,
+                                   .z_j = z_j,
+                                   .n = n,
+                                   .points = points,
+                                   .status = status};
+  parallel_for(num_blocks, num_threads, triangulation_block, &worker);
 }
 
 /**
@@ -8307,6 +9370,35 @@ void mav_model_telem_update(mav_model_telem_t *telem,
   telem->vz[idx] = mav->x[11];
 }
 
+/**
+ * Save MAV model telemetry to telemetry log at `save_path`.
+ */
+int mav_model_telem_save(const mav_model_telem_t *telem,
+                         const char *save_path) {
+  tlog_writer_t *writer = tlog_writer_malloc(save_path);
+  if (writer == NULL) {
+    return -1;
+  }
+
+  const int att = tlog_writer_channel(writer, "attitude", TLOG_REAL, 3);
+  const int rate = tlog_writer_channel(writer, "angular_rate", TLOG_REAL, 3);
+  const int pos = tlog_writer_channel(writer, "position", TLOG_REAL, 3);
+  const int vel = tlog_writer_channel(writer, "velocity", TLOG_REAL, 3);
+  for (int k = 0; k < telem->num_events; k++) {
+    const timestamp_t ts = sec2ts(telem->time[k]);
+    const real_t att_k[3] = {telem->roll[k], telem->pitch[k], telem->yaw[k]};
+    const real_t rate_k[3] = {telem->wx[k], telem->wy[k], telem->wz[k]};
+    const real_t pos_k[3] = {telem->x[k], telem->y[k], telem->z[k]};
+    const real_t vel_k[3] = {telem->vx[k], telem->vy[k], telem->vz[k]};
+    tlog_write(writer, att, ts, att_k);
+    tlog_write(writer, rate, ts, rate_k);
+    tlog_write(writer, pos, ts, pos_k);
+    tlog_write(writer, vel, ts, vel_k);
+  }
+
+  return tlog_writer_close(writer);
+}
+
 void mav_model_telem_plot(const mav_model_telem_t *telem) {
   // Plot
   FILE *g = gnuplot_init();
@@ -8633,6 +9725,536 @@ int mav_waypoints_update(mav_waypoints_t *wps,
   return 0;
 }
 
+/**
+ * Malloc batch simulator for `num_mavs` MAVs. Telemetry is recorded every
+ * `telem_every` steps for up to `telem_capacity` samples (0 to disable).
+ * Every MAV starts with the default controllers, its model must be set with
+ * `mav_batch_set_model()` before running.
+ */
+mav_batch_t *mav_batch_malloc(const int num_mavs,
+                              const int telem_every,
+                              const int telem_capacity) {
+  assert(num_mavs > 0);
+  // Pad fields by a cache line, with a power of two stride every field of a
+  // block would map to the same cache set
+  const int num_blocks = (num_mavs + MAV_BATCH_BLOCK - 1) / MAV_BATCH_BLOCK;
+  const int N = num_blocks * MAV_BATCH_BLOCK + 8;
+  const int P = MAV_BATCH_NUM_PIDS;
+
+  mav_batch_t *batch = MALLOC(mav_batch_t, 1);
+  batch->num_mavs = num_mavs;
+  batch->stride = N;
+  batch->num_threads = 0;
+  batch->time = 0.0;
+  batch->num_steps = 0;
+
+  // Model
+  batch->x = CALLOC(real_t, 12 * N);
+  batch->inertia = CALLOC(real_t, 3 * N);
+  batch->kr = CALLOC(real_t, N);
+  batch->kt = CALLOC(real_t, N);
+  batch->l = CALLOC(real_t, N);
+  batch->d = CALLOC(real_t, N);
+  batch->m = CALLOC(real_t, N);
+  batch->g = CALLOC(real_t, N);
+
+  // Disturbances
+  batch->force = CALLOC(real_t, 3 * N);
+  batch->torque = CALLOC(real_t, 3 * N);
+
+  // Controllers
+  batch->sp = CALLOC(real_t, 4 * N);
+  batch->gains = CALLOC(real_t, P * 3 * N);
+  batch->error_prev = CALLOC(real_t, P * N);
+  batch->error_sum = CALLOC(real_t, P * N);
+  batch->ctrl_dt = CALLOC(real_t, 3 * N);
+  batch->ctrl_u = CALLOC(real_t, 3 * 4 * N);
+
+  mav_att_ctrl_t att_ctrl;
+  mav_vel_ctrl_t vel_ctrl;
+  mav_pos_ctrl_t pos_ctrl;
+  mav_att_ctrl_setup(&att_ctrl);
+  mav_vel_ctrl_setup(&vel_ctrl);
+  mav_pos_ctrl_setup(&pos_ctrl);
+  for (int i = 0; i < num_mavs; i++) {
+    mav_batch_set_ctrl(batch, i, &att_ctrl, &vel_ctrl, &pos_ctrl);
+  }
+
+  // Telemetry
+  batch->telem_every = MAX(telem_every, 1);
+  batch->telem_capacity = MAX(telem_capacity, 0);
+  batch->num_telem = 0;
+  batch->telem_time = NULL;
+  batch->telem = NULL;
+  if (batch->telem_capacity > 0) {
+    const size_t n = (size_t) batch->telem_capacity * 12 * num_mavs;
+    batch->telem_time = CALLOC(real_t, batch->telem_capacity);
+    batch->telem = CALLOC(real_t, n);
+  }
+
+  return batch;
+}
+
+/**
+ * Free batch simulator.
+ */
+void mav_batch_free(mav_batch_t *batch) {
+  if (batch == NULL) {
+    return;
+  }
+
+  free(batch->x);
+  free(batch->inertia);
+  free(batch->kr);
+  free(batch->kt);
+  free(batch->l);
+  free(batch->d);
+  free(batch->m);
+  free(batch->g);
+  free(batch->force);
+  free(batch->torque);
+  free(batch->sp);
+  free(batch->gains);
+  free(batch->error_prev);
+  free(batch->error_sum);
+  free(batch->ctrl_dt);
+  free(batch->ctrl_u);
+  free(batch->telem_time);
+  free(batch->telem);
+  free(batch);
+}
+
+/**
+ * Set state and model parameters of MAV `i`.
+ */
+void mav_batch_set_model(mav_batch_t *batch,
+                         const int i,
+                         const mav_model_t *mav) {
+  assert(batch != NULL);
+  assert(i >= 0 && i < batch->num_mavs);
+  assert(mav != NULL);
+  const int N = batch->stride;
+
+  for (int k = 0; k < 12; k++) {
+    batch->x[k * N + i] = mav->x[k];
+  }
+  for (int k = 0; k < 3; k++) {
+    batch->inertia[k * N + i] = mav->inertia[k];
+  }
+  batch->kr[i] = mav->kr;
+  batch->kt[i] = mav->kt;
+  batch->l[i] = mav->l;
+  batch->d[i] = mav->d;
+  batch->m[i] = mav->m;
+  batch->g[i] = mav->g;
+}
+
+/**
+ * Get state and model parameters of MAV `i`.
+ */
+void mav_batch_get_model(const mav_batch_t *batch,
+                         const int i,
+                         mav_model_t *mav) {
+  assert(batch != NULL);
+  assert(i >= 0 && i < batch->num_mavs);
+  assert(mav != NULL);
+  const int N = batch->stride;
+
+  for (int k = 0; k < 12; k++) {
+    mav->x[k] = batch->x[k * N + i];
+  }
+  for (int k = 0; k < 3; k++) {
+    mav->inertia[k] = batch->inertia[k * N + i];
+  }
+  mav->kr = batch->kr[i];
+  mav->kt = batch->kt[i];
+  mav->l = batch->l[i];
+  mav->d = batch->d[i];
+  mav->m = batch->m[i];
+  mav->g = batch->g[i];
+}
+
+/**
+ * Set controllers of MAV `i`, gains and controller states are copied.
+ */
+void mav_batch_set_ctrl(mav_batch_t *batch,
+                        const int i,
+                        const mav_att_ctrl_t *att_ctrl,
+                        const mav_vel_ctrl_t *vel_ctrl,
+                        const mav_pos_ctrl_t *pos_ctrl) {
+  assert(batch != NULL);
+  assert(i >= 0 && i < batch->num_mavs);
+  assert(att_ctrl && vel_ctrl && pos_ctrl);
+  const int N = batch->stride;
+
+  const pid_ctrl_t *pids[MAV_BATCH_NUM_PIDS] = {&att_ctrl->roll,
+                                                &att_ctrl->pitch,
+                                                &att_ctrl->yaw,
+                                                &vel_ctrl->vx,
+                                                &vel_ctrl->vy,
+                                                &vel_ctrl->vz,
+                                                &pos_ctrl->x,
+                                                &pos_ctrl->y,
+                                                &pos_ctrl->z};
+  for (int k = 0; k < MAV_BATCH_NUM_PIDS; k++) {
+    batch->gains[(k * 3 + 0) * N + i] = pids[k]->k_p;
+    batch->gains[(k * 3 + 1) * N + i] = pids[k]->k_i;
+    batch->gains[(k * 3 + 2) * N + i] = pids[k]->k_d;
+    batch->error_prev[k * N + i] = pids[k]->error_prev;
+    batch->error_sum[k * N + i] = pids[k]->error_sum;
+  }
+
+  batch->ctrl_dt[0 * N + i] = att_ctrl->dt;
+  batch->ctrl_dt[1 * N + i] = vel_ctrl->dt;
+  batch->ctrl_dt[2 * N + i] = pos_ctrl->dt;
+  for (int k = 0; k < 4; k++) {
+    batch->ctrl_u[(0 * 4 + k) * N + i] = att_ctrl->u[k];
+    batch->ctrl_u[(1 * 4 + k) * N + i] = vel_ctrl->u[k];
+    batch->ctrl_u[(2 * 4 + k) * N + i] = pos_ctrl->u[k];
+  }
+}
+
+/**
+ * Set constant external force `force` (world frame) and torque `torque`
+ * (body frame) acting on MAV `i`.
+ */
+void mav_batch_set_disturbance(mav_batch_t *batch,
+                               const int i,
+                               const real_t force[3],
+                               const real_t torque[3]) {
+  assert(batch != NULL);
+  assert(i >= 0 && i < batch->num_mavs);
+  const int N = batch->stride;
+
+  for (int k = 0; k < 3; k++) {
+    batch->force[k * N + i] = (force) ? force[k] : 0.0;
+    batch->torque[k * N + i] = (torque) ? torque[k] : 0.0;
+  }
+}
+
+/**
+ * Set position and yaw setpoint `sp` of MAV `i`.
+ */
+void mav_batch_set_setpoint(mav_batch_t *batch,
+                            const int i,
+                            const real_t sp[4]) {
+  assert(batch != NULL);
+  assert(i >= 0 && i < batch->num_mavs);
+  assert(sp != NULL);
+  const int N = batch->stride;
+
+  for (int k = 0; k < 4; k++) {
+    batch->sp[k * N + i] = sp[k];
+  }
+}
+
+/**
+ * Update PID of MAV `i` as `pid_ctrl_update()` does, the controller state is
+ * only updated if `run` is set. `gains`, `error_prev` and `error_sum` point
+ * to the PID's fields, `N` is the field stride.
+ */
+static inline real_t mav_batch_pid(const real_t *gains,
+                                   real_t *error_prev,
+                                   real_t *error_sum,
+                                   const int N,
+                                   const int i,
+                                   const real_t setpoint,
+                                   const real_t input,
+                                   const real_t dt,
+                                   const int run) {
+  const real_t error = setpoint - input;
+  const real_t sum = error_sum[i] + error * dt;
+  const real_t error_p = gains[0 * N + i] * error;
+  const real_t error_i = gains[1 * N + i] * sum;
+  const real_t error_d = gains[2 * N + i] * (error - error_prev[i]) / dt;
+  error_sum[i] = (run) ? sum : error_sum[i];
+  error_prev[i] = (run) ? error : error_prev[i];
+  return error_p + error_i + error_d;
+}
+
+/**
+ * Step MAVs `i_s` to `i_e` (exclusive, at most `MAV_BATCH_BLOCK`) by `dt`:
+ * position, velocity and attitude controllers followed by the model update,
+ * mirroring `mav_pos_ctrl_update()`, `mav_vel_ctrl_update()`,
+ * `mav_att_ctrl_update()` and `mav_model_update()`.
+ *
+ * Each stage is a branch-free loop over the MAVs, controllers that are not
+ * due this step compute their output and discard it, so that the loops can
+ * be vectorized.
+ */
+static void mav_batch_step(mav_batch_t *batch,
+                           const int i_s,
+                           const int i_e,
+                           const real_t dt) {
+  const int N = batch->stride;
+  const int P = N * 3;
+  real_t *x = batch->x;
+  real_t *ctrl_dt = batch->ctrl_dt;
+  real_t *u_att = batch->ctrl_u + 0 * 4 * N;
+  real_t *u_vel = batch->ctrl_u + 1 * 4 * N;
+  real_t *u_pos = batch->ctrl_u + 2 * 4 * N;
+  const real_t *sp = batch->sp;
+  const real_t *gains = batch->gains;
+  real_t *e_prev = batch->error_prev;
+  real_t *e_sum = batch->error_sum;
+
+  // Attitude trigonometry, offset by i_s
+  real_t cph[MAV_BATCH_BLOCK];
+  real_t sph[MAV_BATCH_BLOCK];
+  real_t cth[MAV_BATCH_BLOCK];
+  real_t sth[MAV_BATCH_BLOCK];
+  real_t cps[MAV_BATCH_BLOCK];
+  real_t sps[MAV_BATCH_BLOCK];
+#pragma omp simd
+  for (int i = i_s; i < i_e; i++) {
+    const int j = i - i_s;
+    cph[j] = cos(x[0 * N + i]);
+    sph[j] = sin(x[0 * N + i]);
+    cth[j] = cos(x[1 * N + i]);
+    sth[j] = sin(x[1 * N + i]);
+    cps[j] = cos(x[2 * N + i]);
+    sps[j] = sin(x[2 * N + i]);
+  }
+
+  // Position controller
+#pragma omp simd
+  for (int i = i_s; i < i_e; i++) {
+    const int j = i - i_s;
+    const real_t cdt = ctrl_dt[2 * N + i] + dt;
+    const int run = cdt >= 0.01;
+    const real_t ex = sp[0 * N + i] - x[6 * N + i];
+    const real_t ey = sp[1 * N + i] - x[7 * N + i];
+    const real_t ez = sp[2 * N + i] - x[8 * N + i];
+    const real_t ex_S = cps[j] * ex + sps[j] * ey;
+    const real_t ey_S = -sps[j] * ex + cps[j] * ey;
+    const real_t vx =
+        mav_batch_pid(gains + 6 * P, e_prev + 6 * N, e_sum + 6 * N, N, i,
+                      ex_S, 0.0, cdt, run);
+    const real_t vy =
+        mav_batch_pid(gains + 7 * P, e_prev + 7 * N, e_sum + 7 * N, N, i,
+                      ey_S, 0.0, cdt, run);
+    const real_t vz =
+        mav_batch_pid(gains + 8 * P, e_prev + 8 * N, e_sum + 8 * N, N, i,
+                      ez, 0.0, cdt, run);
+    u_pos[0 * N + i] = (run) ? clip_value(vx, -2.5, 2.5) : u_pos[0 * N + i];
+    u_pos[1 * N + i] = (run) ? clip_value(vy, -2.5, 2.5) : u_pos[1 * N + i];
+    u_pos[2 * N + i] = (run) ? clip_value(vz, -5.0, 5.0) : u_pos[2 * N + i];
+    u_pos[3 * N + i] = (run) ? sp[3 * N + i] : u_pos[3 * N + i];
+    ctrl_dt[2 * N + i] = (run) ? 0.0 : cdt;
+  }
+
+  // Velocity controller
+  const real_t rp_max = deg2rad(20.0);
+#pragma omp simd
+  for (int i = i_s; i < i_e; i++) {
+    const int j = i - i_s;
+    const real_t cdt = ctrl_dt[1 * N + i] + dt;
+    const int run = cdt >= 0.001;
+    const real_t ex = u_pos[0 * N + i] - x[9 * N + i];
+    const real_t ey = u_pos[1 * N + i] - x[10 * N + i];
+    const real_t ez = u_pos[2 * N + i] - x[11 * N + i];
+    const real_t ex_S = cps[j] * ex + sps[j] * ey;
+    const real_t ey_S = -sps[j] * ex + cps[j] * ey;
+    const real_t r =
+        -mav_batch_pid(gains + 4 * P, e_prev + 4 * N, e_sum + 4 * N, N, i,
+                       ey_S, 0.0, dt, run);
+    const real_t p =
+        mav_batch_pid(gains + 3 * P, e_prev + 3 * N, e_sum + 3 * N, N, i,
+                      ex_S, 0.0, dt, run);
+    const real_t t =
+        0.5 + mav_batch_pid(gains + 5 * P, e_prev + 5 * N, e_sum + 5 * N, N,
+                            i, ez, 0.0, dt, run);
+    const real_t u0 = clip_value(r, -rp_max, rp_max);
+    const real_t u1 = clip_value(p, -rp_max, rp_max);
+    u_vel[0 * N + i] = (run) ? u0 : u_vel[0 * N + i];
+    u_vel[1 * N + i] = (run) ? u1 : u_vel[1 * N + i];
+    u_vel[2 * N + i] = (run) ? u_pos[3 * N + i] : u_vel[2 * N + i];
+    u_vel[3 * N + i] = (run) ? clip_value(t, 0.0, 1.0) : u_vel[3 * N + i];
+    ctrl_dt[1 * N + i] = (run) ? 0.0 : cdt;
+  }
+
+  // Attitude controller
+#pragma omp simd
+  for (int i = i_s; i < i_e; i++) {
+    const real_t cdt = ctrl_dt[0 * N + i] + dt;
+    const int run = cdt >= 0.001;
+    real_t e_yaw = u_vel[2 * N + i] - x[2 * N + i];
+    e_yaw -= 2.0 * M_PI * nearbyint(e_yaw / (2.0 * M_PI));
+    const real_t r =
+        mav_batch_pid(gains + 0 * P, e_prev + 0 * N, e_sum + 0 * N, N, i,
+                      u_vel[0 * N + i], x[0 * N + i], cdt, run);
+    const real_t p =
+        mav_batch_pid(gains + 1 * P, e_prev + 1 * N, e_sum + 1 * N, N, i,
+                      u_vel[1 * N + i], x[1 * N + i], cdt, run);
+    const real_t y =
+        mav_batch_pid(gains + 2 * P, e_prev + 2 * N, e_sum + 2 * N, N, i,
+                      e_yaw, 0.0, cdt, run);
+    const real_t t = clip_value(u_vel[3 * N + i], 0.0, 1.0);
+    const real_t u0 = clip_value(-p - y + t, 0.0, 1.0);
+    const real_t u1 = clip_value(-r + y + t, 0.0, 1.0);
+    const real_t u2 = clip_value(p - y + t, 0.0, 1.0);
+    const real_t u3 = clip_value(r + y + t, 0.0, 1.0);
+    u_att[0 * N + i] = (run) ? u0 : u_att[0 * N + i];
+    u_att[1 * N + i] = (run) ? u1 : u_att[1 * N + i];
+    u_att[2 * N + i] = (run) ? u2 : u_att[2 * N + i];
+    u_att[3 * N + i] = (run) ? u3 : u_att[3 * N + i];
+    ctrl_dt[0 * N + i] = (run) ? 0.0 : cdt;
+  }
+
+  // Model
+#pragma omp simd
+  for (int i = i_s; i < i_e; i++) {
+    const int j = i - i_s;
+
+    // -- Constants
+    const real_t Ix = batch->inertia[0 * N + i];
+    const real_t Iy = batch->inertia[1 * N + i];
+    const real_t Iz = batch->inertia[2 * N + i];
+    const real_t kr = batch->kr[i];
+    const real_t kt = batch->kt[i];
+    const real_t l = batch->l[i];
+    const real_t d = batch->d[i];
+    const real_t m = batch->m[i];
+    const real_t mr = 1.0 / m;
+    const real_t g = batch->g[i];
+
+    // -- Convert motor inputs to torques and total thrust
+    const real_t mt = 5.0; // Max-thrust
+    const real_t s0 = mt * u_att[0 * N + i];
+    const real_t s1 = mt * u_att[1 * N + i];
+    const real_t s2 = mt * u_att[2 * N + i];
+    const real_t s3 = mt * u_att[3 * N + i];
+    const real_t tauf = s0 + s1 + s2 + s3;
+    const real_t taup = -l * s1 + l * s3;
+    const real_t tauq = -l * s0 + l * s2;
+    const real_t taur = -d * s0 + d * s1 - d * s2 + d * s3;
+
+    // -- Disturbances
+    const real_t ap = batch->torque[0 * N + i] / Ix;
+    const real_t aq = batch->torque[1 * N + i] / Iy;
+    const real_t ar = batch->torque[2 * N + i] / Iz;
+    const real_t ax = batch->force[0 * N + i] * mr;
+    const real_t ay = batch->force[1 * N + i] * mr;
+    const real_t az = batch->force[2 * N + i] * mr;
+
+    // -- Attitude
+    const real_t p = x[3 * N + i];
+    const real_t q = x[4 * N + i];
+    const real_t r = x[5 * N + i];
+    const real_t tth = sth[j] / cth[j];
+    x[0 * N + i] += (p + q * sph[j] * tth + r * cph[j] * tth) * dt;
+    x[1 * N + i] += (q * cph[j] - r * sph[j]) * dt;
+    x[2 * N + i] += ((1 / cth[j]) * (q * sph[j] + r * cph[j])) * dt;
+
+    // -- Angular velocity
+    const real_t Iyz = (Iz - Iy) / Ix;
+    const real_t Izx = (Ix - Iz) / Iy;
+    const real_t Ixy = (Iy - Ix) / Iz;
+    x[3 * N + i] += (-Iyz * q * r - (kr * p / Ix) + (1 / Ix) * taup + ap) * dt;
+    x[4 * N + i] += (-Izx * p * r - (kr * q / Iy) + (1 / Iy) * tauq + aq) * dt;
+    x[5 * N + i] += (-Ixy * p * q - (kr * r / Iz) + (1 / Iz) * taur + ar) * dt;
+
+    // -- Position
+    const real_t vx = x[9 * N + i];
+    const real_t vy = x[10 * N + i];
+    const real_t vz = x[11 * N + i];
+    x[6 * N + i] += vx * dt;
+    x[7 * N + i] += vy * dt;
+    x[8 * N + i] += vz * dt;
+
+    // -- Linear velocity
+    const real_t Rx = cph[j] * sth[j] * cps[j] + sph[j] * sps[j];
+    const real_t Ry = cph[j] * sth[j] * sps[j] - sph[j] * cps[j];
+    const real_t Rz = cph[j] * cth[j];
+    x[9 * N + i] += ((-kt * vx / m) + mr * Rx * tauf + ax) * dt;
+    x[10 * N + i] += ((-kt * vy / m) + mr * Ry * tauf + ay) * dt;
+    x[11 * N + i] += (-(kt * vz / m) + mr * Rz * tauf - g + az) * dt;
+  }
+}
+
+typedef struct mav_batch_worker_t {
+  mav_batch_t *batch;
+  int num_steps;
+  real_t dt;
+} mav_batch_worker_t;
+
+/**
+ * Simulate block `block` of MAVs for all steps, blocks share no state.
+ */
+static void mav_batch_block(void *data, const int block, const int thread) {
+  UNUSED(thread);
+  mav_batch_worker_t *worker = (mav_batch_worker_t *) data;
+  mav_batch_t *batch = worker->batch;
+  const int N = batch->num_mavs;
+  const int step_s = batch->num_steps;
+  const int i_s = block * MAV_BATCH_BLOCK;
+  const int i_e = MIN(i_s + MAV_BATCH_BLOCK, N);
+
+  for (int step = step_s; step < step_s + worker->num_steps; step++) {
+    mav_batch_step(batch, i_s, i_e, worker->dt);
+
+    // Record telemetry
+    const int s = step / batch->telem_every;
+    if ((step % batch->telem_every) || s >= batch->telem_capacity) {
+      continue;
+    }
+    for (int k = 0; k < 12; k++) {
+      real_t *dst = batch->telem + ((size_t) s * 12 + k) * N;
+      const real_t *src = batch->x + k * batch->stride;
+      for (int i = i_s; i < i_e; i++) {
+        dst[i] = src[i];
+      }
+    }
+  }
+}
+
+/**
+ * Run the batch simulator for `num_steps` steps of `dt` seconds. MAVs are
+ * split into blocks of `MAV_BATCH_BLOCK` and simulated in parallel.
+ * Telemetry is recorded after every `telem_every`-th step until the arena is
+ * full.
+ */
+void mav_batch_run(mav_batch_t *batch, const int num_steps, const real_t dt) {
+  assert(batch != NULL);
+  assert(dt > 0.0);
+  if (num_steps <= 0) {
+    return;
+  }
+
+  // Simulate
+  const int num_blocks =
+      (batch->num_mavs + MAV_BATCH_BLOCK - 1) / MAV_BATCH_BLOCK;
+  mav_batch_worker_t worker = {.batch = batch,
+                               .num_steps = num_steps,
+                               .dt = dt};
+  parallel_for(num_blocks, batch->num_threads, mav_batch_block, &worker);
+
+  // Telemetry timestamps
+  for (int step = batch->num_steps; step < batch->num_steps + num_steps;
+       step++) {
+    const int s = step / batch->telem_every;
+    if ((step % batch->telem_every) || s >= batch->telem_capacity) {
+      continue;
+    }
+    batch->telem_time[s] = batch->time + (step - batch->num_steps + 1) * dt;
+    batch->num_telem = s + 1;
+  }
+  batch->time += num_steps * dt;
+  batch->num_steps += num_steps;
+}
+
+/**
+ * Return telemetry of state `k` at sample `s` for all MAVs (`num_mavs`).
+ */
+const real_t *mav_batch_telem(const mav_batch_t *batch,
+                              const int s,
+                              const int k) {
+  assert(batch != NULL);
+  assert(s >= 0 && s < batch->num_telem);
+  assert(k >= 0 && k < 12);
+  return batch->telem + ((size_t) s * 12 + k) * batch->num_mavs;
+}
+
 /******************************************************************************
  * SENSOR FUSION
  *****************************************************************************/
@@ -9632,6 +11254,61 @@ void fiducial_buffer_add(fiducial_buffer_t *buf,
 // CAMERA-PARAMETERS //
 ///////////////////////
 
+/**
+ * Resolve camera model id from projection and distortion model names.
+ * Returns -1 if the model is not supported.
+ */
+int camera_model_id(const char *proj_model, const char *dist_model) {
+  assert(proj_model != NULL);
+  assert(dist_model != NULL);
+
+  if (streqs(proj_model, "pinhole") && streqs(dist_model, "radtan4")) {
+    return CAMERA_PINHOLE_RADTAN4;
+  } else if (streqs(proj_model, "pinhole") && streqs(dist_model, "equi4")) {
+    return CAMERA_PINHOLE_EQUI4;
+  }
+
+  return -1;
+}
+
+/**
+ * Projection Jacobian of camera `model` w.r.t. 3D point `p_C`.
+ */
+void camera_model_project_jacobian(const int model,
+                                   const real_t *params,
+                                   const real_t p_C[3],
+                                   real_t J[2 * 3]) {
+  switch (model) {
+    case CAMERA_PINHOLE_RADTAN4:
+      pinhole_radtan4_project_jacobian(params, p_C, J);
+      break;
+    case CAMERA_PINHOLE_EQUI4:
+      pinhole_equi4_project_jacobian(params, p_C, J);
+      break;
+    default:
+      FATAL("Unknown camera model [%d]!\n", model);
+  }
+}
+
+/**
+ * Parameter Jacobian of camera `model` evaluated at 3D point `p_C`.
+ */
+void camera_model_params_jacobian(const int model,
+                                  const real_t *params,
+                                  const real_t p_C[3],
+                                  real_t J[2 * 8]) {
+  switch (model) {
+    case CAMERA_PINHOLE_RADTAN4:
+      pinhole_radtan4_params_jacobian(params, p_C, J);
+      break;
+    case CAMERA_PINHOLE_EQUI4:
+      pinhole_equi4_params_jacobian(params, p_C, J);
+      break;
+    default:
+      FATAL("Unknown camera model [%d]!\n", model);
+  }
+}
+
 /**
  * Setup camera parameters
  */
@@ -9666,16 +11343,20 @@ void camera_params_setup(camera_params_t *camera,
   camera->data[6] = data[6];
   camera->data[7] = data[7];
 
-  if (streqs(proj_model, "pinhole") && streqs(dist_model, "radtan4")) {
-    camera->proj_func = pinhole_radtan4_project;
-    camera->back_proj_func = pinhole_radtan4_back_project;
-    camera->undistort_func = pinhole_radtan4_undistort;
-  } else if (streqs(proj_model, "pinhole") && streqs(dist_model, "equi4")) {
-    camera->proj_func = pinhole_equi4_project;
-    camera->back_proj_func = pinhole_equi4_back_project;
-    camera->undistort_func = pinhole_equi4_undistort;
-  } else {
-    FATAL("Unknown [%s-%s] camera model!\n", proj_model, dist_model);
+  camera->model = camera_model_id(proj_model, dist_model);
+  switch (camera->model) {
+    case CAMERA_PINHOLE_RADTAN4:
+      camera->proj_func = pinhole_radtan4_project;
+      camera->back_proj_func = pinhole_radtan4_back_project;
+      camera->undistort_func = pinhole_radtan4_undistort;
+      break;
+    case CAMERA_PINHOLE_EQUI4:
+      camera->proj_func = pinhole_equi4_project;
+      camera->back_proj_func = pinhole_equi4_back_project;
+      camera->undistort_func = pinhole_equi4_undistort;
+      break;
+    default:
+      FATAL("Unknown [%s-%s] camera model!\n", proj_model, dist_model);
   }
 }
 
@@ -9691,6 +11372,7 @@ void camera_params_copy(const camera_params_t *src, camera_params_t *dst) {
   dst->resolution[1] = src->resolution[1];
   strcpy(dst->proj_model, src->proj_model);
   strcpy(dst->dist_model, src->dist_model);
+  dst->model = src->model;
   dst->data[0] = src->data[0];
   dst->data[1] = src->data[1];
   dst->data[2] = src->data[2];
@@ -9744,10 +11426,32 @@ void camera_project(const camera_params_t *camera,
                     const real_t p_C[3],
                     real_t z[2]) {
   assert(camera != NULL);
-  assert(camera->proj_func != NULL);
   assert(p_C != NULL);
   assert(z != NULL);
-  camera->proj_func(camera->data, p_C, z);
+  camera_model_project(camera->model, camera->data, p_C, z);
+}
+
+/**
+ * Project `n` 3D points `p_C` (n x 3) to image points `z` (n x 2).
+ */
+void camera_project_points(const camera_params_t *camera,
+                           const real_t *p_C,
+                           const int n,
+                           real_t *z) {
+  assert(camera != NULL);
+  assert(p_C != NULL);
+  assert(z != NULL);
+
+  switch (camera->model) {
+    case CAMERA_PINHOLE_RADTAN4:
+      pinhole_radtan4_project_points(camera->data, p_C, n, z);
+      break;
+    case CAMERA_PINHOLE_EQUI4:
+      pinhole_equi4_project_points(camera->data, p_C, n, z);
+      break;
+    default:
+      FATAL("Unknown camera model [%d]!\n", camera->model);
+  }
 }
 
 /**
@@ -9762,6 +11466,45 @@ void camera_back_project(const camera_params_t *camera,
   camera->back_proj_func(camera->data, z, bearing);
 }
 
+/**
+ * Back project `n` image points `z` (n x 2) to bearing vectors (n x 3).
+ */
+void camera_back_project_points(const camera_params_t *camera,
+                                const real_t *z,
+                                const int n,
+                                real_t *bearings) {
+  assert(camera != NULL);
+  assert(z != NULL);
+  assert(bearings != NULL);
+
+  const real_t *k = camera->data;
+  const real_t *d = camera->data + 4;
+  switch (camera->model) {
+    case CAMERA_PINHOLE_RADTAN4:
+#pragma omp simd
+      for (int i = 0; i < n; i++) {
+        const real_t x = (z[i * 2 + 0] - k[2]) / k[0];
+        const real_t y = (z[i * 2 + 1] - k[3]) / k[1];
+        real_t *b = &bearings[i * 3];
+        radtan4_undistort_inline(d, x, y, &b[0], &b[1]);
+        b[2] = 1.0;
+      }
+      break;
+    case CAMERA_PINHOLE_EQUI4:
+#pragma omp simd
+      for (int i = 0; i < n; i++) {
+        const real_t x = (z[i * 2 + 0] - k[2]) / k[0];
+        const real_t y = (z[i * 2 + 1] - k[3]) / k[1];
+        real_t *b = &bearings[i * 3];
+        equi4_undistort_inline(d, x, y, &b[0], &b[1]);
+        b[2] = 1.0;
+      }
+      break;
+    default:
+      FATAL("Unknown camera model [%d]!\n", camera->model);
+  }
+}
+
 /**
  * Undistort image points.
  */
@@ -9773,10 +11516,15 @@ void camera_undistort_points(const camera_params_t *camera,
   assert(kps != NULL);
   assert(kps_und != NULL);
 
-  for (int i = 0; i < num_points; i++) {
-    const real_t *z_in = &kps[2 * i];
-    real_t *z_out = &kps_und[i * 2];
-    camera->undistort_func(camera->data, z_in, z_out);
+  switch (camera->model) {
+    case CAMERA_PINHOLE_RADTAN4:
+      pinhole_radtan4_undistort_points(camera->data, kps, num_points, kps_und);
+      break;
+    case CAMERA_PINHOLE_EQUI4:
+      pinhole_equi4_undistort_points(camera->data, kps, num_points, kps_und);
+      break;
+    default:
+      FATAL("Unknown camera model [%d]!\n", camera->model);
   }
 }
 
@@ -9836,24 +11584,289 @@ void triangulate_batch(const camera_params_t *cam_i,
   pinhole_projection_matrix(cam_i->data, T_eye, P_i);
   pinhole_projection_matrix(cam_j->data, T_CiCj, P_j);
 
+  // Undistort keypoints
+  real_t *z_i = MALLOC(real_t, n * 2);
+  real_t *z_j = MALLOC(real_t, n * 2);
+  camera_undistort_points(cam_i, kps_i, n, z_i);
+  camera_undistort_points(cam_j, kps_j, n, z_j);
+
   // Triangulate features
+  linear_triangulation_batch(P_i, P_j, z_i, z_j, n, 0, points, status);
+
+  // Clean up
+  free(z_i);
+  free(z_j);
+}
+
+/**
+ * Triangulate stereo features in batch, points are expressed in the world
+ * frame given the pose of camera i `T_WCi`.
+ */
+void stereo_triangulate(const camera_params_t *cam_i,
+                        const camera_params_t *cam_j,
+                        const real_t T_WCi[4 * 4],
+                        const real_t T_CiCj[4 * 4],
+                        const real_t *kps_i,
+                        const real_t *kps_j,
+                        const int n,
+                        real_t *points,
+                        int *status) {
+  assert(T_WCi != NULL);
+  triangulate_batch(cam_i, cam_j, T_CiCj, kps_i, kps_j, n, points, status);
   for (int i = 0; i < n; i++) {
-    // Undistort keypoints
-    real_t z_i[2] = {0};
-    real_t z_j[2] = {0};
-    cam_i->undistort_func(cam_i->data, &kps_i[i * 2], z_i);
-    cam_j->undistort_func(cam_j->data, &kps_j[i * 2], z_j);
+    real_t p_Ci[3] = {points[i * 3 + 0], points[i * 3 + 1], points[i * 3 + 2]};
+    tf_point(T_WCi, p_Ci, points + i * 3);
+  }
+}
+
+///////////
+// REMAP //
+///////////
+
+/**
+ * Build a remap table that renders camera `cam` into a `width` x `height`
+ * pinhole image with intrinsics `K_new` (fx, fy, cx, cy). The optional
+ * rotation `R` maps vectors from the camera frame to the new image frame, it
+ * is used for stereo rectification and can be NULL.
+ * @returns Heap allocated remap table
+ */
+remap_table_t *remap_table_malloc(const camera_params_t *cam,
+                                  const int width,
+                                  const int height,
+                                  const real_t K_new[4],
+                                  const real_t R[3 * 3]) {
+  assert(cam != NULL);
+  assert(width > 0 && height > 0);
+  assert(K_new != NULL);
+  assert(cam->resolution[0] >= 2 && cam->resolution[1] >= 2);
+
+  remap_table_t *table = MALLOC(remap_table_t, 1);
+  table->width = width;
+  table->height = height;
+  table->src_width = cam->resolution[0];
+  table->src_height = cam->resolution[1];
+  table->offsets = MALLOC(int32_t, width * height);
+  table->weights = MALLOC(uint16_t, width * height * 4);
+
+  // Rotation from the new image frame to the camera frame
+  real_t C[3 * 3] = {1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0};
+  if (R) {
+    mat_transpose(R, 3, 3, C);
+  }
+
+  // Project the ray of every destination pixel into the source image
+  const int src_w = table->src_width;
+  const int src_h = table->src_height;
+  const int S = REMAP_FRAC_SIZE;
+  real_t *p_C = MALLOC(real_t, width * 3);
+  real_t *z = MALLOC(real_t, width * 2);
+  for (int v = 0; v < height; v++) {
+    for (int u = 0; u < width; u++) {
+      const real_t x = (u - K_new[2]) / K_new[0];
+      const real_t y = (v - K_new[3]) / K_new[1];
+      p_C[u * 3 + 0] = C[0] * x + C[1] * y + C[2];
+      p_C[u * 3 + 1] = C[3] * x + C[4] * y + C[5];
+      p_C[u * 3 + 2] = C[6] * x + C[7] * y + C[8];
+    }
+    camera_project_points(cam, p_C, width, z);
+
+    for (int u = 0; u < width; u++) {
+      const int idx = v * width + u;
+      const real_t xs = z[u * 2 + 0];
+      const real_t ys = z[u * 2 + 1];
+      uint16_t *w = &table->weights[idx * 4];
+
+      // Invalid pixels sample the first pixel with zero weights
+      const int z_ok = p_C[u * 3 + 2] > 0;
+      const int x_ok = (xs >= 0.0 && xs <= src_w - 1);
+      const int y_ok = (ys >= 0.0 && ys <= src_h - 1);
+      if (!(z_ok && x_ok && y_ok)) {
+        table->offsets[idx] = 0;
+        w[0] = w[1] = w[2] = w[3] = 0;
+        continue;
+      }
+
+      // Top-left sample, clamped so the 2x2 neighbourhood is in the image
+      const int x0 = MIN((int) xs, src_w - 2);
+      const int y0 = MIN((int) ys, src_h - 2);
+      const int ax = (int) lround((xs - x0) * S);
+      const int ay = (int) lround((ys - y0) * S);
+      table->offsets[idx] = y0 * src_w + x0;
+      w[0] = (S - ax) * (S - ay);
+      w[1] = ax * (S - ay);
+      w[2] = (S - ax) * ay;
+      w[3] = ax * ay;
+    }
+  }
+  free(p_C);
+  free(z);
+
+  return table;
+}
+
+/**
+ * Build a remap table that undistorts camera `cam` into a pinhole image with
+ * the same resolution and intrinsics.
+ * @returns Heap allocated remap table
+ */
+remap_table_t *remap_table_undistort(const camera_params_t *cam) {
+  assert(cam != NULL);
+  const int width = cam->resolution[0];
+  const int height = cam->resolution[1];
+  return remap_table_malloc(cam, width, height, cam->data, NULL);
+}
 
-    // Triangulate
-    real_t p[3] = {0};
-    linear_triangulation(P_i, P_j, z_i, z_j, p);
-    points[i * 3 + 0] = p[0];
-    points[i * 3 + 1] = p[1];
-    points[i * 3 + 2] = p[2];
-    status[i] = 0;
+/**
+ * Free remap table.
+ */
+void remap_table_free(remap_table_t *table) {
+  if (table == NULL) {
+    return;
+  }
+  free(table->offsets);
+  free(table->weights);
+  free(table);
+}
+
+/**
+ * Remap image `src` into `dst` using a precomputed remap `table`. The
+ * destination image must be allocated with the table's width and height and
+ * the same number of channels as `src`.
+ */
+void remap_image(const remap_table_t *table, const image_t *src, image_t *dst) {
+  assert(table != NULL);
+  assert(src != NULL && src->data != NULL);
+  assert(dst != NULL && dst->data != NULL);
+  assert(src->width == table->src_width);
+  assert(src->height == table->src_height);
+  assert(dst->width == table->width);
+  assert(dst->height == table->height);
+  assert(src->channels == dst->channels);
+
+  const int N = table->width * table->height;
+  const int channels = src->channels;
+  const int stride = src->width * channels;
+  const int shift = 2 * REMAP_FRAC_BITS;
+  const uint32_t half = 1u << (shift - 1);
+  const int32_t *offsets = table->offsets;
+  const uint16_t *weights = table->weights;
+  const uint8_t *s = src->data;
+  uint8_t *d = dst->data;
+
+  if (channels == 1) {
+#pragma omp simd
+    for (int i = 0; i < N; i++) {
+      const uint8_t *p = &s[offsets[i]];
+      const uint16_t *w = &weights[i * 4];
+      const uint32_t sum = w[0] * p[0] + w[1] * p[1] + w[2] * p[stride] +
+                           w[3] * p[stride + 1];
+      d[i] = (uint8_t) ((sum + half) >> shift);
+    }
+    return;
+  }
+
+  for (int i = 0; i < N; i++) {
+    const uint8_t *p = &s[offsets[i] * channels];
+    const uint16_t *w = &weights[i * 4];
+    for (int c = 0; c < channels; c++) {
+      const uint32_t sum = w[0] * p[c] + w[1] * p[channels + c] +
+                           w[2] * p[stride + c] +
+                           w[3] * p[stride + channels + c];
+      d[i * channels + c] = (uint8_t) ((sum + half) >> shift);
+    }
   }
 }
 
+/**
+ * Compute stereo rectification for cameras `cam0` and `cam1` with extrinsic
+ * `T_C0C1`. Both cameras are rotated half way towards each other and then
+ * aligned with the baseline, so that corresponding points lie on the same
+ * image row. Outputs the shared rectified intrinsics `K_rect` (fx, fy, cx,
+ * cy) and rotations `R0` and `R1` from each camera frame to its rectified
+ * frame.
+ */
+void stereo_rectify(const camera_params_t *cam0,
+                    const camera_params_t *cam1,
+                    const real_t T_C0C1[4 * 4],
+                    real_t K_rect[4],
+                    real_t R0[3 * 3],
+                    real_t R1[3 * 3]) {
+  assert(cam0 != NULL);
+  assert(cam1 != NULL);
+  assert(T_C0C1 != NULL);
+  assert(K_rect != NULL);
+  assert(R0 != NULL);
+  assert(R1 != NULL);
+
+  // Split relative rotation in half
+  real_t C_C0C1[3 * 3] = {0};
+  real_t r_C0C1[3] = {0};
+  real_t rvec[3] = {0};
+  real_t C_half[3 * 3] = {0};
+  real_t C_half_t[3 * 3] = {0};
+  tf_rot_get(T_C0C1, C_C0C1);
+  tf_trans_get(T_C0C1, r_C0C1);
+  lie_Log(C_C0C1, rvec);
+  vec_scale(rvec, 3, 0.5);
+  lie_Exp(rvec, C_half);
+  mat_transpose(C_half, 3, 3, C_half_t);
+
+  // Align x-axis with the baseline expressed in the half way frame
+  real_t e1[3] = {0};
+  real_t e2[3] = {0};
+  real_t e3[3] = {0};
+  dot(C_half_t, 3, 3, r_C0C1, 3, 1, e1);
+  e2[0] = -e1[1];
+  e2[1] = e1[0];
+  e2[2] = 0.0;
+  vec3_normalize(e1);
+  vec3_normalize(e2);
+  vec3_cross(e1, e2, e3);
+  real_t R_w[3 * 3] = {0};
+  vec_copy(e1, 3, &R_w[0]);
+  vec_copy(e2, 3, &R_w[3]);
+  vec_copy(e3, 3, &R_w[6]);
+
+  // R0 = R_w * C_half', R1 = R0 * C_C0C1
+  dot(R_w, 3, 3, C_half_t, 3, 3, R0);
+  dot(R0, 3, 3, C_C0C1, 3, 3, R1);
+
+  // Shared intrinsics
+  const real_t *k0 = cam0->data;
+  const real_t *k1 = cam1->data;
+  const real_t f = (k0[0] + k0[1] + k1[0] + k1[1]) / 4.0;
+  K_rect[0] = f;
+  K_rect[1] = f;
+  K_rect[2] = (k0[2] + k1[2]) / 2.0;
+  K_rect[3] = (k0[3] + k1[3]) / 2.0;
+}
+
+/**
+ * Build stereo rectification remap tables for cameras `cam0` and `cam1` with
+ * extrinsic `T_C0C1`, the shared rectified intrinsics are written to
+ * `K_rect`.
+ */
+void remap_table_stereo_rectify(const camera_params_t *cam0,
+                                const camera_params_t *cam1,
+                                const real_t T_C0C1[4 * 4],
+                                real_t K_rect[4],
+                                remap_table_t **table0,
+                                remap_table_t **table1) {
+  assert(table0 != NULL);
+  assert(table1 != NULL);
+
+  real_t R0[3 * 3] = {0};
+  real_t R1[3 * 3] = {0};
+  stereo_rectify(cam0, cam1, T_C0C1, K_rect, R0, R1);
+
+  const int w0 = cam0->resolution[0];
+  const int h0 = cam0->resolution[1];
+  const int w1 = cam1->resolution[0];
+  const int h1 = cam1->resolution[1];
+  *table0 = remap_table_malloc(cam0, w0, h0, K_rect, R0);
+  *table1 = remap_table_malloc(cam1, w1, h1, K_rect, R1);
+}
+
 //////////////
 // VELOCITY //
 //////////////
@@ -10621,6 +12634,306 @@ void param_order_add_time_delay(param_order_t **h, time_delay_t *p, int *c) {
   param_order_add(h, TIME_DELAY_PARAM, fix, data, c);
 }
 
+//////////////////////
+// INFORMATION GAIN //
+//////////////////////
+
+/**
+ * In-place Cholesky decomposition of the `n x n` symmetric matrix `A`, only
+ * the lower triangle is read and written.
+ * @returns 0 for success, -1 if `A` is not positive definite
+ */
+static int info_gain_chol(real_t *A, const int n) {
+  for (int j = 0; j < n; j++) {
+    real_t d = A[j * n + j];
+    for (int k = 0; k < j; k++) {
+      d -= A[j * n + k] * A[j * n + k];
+    }
+    if (d <= 0.0) {
+      return -1;
+    }
+    d = sqrt(d);
+    A[j * n + j] = d;
+
+    for (int i = j + 1; i < n; i++) {
+      real_t s = A[i * n + j];
+      for (int k = 0; k < j; k++) {
+        s -= A[i * n + k] * A[j * n + k];
+      }
+      A[i * n + j] = s / d;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * Malloc information gain evaluator for the parameters in columns `col_s` to
+ * `col_e` (inclusive) of information matrix `H`. Their marginal covariance is
+ * the corresponding block of the pseudo-inverse of `H`, eigenvalues below
+ * the usual `max(eig) * size * eps` threshold are treated as unobservable.
+ */
+info_gain_t *info_gain_malloc(param_order_t *hash,
+                              const real_t *H,
+                              const int sv_size,
+                              const int col_s,
+                              const int col_e) {
+  assert(hash != NULL);
+  assert(H != NULL);
+  assert(col_s >= 0 && col_e < sv_size && col_s <= col_e);
+  const real_t eps = (PRECISION == 1) ? FLT_EPSILON : DBL_EPSILON;
+
+  // Marginal covariance: block of the pseudo-inverse of H
+  const int size = col_e - col_s + 1;
+  real_t *V = MALLOC(real_t, sv_size * sv_size);
+  real_t *w = MALLOC(real_t, sv_size);
+  real_t *covar = CALLOC(real_t, size * size);
+  if (eig_sym(H, sv_size, sv_size, V, w) != 0) {
+    free(V);
+    free(w);
+    free(covar);
+    return NULL;
+  }
+  real_t w_max = 0.0;
+  for (int k = 0; k < sv_size; k++) {
+    w_max = MAX(w_max, fabs(w[k]));
+  }
+  for (int k = 0; k < sv_size; k++) {
+    if (w[k] <= w_max * sv_size * eps) {
+      continue;
+    }
+    for (int i = 0; i < size; i++) {
+      const real_t v_i = V[(col_s + i) * sv_size + k] / w[k];
+      for (int j = 0; j < size; j++) {
+        covar[i * size + j] += v_i * V[(col_s + j) * sv_size + k];
+      }
+    }
+  }
+  free(V);
+  free(w);
+
+  // Factor covariance = L * L' over its range and compute its entropy
+  real_t *U = MALLOC(real_t, size * size);
+  real_t *s = MALLOC(real_t, size);
+  const int retval = eig_sym(covar, size, size, U, s);
+  free(covar);
+  if (retval != 0) {
+    free(U);
+    free(s);
+    return NULL;
+  }
+  real_t s_max = 0.0;
+  for (int k = 0; k < size; k++) {
+    s_max = MAX(s_max, fabs(s[k]));
+  }
+
+  int rank = 0;
+  real_t logdet = 0.0;
+  real_t *L = CALLOC(real_t, size * size);
+  for (int k = 0; k < size; k++) {
+    if (s[k] <= s_max * size * eps) {
+      continue;
+    }
+    const real_t s_sqrt = sqrt(s[k]);
+    for (int i = 0; i < size; i++) {
+      L[i * size + rank] = U[i * size + k] * s_sqrt;
+    }
+    logdet += log(s[k]);
+    rank++;
+  }
+  free(U);
+  free(s);
+  if (rank == 0) {
+    LOG_ERROR("Marginal covariance has rank 0!\n");
+    free(L);
+    return NULL;
+  }
+
+  info_gain_t *ig = MALLOC(info_gain_t, 1);
+  ig->size = size;
+  ig->rank = rank;
+  ig->L = L;
+  ig->entropy = 0.5 * (rank * log(2.0 * M_PI * exp(1)) + logdet);
+
+  // Parameter columns, copied out of the hash so that lookups are read-only
+  // and can be done from multiple threads
+  ig->num_params = 0;
+  ig->params = MALLOC(void *, hmlen(hash));
+  ig->cols = MALLOC(int, hmlen(hash));
+  for (int i = 0; i < hmlen(hash); i++) {
+    if (hash[i].fix || hash[i].idx < col_s || hash[i].idx > col_e) {
+      continue;
+    }
+    ig->params[ig->num_params] = hash[i].key;
+    ig->cols[ig->num_params] = hash[i].idx - col_s;
+    ig->num_params++;
+  }
+
+  return ig;
+}
+
+/**
+ * Free information gain evaluator.
+ */
+void info_gain_free(info_gain_t *ig) {
+  if (ig == NULL) {
+    return;
+  }
+  free(ig->L);
+  free(ig->params);
+  free(ig->cols);
+  free(ig);
+}
+
+/**
+ * Return column of parameter `param` in the evaluator, -1 if it is not
+ * scored.
+ */
+int info_gain_col(const info_gain_t *ig, const void *param) {
+  for (int i = 0; i < ig->num_params; i++) {
+    if (ig->params[i] == param) {
+      return ig->cols[i];
+    }
+  }
+  return -1;
+}
+
+/**
+ * Score candidate measurements with whitened Jacobian `J` (`m x size`) with
+ * respect to the scored parameters, and `J_nuis` (`m x p`) with respect to
+ * `p` new nuisance parameters with prior information `info_nuis` (diagonal,
+ * NULL for none). The nuisance parameters are marginalized out,
+ *
+ *   dH = J' J - J' J_nuis (J_nuis' J_nuis + diag(info_nuis))^-1 J_nuis' J
+ *
+ * and with the covariance factor L L' of the current marginal, the matrix
+ * determinant lemma gives the entropy after adding the measurements:
+ *
+ *   entropy' = entropy - 0.5 * log(det(I + L' dH L))
+ *
+ * @returns 0 for success, -1 for failure
+ */
+int info_gain_eval(const info_gain_t *ig,
+                   const real_t *J,
+                   const real_t *J_nuis,
+                   const real_t *info_nuis,
+                   const int m,
+                   const int p,
+                   real_t *entropy) {
+  assert(ig != NULL);
+  assert(J != NULL);
+  assert(p == 0 || J_nuis != NULL);
+  assert(entropy != NULL);
+
+  const int n = ig->size;
+  real_t *dH = CALLOC(real_t, n * n);
+  real_t *M = CALLOC(real_t, n * n);
+  int status = 0;
+
+  // dH = J' * J (lower triangle)
+  for (int k = 0; k < m; k++) {
+    const real_t *J_k = J + k * n;
+    for (int i = 0; i < n; i++) {
+      for (int j = 0; j <= i; j++) {
+        dH[i * n + j] += J_k[i] * J_k[j];
+      }
+    }
+  }
+
+  // Marginalize nuisance parameters
+  if (p > 0) {
+    real_t *A = CALLOC(real_t, p * p);
+    real_t *B = CALLOC(real_t, p * n);
+    for (int k = 0; k < m; k++) {
+      const real_t *Jn_k = J_nuis + k * p;
+      const real_t *J_k = J + k * n;
+      for (int i = 0; i < p; i++) {
+        for (int j = 0; j <= i; j++) {
+          A[i * p + j] += Jn_k[i] * Jn_k[j];
+        }
+        for (int j = 0; j < n; j++) {
+          B[i * n + j] += Jn_k[i] * J_k[j];
+        }
+      }
+    }
+    for (int i = 0; i < p; i++) {
+      A[i * p + i] += (info_nuis) ? info_nuis[i] : 0.0;
+    }
+
+    // B <- L_A^-1 B, then dH -= B' B
+    if (info_gain_chol(A, p) != 0) {
+      status = -1;
+    } else {
+      for (int j = 0; j < n; j++) {
+        for (int i = 0; i < p; i++) {
+          real_t s = B[i * n + j];
+          for (int k = 0; k < i; k++) {
+            s -= A[i * p + k] * B[k * n + j];
+          }
+          B[i * n + j] = s / A[i * p + i];
+        }
+      }
+      for (int i = 0; i < n; i++) {
+        for (int j = 0; j <= i; j++) {
+          real_t s = 0.0;
+          for (int k = 0; k < p; k++) {
+            s += B[k * n + i] * B[k * n + j];
+          }
+          dH[i * n + j] -= s;
+        }
+      }
+    }
+    free(A);
+    free(B);
+  }
+
+  if (status == 0) {
+    // Symmetrize dH and form M = I + L' dH L
+    const int rank = ig->rank;
+    for (int i = 0; i < n; i++) {
+      for (int j = 0; j < i; j++) {
+        dH[j * n + i] = dH[i * n + j];
+      }
+    }
+    real_t *dH_L = CALLOC(real_t, n * rank);
+    for (int i = 0; i < n; i++) {
+      for (int k = 0; k < n; k++) {
+        const real_t dH_ik = dH[i * n + k];
+        for (int j = 0; j < rank; j++) {
+          dH_L[i * rank + j] += dH_ik * ig->L[k * n + j];
+        }
+      }
+    }
+    for (int i = 0; i < rank; i++) {
+      for (int j = 0; j <= i; j++) {
+        real_t s = (i == j) ? 1.0 : 0.0;
+        for (int k = 0; k < n; k++) {
+          s += ig->L[k * n + i] * dH_L[k * rank + j];
+        }
+        M[i * rank + j] = s;
+      }
+    }
+    free(dH_L);
+
+    // log(det(M)) from the Cholesky factor of M
+    if (info_gain_chol(M, rank) != 0) {
+      status = -1;
+    } else {
+      real_t logdet = 0.0;
+      for (int i = 0; i < rank; i++) {
+        logdet += 2.0 * log(M[i * rank + i]);
+      }
+      *entropy = ig->entropy - 0.5 * logdet;
+    }
+  }
+
+  // Clean up
+  free(dH);
+  free(M);
+
+  return status;
+}
+
 ////////////
 // FACTOR //
 ////////////
@@ -11065,7 +13378,8 @@ int ba_factor_eval(void *factor_ptr) {
   real_t z_hat[2];
   tf_inv(T_WCi, T_CiW);
   tf_point(T_CiW, p_W, p_Ci);
-  camera_project(factor->camera, p_Ci, z_hat);
+  const int cam_model = factor->camera->model;
+  camera_model_project(cam_model, cam_params, p_Ci, z_hat);
   // -- Residual
   real_t r[2] = {0};
   r[0] = factor->z[0] - z_hat[0];
@@ -11081,11 +13395,11 @@ int ba_factor_eval(void *factor_ptr) {
   // -- Form: Jh_weighted = -1 * sqrt_info * Jh
   real_t Jh[2 * 3] = {0};
   real_t Jh_w[2 * 3] = {0};
-  pinhole_radtan4_project_jacobian(cam_params, p_Ci, Jh);
+  camera_model_project_jacobian(cam_model, cam_params, p_Ci, Jh);
   dot(neg_sqrt_info, 2, 2, Jh, 2, 3, Jh_w);
   // -- Form: J_cam_params
   real_t J_cam_params[2 * 8] = {0};
-  pinhole_radtan4_params_jacobian(cam_params, p_Ci, J_cam_params);
+  camera_model_params_jacobian(cam_model, cam_params, p_Ci, J_cam_params);
   // -- Fill jacobians
   ba_factor_pose_jacobian(Jh_w, T_WCi, p_W, factor->jacs[0]);
   ba_factor_feature_jacobian(Jh_w, T_WCi, factor->jacs[1]);
@@ -11385,7 +13699,8 @@ int camera_factor_eval(void *factor_ptr) {
   // Calculate residuals
   // -- Project point from world to image plane
   real_t z_hat[2];
-  camera_project(factor->camera, p_Ci, z_hat);
+  const int cam_model = factor->camera->model;
+  camera_model_project(cam_model, cam_params, p_Ci, z_hat);
   // -- Residual
   real_t r[2] = {0};
   r[0] = factor->z[0] - z_hat[0];
@@ -11401,11 +13716,11 @@ int camera_factor_eval(void *factor_ptr) {
   // -- Form: Jh_ = -1 * sqrt_info * Jh
   real_t Jh[2 * 3] = {0};
   real_t Jh_[2 * 3] = {0};
-  pinhole_radtan4_project_jacobian(cam_params, p_Ci, Jh);
+  camera_model_project_jacobian(cam_model, cam_params, p_Ci, Jh);
   dot(neg_sqrt_info, 2, 2, Jh, 2, 3, Jh_);
   // -- Form: J_cam_params
   real_t J_cam_params[2 * 8] = {0};
-  pinhole_radtan4_params_jacobian(cam_params, p_Ci, J_cam_params);
+  camera_model_params_jacobian(cam_model, cam_params, p_Ci, J_cam_params);
   // -- Fill Jacobians
   camera_factor_pose_jacobian(Jh_, T_WB, T_BCi, p_W, factor->jacs[0]);
   camera_factor_extrinsic_jacobian(Jh_, T_BCi, p_Ci, factor->jacs[1]);
@@ -12606,6 +14921,8 @@ void imu_factor_reset(imu_factor_t *factor) {
 }
 
 void imu_factor_preintegrate(imu_factor_t *factor) {
+  TRACE_FUNC();
+
   // Reset variables
   imu_factor_reset(factor);
 
@@ -13291,7 +15608,8 @@ int calib_camera_factor_eval(void *factor_ptr) {
   int status = 0;
   real_t z_hat[2];
   TF_POINT(T_CiF, factor->p_FFi, p_CiFi);
-  camera_project(factor->cam_params, p_CiFi, z_hat);
+  const int cam_model = factor->cam_params->model;
+  camera_model_project(cam_model, cam_params, p_CiFi, z_hat);
   const int res_x = factor->cam_params->resolution[0];
   const int res_y = factor->cam_params->resolution[1];
   const int x_ok = (z_hat[0] > 0 && z_hat[0] < res_x);
@@ -13322,11 +15640,11 @@ int calib_camera_factor_eval(void *factor_ptr) {
   // Form: Jh_w = -1 * sqrt_info * Jh
   real_t Jh[2 * 3] = {0};
   real_t Jh_w[2 * 3] = {0};
-  pinhole_radtan4_project_jacobian(cam_params, p_CiFi, Jh);
+  camera_model_project_jacobian(cam_model, cam_params, p_CiFi, Jh);
   dot(neg_sqrt_info, 2, 2, Jh, 2, 3, Jh_w);
   // Form: J_cam_params
   real_t J_cam_params[2 * 8] = {0};
-  pinhole_radtan4_params_jacobian(cam_params, p_CiFi, J_cam_params);
+  camera_model_params_jacobian(cam_model, cam_params, p_CiFi, J_cam_params);
 
   // -- Jacobians w.r.t relative camera pose T_BF
   {
@@ -13543,7 +15861,8 @@ int calib_imucam_factor_eval(void *factor_ptr) {
   // Project to image plane
   real_t z_hat[2];
   TF_POINT(T_CiF, factor->p_FFi, p_CiFi);
-  camera_project(factor->cam_params, p_CiFi, z_hat);
+  const int cam_model = factor->cam_params->model;
+  camera_model_project(cam_model, cam_params, p_CiFi, z_hat);
 
   // Calculate residuals
   real_t r[2] = {0, 0};
@@ -13561,11 +15880,11 @@ int calib_imucam_factor_eval(void *factor_ptr) {
   // Form: Jh_w = -1 * sqrt_info * Jh
   real_t Jh[2 * 3] = {0};
   real_t Jh_w[2 * 3] = {0};
-  pinhole_radtan4_project_jacobian(cam_params, p_CiFi, Jh);
+  camera_model_project_jacobian(cam_model, cam_params, p_CiFi, Jh);
   dot(neg_sqrt_info, 2, 2, Jh, 2, 3, Jh_w);
   // Form: J_cam_params
   real_t J_cam_params[2 * 8] = {0};
-  pinhole_radtan4_params_jacobian(cam_params, p_CiFi, J_cam_params);
+  camera_model_params_jacobian(cam_model, cam_params, p_CiFi, J_cam_params);
 
   // -- Jacobians w.r.t fiducial pose T_WF
   {
@@ -14211,7 +16530,8 @@ int calib_gimbal_factor_eval(void *factor_ptr) {
   // Project to image plane
   real_t z_hat[2];
   TF_POINT(T_CiF, factor->p_FFi, p_CiFi);
-  camera_project(factor->cam, p_CiFi, z_hat);
+  const int cam_model = factor->cam->model;
+  camera_model_project(cam_model, cam_params, p_CiFi, z_hat);
 
   // Calculate residuals
   real_t r[2] = {0, 0};
@@ -14227,11 +16547,11 @@ int calib_gimbal_factor_eval(void *factor_ptr) {
   // Form: Jh_w = -1 * sqrt_info * Jh
   real_t Jh[2 * 3] = {0};
   real_t Jh_w[2 * 3] = {0};
-  pinhole_radtan4_project_jacobian(cam_params, p_CiFi, Jh);
+  camera_model_project_jacobian(cam_model, cam_params, p_CiFi, Jh);
   dot(neg_sqrt_info, 2, 2, Jh, 2, 3, Jh_w);
   // Form: J_cam_params
   real_t J_cam_params[2 * 8] = {0};
-  pinhole_radtan4_params_jacobian(cam_params, p_CiFi, J_cam_params);
+  camera_model_params_jacobian(cam_model, cam_params, p_CiFi, J_cam_params);
 
   // -- Fill Jacobians
   TF_CHAIN(T_CiM0b, 2, T_CiB, T_BM0);
@@ -14888,6 +17208,8 @@ static void marg_factor_form_fejs(marg_factor_t *marg) {
 }
 
 void marg_factor_marginalize(marg_factor_t *marg) {
+  TRACE_FUNC();
+
   // Form Hessian and RHS of Gauss newton
   TIC(hessian_form);
   marg_factor_hessian_form(marg);
@@ -15258,6 +17580,8 @@ void solver_update(solver_t *solver, real_t *dx, int sv_size) {
  * Step nonlinear least squares problem.
  */
 real_t **solver_step(solver_t *solver, const real_t lambda_k, void *data) {
+  TRACE_FUNC();
+
   // Linearize non-linear system
   if (solver->linearize) {
     // Linearize
@@ -15286,6 +17610,7 @@ real_t **solver_step(solver_t *solver, const real_t lambda_k, void *data) {
 
   // Solve non-linear system
   if (solver->linsolve_func) {
+    TRACE_SCOPE("solver_linsolve");
     solver->linsolve_func(data,
                           solver->sv_size,
                           solver->hash,
@@ -15294,6 +17619,7 @@ real_t **solver_step(solver_t *solver, const real_t lambda_k, void *data) {
                           solver->dx);
   } else {
     // Solve: H * dx = g
+    TRACE_SCOPE("solver_linsolve");
 #ifdef SOLVER_USE_SUITESPARSE
     suitesparse_chol_solve(solver->common,
                            solver->H_damped,
@@ -15636,8 +17962,21 @@ int camchain_find(camchain_t *cc,
 // CAMERA CALIBRATION //
 ////////////////////////
 
+/**
+ * Size of `n` bytes rounded up to the next cache line.
+ */
+static size_t view_align(const size_t n) {
+  return (n + CACHE_LINE_SIZE - 1) & ~((size_t) CACHE_LINE_SIZE - 1);
+}
+
 /**
  * Malloc camera calibration view.
+ *
+ * The view, its factors and its measurement arrays are carved out of a single
+ * cache-line aligned block in the order they are traversed during
+ * linearization (view, factors, keypoints, object points, tag ids and corner
+ * indices). This keeps a view's factors contiguous with its header and lets
+ * `calib_camera_view_free()` release everything with one `free()`.
  */
 calib_camera_view_t *calib_camera_view_malloc(const timestamp_t ts,
                                               const int view_idx,
@@ -15650,7 +17989,38 @@ calib_camera_view_t *calib_camera_view_malloc(const timestamp_t ts,
                                               pose_t *pose,
                                               extrinsic_t *cam_ext,
                                               camera_params_t *cam_params) {
-  calib_camera_view_t *view = MALLOC(calib_camera_view_t, 1);
+  assert(num_corners > 0);
+
+  // Layout
+  const size_t N = num_corners;
+  const size_t view_size = view_align(sizeof(calib_camera_view_t));
+  const size_t factors_size = view_align(sizeof(calib_camera_factor_t) * N);
+  const size_t kps_size = view_align(sizeof(real_t) * N * 2);
+  const size_t pts_size = view_align(sizeof(real_t) * N * 3);
+  const size_t ids_size = view_align(sizeof(int) * N);
+  const size_t block_size =
+      view_size + factors_size + kps_size + pts_size + ids_size * 2;
+
+  uint8_t *block = NULL;
+  if (posix_memalign((void **) &block, CACHE_LINE_SIZE, block_size)) {
+    FATAL("Failed to allocate calib_camera_view_t!\n");
+  }
+
+  // Carve block
+  size_t offset = 0;
+  calib_camera_view_t *view = (calib_camera_view_t *) block;
+  offset += view_size;
+  view->factors = (calib_camera_factor_t *) (block + offset);
+  offset += factors_size;
+  view->keypoints = (real_t *) (block + offset);
+  offset += kps_size;
+  view->object_points = (real_t *) (block + offset);
+  offset += pts_size;
+  view->tag_ids = (int *) (block + offset);
+  offset += ids_size;
+  view->corner_indices = (int *) (block + offset);
+  offset += ids_size;
+  assert(offset == block_size);
 
   // Properties
   view->ts = ts;
@@ -15658,32 +18028,7 @@ calib_camera_view_t *calib_camera_view_malloc(const timestamp_t ts,
   view->cam_idx = cam_idx;
   view->num_corners = num_corners;
 
-  // Measurements
-  if (num_corners) {
-    view->tag_ids = MALLOC(int, num_corners);
-    view->corner_indices = MALLOC(int, num_corners);
-    view->object_points = MALLOC(real_t, num_corners * 3);
-    view->keypoints = MALLOC(real_t, num_corners * 2);
-  }
-
-  // Factors
-  view->factors = MALLOC(calib_camera_factor_t, num_corners);
-  assert(view->tag_ids != NULL);
-  assert(view->corner_indices != NULL);
-  assert(view->object_points != NULL);
-  assert(view->keypoints != NULL);
-  assert(view->factors != NULL);
-
-  for (int i = 0; i < num_corners; i++) {
-    view->tag_ids[i] = tag_ids[i];
-    view->corner_indices[i] = corner_indices[i];
-    view->object_points[i * 3] = object_points[i * 3];
-    view->object_points[i * 3 + 1] = object_points[i * 3 + 1];
-    view->object_points[i * 3 + 2] = object_points[i * 3 + 2];
-    view->keypoints[i * 2] = keypoints[i * 2];
-    view->keypoints[i * 2 + 1] = keypoints[i * 2 + 1];
-  }
-
+  // Measurements and factors
   const real_t var[2] = {1.0, 1.0};
   for (int i = 0; i < view->num_corners; i++) {
     const int tag_id = tag_ids[i];
@@ -15711,20 +18056,298 @@ calib_camera_view_t *calib_camera_view_malloc(const timestamp_t ts,
                               var);
   }
 
-  return view;
-}
+  return view;
+}
+
+/**
+ * Free camera calibration view.
+ */
+void calib_camera_view_free(calib_camera_view_t *view) {
+  // View and its arrays share one allocation, see calib_camera_view_malloc()
+  free(view);
+}
+
+/**
+ * Evaluate all calibration factors in a camera view.
+ *
+ * Every factor in a view shares the same pose, extrinsic and camera
+ * parameters, so the transforms are formed once per view and the corners are
+ * processed in structure-of-arrays batches of `CALIB_CAMERA_BATCH_SIZE`. The
+ * 20x20 view Hessian over [pose, extrinsic, camera] is accumulated locally
+ * and scattered into `H` and `g` once. Residuals are written to `r` and the
+ * per-factor residuals and Jacobians are updated for marginalization. If `H`
+ * or `g` is NULL only the residuals and Jacobians are evaluated.
+ */
+void calib_camera_view_linearize(calib_camera_view_t *view,
+                                 const int sv_size,
+                                 param_order_t *hash,
+                                 real_t *H,
+                                 real_t *g,
+                                 real_t *r) {
+  assert(view != NULL);
+  assert(view->num_corners > 0);
+  assert(r != NULL);
+
+  // Only pinhole-radtan4 has a batched kernel, evaluate others per factor
+  calib_camera_factor_t *factors = view->factors;
+  const camera_params_t *cam = factors[0].cam_params;
+  if (cam->model != CAMERA_PINHOLE_RADTAN4) {
+    for (int i = 0; i < view->num_corners; i++) {
+      calib_camera_factor_t *factor = &factors[i];
+      calib_camera_factor_eval(factor);
+      vec_copy(factor->r, factor->r_size, &r[i * 2]);
+      solver_fill_hessian(hash,
+                          factor->num_params,
+                          factor->params,
+                          factor->jacs,
+                          factor->r,
+                          factor->r_size,
+                          sv_size,
+                          H,
+                          g);
+    }
+    return;
+  }
+
+  // Form T_CiF once per view
+  TF(factors[0].params[0], T_BF);
+  TF(factors[0].params[1], T_BCi);
+  TF_INV(T_BCi, T_CiB);
+  TF_CHAIN(T_CiF, 2, T_CiB, T_BF);
+  real_t C_CiB[3 * 3] = {0};
+  real_t C_CiF[3 * 3] = {0};
+  real_t r_CiF[3] = {0};
+  tf_rot_get(T_CiB, C_CiB);
+  tf_rot_get(T_CiF, C_CiF);
+  tf_trans_get(T_CiF, r_CiF);
+
+  // Camera parameters
+  const real_t fx = cam->data[0];
+  const real_t fy = cam->data[1];
+  const real_t cx = cam->data[2];
+  const real_t cy = cam->data[3];
+  const real_t k1 = cam->data[4];
+  const real_t k2 = cam->data[5];
+  const real_t p1 = cam->data[6];
+  const real_t p2 = cam->data[7];
+  const real_t res_x = cam->resolution[0];
+  const real_t res_y = cam->resolution[1];
+
+  // Local Hessian and gradient over [pose (6), extrinsic (6), camera (8)]
+  const int N = 20;
+  real_t H_view[20 * 20] = {0};
+  real_t g_view[20] = {0};
+
+  // Structure-of-arrays batch, J0 and J1 are the two Jacobian rows
+  const int B = CALIB_CAMERA_BATCH_SIZE;
+  real_t J0[20][CALIB_CAMERA_BATCH_SIZE];
+  real_t J1[20][CALIB_CAMERA_BATCH_SIZE];
+  real_t r0[CALIB_CAMERA_BATCH_SIZE];
+  real_t r1[CALIB_CAMERA_BATCH_SIZE];
+  real_t p_F[3][CALIB_CAMERA_BATCH_SIZE];
+  real_t z[2][CALIB_CAMERA_BATCH_SIZE];
+  real_t s[2][CALIB_CAMERA_BATCH_SIZE];
+
+  for (int start = 0; start < view->num_corners; start += B) {
+    const int n = MIN(B, view->num_corners - start);
+
+    // Gather measurements
+    for (int k = 0; k < n; k++) {
+      const calib_camera_factor_t *factor = &factors[start + k];
+      p_F[0][k] = factor->p_FFi[0];
+      p_F[1][k] = factor->p_FFi[1];
+      p_F[2][k] = factor->p_FFi[2];
+      z[0][k] = factor->z[0];
+      z[1][k] = factor->z[1];
+      s[0][k] = factor->sqrt_info[0];
+      s[1][k] = factor->sqrt_info[3];
+    }
+
+#pragma omp simd
+    for (int k = 0; k < n; k++) {
+      // Transform and project
+      const real_t xF = p_F[0][k];
+      const real_t yF = p_F[1][k];
+      const real_t zF = p_F[2][k];
+      const real_t px =
+          C_CiF[0] * xF + C_CiF[1] * yF + C_CiF[2] * zF + r_CiF[0];
+      const real_t py =
+          C_CiF[3] * xF + C_CiF[4] * yF + C_CiF[5] * zF + r_CiF[1];
+      const real_t pz =
+          C_CiF[6] * xF + C_CiF[7] * yF + C_CiF[8] * zF + r_CiF[2];
+      const real_t iz = 1.0 / pz;
+      const real_t x = px * iz;
+      const real_t y = py * iz;
+
+      // Distort
+      const real_t x2 = x * x;
+      const real_t y2 = y * y;
+      const real_t xy = x * y;
+      const real_t r2 = x2 + y2;
+      const real_t r4 = r2 * r2;
+      const real_t rad = 1.0 + k1 * r2 + k2 * r4;
+      const real_t xd = x * rad + 2.0 * p1 * xy + p2 * (r2 + 2.0 * x2);
+      const real_t yd = y * rad + 2.0 * p2 * xy + p1 * (r2 + 2.0 * y2);
+      const real_t u = fx * xd + cx;
+      const real_t v = fy * yd + cy;
+
+      // Residuals
+      const real_t s0 = s[0][k];
+      const real_t s1 = s[1][k];
+      r0[k] = s0 * (z[0][k] - u);
+      r1[k] = s1 * (z[1][k] - v);
+
+      // Zero out Jacobians if reprojection is not valid
+      const int ok = (u > 0 && u < res_x && v > 0 && v < res_y && pz > 0);
+      const real_t w0 = ok ? -s0 : 0.0;
+      const real_t w1 = ok ? -s1 : 0.0;
+
+      // Distortion point Jacobian
+      const real_t dr = 2.0 * k1 + 4.0 * k2 * r2;
+      const real_t d00 = rad + 2.0 * p1 * y + 6.0 * p2 * x + x * x * dr;
+      const real_t d01 = 2.0 * p1 * x + 2.0 * p2 * y + x * y * dr;
+      const real_t d11 = rad + 6.0 * p1 * y + 2.0 * p2 * x + y * y * dr;
+
+      // A = -sqrt_info * Jh, where Jh = J_k * J_d * J_p
+      const real_t a00 = w0 * fx * d00 * iz;
+      const real_t a01 = w0 * fx * d01 * iz;
+      const real_t a02 = -w0 * fx * (d00 * x + d01 * y) * iz;
+      const real_t a10 = w1 * fy * d01 * iz;
+      const real_t a11 = w1 * fy * d11 * iz;
+      const real_t a12 = -w1 * fy * (d01 * x + d11 * y) * iz;
+
+      // Pose position: A * C_CiB, extrinsic position: -A * C_CiB
+      J0[0][k] = a00 * C_CiB[0] + a01 * C_CiB[3] + a02 * C_CiB[6];
+      J0[1][k] = a00 * C_CiB[1] + a01 * C_CiB[4] + a02 * C_CiB[7];
+      J0[2][k] = a00 * C_CiB[2] + a01 * C_CiB[5] + a02 * C_CiB[8];
+      J1[0][k] = a10 * C_CiB[0] + a11 * C_CiB[3] + a12 * C_CiB[6];
+      J1[1][k] = a10 * C_CiB[1] + a11 * C_CiB[4] + a12 * C_CiB[7];
+      J1[2][k] = a10 * C_CiB[2] + a11 * C_CiB[5] + a12 * C_CiB[8];
+      J0[6][k] = -J0[0][k];
+      J0[7][k] = -J0[1][k];
+      J0[8][k] = -J0[2][k];
+      J1[6][k] = -J1[0][k];
+      J1[7][k] = -J1[1][k];
+      J1[8][k] = -J1[2][k];
+
+      // Pose rotation: -A * C_CiF * hat(p_F) = p_F x (C_CiF' * a)
+      const real_t b00 = a00 * C_CiF[0] + a01 * C_CiF[3] + a02 * C_CiF[6];
+      const real_t b01 = a00 * C_CiF[1] + a01 * C_CiF[4] + a02 * C_CiF[7];
+      const real_t b02 = a00 * C_CiF[2] + a01 * C_CiF[5] + a02 * C_CiF[8];
+      const real_t b10 = a10 * C_CiF[0] + a11 * C_CiF[3] + a12 * C_CiF[6];
+      const real_t b11 = a10 * C_CiF[1] + a11 * C_CiF[4] + a12 * C_CiF[7];
+      const real_t b12 = a10 * C_CiF[2] + a11 * C_CiF[5] + a12 * C_CiF[8];
+      J0[3][k] = yF * b02 - zF * b01;
+      J0[4][k] = zF * b00 - xF * b02;
+      J0[5][k] = xF * b01 - yF * b00;
+      J1[3][k] = yF * b12 - zF * b11;
+      J1[4][k] = zF * b10 - xF * b12;
+      J1[5][k] = xF * b11 - yF * b10;
+
+      // Extrinsic rotation: A * hat(p_C) = a x p_C
+      J0[9][k] = a01 * pz - a02 * py;
+      J0[10][k] = a02 * px - a00 * pz;
+      J0[11][k] = a00 * py - a01 * px;
+      J1[9][k] = a11 * pz - a12 * py;
+      J1[10][k] = a12 * px - a10 * pz;
+      J1[11][k] = a10 * py - a11 * px;
+
+      // Camera parameters: -sqrt_info * [J_proj_params, J_k * J_dist_params]
+      J0[12][k] = w0 * xd;
+      J0[13][k] = 0.0;
+      J0[14][k] = w0;
+      J0[15][k] = 0.0;
+      J0[16][k] = w0 * fx * x * r2;
+      J0[17][k] = w0 * fx * x * r4;
+      J0[18][k] = w0 * fx * 2.0 * xy;
+      J0[19][k] = w0 * fx * (3.0 * x2 + y2);
+      J1[12][k] = 0.0;
+      J1[13][k] = w1 * yd;
+      J1[14][k] = 0.0;
+      J1[15][k] = w1;
+      J1[16][k] = w1 * fy * y * r2;
+      J1[17][k] = w1 * fy * y * r4;
+      J1[18][k] = w1 * fy * (x2 + 3.0 * y2);
+      J1[19][k] = w1 * fy * 2.0 * xy;
+    }
+
+    // Write back residuals and per-factor Jacobians
+    for (int k = 0; k < n; k++) {
+      calib_camera_factor_t *factor = &factors[start + k];
+      factor->r[0] = r0[k];
+      factor->r[1] = r1[k];
+      r[(start + k) * 2 + 0] = r0[k];
+      r[(start + k) * 2 + 1] = r1[k];
+      for (int c = 0; c < 6; c++) {
+        factor->J_pose[c] = J0[c][k];
+        factor->J_pose[6 + c] = J1[c][k];
+        factor->J_cam_ext[c] = J0[6 + c][k];
+        factor->J_cam_ext[6 + c] = J1[6 + c][k];
+      }
+      for (int c = 0; c < 8; c++) {
+        factor->J_cam_params[c] = J0[12 + c][k];
+        factor->J_cam_params[8 + c] = J1[12 + c][k];
+      }
+    }
+    if (H == NULL || g == NULL) {
+      continue;
+    }
+
+    // Accumulate upper triangle of H_view = J' * J and g_view = -J' * r
+    for (int i = 0; i < N; i++) {
+      for (int j = i; j < N; j++) {
+        real_t sum = 0.0;
+#pragma omp simd reduction(+ : sum)
+        for (int k = 0; k < n; k++) {
+          sum += J0[i][k] * J0[j][k] + J1[i][k] * J1[j][k];
+        }
+        H_view[i * N + j] += sum;
+      }
+
+      real_t sum = 0.0;
+#pragma omp simd reduction(+ : sum)
+      for (int k = 0; k < n; k++) {
+        sum += J0[i][k] * r0[k] + J1[i][k] * r1[k];
+      }
+      g_view[i] -= sum;
+    }
+  }
+  if (H == NULL || g == NULL) {
+    return;
+  }
+
+  // Scatter view Hessian blocks into H and g
+  const int offsets[3] = {0, 6, 12};
+  const int sizes[3] = {6, 6, 8};
+  for (int bi = 0; bi < 3; bi++) {
+    const param_order_t pi = hmgets(hash, factors[0].params[bi]);
+    if (pi.fix) {
+      continue;
+    }
 
-/**
- * Free camera calibration view.
- */
-void calib_camera_view_free(calib_camera_view_t *view) {
-  if (view) {
-    free(view->tag_ids);
-    free(view->corner_indices);
-    free(view->object_points);
-    free(view->keypoints);
-    free(view->factors);
-    free(view);
+    for (int bj = bi; bj < 3; bj++) {
+      const param_order_t pj = hmgets(hash, factors[0].params[bj]);
+      if (pj.fix) {
+        continue;
+      }
+
+      for (int i = 0; i < sizes[bi]; i++) {
+        const int hi = offsets[bi] + i;
+        for (int j = 0; j < sizes[bj]; j++) {
+          const int hj = offsets[bj] + j;
+          const real_t h = (hi <= hj) ? H_view[hi * N + hj]
+                                      : H_view[hj * N + hi];
+          H[(pi.idx + i) * sv_size + (pj.idx + j)] += h;
+          if (bi != bj) {
+            H[(pj.idx + j) * sv_size + (pi.idx + i)] += h;
+          }
+        }
+      }
+    }
+
+    for (int i = 0; i < sizes[bi]; i++) {
+      g[pi.idx + i] += g_view[offsets[bi] + i];
+    }
   }
 }
 
@@ -16015,12 +18638,70 @@ void calib_camera_marginalize(calib_camera_t *calib) {
   calib->num_views--;
 }
 
+/**
+ * Add camera calibration data of camera `cam_idx` from AprilGrid archive.
+ */
+int calib_camera_add_archive(calib_camera_t *calib,
+                             const int cam_idx,
+                             const char *archive_path) {
+  aprilgrid_archive_t *archive = aprilgrid_archive_load(archive_path);
+  if (archive == NULL) {
+    return -1;
+  }
+
+  // Size buffers for the largest frame once
+  int max_corners = 0;
+  for (int i = 0; i < archive->num_frames; i++) {
+    max_corners = MAX(max_corners, archive->index[i].corners_detected);
+  }
+  int *tag_ids = MALLOC(int, max_corners);
+  int *corner_indices = MALLOC(int, max_corners);
+  real_t *kps = MALLOC(real_t, max_corners * 2);
+  real_t *pts = MALLOC(real_t, max_corners * 3);
+
+  // Frames are sorted by timestamp, add the ones observed by `cam_idx`
+  int view_idx = 0;
+  for (int i = 0; i < archive->num_frames; i++) {
+    if (archive->index[i].cam_idx != cam_idx) {
+      continue;
+    }
+
+    const aprilgrid_view_t grid = aprilgrid_archive_view(archive, i);
+    const timestamp_t ts = grid.frame->timestamp;
+    const int num_corners = grid.frame->corners_detected;
+    aprilgrid_view_measurements(&grid, tag_ids, corner_indices, kps, pts);
+    calib_camera_add_view(calib,
+                          ts,
+                          view_idx++,
+                          cam_idx,
+                          num_corners,
+                          tag_ids,
+                          corner_indices,
+                          pts,
+                          kps);
+  }
+
+  // Clean up
+  free(tag_ids);
+  free(corner_indices);
+  free(kps);
+  free(pts);
+  aprilgrid_archive_free(archive);
+
+  return (view_idx) ? 0 : -1;
+}
+
 /**
  * Add camera calibration data.
  */
 int calib_camera_add_data(calib_camera_t *calib,
                           const int cam_idx,
                           const char *data_path) {
+  // AprilGrid archive
+  if (aprilgrid_archive_check(data_path)) {
+    return calib_camera_add_archive(calib, cam_idx, data_path);
+  }
+
   // Get camera data
   int num_files = 0;
   char **files = list_files(data_path, &num_files);
@@ -16071,6 +18752,82 @@ int calib_camera_add_data(calib_camera_t *calib,
   return 0;
 }
 
+#if ENABLE_APRILGRID_DETECTOR == 1
+typedef struct calib_camera_images_t {
+  calib_camera_t *calib;
+  int cam_idx;
+} calib_camera_images_t;
+
+static void calib_camera_add_grid(void *data,
+                                  const int view_idx,
+                                  aprilgrid_t *grid) {
+  if (grid == NULL) {
+    return;
+  }
+
+  // Get aprilgrid measurements
+  calib_camera_images_t *images = (calib_camera_images_t *) data;
+  const int num_corners = grid->corners_detected;
+  int *tag_ids = MALLOC(int, num_corners);
+  int *corner_indices = MALLOC(int, num_corners);
+  real_t *kps = MALLOC(real_t, num_corners * 2);
+  real_t *pts = MALLOC(real_t, num_corners * 3);
+  aprilgrid_measurements(grid, tag_ids, corner_indices, kps, pts);
+
+  // Add view
+  calib_camera_add_view(images->calib,
+                        grid->timestamp,
+                        view_idx,
+                        images->cam_idx,
+                        num_corners,
+                        tag_ids,
+                        corner_indices,
+                        pts,
+                        kps);
+
+  // Clean up
+  free(tag_ids);
+  free(corner_indices);
+  free(kps);
+  free(pts);
+  aprilgrid_free(grid);
+}
+
+/**
+ * Detect AprilGrids in the images of `image_dir` with batch detector `det`
+ * and add them to the camera calibration problem in image order.
+ * @returns 0 for success, -1 for failure
+ */
+int calib_camera_add_images(calib_camera_t *calib,
+                            const int cam_idx,
+                            const char *image_dir,
+                            aprilgrid_batch_detector_t *det) {
+  assert(calib != NULL);
+  assert(image_dir != NULL);
+  assert(det != NULL);
+
+  int num_images = 0;
+  timestamp_t *timestamps = NULL;
+  char **paths = aprilgrid_list_images(image_dir, &timestamps, &num_images);
+  if (num_images == 0) {
+    return -1;
+  }
+
+  calib_camera_images_t images = {calib, cam_idx};
+  const int retval = aprilgrid_batch_detector_run(det,
+                                                  num_images,
+                                                  timestamps,
+                                                  paths,
+                                                  calib_camera_add_grid,
+                                                  &images);
+
+  list_files_free(paths, num_images);
+  free(timestamps);
+
+  return retval;
+}
+#endif // ENABLE_APRILGRID_DETECTOR
+
 /**
  * Camera calibration reprojection errors.
  */
@@ -16231,14 +18988,10 @@ void calib_camera_cost(const void *data, real_t *r) {
         continue;
       }
 
-      for (int factor_idx = 0; factor_idx < view->num_corners; factor_idx++) {
-        calib_camera_factor_t *factor = &view->factors[factor_idx];
-        calib_camera_factor_eval(factor);
-        vec_copy(factor->r, factor->r_size, &r[r_idx]);
-        r_idx += factor->r_size;
-      } // For each calib factor
-    }   // For each cameras
-  }     // For each views
+      calib_camera_view_linearize(view, 0, NULL, NULL, NULL, &r[r_idx]);
+      r_idx += view->num_corners * 2;
+    } // For each cameras
+  }   // For each views
 
   // -- Evaluate marginalization factor
   if (calib->marg) {
@@ -16256,6 +19009,8 @@ void calib_camera_linearize_compact(const void *data,
                                     real_t *H,
                                     real_t *g,
                                     real_t *r) {
+  TRACE_FUNC();
+
   // Evaluate factors
   calib_camera_t *calib = (calib_camera_t *) data;
   int r_idx = 0;
@@ -16269,24 +19024,10 @@ void calib_camera_linearize_compact(const void *data,
         continue;
       }
 
-      for (int factor_idx = 0; factor_idx < view->num_corners; factor_idx++) {
-        calib_camera_factor_t *factor = &view->factors[factor_idx];
-        calib_camera_factor_eval(factor);
-        vec_copy(factor->r, factor->r_size, &r[r_idx]);
-
-        solver_fill_hessian(hash,
-                            factor->num_params,
-                            factor->params,
-                            factor->jacs,
-                            factor->r,
-                            factor->r_size,
-                            sv_size,
-                            H,
-                            g);
-        r_idx += factor->r_size;
-      } // For each calib factor
-    }   // For each cameras
-  }     // For each views
+      calib_camera_view_linearize(view, sv_size, hash, H, g, &r[r_idx]);
+      r_idx += view->num_corners * 2;
+    } // For each cameras
+  }   // For each views
 
   // -- Evaluate marginalization factor
   if (calib->marg) {
@@ -17435,6 +20176,8 @@ void calib_imucam_linearize_compact(const void *data,
                                     real_t *H,
                                     real_t *g,
                                     real_t *r) {
+  TRACE_FUNC();
+
   // Evaluate factors
   calib_imucam_t *calib = (calib_imucam_t *) data;
   int r_idx = 0;
@@ -17791,6 +20534,20 @@ void calib_gimbal_setup(calib_gimbal_t *calib) {
   calib->fix_cam_exts = 0;
   calib->fix_cam_params = 1;
 
+  // Calibration target
+  calib->num_rows = 6;
+  calib->num_cols = 6;
+  calib->tag_size = 0.088;
+  calib->tag_spacing = 0.3;
+
+  // NBV settings
+  calib->nbv_threads = 0;
+  for (int joint_idx = 0; joint_idx < 3; joint_idx++) {
+    calib->nbv_parts[joint_idx] = 5;
+    calib->nbv_range[joint_idx][0] = deg2rad(-45.0);
+    calib->nbv_range[joint_idx][1] = deg2rad(45.0);
+  }
+
   // Counters
   calib->num_cams = 0;
   calib->num_views = 0;
@@ -17949,6 +20706,16 @@ calib_gimbal_t *calib_gimbal_copy(const calib_gimbal_t *src) {
   dst->fix_cam_exts = src->fix_cam_exts;
   dst->fix_links = src->fix_links;
   dst->fix_joints = src->fix_joints;
+  dst->nbv_threads = src->nbv_threads;
+  for (int joint_idx = 0; joint_idx < 3; joint_idx++) {
+    dst->nbv_parts[joint_idx] = src->nbv_parts[joint_idx];
+    dst->nbv_range[joint_idx][0] = src->nbv_range[joint_idx][0];
+    dst->nbv_range[joint_idx][1] = src->nbv_range[joint_idx][1];
+  }
+  dst->num_rows = src->num_rows;
+  dst->num_cols = src->num_cols;
+  dst->tag_size = src->tag_size;
+  dst->tag_spacing = src->tag_spacing;
 
   // Flags
   dst->fiducial_ext_ok = src->fiducial_ext_ok;
@@ -18626,8 +21393,85 @@ static void calib_gimbal_load_poses(calib_gimbal_t *calib,
   fclose(poses_file);
 }
 
+/**
+ * Load gimbal calibration view from AprilGrid csv file.
+ */
+static void calib_gimbal_load_view_csv(const char *view_fpath,
+                                       int *num_corners,
+                                       int **tag_ids,
+                                       int **corner_indices,
+                                       real_t **object_points,
+                                       real_t **keypoints) {
+  // Load view data
+  FILE *view_file = fopen(view_fpath, "r");
+  if (view_file == NULL) {
+    FATAL("Failed to open file [%s]\n", view_fpath);
+  }
+
+  timestamp_t timestamp = 0;
+  int num_rows = 0;
+  int num_cols = 0;
+  double tag_size = 0.0;
+  double tag_spacing = 0.0;
+  parse_key_value(view_file, "timestamp", "int64_t", &timestamp);
+  parse_key_value(view_file, "num_rows", "int", &num_rows);
+  parse_key_value(view_file, "num_cols", "int", &num_cols);
+  parse_key_value(view_file, "tag_size", "int", &tag_size);
+  parse_key_value(view_file, "tag_spacing", "int", &tag_spacing);
+  parse_skip_line(view_file);
+  parse_key_value(view_file, "corners_detected", "int", num_corners);
+
+  const int n = *num_corners;
+  *tag_ids = MALLOC(int, n);
+  *corner_indices = MALLOC(int, n);
+  *object_points = MALLOC(real_t, n * 3);
+  *keypoints = MALLOC(real_t, n * 2);
+
+  if (n) {
+    parse_skip_line(view_file);
+    for (int i = 0; i < n; i++) {
+      // Get line
+      const size_t buf_len = 1024;
+      char buf[1024] = {0};
+      if (fgets(buf, buf_len, view_file) == NULL) {
+        printf("file: %s, line: [%s]\n", view_fpath, buf);
+        FATAL("Failed to view parse data!\n");
+      }
+
+      // Parse line
+      real_t data[7] = {0};
+      parse_vector_line(buf, "double", data, 7);
+
+      // Add to view
+      (*tag_ids)[i] = (int) data[0];
+      (*corner_indices)[i] = (int) data[1];
+      (*keypoints)[i * 2 + 0] = data[2];
+      (*keypoints)[i * 2 + 1] = data[3];
+      (*object_points)[i * 3] = data[4];
+      (*object_points)[i * 3 + 1] = data[5];
+      (*object_points)[i * 3 + 2] = data[6];
+    }
+  }
+
+  // Clean up
+  fclose(view_file);
+}
+
 static void calib_gimbal_load_views(calib_gimbal_t *calib,
                                     const char *data_path) {
+  // Use AprilGrid archive "aprilgrids.bin" if the dataset has one, else
+  // fall back to one csv file per camera view
+  char archive_path[1000] = {0};
+  string_cat(archive_path, data_path);
+  string_cat(archive_path, "/aprilgrids.bin");
+  aprilgrid_archive_t *archive = NULL;
+  if (file_exists(archive_path) && aprilgrid_archive_check(archive_path)) {
+    archive = aprilgrid_archive_load(archive_path);
+    if (archive == NULL) {
+      FATAL("Failed to load AprilGrid archive [%s]\n", archive_path);
+    }
+  }
+
   // Load views
   calib->views = MALLOC(calib_gimbal_view_t **, calib->num_views);
 
@@ -18635,63 +21479,45 @@ static void calib_gimbal_load_views(calib_gimbal_t *calib,
     calib->views[view_idx] = MALLOC(calib_gimbal_view_t *, calib->num_cams);
 
     for (int cam_idx = 0; cam_idx < calib->num_cams; cam_idx++) {
-      // Form view file path
-      char view_fpath[1000] = {0};
-      char *vfile_fmt = "/cam%d/%ld.csv";
       const timestamp_t ts = calib->timestamps[view_idx];
-      string_cat(view_fpath, data_path);
-      sprintf(view_fpath + strlen(view_fpath), vfile_fmt, cam_idx, ts);
-
-      // Load view data
-      FILE *view_file = fopen(view_fpath, "r");
-      if (view_file == NULL) {
-        FATAL("Failed to open file [%s]\n", view_fpath);
-      }
-
-      timestamp_t timestamp = 0;
-      int num_rows = 0;
-      int num_cols = 0;
-      double tag_size = 0.0;
-      double tag_spacing = 0.0;
       int num_corners = 0;
-      parse_key_value(view_file, "timestamp", "int64_t", &timestamp);
-      parse_key_value(view_file, "num_rows", "int", &num_rows);
-      parse_key_value(view_file, "num_cols", "int", &num_cols);
-      parse_key_value(view_file, "tag_size", "int", &tag_size);
-      parse_key_value(view_file, "tag_spacing", "int", &tag_spacing);
-      parse_skip_line(view_file);
-      parse_key_value(view_file, "corners_detected", "int", &num_corners);
-
-      int *tag_ids = MALLOC(int, num_corners);
-      int *corner_indices = MALLOC(int, num_corners);
-      real_t *object_points = MALLOC(real_t, num_corners * 3);
-      real_t *keypoints = MALLOC(real_t, num_corners * 2);
-
-      if (num_corners) {
-        parse_skip_line(view_file);
-        for (int i = 0; i < num_corners; i++) {
-          // Get line
-          const size_t buf_len = 1024;
-          char buf[1024] = {0};
-          if (fgets(buf, buf_len, view_file) == NULL) {
-            printf("file: %s, line: [%s]\n", view_fpath, buf);
-            FATAL("Failed to view parse data!\n");
-          }
-
-          // Parse line
-          real_t data[7] = {0};
-          parse_vector_line(buf, "double", data, 7);
-
-          // Add to view
-          tag_ids[i] = (int) data[0];
-          corner_indices[i] = (int) data[1];
-          keypoints[i * 2 + 0] = data[2];
-          keypoints[i * 2 + 1] = data[3];
-          object_points[i * 3] = data[4];
-          object_points[i * 3 + 1] = data[5];
-          object_points[i * 3 + 2] = data[6];
+      int *tag_ids = NULL;
+      int *corner_indices = NULL;
+      real_t *object_points = NULL;
+      real_t *keypoints = NULL;
+
+      if (archive) {
+        const int frame_idx = aprilgrid_archive_find(archive, ts, cam_idx);
+        if (frame_idx == -1) {
+          FATAL("View [cam%d/%ld] not in [%s]\n", cam_idx, ts, archive_path);
         }
+        const aprilgrid_view_t grid =
+            aprilgrid_archive_view(archive, frame_idx);
+        num_corners = grid.frame->corners_detected;
+        tag_ids = MALLOC(int, num_corners);
+        corner_indices = MALLOC(int, num_corners);
+        object_points = MALLOC(real_t, num_corners * 3);
+        keypoints = MALLOC(real_t, num_corners * 2);
+        aprilgrid_view_measurements(&grid,
+                                    tag_ids,
+                                    corner_indices,
+                                    keypoints,
+                                    object_points);
+      } else {
+        // Form view file path
+        char view_fpath[1000] = {0};
+        char *vfile_fmt = "/cam%d/%ld.csv";
+        string_cat(view_fpath, data_path);
+        sprintf(view_fpath + strlen(view_fpath), vfile_fmt, cam_idx, ts);
+        calib_gimbal_load_view_csv(view_fpath,
+                                   &num_corners,
+                                   &tag_ids,
+                                   &corner_indices,
+                                   &object_points,
+                                   &keypoints);
+      }
 
+      if (num_corners) {
         if (calib->fiducial_ext_ok == 0) {
           real_t *keypoints_ud = MALLOC(real_t, num_corners * 2);
           real_t *params = calib->cam_params[cam_idx].data;
@@ -18779,11 +21605,11 @@ static void calib_gimbal_load_views(calib_gimbal_t *calib,
       free(corner_indices);
       free(object_points);
       free(keypoints);
-
-      // Clean up
-      fclose(view_file);
     }
   }
+
+  // Clean up
+  aprilgrid_archive_free(archive);
 }
 
 /**
@@ -18906,207 +21732,383 @@ void calib_gimbal_save(const calib_gimbal_t *calib, const char *save_path) {
   }
 
   // Clean up
-  fclose(yaml);
-}
+  fclose(yaml);
+}
+
+int calib_gimbal_validate(calib_gimbal_t *calib) {
+  const int num_checks = 6;
+  const char *checklist_names[] = {"calib->fiducial_ext_ok",
+                                   "calib->gimbal_ext_ok",
+                                   "calib->poses_ok",
+                                   "calib->cams_ok",
+                                   "calib->links_ok",
+                                   "calib->joints_ok"};
+  const int checklist_vals[] = {calib->fiducial_ext_ok,
+                                calib->gimbal_ext_ok,
+                                calib->poses_ok,
+                                calib->cams_ok,
+                                calib->links_ok,
+                                calib->joints_ok};
+
+  for (int i = 0; i < num_checks; i++) {
+    if (checklist_vals[i] != 1) {
+      LOG_ERROR("%s != 1\n", checklist_names[i]);
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * Calculate the Shannon-Entropy of the current gimbal calibration problem.
+ */
+int calib_gimbal_shannon_entropy(calib_gimbal_t *calib, real_t *entropy) {
+  // Determine parameter order
+  int sv_size = 0;
+  int r_size = 0;
+  param_order_t *hash = calib_gimbal_param_order(calib, &sv_size, &r_size);
+
+  // Form Hessian H
+  real_t *H = CALLOC(real_t, sv_size * sv_size);
+  real_t *g = CALLOC(real_t, sv_size);
+  real_t *r = CALLOC(real_t, r_size);
+  calib_gimbal_linearize_compact(calib, sv_size, hash, H, g, r);
+
+  // Estimate covariance
+  real_t *covar = CALLOC(real_t, sv_size * sv_size);
+  pinv(H, sv_size, sv_size, covar);
+
+  // Calculate shannon-entropy
+  int status = 0;
+  if (shannon_entropy(covar, sv_size, entropy) != 0) {
+    status = -1;
+  }
+
+  // Clean up
+  hmfree(hash);
+  free(H);
+  free(g);
+  free(r);
+  free(covar);
+
+  return status;
+}
+
+/**
+ * Form the NBV candidate joint angles from the `nbv_parts` x `nbv_range`
+ * grid settings. `joints` is malloced with 3 joint angles per candidate.
+ * @returns Number of candidates
+ */
+int calib_gimbal_nbv_candidates(const calib_gimbal_t *calib, real_t **joints) {
+  assert(calib != NULL);
+  assert(joints != NULL);
+
+  int parts[3] = {0};
+  real_t steps[3] = {0};
+  int num_candidates = 1;
+  for (int i = 0; i < 3; i++) {
+    parts[i] = MAX(calib->nbv_parts[i], 1);
+    const real_t range = calib->nbv_range[i][1] - calib->nbv_range[i][0];
+    steps[i] = (parts[i] > 1) ? range / (parts[i] - 1) : 0.0;
+    num_candidates *= parts[i];
+  }
+
+  *joints = MALLOC(real_t, num_candidates * 3);
+  int idx = 0;
+  for (int i = 0; i < parts[0]; i++) {
+    for (int j = 0; j < parts[1]; j++) {
+      for (int k = 0; k < parts[2]; k++) {
+        (*joints)[idx * 3 + 0] = calib->nbv_range[0][0] + i * steps[0];
+        (*joints)[idx * 3 + 1] = calib->nbv_range[1][0] + j * steps[1];
+        (*joints)[idx * 3 + 2] = calib->nbv_range[2][0] + k * steps[2];
+        idx++;
+      }
+    }
+  }
+
+  return num_candidates;
+}
+
+typedef struct calib_gimbal_nbv_worker_t {
+  const calib_gimbal_t *calib;
+  const info_gain_t *ig;
+  const aprilgrid_t *calib_target;
+  const real_t *joints;
+  real_t *entropies;
+} calib_gimbal_nbv_worker_t;
+
+/**
+ * Score NBV candidate `joints`. The candidate views are simulated and only
+ * their Jacobians are evaluated on per-thread copies of the parameters, the
+ * shared calibration problem is only read.
+ */
+static int calib_gimbal_nbv_score(const calib_gimbal_nbv_worker_t *worker,
+                                  const real_t joints[3],
+                                  real_t *entropy) {
+  const calib_gimbal_t *calib = worker->calib;
+  const info_gain_t *ig = worker->ig;
+  const int n = ig->size;
+  const int nbv_idx = calib->num_views;
+  const timestamp_t ts = nbv_idx;
+  const int pose_idx = 0;
+  const int num_cams = calib->num_cams;
+
+  // Candidate joint angles, with the same prior calib_gimbal_add_view() uses
+  const real_t joint_var = 0.1;
+  const real_t info = 1.0 / joint_var;
+  const real_t joint_info[3] = {info, info, info};
+  joint_t nbv_joints[3];
+  for (int joint_idx = 0; joint_idx < 3; joint_idx++) {
+    joint_setup(&nbv_joints[joint_idx], ts, joint_idx, joints[joint_idx]);
+  }
+
+  // Copy the parameters the candidate factors reference
+  fiducial_t fiducial_ext;
+  extrinsic_t gimbal_ext;
+  pose_t pose;
+  extrinsic_t links[2];
+  fiducial_copy(&calib->fiducial_ext, &fiducial_ext);
+  extrinsic_copy(&calib->gimbal_ext, &gimbal_ext);
+  pose_copy(&calib->poses[pose_idx], &pose);
+  extrinsic_copy(&calib->links[0], &links[0]);
+  extrinsic_copy(&calib->links[1], &links[1]);
+
+  // Simulate candidate views
+  sim_gimbal_view_t **sim_views = MALLOC(sim_gimbal_view_t *, num_cams);
+  int m = 0;
+  for (int cam_idx = 0; cam_idx < num_cams; cam_idx++) {
+    sim_views[cam_idx] =
+        sim_gimbal3_view(worker->calib_target,
+                         ts,
+                         nbv_idx,
+                         calib->fiducial_ext.data,
+                         calib->poses[pose_idx].data,
+                         calib->gimbal_ext.data,
+                         calib->links[0].data,
+                         calib->links[1].data,
+                         joints[0],
+                         joints[1],
+                         joints[2],
+                         cam_idx,
+                         calib->cam_params[cam_idx].resolution,
+                         calib->cam_params[cam_idx].data,
+                         calib->cam_exts[cam_idx].data);
+    m += sim_views[cam_idx]->num_measurements * 2;
+  }
+
+  // Form candidate Jacobians w.r.t. the scored parameters and the joints
+  real_t *J = CALLOC(real_t, m * n);
+  real_t *J_joints = CALLOC(real_t, m * 3);
+  int r_idx = 0;
+  for (int cam_idx = 0; cam_idx < num_cams; cam_idx++) {
+    sim_gimbal_view_t *sim_view = sim_views[cam_idx];
+    extrinsic_t cam_ext;
+    camera_params_t cam_params;
+    extrinsic_copy(&calib->cam_exts[cam_idx], &cam_ext);
+    camera_params_copy(&calib->cam_params[cam_idx], &cam_params);
+
+    // Shared parameters in factor parameter order, used to find the columns
+    const real_t *calib_params[10] = {calib->fiducial_ext.data,
+                                      calib->gimbal_ext.data,
+                                      calib->poses[pose_idx].data,
+                                      calib->links[0].data,
+                                      calib->links[1].data,
+                                      NULL,
+                                      NULL,
+                                      NULL,
+                                      calib->cam_exts[cam_idx].data,
+                                      calib->cam_params[cam_idx].data};
+
+    calib_gimbal_view_t *view =
+        calib_gimbal_view_malloc(ts,
+                                 nbv_idx,
+                                 cam_idx,
+                                 sim_view->tag_ids,
+                                 sim_view->corner_indices,
+                                 sim_view->object_points,
+                                 sim_view->keypoints,
+                                 sim_view->num_measurements,
+                                 &fiducial_ext,
+                                 &gimbal_ext,
+                                 &pose,
+                                 &links[0],
+                                 &links[1],
+                                 &nbv_joints[0],
+                                 &nbv_joints[1],
+                                 &nbv_joints[2],
+                                 &cam_ext,
+                                 &cam_params);
+
+    for (int factor_idx = 0; factor_idx < view->num_corners; factor_idx++) {
+      calib_gimbal_factor_t *factor = &view->calib_factors[factor_idx];
+      calib_gimbal_factor_eval(factor);
+
+      for (int i = 0; i < factor->num_params; i++) {
+        const real_t *param = factor->params[i];
+        const real_t *jac = factor->jacs[i];
+        const int size = param_local_size(factor->param_types[i]);
+
+        for (int joint_idx = 0; joint_idx < 3; joint_idx++) {
+          if (param == nbv_joints[joint_idx].data) {
+            J_joints[(r_idx + 0) * 3 + joint_idx] = jac[0];
+            J_joints[(r_idx + 1) * 3 + joint_idx] = jac[1];
+          }
+        }
+
+        if (calib_params[i] == NULL) {
+          continue;
+        }
+        const int col = info_gain_col(ig, calib_params[i]);
+        if (col == -1) {
+          continue;
+        }
+        for (int j = 0; j < size; j++) {
+          J[(r_idx + 0) * n + col + j] = jac[0 * size + j];
+          J[(r_idx + 1) * n + col + j] = jac[1 * size + j];
+        }
+      }
+      r_idx += 2;
+    }
+
+    calib_gimbal_view_free(view);
+    sim_gimbal_view_free(sim_view);
+  }
+
+  // Score
+  const int p = (calib->fix_joints) ? 0 : 3;
+  const int status = info_gain_eval(ig, J, J_joints, joint_info, m, p, entropy);
+
+  // Clean up
+  free(sim_views);
+  free(J);
+  free(J_joints);
 
-int calib_gimbal_validate(calib_gimbal_t *calib) {
-  const int num_checks = 6;
-  const char *checklist_names[] = {"calib->fiducial_ext_ok",
-                                   "calib->gimbal_ext_ok",
-                                   "calib->poses_ok",
-                                   "calib->cams_ok",
-                                   "calib->links_ok",
-                                   "calib->joints_ok"};
-  const int checklist_vals[] = {calib->fiducial_ext_ok,
-                                calib->gimbal_ext_ok,
-                                calib->poses_ok,
-                                calib->cams_ok,
-                                calib->links_ok,
-                                calib->joints_ok};
+  return status;
+}
 
-  for (int i = 0; i < num_checks; i++) {
-    if (checklist_vals[i] != 1) {
-      LOG_ERROR("%s != 1\n", checklist_names[i]);
-      return -1;
-    }
+/**
+ * Score NBV candidate `idx`.
+ */
+static void calib_gimbal_nbv_task(void *data, const int idx, const int thread) {
+  UNUSED(thread);
+  calib_gimbal_nbv_worker_t *worker = (calib_gimbal_nbv_worker_t *) data;
+  real_t entropy = INFINITY;
+  const real_t *joints = worker->joints + idx * 3;
+  if (calib_gimbal_nbv_score(worker, joints, &entropy) != 0) {
+    entropy = INFINITY;
   }
-
-  return 0;
+  worker->entropies[idx] = entropy;
 }
 
 /**
- * Calculate the Shannon-Entropy of the current gimbal calibration problem.
+ * Score `num_candidates` NBV candidate joint angles `joints` (3 per
+ * candidate) in parallel. `entropies` holds the Shannon-Entropy of the
+ * calibration parameters (everything but the joint angles) after adding the
+ * candidate view, or INFINITY if it could not be evaluated.
+ *
+ * The marginal covariance of the calibration parameters is formed once, each
+ * candidate is then scored with a rank update from its view's Jacobian only,
+ * see `info_gain_eval()`.
+ *
+ * @returns 0 for success, -1 for failure
  */
-int calib_gimbal_shannon_entropy(calib_gimbal_t *calib, real_t *entropy) {
-  // Determine parameter order
+int calib_gimbal_nbv_eval(const calib_gimbal_t *calib,
+                          const real_t *joints,
+                          const int num_candidates,
+                          real_t *entropies) {
+  assert(calib != NULL);
+  assert(joints != NULL);
+  assert(entropies != NULL);
+  if (num_candidates <= 0) {
+    return -1;
+  }
+
+  // Form information matrix, the joint angles are ordered last
   int sv_size = 0;
   int r_size = 0;
   param_order_t *hash = calib_gimbal_param_order(calib, &sv_size, &r_size);
-
-  // Form Hessian H
   real_t *H = CALLOC(real_t, sv_size * sv_size);
   real_t *g = CALLOC(real_t, sv_size);
   real_t *r = CALLOC(real_t, r_size);
   calib_gimbal_linearize_compact(calib, sv_size, hash, H, g, r);
-
-  // Estimate covariance
-  real_t *covar = CALLOC(real_t, sv_size * sv_size);
-  pinv(H, sv_size, sv_size, covar);
-
-  // Calculate shannon-entropy
-  int status = 0;
-  if (shannon_entropy(covar, sv_size, entropy) != 0) {
-    status = -1;
+  const int num_joint_params =
+      (calib->fix_joints) ? 0 : calib->num_views * calib->num_joints;
+  const int col_e = sv_size - num_joint_params - 1;
+  info_gain_t *ig = NULL;
+  if (col_e >= 0) {
+    ig = info_gain_malloc(hash, H, sv_size, 0, col_e);
   }
-
-  // Clean up
   hmfree(hash);
   free(H);
   free(g);
   free(r);
+  if (ig == NULL) {
+    return -1;
+  }
 
-  return status;
+  // Score candidates
+  aprilgrid_t *calib_target = aprilgrid_malloc(calib->num_rows,
+                                               calib->num_cols,
+                                               calib->tag_size,
+                                               calib->tag_spacing);
+  calib_gimbal_nbv_worker_t worker = {.calib = calib,
+                                      .ig = ig,
+                                      .calib_target = calib_target,
+                                      .joints = joints,
+                                      .entropies = entropies};
+  parallel_for(num_candidates,
+               calib->nbv_threads,
+               calib_gimbal_nbv_task,
+               &worker);
+
+  // Clean up
+  aprilgrid_free(calib_target);
+  info_gain_free(ig);
+
+  return 0;
 }
 
 /**
  * Find the next best view for the gimbal calibration problem.
  */
 void calib_gimbal_nbv(calib_gimbal_t *calib, real_t nbv_joints[3]) {
-  // Sample settings
-  const real_t parts_roll = 5;
-  const real_t parts_pitch = 5;
-  const real_t parts_yaw = 5;
-  const int num_views = parts_roll * parts_pitch * parts_yaw;
-  const real_t range_roll[2] = {deg2rad(-45.0), deg2rad(45.0)};
-  const real_t range_pitch[2] = {deg2rad(-45.0), deg2rad(45.0)};
-  const real_t range_yaw[2] = {deg2rad(-45.0), deg2rad(45.0)};
-  const real_t droll = (range_roll[1] - range_roll[0]) / parts_roll;
-  const real_t dpitch = (range_pitch[1] - range_pitch[0]) / parts_pitch;
-  const real_t dyaw = (range_yaw[1] - range_yaw[0]) / parts_yaw;
-
-  real_t *entropy_scores = MALLOC(real_t, num_views);
-  real_t *entropy_joints = MALLOC(real_t, num_views * 3);
-  int idx = 0;
-  for (real_t r = range_roll[0]; r < range_roll[1]; r += droll) {
-    for (real_t p = range_pitch[0]; p < range_pitch[1]; p += dpitch) {
-      for (real_t y = range_yaw[0]; y < range_yaw[1]; y += dyaw) {
-        entropy_joints[idx + 0] = y;
-        entropy_joints[idx + 1] = r;
-        entropy_joints[idx + 2] = p;
-        idx++;
-      }
-    }
-  }
-
-  // Calculate current entropy
-  real_t entropy_init = 0.0;
-  if (calib_gimbal_shannon_entropy(calib, &entropy_init) != 0) {
+  // Calculate NBV entropies
+  real_t *joints = NULL;
+  const int num_candidates = calib_gimbal_nbv_candidates(calib, &joints);
+  real_t *entropies = MALLOC(real_t, num_candidates);
+  if (calib_gimbal_nbv_eval(calib, joints, num_candidates, entropies) != 0) {
+    free(joints);
+    free(entropies);
     return;
   }
 
-  // Calculate NBV entropies
-  const int nbv_idx = calib->num_views;
-  const timestamp_t ts = nbv_idx;
-  const int pose_idx = 0;
-  aprilgrid_t *calib_target = aprilgrid_malloc(calib->num_rows,
-                                               calib->num_cols,
-                                               calib->tag_size,
-                                               calib->tag_spacing);
-
-  for (int view_idx = 0; view_idx < num_views; view_idx++) {
-    // Make a copy of the gimbal calibration problem
-    calib_gimbal_t *calib_copy = calib_gimbal_copy(calib);
-
-    // Form gimbal joint angles
-    const int num_joints = 3;
-    const real_t y = entropy_joints[view_idx + 0];
-    const real_t r = entropy_joints[view_idx + 1];
-    const real_t p = entropy_joints[view_idx + 2];
-    const real_t joints[3] = {y, r, p};
-
-    // Simulate gimbal view
-    for (int cam_idx = 0; cam_idx < calib->num_cams; cam_idx++) {
-      // Gimbal view
-      sim_gimbal_view_t *view =
-          sim_gimbal3_view(calib_target,
-                           ts,
-                           nbv_idx,
-                           calib_copy->fiducial_ext.data,
-                           calib_copy->poses[pose_idx].data,
-                           calib_copy->gimbal_ext.data,
-                           calib_copy->links[0].data,
-                           calib_copy->links[1].data,
-                           joints[0],
-                           joints[1],
-                           joints[2],
-                           cam_idx,
-                           calib_copy->cam_params[cam_idx].resolution,
-                           calib_copy->cam_params[cam_idx].data,
-                           calib_copy->cam_exts[cam_idx].data);
-
-      // Add view to calibration problem
-      calib_gimbal_add_view(calib_copy,
-                            pose_idx,
-                            nbv_idx,
-                            ts,
-                            cam_idx,
-                            view->num_measurements,
-                            view->tag_ids,
-                            view->corner_indices,
-                            view->object_points,
-                            view->keypoints,
-                            joints,
-                            num_joints);
-
-      // Free view data
-      sim_gimbal_view_free(view);
-    }
-
-    // Calculate shannon entropy
-    real_t entropy_view = 0.0;
-    if (calib_gimbal_shannon_entropy(calib_copy, &entropy_view) != 0) {
+  // Find best
+  int best_idx = -1;
+  for (int idx = 0; idx < num_candidates; idx++) {
+    if (isfinite(entropies[idx]) == 0) {
       continue;
     }
-    entropy_scores[view_idx] = entropy_view;
-
-    // // Remove view
-    // calib_gimbal_remove_view(calib, nbv_idx);
-    calib_gimbal_free(calib_copy);
-
-    // printf("yaw: %.2f, ", y);
-    // printf("roll: %.2f, ", r);
-    // printf("pitch: %.2f, ", p);
-    // printf("entropy_view: %.2f, ", entropy_view);
-    // printf("entropy_best: %.2f\n", entropy_best);
-    printf(".");
-    fflush(stdout);
+    if (best_idx == -1 || entropies[idx] < entropies[best_idx]) {
+      best_idx = idx;
+    }
+  }
+  if (best_idx == -1) {
+    free(joints);
+    free(entropies);
+    return;
   }
+  vec_copy(joints + best_idx * 3, 3, nbv_joints);
 
-  // Find best
-  real_t entropy_best = 0.0;
-  real_t joints_best[3] = {0.0, 0.0, 0.0};
-  for (int view_idx = 0; view_idx < num_views; view_idx++) {
-    if (entropy_scores[view_idx] < entropy_best) {
-      entropy_best = entropy_scores[view_idx];
-      joints_best[0] = entropy_joints[view_idx + 0];
-      joints_best[1] = entropy_joints[view_idx + 1];
-      joints_best[2] = entropy_joints[view_idx + 2];
-    }
-  }
-  free(entropy_scores);
-  free(entropy_joints);
-
-  vec_copy(joints_best, 3, nbv_joints);
-  printf("calib_entropy: %.2f, ", entropy_init);
-  printf("nbv_entropy: %.2f, ", entropy_best);
+  printf("nbv_entropy: %.2f, ", entropies[best_idx]);
   printf("nbv_joints: [");
   printf("%.2f, ", rad2deg(nbv_joints[0]));
   printf("%.2f, ", rad2deg(nbv_joints[1]));
   printf("%.2f]\n", rad2deg(nbv_joints[2]));
-  // printf("\n");
 
   // Clean up
-  aprilgrid_free(calib_target);
+  free(joints);
+  free(entropies);
 }
 
 /**
@@ -19322,6 +22324,8 @@ void calib_gimbal_linearize_compact(const void *data,
                                     real_t *H,
                                     real_t *g,
                                     real_t *r) {
+  TRACE_FUNC();
+
   // Evaluate factors
   calib_gimbal_t *calib = (calib_gimbal_t *) data;
   assert(calib_gimbal_validate(calib) == 0);
@@ -19417,10 +22421,43 @@ void inertial_odometry_free(inertial_odometry_t *odom) {
 }
 
 /**
- * Save inertial odometry.
+ * Save inertial odometry to telemetry log.
+ */
+static void inertial_odometry_save_tlog(const inertial_odometry_t *odom,
+                                        const char *save_path) {
+  tlog_writer_t *writer = tlog_writer_malloc(save_path);
+  if (writer == NULL) {
+    FATAL("Failed to open [%s]!\n", save_path);
+  }
+
+  const int pose = tlog_writer_channel(writer, "pose", TLOG_REAL, 7);
+  const int vel = tlog_writer_channel(writer, "velocity", TLOG_REAL, 3);
+  const int biases = tlog_writer_channel(writer, "biases", TLOG_REAL, 6);
+  for (int k = 0; k < (odom->num_factors + 1); k++) {
+    const timestamp_t ts = odom->poses[k].ts;
+    tlog_write(writer, pose, ts, odom->poses[k].data);
+    tlog_write(writer, vel, ts, odom->vels[k].data);
+    tlog_write(writer, biases, ts, odom->biases[k].data);
+  }
+
+  if (tlog_writer_close(writer) != 0) {
+    FATAL("Failed to save [%s]!\n", save_path);
+  }
+}
+
+/**
+ * Save inertial odometry. Paths ending with ".tlog" are saved as a telemetry
+ * log with channels "pose", "velocity" and "biases", otherwise as csv.
  */
 void inertial_odometry_save(const inertial_odometry_t *odom,
                             const char *save_path) {
+  char ext[1024] = {0};
+  path_file_ext(save_path, ext);
+  if (strcmp(ext, "tlog") == 0) {
+    inertial_odometry_save_tlog(odom, save_path);
+    return;
+  }
+
   // Load file
   FILE *fp = fopen(save_path, "w");
   if (fp == NULL) {
@@ -19449,6 +22486,7 @@ void inertial_odometry_save(const inertial_odometry_t *odom,
     fprintf(fp, "%f,%f,%f", bg[0], bg[1], bg[2]);
     fprintf(fp, "\n");
   }
+  fclose(fp);
 }
 
 /**
@@ -19495,6 +22533,8 @@ void inertial_odometry_linearize_compact(const void *data,
                                          real_t *H,
                                          real_t *g,
                                          real_t *r) {
+  TRACE_FUNC();
+
   // Evaluate factors
   inertial_odometry_t *odom = (inertial_odometry_t *) data;
 
@@ -19876,52 +22916,53 @@ void tsf_camera_event(tsf_t *tsf,
                                  kps0,
                                  kps1);
 
-    // Triangulate features
-    // -- Setup projection matrices
-    real_t P_i[3 * 4] = {0};
-    real_t P_j[3 * 4] = {0};
+    // Triangulate features in world frame
+    POSE2TF(tsf->pose_init, T_WS);
     POSE2TF(tsf->cam_exts[0].data, T_SC0);
     POSE2TF(tsf->cam_exts[1].data, T_SC1);
     TF_INV(T_SC0, T_C0S);
+    TF_CHAIN(T_WC0, 2, T_WS, T_SC0);
     TF_CHAIN(T_C0C1, 2, T_C0S, T_SC1);
-    // pinhole_projection_matrix(tsf->cam0_params.data, T_WC0, P_i);
-    // pinhole_projection_matrix(tsf->cam1_params.data, T_WC1, P_j);
+    real_t points[1000 * 3] = {0};
+    int status[1000] = {0};
+    if (num_match_fids > 0) {
+      stereo_triangulate(&tsf->cam_params[0],
+                         &tsf->cam_params[1],
+                         T_WC0,
+                         T_C0C1,
+                         kps0,
+                         kps1,
+                         num_match_fids,
+                         points,
+                         status);
+    }
 
-    // -- Triangulate features
-    const real_t *cam0_params = tsf->cam_params[0].data;
-    const real_t *cam1_params = tsf->cam_params[1].data;
+    // Add new features and form frameset km1, skip degenerate points
+    tsf_frameset_setup(&tsf->fs_km1);
+    tsf->fs_km1.ts = ts;
+    int num_features = 0;
     for (int i = 0; i < num_match_fids; i++) {
-      // Undistort keypoints
-      real_t z_i[2] = {0};
-      real_t z_j[2] = {0};
-      tsf->cam_params[0].undistort_func(cam0_params, &kps0[i * 2], z_i);
-      tsf->cam_params[1].undistort_func(cam1_params, &kps1[i * 2], z_j);
-
-      // Triangulate
-      real_t p[3] = {0};
-      linear_triangulation(P_i, P_j, z_i, z_j, p);
+      if (status[i] != 0) {
+        continue;
+      }
 
-      // Add new feature
       const int fid = match_fids[i];
       feature_map_t feature;
-      feature_setup(&feature.feature, fid);
+      feature.key = fid;
+      feature_init(&feature.feature, fid, &points[i * 3]);
       hmputs(tsf->feature_map, feature);
-    }
 
-    // Form frameset km1
-    tsf_frameset_setup(&tsf->fs_km1);
-    tsf->fs_km1.ts = ts;
-    for (int i = 0; i < num_match_fids; i++) {
-      tsf->fs_km1.cam0_fids[i] = match_fids[i];
-      tsf->fs_km1.cam0_kps[i * 2 + 0] = kps0[i * 2 + 0];
-      tsf->fs_km1.cam0_kps[i * 2 + 1] = kps0[i * 2 + 1];
+      const int k = num_features++;
+      tsf->fs_km1.cam0_fids[k] = match_fids[i];
+      tsf->fs_km1.cam0_kps[k * 2 + 0] = kps0[i * 2 + 0];
+      tsf->fs_km1.cam0_kps[k * 2 + 1] = kps0[i * 2 + 1];
 
-      tsf->fs_km1.cam1_fids[i] = match_fids[i];
-      tsf->fs_km1.cam1_kps[i * 2 + 0] = kps1[i * 2 + 0];
-      tsf->fs_km1.cam1_kps[i * 2 + 1] = kps1[i * 2 + 1];
+      tsf->fs_km1.cam1_fids[k] = match_fids[i];
+      tsf->fs_km1.cam1_kps[k * 2 + 0] = kps1[i * 2 + 0];
+      tsf->fs_km1.cam1_kps[k * 2 + 1] = kps1[i * 2 + 1];
     }
-    tsf->fs_km1.cam0_num_kps = num_match_fids;
-    tsf->fs_km1.cam1_num_kps = num_match_fids;
+    tsf->fs_km1.cam0_num_kps = num_features;
+    tsf->fs_km1.cam1_num_kps = num_features;
 
     return;
   }
@@ -20116,6 +23157,8 @@ void tsf_linearize_compact(const void *data,
                            real_t *H,
                            real_t *g,
                            real_t *r) {
+  TRACE_FUNC();
+
   // Evaluate factors
   tsf_t *tsf = (tsf_t *) data;
   size_t r_idx = 0;
@@ -20934,6 +23977,228 @@ void sim_create_features(const real_t origin[3],
   }
 }
 
+/**
+ * Setup camera frustum of `cam_params` between depths `near` and `far` (<= 0
+ * for unbounded). The side planes pass through the camera center and the
+ * image corners, their slack is widened until every sampled image border
+ * bearing lies inside, so that distorted cameras are covered.
+ */
+void sim_frustum_setup(sim_frustum_t *frustum,
+                       const camera_params_t *cam_params,
+                       const real_t near,
+                       const real_t far) {
+  assert(frustum != NULL);
+  assert(cam_params != NULL);
+
+  // Sample bearings along the image border, corners first
+  const real_t w = cam_params->resolution[0];
+  const real_t h = cam_params->resolution[1];
+  const real_t corners[4][2] = {{0.0, 0.0}, {w, 0.0}, {w, h}, {0.0, h}};
+  const int samples_per_edge = 8;
+  real_t bearings[4 * 8][3];
+  int num_bearings = 0;
+  for (int k = 0; k < 4; k++) {
+    const real_t *a = corners[k];
+    const real_t *b = corners[(k + 1) % 4];
+    for (int j = 0; j < samples_per_edge; j++) {
+      const real_t t = (real_t) j / samples_per_edge;
+      const real_t z[2] = {a[0] + t * (b[0] - a[0]), a[1] + t * (b[1] - a[1])};
+      camera_back_project(cam_params, z, bearings[num_bearings]);
+      vec3_normalize(bearings[num_bearings]);
+      num_bearings++;
+    }
+  }
+  const real_t z_center[2] = {w / 2.0, h / 2.0};
+  real_t center[3] = {0};
+  camera_back_project(cam_params, z_center, center);
+
+  // Side planes through consecutive corners, normals point out
+  for (int k = 0; k < 4; k++) {
+    const real_t *r_a = bearings[k * samples_per_edge];
+    const real_t *r_b = bearings[((k + 1) % 4) * samples_per_edge];
+    real_t *n = frustum->normals + k * 3;
+    vec3_cross(r_a, r_b, n);
+    vec3_normalize(n);
+    if (n[0] * center[0] + n[1] * center[1] + n[2] * center[2] > 0.0) {
+      n[0] = -n[0];
+      n[1] = -n[1];
+      n[2] = -n[2];
+    }
+
+    real_t slack = 0.0;
+    for (int j = 0; j < num_bearings; j++) {
+      const real_t *r = bearings[j];
+      slack = MAX(slack, n[0] * r[0] + n[1] * r[1] + n[2] * r[2]);
+    }
+    frustum->slack[k] = slack + 1e-6;
+  }
+
+  frustum->near = near;
+  frustum->far = far;
+}
+
+typedef struct sim_features_grid_key_t {
+  int64_t key;
+  int id;
+} sim_features_grid_key_t;
+
+static int sim_features_grid_key_cmp(const void *a, const void *b) {
+  const sim_features_grid_key_t *ka = (const sim_features_grid_key_t *) a;
+  const sim_features_grid_key_t *kb = (const sim_features_grid_key_t *) b;
+  if (ka->key != kb->key) {
+    return (ka->key < kb->key) ? -1 : 1;
+  }
+  return intcmp(ka->id, kb->id);
+}
+
+/**
+ * Malloc uniform grid index over `num_features` features `features` (n x 3)
+ * with cubic cells of size `cell_size`. If `cell_size` <= 0 it is chosen
+ * for roughly 32 features per cell over the bounding box. Only occupied
+ * cells are stored. The features are not copied and must outlive the grid.
+ */
+sim_features_grid_t *sim_features_grid_malloc(const real_t *features,
+                                              const int num_features,
+                                              const real_t cell_size) {
+  assert(features != NULL || num_features == 0);
+  assert(num_features >= 0);
+
+  // Bounding box
+  real_t lo[3] = {0.0, 0.0, 0.0};
+  real_t hi[3] = {0.0, 0.0, 0.0};
+  for (int i = 0; i < num_features; i++) {
+    for (int k = 0; k < 3; k++) {
+      const real_t v = features[i * 3 + k];
+      lo[k] = (i == 0 || v < lo[k]) ? v : lo[k];
+      hi[k] = (i == 0 || v > hi[k]) ? v : hi[k];
+    }
+  }
+
+  // Cell size
+  real_t size = cell_size;
+  if (size <= 0.0) {
+    const real_t extent = MAX(MAX(hi[0] - lo[0], hi[1] - lo[1]), hi[2] - lo[2]);
+    real_t volume = 1.0;
+    for (int k = 0; k < 3; k++) {
+      volume *= MAX(hi[k] - lo[k], extent * 1e-2);
+    }
+    size = (extent > 0.0) ? cbrt(volume * 32.0 / num_features) : 1.0;
+  }
+
+  // Sort features by cell
+  const int64_t dims[3] = {(int64_t) floor((hi[0] - lo[0]) / size) + 1,
+                           (int64_t) floor((hi[1] - lo[1]) / size) + 1,
+                           (int64_t) floor((hi[2] - lo[2]) / size) + 1};
+  sim_features_grid_key_t *keys =
+      MALLOC(sim_features_grid_key_t, MAX(num_features, 1));
+  for (int i = 0; i < num_features; i++) {
+    const real_t *p = features + i * 3;
+    const int64_t ix = (int64_t) floor((p[0] - lo[0]) / size);
+    const int64_t iy = (int64_t) floor((p[1] - lo[1]) / size);
+    const int64_t iz = (int64_t) floor((p[2] - lo[2]) / size);
+    keys[i].key = (ix * dims[1] + iy) * dims[2] + iz;
+    keys[i].id = i;
+  }
+  qsort(keys, num_features, sizeof(sim_features_grid_key_t),
+        sim_features_grid_key_cmp);
+
+  // Form occupied cells
+  sim_features_grid_t *grid = MALLOC(sim_features_grid_t, 1);
+  grid->features = features;
+  grid->num_features = num_features;
+  grid->cell_size = size;
+  grid->num_cells = 0;
+  grid->centers = MALLOC(real_t, MAX(num_features, 1) * 3);
+  grid->offsets = MALLOC(int, num_features + 1);
+  grid->ids = MALLOC(int, MAX(num_features, 1));
+  for (int i = 0; i < num_features; i++) {
+    grid->ids[i] = keys[i].id;
+    if (i > 0 && keys[i].key == keys[i - 1].key) {
+      continue;
+    }
+
+    const int64_t key = keys[i].key;
+    const int64_t iz = key % dims[2];
+    const int64_t iy = (key / dims[2]) % dims[1];
+    const int64_t ix = key / (dims[1] * dims[2]);
+    real_t *c = grid->centers + grid->num_cells * 3;
+    c[0] = lo[0] + (ix + 0.5) * size;
+    c[1] = lo[1] + (iy + 0.5) * size;
+    c[2] = lo[2] + (iz + 0.5) * size;
+    grid->offsets[grid->num_cells++] = i;
+  }
+  grid->offsets[grid->num_cells] = num_features;
+  free(keys);
+
+  return grid;
+}
+
+/**
+ * Free features grid.
+ */
+void sim_features_grid_free(sim_features_grid_t *grid) {
+  if (grid == NULL) {
+    return;
+  }
+  free(grid->centers);
+  free(grid->offsets);
+  free(grid->ids);
+  free(grid);
+}
+
+/**
+ * Query features in cells that intersect `frustum` of a camera with pose
+ * `T_CW`. The candidate feature ids are written in ascending order to `ids`
+ * (at most `num_features`). Candidates are a superset of the visible
+ * features, they still have to be projected.
+ *
+ * @returns Number of candidate features
+ */
+int sim_features_grid_query(const sim_features_grid_t *grid,
+                            const sim_frustum_t *frustum,
+                            const real_t T_CW[4 * 4],
+                            int *ids) {
+  assert(grid != NULL);
+  assert(frustum != NULL);
+  assert(T_CW != NULL);
+  assert(ids != NULL);
+
+  // Cells are tested through their bounding sphere. For a side plane with
+  // normal n and slack s, f(p) = n' p - s |p| is (1 + s)-Lipschitz, so a
+  // cell is outside if f(center) > r (1 + s).
+  const real_t r = grid->cell_size * sqrt(3.0) / 2.0;
+  int num_ids = 0;
+  for (int i = 0; i < grid->num_cells; i++) {
+    const real_t *c_W = grid->centers + i * 3;
+    TF_POINT(T_CW, c_W, c);
+    if (c[2] + r < frustum->near) {
+      continue;
+    }
+    if (frustum->far > 0.0 && c[2] - r > frustum->far) {
+      continue;
+    }
+
+    const real_t c_norm = sqrt(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]);
+    int inside = 1;
+    for (int k = 0; k < 4 && inside; k++) {
+      const real_t *n = frustum->normals + k * 3;
+      const real_t slack = frustum->slack[k];
+      const real_t f = n[0] * c[0] + n[1] * c[1] + n[2] * c[2] - slack * c_norm;
+      inside = (f <= r * (1.0 + slack));
+    }
+    if (inside == 0) {
+      continue;
+    }
+
+    for (int j = grid->offsets[i]; j < grid->offsets[i + 1]; j++) {
+      ids[num_ids++] = grid->ids[j];
+    }
+  }
+  qsort(ids, num_ids, sizeof(int), intcmp2);
+
+  return num_ids;
+}
+
 /**
  * Extract timestamp from path.
  */
@@ -21205,6 +24470,13 @@ sim_camera_circle_trajectory(const sim_circle_t *conf,
   data->timestamps = CALLOC(real_t, data->num_frames);
   data->poses = CALLOC(real_t, data->num_frames * 7);
 
+  // Index features, only candidates in the camera frustum are projected
+  sim_features_grid_t *grid =
+      sim_features_grid_malloc(features, num_features, 0);
+  sim_frustum_t frustum;
+  sim_frustum_setup(&frustum, cam_params, 0.0, 0.0);
+  int *candidates = MALLOC(int, MAX(num_features, 1));
+
   // Simulate camera
   const real_t dt = 1.0 / cam_rate;
   timestamp_t ts = 0.0;
@@ -21232,8 +24504,10 @@ sim_camera_circle_trajectory(const sim_circle_t *conf,
 
     // Simulate camera frame
     sim_camera_frame_t *frame = sim_camera_frame_malloc(ts, cam_idx);
-    for (size_t feature_id = 0; feature_id < num_features; feature_id++) {
+    const int n = sim_features_grid_query(grid, &frustum, T_CW, candidates);
+    for (int i = 0; i < n; i++) {
       // Check point is infront of camera
+      const size_t feature_id = candidates[i];
       const real_t *p_W = &features[feature_id * 3];
       TF_POINT(T_CW, p_W, p_C);
       if (p_C[2] < 0) {
@@ -21265,6 +24539,10 @@ sim_camera_circle_trajectory(const sim_circle_t *conf,
     ts += sec2ts(dt);
   }
 
+  // Clean up
+  sim_features_grid_free(grid);
+  free(candidates);
+
   return data;
 }
 
@@ -21382,6 +24660,394 @@ void sim_circle_camera_imu_free(sim_circle_camera_imu_t *sim_data) {
   free(sim_data);
 }
 
+////////////////
+// SIM SPLINE //
+////////////////
+
+/**
+ * Malloc spline trajectory from `num_points` (>= 4) control points `points`
+ * (x, y, z, yaw, pitch, roll) spaced `dt` seconds apart.
+ */
+sim_spline_t *sim_spline_malloc(const timestamp_t ts_start,
+                                const real_t dt,
+                                const real_t *points,
+                                const int num_points) {
+  assert(dt > 0.0);
+  assert(points != NULL);
+  assert(num_points >= 4);
+
+  sim_spline_t *spline = MALLOC(sim_spline_t, 1);
+  spline->ts_start = ts_start;
+  spline->dt = dt;
+  spline->num_points = num_points;
+  spline->points = MALLOC(real_t, num_points * 6);
+  vec_copy(points, num_points * 6, spline->points);
+
+  return spline;
+}
+
+/**
+ * Free spline trajectory.
+ */
+void sim_spline_free(sim_spline_t *spline) {
+  if (spline == NULL) {
+    return;
+  }
+  free(spline->points);
+  free(spline);
+}
+
+/**
+ * Return end timestamp of spline trajectory.
+ */
+timestamp_t sim_spline_end(const sim_spline_t *spline) {
+  assert(spline != NULL);
+  return spline->ts_start + sec2ts((spline->num_points - 3) * spline->dt);
+}
+
+/**
+ * Evaluate spline trajectory at `ts`, timestamps outside the trajectory are
+ * clamped. Outputs body pose `pose` (T_WB), velocity `v_WB`, acceleration
+ * `a_WB` and angular velocity in the body frame `w_B`, any of which can be
+ * NULL.
+ */
+void sim_spline_eval(const sim_spline_t *spline,
+                     const timestamp_t ts,
+                     real_t pose[7],
+                     real_t v_WB[3],
+                     real_t a_WB[3],
+                     real_t w_B[3]) {
+  assert(spline != NULL);
+
+  // Segment and normalized time
+  const int num_segments = spline->num_points - 3;
+  const real_t s = ts2sec(ts - spline->ts_start) / spline->dt;
+  int seg = (int) floor(s);
+  seg = MAX(MIN(seg, num_segments - 1), 0);
+  const real_t u = MAX(MIN(s - seg, 1.0), 0.0);
+
+  // Cubic B-spline basis and derivatives
+  const real_t u2 = u * u;
+  const real_t u3 = u2 * u;
+  const real_t B[4] = {(1.0 - u) * (1.0 - u) * (1.0 - u) / 6.0,
+                       (3.0 * u3 - 6.0 * u2 + 4.0) / 6.0,
+                       (-3.0 * u3 + 3.0 * u2 + 3.0 * u + 1.0) / 6.0,
+                       u3 / 6.0};
+  const real_t dB[4] = {-(1.0 - u) * (1.0 - u) / 2.0,
+                        (3.0 * u2 - 4.0 * u) / 2.0,
+                        (-3.0 * u2 + 2.0 * u + 1.0) / 2.0,
+                        u2 / 2.0};
+  const real_t ddB[4] = {1.0 - u, 3.0 * u - 2.0, -3.0 * u + 1.0, u};
+
+  // Position, yaw, pitch, roll and their derivatives
+  real_t x[6] = {0};
+  real_t dx[6] = {0};
+  real_t ddx[6] = {0};
+  const real_t dt = spline->dt;
+  for (int j = 0; j < 4; j++) {
+    const real_t *p = spline->points + (seg + j) * 6;
+    for (int k = 0; k < 6; k++) {
+      x[k] += B[j] * p[k];
+      dx[k] += dB[j] * p[k] / dt;
+      ddx[k] += ddB[j] * p[k] / (dt * dt);
+    }
+  }
+
+  if (pose) {
+    real_t q[4] = {0};
+    euler2quat(x + 3, q);
+    pose[0] = x[0];
+    pose[1] = x[1];
+    pose[2] = x[2];
+    pose[3] = q[0];
+    pose[4] = q[1];
+    pose[5] = q[2];
+    pose[6] = q[3];
+  }
+  if (v_WB) {
+    vec_copy(dx, 3, v_WB);
+  }
+  if (a_WB) {
+    vec_copy(ddx, 3, a_WB);
+  }
+  if (w_B) {
+    // Body rates from Euler 321 rates
+    const real_t cth = cos(x[4]);
+    const real_t sth = sin(x[4]);
+    const real_t cph = cos(x[5]);
+    const real_t sph = sin(x[5]);
+    const real_t dpsi = dx[3];
+    const real_t dth = dx[4];
+    const real_t dph = dx[5];
+    w_B[0] = dph - dpsi * sth;
+    w_B[1] = dth * cph + dpsi * sph * cth;
+    w_B[2] = -dth * sph + dpsi * cph * cth;
+  }
+}
+
+/**
+ * Simulate ideal accelerometer `acc` and gyroscope `gyr` measurements of an
+ * IMU at the body frame of the spline trajectory at `ts`.
+ */
+void sim_spline_imu(const sim_spline_t *spline,
+                    const timestamp_t ts,
+                    real_t acc[3],
+                    real_t gyr[3]) {
+  real_t pose[7] = {0};
+  real_t a_WB[3] = {0};
+  sim_spline_eval(spline, ts, pose, NULL, a_WB, gyr);
+
+  // acc = C_BW * (a_WB - g_W)
+  real_t C_WB[3 * 3] = {0};
+  quat2rot(pose + 3, C_WB);
+  const real_t f_W[3] = {a_WB[0], a_WB[1], a_WB[2] + 9.81};
+  acc[0] = C_WB[0] * f_W[0] + C_WB[3] * f_W[1] + C_WB[6] * f_W[2];
+  acc[1] = C_WB[1] * f_W[0] + C_WB[4] * f_W[1] + C_WB[7] * f_W[2];
+  acc[2] = C_WB[2] * f_W[0] + C_WB[5] * f_W[1] + C_WB[8] * f_W[2];
+}
+
+////////////////////
+// SIM VI DATASET //
+////////////////////
+
+/**
+ * Setup visual-inertial simulator with 200Hz IMU and 20Hz cameras.
+ */
+void sim_vi_setup(sim_vi_t *sim,
+                  const sim_spline_t *spline,
+                  const camera_params_t *cam_params,
+                  const real_t *cam_exts,
+                  const int num_cams,
+                  const real_t *features,
+                  const int num_features) {
+  assert(sim != NULL);
+  assert(spline != NULL);
+  assert(num_cams == 0 || (cam_params && cam_exts));
+  assert(num_features == 0 || features != NULL);
+
+  sim->imu_rate = 200.0;
+  sim->cam_rate = 20.0;
+  sim->num_threads = 0;
+  sim->window_size = 16;
+
+  sim->spline = spline;
+
+  sim->num_cams = num_cams;
+  sim->cam_params = cam_params;
+  sim->cam_exts = cam_exts;
+
+  sim->features = features;
+  sim->num_features = num_features;
+}
+
+/**
+ * Simulate camera `cam_idx` observing the landmarks at `ts`.
+ */
+static void sim_vi_camera_event(const sim_vi_t *sim,
+                                const sim_features_grid_t *grid,
+                                const sim_frustum_t *frustum,
+                                int *candidates,
+                                const timestamp_t ts,
+                                const int cam_idx,
+                                camera_event_t *event) {
+  const camera_params_t *cam = &sim->cam_params[cam_idx];
+
+  // Camera pose T_WC = T_WB * T_BC
+  real_t pose[7] = {0};
+  sim_spline_eval(sim->spline, ts, pose, NULL, NULL, NULL);
+  TF(pose, T_WB);
+  TF(sim->cam_exts + cam_idx * 7, T_BC);
+  TF_CHAIN(T_WC, 2, T_WB, T_BC);
+  TF_INV(T_WC, T_CW);
+
+  // Project candidate landmarks in front of the camera and inside the image
+  int capacity = 64;
+  event->ts = ts;
+  event->cam_idx = cam_idx;
+  event->image_path = NULL;
+  event->num_features = 0;
+  event->feature_ids = MALLOC(size_t, capacity);
+  event->keypoints = MALLOC(real_t, capacity * 2);
+  const int num_candidates =
+      sim_features_grid_query(grid, frustum, T_CW, candidates);
+  for (int c = 0; c < num_candidates; c++) {
+    const int i = candidates[c];
+    const real_t *p_W = sim->features + i * 3;
+    TF_POINT(T_CW, p_W, p_C);
+    if (p_C[2] < 1e-3) {
+      continue;
+    }
+
+    real_t z[2] = {0};
+    camera_project(cam, p_C, z);
+    const int x_ok = (z[0] > 0 && z[0] < cam->resolution[0]);
+    const int y_ok = (z[1] > 0 && z[1] < cam->resolution[1]);
+    if (x_ok == 0 || y_ok == 0) {
+      continue;
+    }
+
+    if (event->num_features == capacity) {
+      capacity *= 2;
+      event->feature_ids = REALLOC(event->feature_ids, size_t, capacity);
+      event->keypoints = REALLOC(event->keypoints, real_t, capacity * 2);
+    }
+    const int n = event->num_features++;
+    event->feature_ids[n] = i;
+    event->keypoints[n * 2 + 0] = z[0];
+    event->keypoints[n * 2 + 1] = z[1];
+  }
+}
+
+typedef struct sim_vi_worker_t {
+  const sim_vi_t *sim;
+  const sim_features_grid_t *grid;
+  const sim_frustum_t *frustums;
+  const timestamp_t *cam_ts;
+  camera_event_t *events;
+  int *candidates;
+  int candidates_size;
+} sim_vi_worker_t;
+
+/**
+ * Simulate camera event `idx`, each thread has its own candidates buffer.
+ */
+static void sim_vi_task(void *data, const int idx, const int thread) {
+  sim_vi_worker_t *worker = (sim_vi_worker_t *) data;
+  const sim_vi_t *sim = worker->sim;
+  const int num_cams = sim->num_cams;
+  const timestamp_t ts = worker->cam_ts[idx / num_cams];
+  const int cam_idx = idx % num_cams;
+  sim_vi_camera_event(sim,
+                      worker->grid,
+                      &worker->frustums[cam_idx],
+                      worker->candidates + thread * worker->candidates_size,
+                      ts,
+                      cam_idx,
+                      &worker->events[idx]);
+}
+
+/**
+ * Simulate camera events of `num_ts` timestamps `cam_ts` for all cameras in
+ * parallel, `events` is ordered by timestamp then camera index.
+ */
+static void sim_vi_camera_events(const sim_vi_t *sim,
+                                 const sim_features_grid_t *grid,
+                                 const sim_frustum_t *frustums,
+                                 const timestamp_t *cam_ts,
+                                 const int num_ts,
+                                 camera_event_t *events) {
+  const int num_tasks = num_ts * sim->num_cams;
+  const int num_threads = parallel_threads(sim->num_threads, num_tasks);
+  const int candidates_size = MAX(sim->num_features, 1);
+  int *candidates = MALLOC(int, num_threads * candidates_size);
+  sim_vi_worker_t worker = {.sim = sim,
+                            .grid = grid,
+                            .frustums = frustums,
+                            .cam_ts = cam_ts,
+                            .events = events,
+                            .candidates = candidates,
+                            .candidates_size = candidates_size};
+  parallel_for(num_tasks, sim->num_threads, sim_vi_task, &worker);
+  free(candidates);
+}
+
+/**
+ * Run visual-inertial simulator over the whole spline trajectory. Events are
+ * passed to `cb` in timestamp order, at equal timestamps the IMU event comes
+ * first followed by the cameras in index order.
+ *
+ * Camera events are simulated in parallel in windows of `window_size`
+ * camera timestamps, so memory use does not grow with the trajectory
+ * duration. Landmarks are culled per frame with a `sim_features_grid_t`.
+ *
+ * @returns 0 for success, otherwise the non-zero value returned by `cb`
+ */
+int sim_vi_run(const sim_vi_t *sim, sim_vi_event_cb_t cb, void *arg) {
+  assert(sim != NULL);
+  assert(sim->imu_rate > 0.0 && sim->cam_rate > 0.0);
+  assert(cb != NULL);
+
+  // Setup
+  const timestamp_t ts_start = sim->spline->ts_start;
+  const timestamp_t ts_end = sim_spline_end(sim->spline);
+  const real_t duration = ts2sec(ts_end - ts_start);
+  const int64_t num_imu = (int64_t) floor(duration * sim->imu_rate) + 1;
+  const int64_t num_cam = (int64_t) floor(duration * sim->cam_rate) + 1;
+  const int window_size = MAX(sim->window_size, 1);
+  timestamp_t *cam_ts = MALLOC(timestamp_t, window_size);
+  camera_event_t *cam_events = NULL;
+  sim_frustum_t *frustums = NULL;
+  sim_features_grid_t *grid = NULL;
+  if (sim->num_cams > 0) {
+    cam_events = MALLOC(camera_event_t, window_size * sim->num_cams);
+    frustums = MALLOC(sim_frustum_t, sim->num_cams);
+    for (int i = 0; i < sim->num_cams; i++) {
+      sim_frustum_setup(&frustums[i], &sim->cam_params[i], 1e-3, 0.0);
+    }
+    grid = sim_features_grid_malloc(sim->features, sim->num_features, 0);
+  }
+
+  int retval = 0;
+  int64_t imu_idx = 0;
+  for (int64_t k = 0; k < num_cam && retval == 0; k += window_size) {
+    // Simulate camera events of this window
+    const int num_ts = MIN(window_size, num_cam - k);
+    for (int i = 0; i < num_ts; i++) {
+      cam_ts[i] = ts_start + sec2ts((k + i) / sim->cam_rate);
+    }
+    if (sim->num_cams > 0) {
+      sim_vi_camera_events(sim, grid, frustums, cam_ts, num_ts, cam_events);
+    }
+
+    // Stream IMU and camera events in order
+    const int last_window = (k + num_ts >= num_cam);
+    for (int i = 0; i <= num_ts && retval == 0; i++) {
+      const int has_cam = (i < num_ts);
+      if (has_cam == 0 && last_window == 0) {
+        break;
+      }
+
+      // -- IMU events up to and including the camera timestamp
+      while (imu_idx < num_imu && retval == 0) {
+        const timestamp_t ts = ts_start + sec2ts(imu_idx / sim->imu_rate);
+        if (has_cam && ts > cam_ts[i]) {
+          break;
+        }
+        timeline_event_t event;
+        event.type = IMU_EVENT;
+        event.ts = ts;
+        event.data.imu.ts = ts;
+        sim_spline_imu(sim->spline, ts, event.data.imu.acc, event.data.imu.gyr);
+        retval = cb(arg, &event);
+        imu_idx++;
+      }
+
+      // -- Camera events
+      for (int j = 0; has_cam && j < sim->num_cams && retval == 0; j++) {
+        timeline_event_t event;
+        event.type = CAMERA_EVENT;
+        event.ts = cam_ts[i];
+        event.data.camera = cam_events[i * sim->num_cams + j];
+        retval = cb(arg, &event);
+      }
+    }
+
+    // Clean up window
+    for (int i = 0; i < num_ts * sim->num_cams; i++) {
+      free(cam_events[i].feature_ids);
+      free(cam_events[i].keypoints);
+    }
+  }
+
+  // Clean up
+  free(cam_ts);
+  free(cam_events);
+  free(frustums);
+  sim_features_grid_free(grid);
+
+  return retval;
+}
+
 /////////////////////
 // SIM GIMBAL DATA //
 /////////////////////
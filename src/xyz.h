@@ -18,6 +18,7 @@ extern "C" {
 #define USE_APRILGRID
 // #define USE_TIS
 // #define USE_SBGC
+#define USE_TRACE
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -25,13 +26,18 @@ extern "C" {
 #include <stdbool.h>
 #include <string.h>
 #include <math.h>
+#include <float.h>
 #include <complex.h>
 #include <time.h>
+#include <pthread.h>
 #include <unistd.h>
 #include <dirent.h>
 #include <libgen.h>
 #include <assert.h>
 #include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 
 #include <errno.h>
 #include <netdb.h>
@@ -62,6 +68,7 @@ extern "C" {
 #endif
 
 #ifdef USE_APRILGRID
+#define APRILGRID_TRACE_SCOPE(NAME) TRACE_SCOPE(NAME)
 #include "aprilgrid.h"
 #endif
 
@@ -462,6 +469,64 @@ int queue_full(queue_t *q);
 void *queue_first(queue_t *q);
 void *queue_last(queue_t *q);
 
+////////////////
+// SPSC QUEUE //
+////////////////
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+/**
+ * Bounded lock-free single-producer / single-consumer ring queue.
+ *
+ * Elements are copied in and out of a preallocated ring, so no allocation
+ * happens after `spsc_queue_malloc()`. Only one thread may push and only one
+ * thread may pop. The head and tail indices live on separate cache lines so
+ * the producer and consumer do not false-share.
+ */
+typedef struct spsc_queue_t {
+  // Consumer owned
+  size_t head;
+  size_t tail_cache;
+  char pad0[CACHE_LINE_SIZE - 2 * sizeof(size_t)];
+
+  // Producer owned
+  size_t tail;
+  size_t head_cache;
+  char pad1[CACHE_LINE_SIZE - 2 * sizeof(size_t)];
+
+  // Read-only after setup
+  size_t capacity;
+  size_t mask;
+  size_t element_size;
+  uint8_t *data;
+} spsc_queue_t;
+
+spsc_queue_t *spsc_queue_malloc(const size_t element_size,
+                                const size_t capacity);
+void spsc_queue_free(spsc_queue_t *q);
+int spsc_queue_push(spsc_queue_t *q, const void *el);
+int spsc_queue_pop(spsc_queue_t *q, void *el);
+int spsc_queue_peek(spsc_queue_t *q, void *el);
+size_t spsc_queue_size(spsc_queue_t *q);
+int spsc_queue_empty(spsc_queue_t *q);
+int spsc_queue_full(spsc_queue_t *q);
+
+/**
+ * Generate type-safe push / pop wrappers around `spsc_queue_t`.
+ */
+#define SPSC_QUEUE_TYPE(PREFIX, DATA_TYPE)                                     \
+  static inline spsc_queue_t *PREFIX##_malloc(const size_t capacity) {         \
+    return spsc_queue_malloc(sizeof(DATA_TYPE), capacity);                     \
+  }                                                                            \
+  static inline int PREFIX##_push(spsc_queue_t *q, const DATA_TYPE *el) {      \
+    return spsc_queue_push(q, el);                                             \
+  }                                                                            \
+  static inline int PREFIX##_pop(spsc_queue_t *q, DATA_TYPE *el) {             \
+    return spsc_queue_pop(q, el);                                              \
+  }
+
 /////////////
 // HASHMAP //
 /////////////
@@ -522,6 +587,214 @@ timestamp_t str2ts(const char *ts_str);
 real_t ts2sec(const timestamp_t ts);
 timestamp_t sec2ts(const real_t time_s);
 
+/*******************************************************************************
+ * TELEMETRY LOG
+ ******************************************************************************/
+
+/**
+ * Telemetry log: append-only binary log of timestamped typed channels.
+ *
+ * Layout (native byte order, all sections 8-byte aligned):
+ *
+ *   header    tlog_header_t
+ *   chunks    [timestamps | values] x N, one channel per chunk
+ *   channels  tlog_channel_t x M
+ *   index     tlog_chunk_t x N, sorted by (channel, ts_start)
+ *
+ * Samples are buffered per channel and written a chunk at a time, so logging
+ * a sample is a copy into memory. An index offset of 0 marks a log that was
+ * not closed.
+ */
+#define TLOG_MAGIC "XYZTLOG0"
+#define TLOG_VERSION 1
+#define TLOG_NAME_SIZE 32
+#ifndef TLOG_CHUNK_SAMPLES
+#define TLOG_CHUNK_SAMPLES 1024
+#endif
+
+#define TLOG_U8 0
+#define TLOG_I32 1
+#define TLOG_I64 2
+#define TLOG_F32 3
+#define TLOG_F64 4
+#if PRECISION == 1
+#define TLOG_REAL TLOG_F32
+#else
+#define TLOG_REAL TLOG_F64
+#endif
+
+typedef struct tlog_header_t {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_channels;
+  uint64_t num_chunks;
+  uint64_t index_offset;
+} tlog_header_t;
+
+typedef struct tlog_channel_t {
+  char name[TLOG_NAME_SIZE];
+  int32_t type;
+  int32_t dim;
+  uint64_t num_samples;
+} tlog_channel_t;
+
+typedef struct tlog_chunk_t {
+  int64_t ts_start;
+  int64_t ts_end;
+  uint64_t offset;
+  int32_t channel;
+  int32_t num_samples;
+} tlog_chunk_t;
+
+/** Zero-copy view of consecutive samples in a chunk */
+typedef struct tlog_slice_t {
+  const timestamp_t *ts;
+  const void *data;
+  int num_samples;
+} tlog_slice_t;
+
+typedef struct tlog_buf_t {
+  size_t stride;
+  int num_samples;
+  timestamp_t *ts;
+  uint8_t *data;
+} tlog_buf_t;
+
+typedef struct tlog_writer_t {
+  FILE *fp;
+  uint64_t offset;
+
+  tlog_channel_t *channels;
+  tlog_buf_t *bufs;
+  int num_channels;
+
+  tlog_chunk_t *chunks;
+  size_t num_chunks;
+  size_t capacity;
+} tlog_writer_t;
+
+typedef struct tlog_t {
+  void *data;
+  size_t size;
+  int num_channels;
+  const tlog_channel_t *channels;
+  size_t num_chunks;
+  const tlog_chunk_t *chunks;
+} tlog_t;
+
+size_t tlog_type_size(const int type);
+tlog_writer_t *tlog_writer_malloc(const char *path);
+int tlog_writer_channel(tlog_writer_t *writer,
+                        const char *name,
+                        const int type,
+                        const int dim);
+int tlog_writer_flush(tlog_writer_t *writer, const int channel);
+int tlog_writer_close(tlog_writer_t *writer);
+int tlog_check(const char *path);
+tlog_t *tlog_load(const char *path);
+void tlog_free(tlog_t *log);
+int tlog_find(const tlog_t *log, const char *name);
+int tlog_slice(const tlog_t *log,
+               const int channel,
+               const timestamp_t ts_start,
+               const timestamp_t ts_end,
+               size_t *cursor,
+               tlog_slice_t *slice);
+
+/**
+ * Log sample `data` with timestamp `ts` to `channel`. Timestamps must not
+ * decrease within a channel.
+ */
+static inline int tlog_write(tlog_writer_t *writer,
+                             const int channel,
+                             const timestamp_t ts,
+                             const void *data) {
+  tlog_buf_t *buf = &writer->bufs[channel];
+  const int k = buf->num_samples++;
+  buf->ts[k] = ts;
+  memcpy(buf->data + buf->stride * k, data, buf->stride);
+  if (buf->num_samples == TLOG_CHUNK_SAMPLES) {
+    return tlog_writer_flush(writer, channel);
+  }
+  return 0;
+}
+
+/*******************************************************************************
+ * TRACE
+ ******************************************************************************/
+
+/**
+ * Scoped tracing. Events are recorded per thread between `trace_start()` and
+ * `trace_stop()` and saved as Chrome / Perfetto trace JSON with
+ * `trace_save()`. Comment out USE_TRACE to compile the trace points out.
+ */
+#ifndef TRACE_BLOCK_SIZE
+#define TRACE_BLOCK_SIZE 4096
+#endif
+
+typedef struct trace_event_t {
+  const char *name;
+  uint64_t ts;
+  uint64_t dur;
+} trace_event_t;
+
+typedef struct trace_block_t {
+  trace_event_t events[TRACE_BLOCK_SIZE];
+  int num_events;
+  struct trace_block_t *next;
+} trace_block_t;
+
+typedef struct trace_buf_t {
+  int tid;
+  trace_block_t *head;
+  trace_block_t *tail;
+  struct trace_buf_t *next;
+} trace_buf_t;
+
+typedef struct trace_scope_t {
+  const char *name;
+  uint64_t ts;
+} trace_scope_t;
+
+void trace_start();
+void trace_stop();
+void trace_clear();
+int trace_save(const char *json_path);
+int trace_total(const char *name, uint64_t *dur);
+trace_scope_t trace_begin(const char *name);
+void trace_end(trace_scope_t *scope);
+
+#define TRACE_CONCAT_(A, B) A##B
+#define TRACE_CONCAT(A, B) TRACE_CONCAT_(A, B)
+
+/** Trace the enclosing scope as `NAME`, `NAME` must be a static string */
+#ifdef USE_TRACE
+#define TRACE_SCOPE(NAME)                                                      \
+  trace_scope_t TRACE_CONCAT(trace_scope_, __LINE__)                           \
+      __attribute__((cleanup(trace_end))) = trace_begin(NAME)
+#else
+#define TRACE_SCOPE(NAME)
+#endif
+
+/** Trace the enclosing function */
+#define TRACE_FUNC() TRACE_SCOPE(__func__)
+
+/*******************************************************************************
+ * PARALLEL
+ ******************************************************************************/
+
+/**
+ * Parallel for task callback, `task` is in [0, num_tasks) and `thread` is in
+ * [0, parallel_threads(num_threads, num_tasks)) for per-thread scratch space.
+ */
+typedef void (*parallel_task_t)(void *data, const int task, const int thread);
+
+int parallel_threads(const int num_threads, const int num_tasks);
+void parallel_for(const int num_tasks,
+                  const int num_threads,
+                  parallel_task_t task_fn,
+                  void *data);
+
 /*******************************************************************************
  * NETWORK
  ******************************************************************************/
@@ -1306,6 +1579,168 @@ void pinhole_equi4_params_jacobian(const real_t params[8],
                                    const real_t p_C[3],
                                    real_t J[2 * 8]);
 
+/**
+ * Inlinable Radial-Tangential distortion of normalized point (x, y).
+ */
+static inline void radtan4_distort_inline(const real_t d[4],
+                                          const real_t x,
+                                          const real_t y,
+                                          real_t *xd,
+                                          real_t *yd) {
+  const real_t x2 = x * x;
+  const real_t y2 = y * y;
+  const real_t xy = x * y;
+  const real_t r2 = x2 + y2;
+  const real_t rad = 1.0 + d[0] * r2 + d[1] * r2 * r2;
+  *xd = x * rad + (2.0 * d[2] * xy + d[3] * (r2 + 2.0 * x2));
+  *yd = y * rad + (2.0 * d[3] * xy + d[2] * (r2 + 2.0 * y2));
+}
+
+/**
+ * Inlinable Equi-distant distortion of normalized point (x, y).
+ */
+static inline void equi4_distort_inline(const real_t d[4],
+                                        const real_t x,
+                                        const real_t y,
+                                        real_t *xd,
+                                        real_t *yd) {
+  const real_t r = sqrt(x * x + y * y);
+  const real_t th = atan(r);
+  const real_t th2 = th * th;
+  const real_t th4 = th2 * th2;
+  const real_t th6 = th4 * th2;
+  const real_t th8 = th4 * th4;
+  const real_t thd = th * (1.0 + d[0] * th2 + d[1] * th4 + d[2] * th6 +
+                           d[3] * th8);
+  const real_t s = thd / r;
+  *xd = s * x;
+  *yd = s * y;
+}
+
+/**
+ * Generate an inlinable `<PREFIX>_project_inline()` kernel for a pinhole
+ * camera model with distortion `DISTORT`. The parameters are laid out as
+ * (fx, fy, cx, cy, d0, d1, d2, d3).
+ */
+#define PINHOLE_PROJECT_KERNEL(PREFIX, DISTORT)                                \
+  static inline void PREFIX##_project_inline(const real_t *params,             \
+                                             const real_t p_C[3],              \
+                                             real_t z[2]) {                    \
+    const real_t x = p_C[0] / p_C[2];                                          \
+    const real_t y = p_C[1] / p_C[2];                                          \
+    real_t xd = 0.0;                                                           \
+    real_t yd = 0.0;                                                           \
+    DISTORT(params + 4, x, y, &xd, &yd);                                       \
+    z[0] = xd * params[0] + params[2];                                         \
+    z[1] = yd * params[1] + params[3];                                         \
+  }
+
+PINHOLE_PROJECT_KERNEL(pinhole_radtan4, radtan4_distort_inline)
+PINHOLE_PROJECT_KERNEL(pinhole_equi4, equi4_distort_inline)
+
+/**
+ * Inlinable Radial-Tangential undistortion of normalized point (x, y) using
+ * a fixed number of Newton iterations so it vectorizes over point arrays.
+ */
+static inline void radtan4_undistort_inline(const real_t d[4],
+                                            const real_t x_in,
+                                            const real_t y_in,
+                                            real_t *x_out,
+                                            real_t *y_out) {
+  real_t x = x_in;
+  real_t y = y_in;
+  for (int i = 0; i < 5; i++) {
+    const real_t x2 = x * x;
+    const real_t y2 = y * y;
+    const real_t xy = x * y;
+    const real_t r2 = x2 + y2;
+    const real_t rad = 1.0 + d[0] * r2 + d[1] * r2 * r2;
+    const real_t dr = 2.0 * d[0] + 4.0 * d[1] * r2;
+    const real_t xd = x * rad + (2.0 * d[2] * xy + d[3] * (r2 + 2.0 * x2));
+    const real_t yd = y * rad + (2.0 * d[3] * xy + d[2] * (r2 + 2.0 * y2));
+    const real_t ex = x_in - xd;
+    const real_t ey = y_in - yd;
+
+    // Solve J * dp = e, J is the symmetric 2x2 point Jacobian
+    const real_t j00 = rad + 2.0 * d[2] * y + 6.0 * d[3] * x + x2 * dr;
+    const real_t j01 = 2.0 * d[2] * x + 2.0 * d[3] * y + xy * dr;
+    const real_t j11 = rad + 6.0 * d[2] * y + 2.0 * d[3] * x + y2 * dr;
+    const real_t det = j00 * j11 - j01 * j01;
+    const real_t det_inv = (fabs(det) > 1e-12) ? 1.0 / det : 0.0;
+    x += det_inv * (j11 * ex - j01 * ey);
+    y += det_inv * (j00 * ey - j01 * ex);
+  }
+  *x_out = x;
+  *y_out = y;
+}
+
+/**
+ * Inlinable Equi-distant undistortion of normalized point (x, y) using a
+ * fixed number of Newton iterations on theta.
+ */
+static inline void equi4_undistort_inline(const real_t d[4],
+                                          const real_t x_in,
+                                          const real_t y_in,
+                                          real_t *x_out,
+                                          real_t *y_out) {
+  const real_t thd = sqrt(x_in * x_in + y_in * y_in);
+  real_t th = thd; // Initial guess
+  for (int i = 0; i < 10; i++) {
+    const real_t th2 = th * th;
+    const real_t th4 = th2 * th2;
+    const real_t th6 = th4 * th2;
+    const real_t th8 = th4 * th4;
+    const real_t f = th * (1.0 + d[0] * th2 + d[1] * th4 + d[2] * th6 +
+                           d[3] * th8) -
+                     thd;
+    const real_t df = 1.0 + 3.0 * d[0] * th2 + 5.0 * d[1] * th4 +
+                      7.0 * d[2] * th6 + 9.0 * d[3] * th8;
+    th -= f / df;
+  }
+
+  const real_t scaling = (thd > 1e-12) ? tan(th) / thd : 1.0;
+  *x_out = x_in * scaling;
+  *y_out = y_in * scaling;
+}
+
+/**
+ * Generate an inlinable `<PREFIX>_undistort_inline()` kernel for a pinhole
+ * camera model with undistortion `UNDISTORT`, it undistorts image point
+ * `z_in` and writes the undistorted image point to `z_out`.
+ */
+#define PINHOLE_UNDISTORT_KERNEL(PREFIX, UNDISTORT)                            \
+  static inline void PREFIX##_undistort_inline(const real_t *params,           \
+                                               const real_t z_in[2],           \
+                                               real_t z_out[2]) {              \
+    const real_t x = (z_in[0] - params[2]) / params[0];                        \
+    const real_t y = (z_in[1] - params[3]) / params[1];                        \
+    real_t xu = 0.0;                                                           \
+    real_t yu = 0.0;                                                           \
+    UNDISTORT(params + 4, x, y, &xu, &yu);                                     \
+    z_out[0] = xu * params[0] + params[2];                                     \
+    z_out[1] = yu * params[1] + params[3];                                     \
+  }
+
+PINHOLE_UNDISTORT_KERNEL(pinhole_radtan4, radtan4_undistort_inline)
+PINHOLE_UNDISTORT_KERNEL(pinhole_equi4, equi4_undistort_inline)
+
+void pinhole_radtan4_project_points(const real_t params[8],
+                                    const real_t *p_C,
+                                    const int n,
+                                    real_t *z);
+void pinhole_radtan4_undistort_points(const real_t params[8],
+                                      const real_t *z_in,
+                                      const int n,
+                                      real_t *z_out);
+void pinhole_equi4_project_points(const real_t params[8],
+                                  const real_t *p_C,
+                                  const int n,
+                                  real_t *z);
+void pinhole_equi4_undistort_points(const real_t params[8],
+                                    const real_t *z_in,
+                                    const int n,
+                                    real_t *z_out);
+
 //////////////
 // GEOMETRY //
 //////////////
@@ -1316,6 +1751,17 @@ void linear_triangulation(const real_t P_i[3 * 4],
                           const real_t z_j[2],
                           real_t p[3]);
 
+#define TRIANGULATION_BLOCK 1024
+
+void linear_triangulation_batch(const real_t P_i[3 * 4],
+                                const real_t P_j[3 * 4],
+                                const real_t *z_i,
+                                const real_t *z_j,
+                                const int n,
+                                const int num_threads,
+                                real_t *points,
+                                int *status);
+
 int homography_find(const real_t *pts_i,
                     const real_t *pts_j,
                     const int num_points,
@@ -1454,6 +1900,8 @@ void mav_model_telem_free(mav_model_telem_t *telem);
 void mav_model_telem_update(mav_model_telem_t *telem,
                             const mav_model_t *mav,
                             const real_t time);
+int mav_model_telem_save(const mav_model_telem_t *telem,
+                         const char *save_path);
 void mav_model_telem_plot(const mav_model_telem_t *telem);
 void mav_model_telem_plot_xy(const mav_model_telem_t *telem);
 
@@ -1530,6 +1978,85 @@ int mav_waypoints_update(mav_waypoints_t *wps,
                          const real_t dt,
                          real_t wp[4]);
 
+/** MAV Batch Simulator **/
+#define MAV_BATCH_BLOCK 64 // MAVs per work item
+#define MAV_BATCH_NUM_PIDS 9
+
+/**
+ * Simulates many independent MAVs, each flown by the cascaded position,
+ * velocity and attitude controllers above, with its own model parameters,
+ * controller gains, disturbances and setpoint.
+ *
+ * Everything is stored structure-of-arrays, field `k` of MAV `i` is at
+ * `[k * stride + i]`. PIDs are ordered roll, pitch, yaw (attitude), vx, vy,
+ * vz (velocity), x, y, z (position) and their gains are stored as kp, ki, kd.
+ * Telemetry is recorded into a preallocated arena, sample `s` of state `k`
+ * of MAV `i` is at `telem[(s * 12 + k) * num_mavs + i]`.
+ */
+typedef struct mav_batch_t {
+  int num_mavs;
+  int stride;      // Field stride
+  int num_threads; // Worker threads, <= 0 for one per core
+  real_t time;
+  int num_steps;
+
+  // Model
+  real_t *x;       // State (12)
+  real_t *inertia; // Moment of inertia (3)
+  real_t *kr;      // Rotation drag constant
+  real_t *kt;      // Translation drag constant
+  real_t *l;       // Arm length
+  real_t *d;       // Drag
+  real_t *m;       // Mass
+  real_t *g;       // Gravitational constant
+
+  // Disturbances
+  real_t *force;  // External force in world frame [N] (3)
+  real_t *torque; // External torque in body frame [Nm] (3)
+
+  // Controllers
+  real_t *sp;         // Position and yaw setpoint (4)
+  real_t *gains;      // PID gains (MAV_BATCH_NUM_PIDS x 3)
+  real_t *error_prev; // PID previous error (MAV_BATCH_NUM_PIDS)
+  real_t *error_sum;  // PID error sum (MAV_BATCH_NUM_PIDS)
+  real_t *ctrl_dt;    // Attitude, velocity and position controller dt (3)
+  real_t *ctrl_u;     // Attitude, velocity and position controller u (3 x 4)
+
+  // Telemetry
+  int telem_every;    // Record every n-th step
+  int telem_capacity; // Max number of samples
+  int num_telem;
+  real_t *telem_time;
+  real_t *telem;
+} mav_batch_t;
+
+mav_batch_t *mav_batch_malloc(const int num_mavs,
+                              const int telem_every,
+                              const int telem_capacity);
+void mav_batch_free(mav_batch_t *batch);
+void mav_batch_set_model(mav_batch_t *batch,
+                         const int i,
+                         const mav_model_t *mav);
+void mav_batch_get_model(const mav_batch_t *batch,
+                         const int i,
+                         mav_model_t *mav);
+void mav_batch_set_ctrl(mav_batch_t *batch,
+                        const int i,
+                        const mav_att_ctrl_t *att_ctrl,
+                        const mav_vel_ctrl_t *vel_ctrl,
+                        const mav_pos_ctrl_t *pos_ctrl);
+void mav_batch_set_disturbance(mav_batch_t *batch,
+                               const int i,
+                               const real_t force[3],
+                               const real_t torque[3]);
+void mav_batch_set_setpoint(mav_batch_t *batch,
+                            const int i,
+                            const real_t sp[4]);
+void mav_batch_run(mav_batch_t *batch, const int num_steps, const real_t dt);
+const real_t *mav_batch_telem(const mav_batch_t *batch,
+                              const int s,
+                              const int k);
+
 /*******************************************************************************
  * SENSOR FUSION
  ******************************************************************************/
@@ -1631,6 +2158,14 @@ void print_camera_event(const camera_event_t *event);
 void print_imu_event(const imu_event_t *event);
 void print_fiducial_event(const fiducial_event_t *event);
 
+/**
+ * Sensor event queues for handing events from a driver thread to an
+ * estimator thread. Fiducial events carry heap arrays, ownership of those
+ * arrays passes to the consumer on pop.
+ */
+SPSC_QUEUE_TYPE(imu_event_queue, imu_event_t)
+SPSC_QUEUE_TYPE(fiducial_event_queue, fiducial_event_t)
+
 timeline_t *timeline_malloc();
 void timeline_free(timeline_t *timeline);
 timeline_t *timeline_load_data(const char *data_dir,
@@ -1738,6 +2273,9 @@ void fiducial_buffer_add(fiducial_buffer_t *buf,
 // CAMERA-PARAMETERS //
 ///////////////////////
 
+#define CAMERA_PINHOLE_RADTAN4 1
+#define CAMERA_PINHOLE_EQUI4 2
+
 typedef struct camera_params_t {
   int marginalize;
   int fix;
@@ -1746,6 +2284,7 @@ typedef struct camera_params_t {
   int resolution[2];
   char proj_model[30];
   char dist_model[30];
+  int model;
   real_t data[8];
 
   project_func_t proj_func;
@@ -1762,16 +2301,54 @@ void camera_params_setup(camera_params_t *camera,
 void camera_params_copy(const camera_params_t *src, camera_params_t *dst);
 void camera_params_fprint(const camera_params_t *cam, FILE *f);
 void camera_params_print(const camera_params_t *camera);
+int camera_model_id(const char *proj_model, const char *dist_model);
+void camera_model_project_jacobian(const int model,
+                                   const real_t *params,
+                                   const real_t p_C[3],
+                                   real_t J[2 * 3]);
+void camera_model_params_jacobian(const int model,
+                                  const real_t *params,
+                                  const real_t p_C[3],
+                                  real_t J[2 * 8]);
 void camera_project(const camera_params_t *camera,
                     const real_t p_C[3],
                     real_t z[2]);
+void camera_project_points(const camera_params_t *camera,
+                           const real_t *p_C,
+                           const int n,
+                           real_t *z);
 void camera_back_project(const camera_params_t *camera,
                          const real_t z[2],
                          real_t bearing[3]);
+void camera_back_project_points(const camera_params_t *camera,
+                                const real_t *z,
+                                const int n,
+                                real_t *bearings);
 void camera_undistort_points(const camera_params_t *camera,
                              const real_t *kps,
                              const int num_points,
                              real_t *kps_und);
+
+/**
+ * Project 3D point `p_C` to image point `z` with camera `model` and `params`,
+ * the model is resolved with a switch so the kernel is inlined at call sites.
+ */
+static inline void camera_model_project(const int model,
+                                        const real_t *params,
+                                        const real_t p_C[3],
+                                        real_t z[2]) {
+  switch (model) {
+    case CAMERA_PINHOLE_RADTAN4:
+      pinhole_radtan4_project_inline(params, p_C, z);
+      break;
+    case CAMERA_PINHOLE_EQUI4:
+      pinhole_equi4_project_inline(params, p_C, z);
+      break;
+    default:
+      FATAL("Unknown camera model [%d]!\n", model);
+  }
+}
+
 int solvepnp_camera(const camera_params_t *cam_params,
                     const real_t *img_pts,
                     const real_t *obj_pts,
@@ -1795,6 +2372,49 @@ void stereo_triangulate(const camera_params_t *cam_i,
                         real_t *points,
                         int *status);
 
+///////////
+// REMAP //
+///////////
+
+#define REMAP_FRAC_BITS 5
+#define REMAP_FRAC_SIZE (1 << REMAP_FRAC_BITS)
+
+/**
+ * Image remap table. For every destination pixel it stores the source pixel
+ * index of the top-left bilinear sample and four fixed-point bilinear weights
+ * that sum to REMAP_FRAC_SIZE^2. Pixels that map outside the source image
+ * have zero weights.
+ */
+typedef struct remap_table_t {
+  int width;
+  int height;
+  int src_width;
+  int src_height;
+  int32_t *offsets;
+  uint16_t *weights;
+} remap_table_t;
+
+remap_table_t *remap_table_malloc(const camera_params_t *cam,
+                                  const int width,
+                                  const int height,
+                                  const real_t K_new[4],
+                                  const real_t R[3 * 3]);
+remap_table_t *remap_table_undistort(const camera_params_t *cam);
+void remap_table_free(remap_table_t *table);
+void remap_image(const remap_table_t *table, const image_t *src, image_t *dst);
+void stereo_rectify(const camera_params_t *cam0,
+                    const camera_params_t *cam1,
+                    const real_t T_C0C1[4 * 4],
+                    real_t K_rect[4],
+                    real_t R0[3 * 3],
+                    real_t R1[3 * 3]);
+void remap_table_stereo_rectify(const camera_params_t *cam0,
+                                const camera_params_t *cam1,
+                                const real_t T_C0C1[4 * 4],
+                                real_t K_rect[4],
+                                remap_table_t **table0,
+                                remap_table_t **table1);
+
 //////////////
 // VELOCITY //
 //////////////
@@ -1997,6 +2617,43 @@ void param_order_add_joint(param_order_t **h, joint_t *p, int *c);
 void param_order_add_camera(param_order_t **h, camera_params_t *p, int *c);
 void param_order_add_time_delay(param_order_t **h, time_delay_t *p, int *c);
 
+//////////////////////
+// INFORMATION GAIN //
+//////////////////////
+
+/**
+ * Information gain evaluator. Keeps a factor of the marginal covariance of a
+ * block of parameters and scores candidate measurements by the entropy of
+ * that block after adding them, using the matrix determinant lemma instead of
+ * re-forming and inverting the full information matrix. Unobservable
+ * directions (e.g. gauge freedoms) are excluded from the entropy.
+ */
+typedef struct info_gain_t {
+  int size;       // Number of parameters scored
+  int rank;       // Rank of their marginal covariance
+  real_t *L;      // Covariance factor L L' (size x rank)
+  real_t entropy; // Entropy of the marginal covariance
+
+  int num_params;
+  void **params;
+  int *cols;
+} info_gain_t;
+
+info_gain_t *info_gain_malloc(param_order_t *hash,
+                              const real_t *H,
+                              const int sv_size,
+                              const int col_s,
+                              const int col_e);
+void info_gain_free(info_gain_t *ig);
+int info_gain_col(const info_gain_t *ig, const void *param);
+int info_gain_eval(const info_gain_t *ig,
+                   const real_t *J,
+                   const real_t *J_nuis,
+                   const real_t *info_nuis,
+                   const int m,
+                   const int p,
+                   real_t *entropy);
+
 ////////////
 // FACTOR //
 ////////////
@@ -2949,6 +3606,10 @@ int camchain_find(camchain_t *cc,
 // CAMERA CALIBRATION //
 ////////////////////////
 
+#ifndef CALIB_CAMERA_BATCH_SIZE
+#define CALIB_CAMERA_BATCH_SIZE 64
+#endif
+
 typedef struct calib_camera_view_t {
   timestamp_t ts;
   int view_idx;
@@ -3006,6 +3667,12 @@ calib_camera_view_t *calib_camera_view_malloc(const timestamp_t ts,
                                               extrinsic_t *cam_ext,
                                               camera_params_t *cam_params);
 void calib_camera_view_free(calib_camera_view_t *view);
+void calib_camera_view_linearize(calib_camera_view_t *view,
+                                 const int sv_size,
+                                 param_order_t *hash,
+                                 real_t *H,
+                                 real_t *g,
+                                 real_t *r);
 
 calib_camera_t *calib_camera_malloc();
 void calib_camera_free(calib_camera_t *calib);
@@ -3027,9 +3694,18 @@ void calib_camera_add_view(calib_camera_t *calib,
                            const real_t *object_points,
                            const real_t *keypoints);
 void calib_camera_marginalize(calib_camera_t *calib);
+int calib_camera_add_archive(calib_camera_t *calib,
+                             const int cam_idx,
+                             const char *archive_path);
 int calib_camera_add_data(calib_camera_t *calib,
                           const int cam_idx,
                           const char *data_path);
+#if ENABLE_APRILGRID_DETECTOR == 1
+int calib_camera_add_images(calib_camera_t *calib,
+                            const int cam_idx,
+                            const char *image_dir,
+                            aprilgrid_batch_detector_t *det);
+#endif // ENABLE_APRILGRID_DETECTOR
 void calib_camera_errors(calib_camera_t *calib,
                          real_t *reproj_rmse,
                          real_t *reproj_mean,
@@ -3222,6 +3898,13 @@ typedef struct calib_gimbal_t {
   int fix_links;
   int fix_joints;
 
+  // NBV settings: candidate grid of `nbv_parts[i]` joint angles evenly
+  // spaced over [`nbv_range[i][0]`, `nbv_range[i][1]`] for each joint, scored
+  // by `nbv_threads` threads (0 for the number of online CPUs)
+  int nbv_threads;
+  int nbv_parts[3];
+  real_t nbv_range[3][2];
+
   int num_rows;
   int num_cols;
   double tag_size;
@@ -3322,6 +4005,11 @@ int calib_gimbal_remove_view(calib_gimbal_t *calib, const int view_idx);
 calib_gimbal_t *calib_gimbal_load(const char *data_path);
 void calib_gimbal_save(const calib_gimbal_t *calib, const char *data_path);
 int calib_gimbal_validate(calib_gimbal_t *calib);
+int calib_gimbal_nbv_candidates(const calib_gimbal_t *calib, real_t **joints);
+int calib_gimbal_nbv_eval(const calib_gimbal_t *calib,
+                          const real_t *joints,
+                          const int num_candidates,
+                          real_t *entropies);
 void calib_gimbal_nbv(calib_gimbal_t *calib, real_t nbv_joints[3]);
 param_order_t *calib_gimbal_param_order(const void *data,
                                         int *sv_size,
@@ -3607,6 +4295,40 @@ void sim_create_features(const real_t origin[3],
                          const int num_features,
                          real_t *features);
 
+/** Sim Camera Frustum **/
+typedef struct sim_frustum_t {
+  real_t normals[4 * 3]; // Side plane normals in camera frame, pointing out
+  real_t slack[4];       // Side plane slack covering lens distortion
+  real_t near;           // Near plane depth
+  real_t far;            // Far plane depth, <= 0 for none
+} sim_frustum_t;
+
+void sim_frustum_setup(sim_frustum_t *frustum,
+                       const camera_params_t *cam_params,
+                       const real_t near,
+                       const real_t far);
+
+/** Sim Features Grid **/
+typedef struct sim_features_grid_t {
+  const real_t *features;
+  int num_features;
+  real_t cell_size;
+
+  int num_cells;   // Number of occupied cells
+  real_t *centers; // Cell centers (num_cells x 3)
+  int *offsets;    // Offset of each cell in `ids` (num_cells + 1)
+  int *ids;        // Feature ids grouped by cell
+} sim_features_grid_t;
+
+sim_features_grid_t *sim_features_grid_malloc(const real_t *features,
+                                              const int num_features,
+                                              const real_t cell_size);
+void sim_features_grid_free(sim_features_grid_t *grid);
+int sim_features_grid_query(const sim_features_grid_t *grid,
+                            const sim_frustum_t *frustum,
+                            const real_t T_CW[4 * 4],
+                            int *ids);
+
 /** Sim Camera Frame **/
 typedef struct sim_camera_frame_t {
   timestamp_t ts;
@@ -3676,6 +4398,84 @@ typedef struct sim_circle_camera_imu_t {
 sim_circle_camera_imu_t *sim_circle_camera_imu();
 void sim_circle_camera_imu_free(sim_circle_camera_imu_t *sim_data);
 
+////////////////
+// SIM SPLINE //
+////////////////
+
+/**
+ * Uniform cubic B-spline body trajectory. Control points are spaced `dt`
+ * seconds apart and hold position and yaw, pitch, roll (x, y, z, yaw, pitch,
+ * roll), the trajectory is defined from `ts_start` for `num_points - 3`
+ * segments.
+ */
+typedef struct sim_spline_t {
+  timestamp_t ts_start;
+  real_t dt;
+  int num_points;
+  real_t *points;
+} sim_spline_t;
+
+sim_spline_t *sim_spline_malloc(const timestamp_t ts_start,
+                                const real_t dt,
+                                const real_t *points,
+                                const int num_points);
+void sim_spline_free(sim_spline_t *spline);
+timestamp_t sim_spline_end(const sim_spline_t *spline);
+void sim_spline_eval(const sim_spline_t *spline,
+                     const timestamp_t ts,
+                     real_t pose[7],
+                     real_t v_WB[3],
+                     real_t a_WB[3],
+                     real_t w_B[3]);
+void sim_spline_imu(const sim_spline_t *spline,
+                    const timestamp_t ts,
+                    real_t acc[3],
+                    real_t gyr[3]);
+
+////////////////////
+// SIM VI DATASET //
+////////////////////
+
+/**
+ * Event callback of the visual-inertial simulator, arrays of the event are
+ * only valid during the call. Return non-zero to stop the simulation.
+ */
+typedef int (*sim_vi_event_cb_t)(void *arg, const timeline_event_t *event);
+
+/**
+ * Visual-inertial dataset simulator. An IMU at the body frame and
+ * `num_cams` cameras with extrinsics `cam_exts` (T_BC, 7 per camera) follow
+ * `spline` and observe the landmarks `features`.
+ */
+typedef struct sim_vi_t {
+  // Settings
+  real_t imu_rate;  // [Hz]
+  real_t cam_rate;  // [Hz]
+  int num_threads;  // Worker threads, <= 0 for one per core
+  int window_size;  // Camera timestamps simulated per batch
+
+  // Trajectory
+  const sim_spline_t *spline;
+
+  // Cameras
+  int num_cams;
+  const camera_params_t *cam_params;
+  const real_t *cam_exts;
+
+  // Landmarks
+  const real_t *features;
+  int num_features;
+} sim_vi_t;
+
+void sim_vi_setup(sim_vi_t *sim,
+                  const sim_spline_t *spline,
+                  const camera_params_t *cam_params,
+                  const real_t *cam_exts,
+                  const int num_cams,
+                  const real_t *features,
+                  const int num_features);
+int sim_vi_run(const sim_vi_t *sim, sim_vi_event_cb_t cb, void *arg);
+
 /////////////////////
 // SIM GIMBAL DATA //
 /////////////////////